@@ -6,6 +6,10 @@
 #include "BKEngine.h"
 #include <vector>
 #include <algorithm>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 template <class T>
 class TArray
@@ -20,16 +24,24 @@ public:
     {
         Array = Other.Array;
     }
+    TArray(TArray<T>&& Other) noexcept : Array(std::move(Other.Array))
+    {
+    }
     TArray<T>& operator=(const TArray<T>& Other)
     {
         Array = Other.Array;
         return *this;
     }
+    TArray<T>& operator=(TArray<T>&& Other) noexcept
+    {
+        Array = std::move(Other.Array);
+        return *this;
+    }
     TArray(const T* Other, int32 Length)
     {
-        for (int32 i = 0; i < Length; i++)
+        if (Other && Length > 0)
         {
-            Array.push_back(Other[i]);
+            Array.assign(Other, Other + Length);
         }
     }
     explicit TArray(T Other)
@@ -49,18 +61,17 @@ public:
     {
         Array.push_back(Item);
     }
-    void Add(const T&& Item)
+    void Add(T&& Item)
     {
-        Array.push_back(Item);
+        Array.push_back(std::move(Item));
     }
+    //Range insert; a single memmove for trivially copyable T.
     void Add(const T* Ptr, int32 Count)
     {
-        std::vector<T> NewItems;
-        for (int32 i = 0; i < Count; i++)
+        if (Ptr && Count > 0)
         {
-            NewItems.push_back(Ptr + i);
+            Array.insert(Array.end(), Ptr, Ptr + Count);
         }
-        Array.insert(Array.end(), NewItems.begin(), NewItems.end());
     }
     bool AddUnique(const T& Item)
     {
@@ -73,10 +84,19 @@ public:
     }
     void Append(const TArray<T>& Other)
     {
-        for (auto& Item : Other.Array)
+        Array.insert(Array.end(), Other.Array.begin(), Other.Array.end());
+    }
+    void Append(TArray<T>&& Other)
+    {
+        if (Array.empty())
+        {
+            Array = std::move(Other.Array);
+        }
+        else
         {
-            Add(Item);
+            Array.insert(Array.end(), std::make_move_iterator(Other.Array.begin()), std::make_move_iterator(Other.Array.end()));
         }
+        Other.Array.clear();
     }
     void AppendUnique(const TArray<T>& Other)
     {
@@ -127,31 +147,19 @@ public:
     }
     int32 FindLast(const T& Item)
     {
-        auto Ix = static_cast<int32>(Array.size() - 1);
-        for (auto ExIt = Array.end(); ExIt != Array.begin() ; --ExIt)
+        for (auto Ix = static_cast<int32>(Array.size()) - 1; Ix >= 0; Ix--)
         {
-            if (Item == *ExIt)
+            if (Item == Array[Ix])
             {
                 return Ix;
             }
-            Ix--;
         }
         return INDEX_NONE;
     }
     bool FindLast(const T& Item, int32& Index)
     {
-        Index = INDEX_NONE;
-        auto Ix = static_cast<int32>(Array.size() - 1);
-        for (auto ExIt = Array.end(); ExIt != Array.begin() ; --ExIt)
-        {
-            if (Item == *ExIt)
-            {
-                Index = Ix;
-                return true;
-            }
-            Ix--;
-        }
-        return false;
+        Index = FindLast(Item);
+        return Index != INDEX_NONE;
     }
     const T* GetData() const
     {
@@ -165,29 +173,26 @@ public:
     {
         Array.insert(Array.begin() + Index, Item);
     }
+    void Insert(T&& Item, int32 Index)
+    {
+        Array.insert(Array.begin() + Index, std::move(Item));
+    }
     void Insert(const T* Ptr, int32 Count, int32 Index)
     {
-        std::vector<T> NewItems;
-        for (int32 i = 0; i < Count; i++)
+        if (Ptr && Count > 0)
         {
-            NewItems.push_back(*(Ptr + i));
+            Array.insert(Array.begin() + Index, Ptr, Ptr + Count);
         }
-        Array.insert(Array.begin() + Index, NewItems.begin(), NewItems.end());
     }
     void Insert(const T& Item, int32 Count, int32 Index)
     {
-        std::vector<T> NewItems;
-        for (int32 i = 0; i < Count; i++)
-        {
-            NewItems.push_back(Item);
-        }
-        Array.insert(Array.begin() + Index, NewItems.begin(), NewItems.end());
+        Array.insert(Array.begin() + Index, static_cast<WSIZE__T>(Count), Item);
     }
     bool IsValidIndex(int32 Index)
     {
         return Index >= 0 && Index < Array.size();
     }
-    const T& Last()
+    typename std::vector<T>::const_reference Last() const
     {
         return Array.back();
     }
@@ -195,29 +200,30 @@ public:
     {
         return static_cast<const int32>(Array.size());
     }
-    const T& Pop()
+    //Removes and returns the last element, or T() when empty.
+    T Pop()
     {
-        if (!Array.empty())
+        if (Array.empty())
         {
-            return Array.pop_back();
+            return T();
         }
-        return nullptr;
+        T Item = std::move(Array.back());
+        Array.pop_back();
+        return Item;
     }
     void Push(const T& Item)
     {
         Array.push_back(Item);
     }
+    void Push(T&& Item)
+    {
+        Array.push_back(std::move(Item));
+    }
     int32 Remove(const T& Item)
     {
-        int32 RemovedNo = 0;
-        for (auto ExIt = Array.end(); ExIt != Array.begin() ; --ExIt)
-        {
-            if (Item == *ExIt)
-            {
-                Array.erase(ExIt);
-                RemovedNo++;
-            }
-        }
+        auto NewEnd = std::remove(Array.begin(), Array.end(), Item);
+        auto RemovedNo = static_cast<int32>(Array.end() - NewEnd);
+        Array.erase(NewEnd, Array.end());
         return RemovedNo;
     }
     void RemoveAt(int32 Index, int32 Count = 1)
@@ -228,7 +234,12 @@ public:
     {
         Array.clear();
     }
-    T operator[](int32 Index) const
+    //Reference types come from the vector so TArray<bool> keeps working through the proxy.
+    typename std::vector<T>::reference operator[](int32 Index)
+    {
+        return Array.at(Index);
+    }
+    typename std::vector<T>::const_reference operator[](int32 Index) const
     {
         return Array.at(Index);
     }
@@ -244,10 +255,15 @@ public:
     {
         Array.resize(NewNum);
     }
+    //Only reserves capacity; Num() is unchanged. Existing callers rely on this.
     void SetNumUninitialized(int32 NewNum)
     {
         Array.reserve(NewNum);
     }
+    void Reserve(int32 NewNum)
+    {
+        Array.reserve(NewNum);
+    }
     void SetNumZeroed(int32 NewNum)
     {
         auto OldSize = static_cast<int32>(Array.size());
@@ -257,10 +273,12 @@ public:
             Array[i] = (T)0;
         }
     }
+    //Constructs in place; returns the index of the new element.
     template<class... Args>
-    void Emplace(Args&&... args)
+    int32 Emplace(Args&&... args)
     {
-        Array.push_back(T(args...));
+        Array.emplace_back(std::forward<Args>(args)...);
+        return static_cast<int32>(Array.size()) - 1;
     }
     int32 AddUninitialized(int32 Count = 1)
     {
@@ -270,8 +288,7 @@ public:
     }
     void InsertUninitialized(int32 Index, int32 Count = 1)
     {
-        auto OldNum = static_cast<const int32>(Array.size());
-        Array.resize(Array.size() + Count);
+        Array.insert(Array.begin() + Index, static_cast<WSIZE__T>(Count), T());
     }
     int32 AddZeroed(int32 Count = 1)
     {
@@ -285,10 +302,10 @@ public:
 
     typedef T* iterator;
     typedef const T* const_iterator;
-    iterator begin() { return &Array[0]; }
-    const_iterator begin() const { return &Array[0]; }
-    iterator end() { return &Array[Array.size()]; }
-    const_iterator end() const { return &Array[Array.size()]; }
+    iterator begin() { return Array.data(); }
+    const_iterator begin() const { return Array.data(); }
+    iterator end() { return Array.data() + Array.size(); }
+    const_iterator end() const { return Array.data() + Array.size(); }
 };
 
 template <class T>
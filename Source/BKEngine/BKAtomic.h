@@ -0,0 +1,119 @@
+// Copyright Burak Kara, All rights reserved.
+
+#ifndef Pragma_Once_BKAtomic
+#define Pragma_Once_BKAtomic
+
+#include "BKEngine.h"
+#include <atomic>
+
+// std::atomic wrapper for counters and flags that used to sit behind their own mutex.
+// Unlike std::atomic it is copyable (copies take a snapshot), so classes holding one keep their copy semantics.
+// Arithmetic members are only available for integral T.
+template <typename T>
+class BKAtomic
+{
+
+private:
+    std::atomic<T> Value;
+
+public:
+    BKAtomic() : Value(T())
+    {
+    }
+    BKAtomic(T InitialValue) : Value(InitialValue)
+    {
+    }
+    BKAtomic(const BKAtomic& Other) : Value(Other.Load())
+    {
+    }
+    BKAtomic& operator=(const BKAtomic& Other)
+    {
+        Store(Other.Load());
+        return *this;
+    }
+    BKAtomic& operator=(T NewValue)
+    {
+        Store(NewValue);
+        return *this;
+    }
+    operator T() const
+    {
+        return Load();
+    }
+
+    T Load(std::memory_order Order = std::memory_order_seq_cst) const
+    {
+        return Value.load(Order);
+    }
+    void Store(T NewValue, std::memory_order Order = std::memory_order_seq_cst)
+    {
+        Value.store(NewValue, Order);
+    }
+    T Exchange(T NewValue, std::memory_order Order = std::memory_order_seq_cst)
+    {
+        return Value.exchange(NewValue, Order);
+    }
+    //On failure Expected receives the current value.
+    bool CompareExchange(T& Expected, T Desired, std::memory_order Order = std::memory_order_seq_cst)
+    {
+        return Value.compare_exchange_strong(Expected, Desired, Order);
+    }
+
+    //Atomically replaces the value with Function(OldValue) and returns the new value.
+    template <typename F>
+    T Update(F&& Function)
+    {
+        T OldValue = Value.load(std::memory_order_relaxed);
+        T NewValue = Function(OldValue);
+        while (!Value.compare_exchange_weak(OldValue, NewValue))
+        {
+            NewValue = Function(OldValue);
+        }
+        return NewValue;
+    }
+
+    //Return the new value.
+    T Add(T Amount, std::memory_order Order = std::memory_order_seq_cst)
+    {
+        return static_cast<T>(Value.fetch_add(Amount, Order) + Amount);
+    }
+    T Subtract(T Amount, std::memory_order Order = std::memory_order_seq_cst)
+    {
+        return static_cast<T>(Value.fetch_sub(Amount, Order) - Amount);
+    }
+    T Increment(std::memory_order Order = std::memory_order_seq_cst)
+    {
+        return Add(1, Order);
+    }
+    T Decrement(std::memory_order Order = std::memory_order_seq_cst)
+    {
+        return Subtract(1, Order);
+    }
+
+    T operator++()
+    {
+        return Increment();
+    }
+    T operator--()
+    {
+        return Decrement();
+    }
+    T operator++(int)
+    {
+        return Value.fetch_add(1);
+    }
+    T operator--(int)
+    {
+        return Value.fetch_sub(1);
+    }
+    T operator+=(T Amount)
+    {
+        return Add(Amount);
+    }
+    T operator-=(T Amount)
+    {
+        return Subtract(Amount);
+    }
+};
+
+#endif //Pragma_Once_BKAtomic
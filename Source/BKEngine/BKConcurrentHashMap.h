@@ -0,0 +1,175 @@
+// Copyright Burak Kara, All rights reserved.
+
+#ifndef Pragma_Once_BKConcurrentHashMap
+#define Pragma_Once_BKConcurrentHashMap
+
+#include "BKEngine.h"
+#include "BKFlatHashMap.h"
+#include "BKMutex.h"
+#include <atomic>
+
+#define BK_CONCURRENT_HASH_MAP_DEFAULT_SHARDS 64
+
+// Lock-striped hash map: keys are spread over ShardCount BKFlatHashMaps, each behind its own mutex,
+// so threads working on different keys rarely contend. ShardCount must be a power of two.
+// Callbacks run under the lock of the shard that holds the entry. They must not add or remove entries
+// of the same map, and must not keep the value reference after returning.
+template <typename K, typename V, uint32 ShardCount = BK_CONCURRENT_HASH_MAP_DEFAULT_SHARDS, typename Hash = BKHash<K>>
+class BKConcurrentHashMap
+{
+    static_assert(ShardCount > 0 && (ShardCount & (ShardCount - 1)) == 0, "ShardCount must be a power of two.");
+
+private:
+    //Padded rather than aligned, since owners are usually heap-allocated and C++11 new ignores extended alignment.
+    struct FShard
+    {
+        BKMutex Mutex;
+        BKFlatHashMap<K, V, Hash> Map;
+        ANSICHAR Pad[BK_CACHE_LINE_SIZE]{};
+    };
+
+    FShard Shards[ShardCount];
+    std::atomic<int32> Count;
+
+    Hash Hasher;
+
+    BKConcurrentHashMap(const BKConcurrentHashMap&);
+    BKConcurrentHashMap& operator=(const BKConcurrentHashMap&);
+
+    template <typename Q>
+    FShard& GetShard(const Q& Key)
+    {
+        //The flat map uses the low bits of its own mix; pick the shard from the high bits so the two stay independent.
+        uint64 Mixed = static_cast<uint64>(Hasher(Key)) * 0x9E3779B97F4A7C15ull;
+        return Shards[static_cast<uint32>(Mixed >> 40) & (ShardCount - 1)];
+    }
+
+public:
+    BKConcurrentHashMap() : Count(0)
+    {
+    }
+
+    //Copies the value out. Returns false if the key is not present.
+    template <typename Q>
+    bool Get(const Q& Key, V& OutValue)
+    {
+        FShard& Shard = GetShard(Key);
+        BKScopeGuard Guard(&Shard.Mutex);
+        if (const V* Found = Shard.Map.Find(Key))
+        {
+            OutValue = *Found;
+            return true;
+        }
+        return false;
+    }
+
+    template <typename Q>
+    bool Contains(const Q& Key)
+    {
+        FShard& Shard = GetShard(Key);
+        BKScopeGuard Guard(&Shard.Mutex);
+        return Shard.Map.Contains(Key);
+    }
+
+    //Does not overwrite an existing value. Returns true if the pair was added.
+    bool Put(const K& Key, const V& Value)
+    {
+        FShard& Shard = GetShard(Key);
+        BKScopeGuard Guard(&Shard.Mutex);
+        if (!Shard.Map.Add(Key, Value)) return false;
+        Count.fetch_add(1, std::memory_order_seq_cst);
+        return true;
+    }
+
+    //Looks the key up and adds a value-initialized entry if it is missing, then calls Callback(V& Value, bool bAdded)
+    //under the shard lock. If the callback returns false the entry is removed again. Returns whether the entry remains.
+    template <typename F>
+    bool FindOrInsert(const K& Key, F&& Callback)
+    {
+        FShard& Shard = GetShard(Key);
+        BKScopeGuard Guard(&Shard.Mutex);
+
+        bool bAdded = false;
+        V* Value = Shard.Map.Find(Key);
+        if (!Value)
+        {
+            Value = &Shard.Map.FindOrAdd(Key);
+            Count.fetch_add(1, std::memory_order_seq_cst);
+            bAdded = true;
+        }
+        if (Callback(*Value, bAdded)) return true;
+
+        Shard.Map.Remove(Key);
+        Count.fetch_sub(1, std::memory_order_seq_cst);
+        return false;
+    }
+
+    template <typename Q>
+    bool Remove(const Q& Key)
+    {
+        FShard& Shard = GetShard(Key);
+        BKScopeGuard Guard(&Shard.Mutex);
+        if (!Shard.Map.Remove(Key)) return false;
+        Count.fetch_sub(1, std::memory_order_seq_cst);
+        return true;
+    }
+
+    //Removes the entry only if it still holds ExpectedValue; a newer entry under the same key is left alone.
+    bool RemoveValue(const K& Key, const V& ExpectedValue)
+    {
+        FShard& Shard = GetShard(Key);
+        BKScopeGuard Guard(&Shard.Mutex);
+        const V* Found = Shard.Map.Find(Key);
+        if (!Found || !(*Found == ExpectedValue)) return false;
+        Shard.Map.Remove(Key);
+        Count.fetch_sub(1, std::memory_order_seq_cst);
+        return true;
+    }
+
+    //Visits the shards one at a time under their locks. Entries added or removed concurrently in other shards may or may not be seen.
+    template <typename F>
+    void ForEach(F&& Callback)
+    {
+        for (uint32 i = 0; i < ShardCount; i++)
+        {
+            BKScopeGuard Guard(&Shards[i].Mutex);
+            Shards[i].Map.ForEach(Callback);
+        }
+    }
+
+    //Removes every entry for which Predicate(const K&, V&) returns true. Returns the number removed.
+    template <typename F>
+    int32 RemoveIf(F&& Predicate)
+    {
+        int32 RemovedNo = 0;
+        for (uint32 i = 0; i < ShardCount; i++)
+        {
+            BKScopeGuard Guard(&Shards[i].Mutex);
+            int32 ShardRemovedNo = Shards[i].Map.RemoveIf(Predicate);
+            Count.fetch_sub(ShardRemovedNo, std::memory_order_seq_cst);
+            RemovedNo += ShardRemovedNo;
+        }
+        return RemovedNo;
+    }
+
+    void Clear()
+    {
+        for (uint32 i = 0; i < ShardCount; i++)
+        {
+            BKScopeGuard Guard(&Shards[i].Mutex);
+            Count.fetch_sub(Shards[i].Map.Num(), std::memory_order_seq_cst);
+            Shards[i].Map.Empty();
+        }
+    }
+
+    int32 Num() const
+    {
+        return Count.load(std::memory_order_seq_cst);
+    }
+    bool IsEmpty() const
+    {
+        return Num() == 0;
+    }
+};
+
+#endif //Pragma_Once_BKConcurrentHashMap
@@ -17,7 +17,16 @@ public:
 #else
         memset(&m_cond, 0, sizeof(pthread_cond_t));
 
+    #if PLATFORM_APPLE
         pthread_cond_init(&m_cond, nullptr);
+    #else
+        //Monotonic, so timed waits are not affected by wall-clock adjustments.
+        pthread_condattr_t Attr{};
+        pthread_condattr_init(&Attr);
+        pthread_condattr_setclock(&Attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&m_cond, &Attr);
+        pthread_condattr_destroy(&Attr);
+    #endif
 #endif
     }
 
@@ -36,12 +45,26 @@ public:
         WakeAllConditionVariable(&m_cond);
 #else
         pthread_cond_broadcast(&m_cond);
+#endif
+    }
+    //Wakes a single waiter.
+    void signal_one()
+    {
+#if PLATFORM_WINDOWS
+        WakeConditionVariable(&m_cond);
+#else
+        pthread_cond_signal(&m_cond);
 #endif
     }
     void wait(BKScopeGuard& guard)
     {
         guard.SleepWithCondition(&m_cond);
     }
+    //Returns false if TimeoutMs elapsed without a signal. Spurious wake-ups are possible; re-check the predicate.
+    bool wait_for(BKScopeGuard& guard, uint32 TimeoutMs)
+    {
+        return guard.SleepWithConditionFor(&m_cond, TimeoutMs);
+    }
 
 private:
 #if PLATFORM_WINDOWS
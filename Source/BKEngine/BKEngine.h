@@ -36,8 +36,29 @@
     #define PLATFORM_LINUX 0
 #endif
 
+//Set by the build when configured with BK_ENABLE_COROUTINES; needs a C++20 compiler.
+#if !defined(BK_WITH_COROUTINES)
+    #define BK_WITH_COROUTINES 0
+#elif BK_WITH_COROUTINES && !defined(__cpp_impl_coroutine)
+    #error "BK_WITH_COROUTINES requires a compiler with C++20 coroutine support."
+#endif
+
 #define INDEX_NONE (-1)
 
+#define BK_CACHE_LINE_SIZE 64
+
+//Spin-wait hint for busy loops.
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #include <intrin.h>
+    #define BK_CPU_PAUSE() _mm_pause()
+#elif defined(__x86_64__) || defined(__i386__)
+    #define BK_CPU_PAUSE() __builtin_ia32_pause()
+#elif defined(__aarch64__) || defined(__arm__)
+    #define BK_CPU_PAUSE() __asm__ __volatile__("yield")
+#else
+    #define BK_CPU_PAUSE() ((void)0)
+#endif
+
 template<typename T32BITS, typename T64BITS, int PointerSize>
 struct SelectIntPointerType
 {
@@ -0,0 +1,82 @@
+// Copyright Burak Kara, All rights reserved.
+
+#ifndef Pragma_Once_BKFastMutex
+#define Pragma_Once_BKFastMutex
+
+#include "BKEngine.h"
+#include "BKFutex.h"
+#include <atomic>
+
+#define BK_FAST_MUTEX_SPIN_COUNT 128
+
+// Non-recursive mutex for short critical sections. Uncontended lock/unlock is a single atomic operation;
+// under contention it spins briefly, then parks on a futex. Locking it twice from the same thread deadlocks.
+class BKFastMutex
+{
+
+private:
+    //0: unlocked, 1: locked, 2: locked and there may be parked waiters.
+    std::atomic<uint32> State;
+
+    BKFastMutex(const BKFastMutex&);
+    BKFastMutex& operator=(const BKFastMutex&);
+
+    void LockSlow()
+    {
+        for (int32 i = 0; i < BK_FAST_MUTEX_SPIN_COUNT; i++)
+        {
+            if (State.load(std::memory_order_relaxed) == 0 && TryLock()) return;
+            BK_CPU_PAUSE();
+        }
+        while (State.exchange(2, std::memory_order_acquire) != 0)
+        {
+            BKFutex::Wait(&State, 2);
+        }
+    }
+
+public:
+    BKFastMutex() : State(0)
+    {
+    }
+
+    bool TryLock()
+    {
+        uint32 Expected = 0;
+        return State.compare_exchange_strong(Expected, 1, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    void Lock()
+    {
+        if (!TryLock()) LockSlow();
+    }
+
+    void Unlock()
+    {
+        if (State.exchange(0, std::memory_order_release) == 2)
+        {
+            BKFutex::WakeOne(&State);
+        }
+    }
+};
+
+class BKFastScopeGuard
+{
+
+private:
+    BKFastMutex* RelativeMutex = nullptr;
+
+    BKFastScopeGuard(const BKFastScopeGuard&);
+    BKFastScopeGuard& operator=(const BKFastScopeGuard&);
+
+public:
+    explicit BKFastScopeGuard(BKFastMutex* Mutex) : RelativeMutex(Mutex)
+    {
+        if (RelativeMutex) RelativeMutex->Lock();
+    }
+    ~BKFastScopeGuard()
+    {
+        if (RelativeMutex) RelativeMutex->Unlock();
+    }
+};
+
+#endif //Pragma_Once_BKFastMutex
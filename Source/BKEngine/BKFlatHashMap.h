@@ -0,0 +1,477 @@
+// Copyright Burak Kara, All rights reserved.
+
+#ifndef Pragma_Once_BKFlatHashMap
+#define Pragma_Once_BKFlatHashMap
+
+#include "BKEngine.h"
+#include "BKString.h"
+#include <cstring>
+#include <functional>
+#include <new>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define BK_FLAT_HASH_MAP_SSE2 1
+    #include <emmintrin.h>
+#else
+    #define BK_FLAT_HASH_MAP_SSE2 0
+#endif
+
+#define BK_FLAT_HASH_MAP_GROUP_WIDTH 16
+
+//Default hasher/equality for BKFlatHashMap. FString uses the transparent versions so it can be looked up with raw wide strings.
+template <typename K>
+struct BKHash : std::hash<K>
+{
+};
+template <>
+struct BKHash<FString> : FStringHash
+{
+};
+template <typename K>
+struct BKEqualTo : std::equal_to<K>
+{
+};
+template <>
+struct BKEqualTo<FString> : FStringEqual
+{
+};
+
+// Open-addressing hash map in the SwissTable layout: one control byte per slot holding 7 bits of the hash,
+// probed 16 slots at a time (SSE2 when available). Elements never move on erase, so removing entries
+// from inside ForEach is safe; inserting during ForEach is not.
+template <typename K, typename V, typename Hash = BKHash<K>, typename KeyEqual = BKEqualTo<K>>
+class BKFlatHashMap
+{
+
+private:
+    struct FSlot
+    {
+        K Key;
+        V Value;
+
+        template <typename KeyType, typename ValueType>
+        FSlot(KeyType&& _Key, ValueType&& _Value) : Key(std::forward<KeyType>(_Key)), Value(std::forward<ValueType>(_Value))
+        {
+        }
+    };
+
+    static const int8 ControlEmpty = -128;
+    static const int8 ControlDeleted = -2;
+
+    int8* Controls = nullptr;
+    FSlot* Slots = nullptr;
+
+    //Always zero or a power of two, at least one group wide.
+    WSIZE__T Capacity = 0;
+    WSIZE__T Size = 0;
+    WSIZE__T Deleted = 0;
+
+    Hash Hasher;
+    KeyEqual Equal;
+
+    static WSIZE__T MixHash(WSIZE__T HashValue)
+    {
+        //std::hash is the identity for integers and pointers; spread the bits before splitting into H1/H2.
+        uint64 Mixed = static_cast<uint64>(HashValue) * 0x9E3779B97F4A7C15ull;
+        return static_cast<WSIZE__T>(Mixed ^ (Mixed >> 32));
+    }
+    static int8 H2(WSIZE__T MixedHash)
+    {
+        return static_cast<int8>(MixedHash & 0x7F);
+    }
+    static WSIZE__T H1(WSIZE__T MixedHash)
+    {
+        return MixedHash >> 7;
+    }
+
+    static uint32 MatchByte(const int8* Group, int8 Value)
+    {
+#if BK_FLAT_HASH_MAP_SSE2
+        __m128i Ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Group));
+        return static_cast<uint32>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(Value), Ctrl)));
+#else
+        uint32 Mask = 0;
+        for (int32 i = 0; i < BK_FLAT_HASH_MAP_GROUP_WIDTH; i++)
+        {
+            if (Group[i] == Value) Mask |= (1u << i);
+        }
+        return Mask;
+#endif
+    }
+    //Empty and deleted control bytes are the only negative ones.
+    static uint32 MatchEmptyOrDeleted(const int8* Group)
+    {
+#if BK_FLAT_HASH_MAP_SSE2
+        return static_cast<uint32>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(Group))));
+#else
+        uint32 Mask = 0;
+        for (int32 i = 0; i < BK_FLAT_HASH_MAP_GROUP_WIDTH; i++)
+        {
+            if (Group[i] < 0) Mask |= (1u << i);
+        }
+        return Mask;
+#endif
+    }
+    static int32 LowestBit(uint32 Mask)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctz(Mask);
+#else
+        int32 Index = 0;
+        while (!(Mask & 1u))
+        {
+            Mask >>= 1;
+            Index++;
+        }
+        return Index;
+#endif
+    }
+
+    WSIZE__T GroupCount() const
+    {
+        return Capacity / BK_FLAT_HASH_MAP_GROUP_WIDTH;
+    }
+
+    template <typename Q>
+    WSIZE__T FindIndex(const Q& Key) const
+    {
+        if (Size == 0) return Capacity;
+
+        WSIZE__T Mixed = MixHash(Hasher(Key));
+        int8 Tag = H2(Mixed);
+        WSIZE__T GroupMask = GroupCount() - 1;
+        WSIZE__T GroupIndex = H1(Mixed) & GroupMask;
+
+        //Triangular probing over groups visits every group once when the group count is a power of two.
+        for (WSIZE__T Step = 1; Step <= GroupCount(); Step++)
+        {
+            const int8* Group = Controls + GroupIndex * BK_FLAT_HASH_MAP_GROUP_WIDTH;
+            for (uint32 Mask = MatchByte(Group, Tag); Mask; Mask &= Mask - 1)
+            {
+                WSIZE__T Index = GroupIndex * BK_FLAT_HASH_MAP_GROUP_WIDTH + LowestBit(Mask);
+                if (Equal(Slots[Index].Key, Key)) return Index;
+            }
+            if (MatchByte(Group, ControlEmpty)) return Capacity;
+            GroupIndex = (GroupIndex + Step) & GroupMask;
+        }
+        return Capacity;
+    }
+
+    //First empty or deleted slot on the probe sequence of the hash. The table must have room.
+    WSIZE__T FindInsertIndex(WSIZE__T Mixed) const
+    {
+        WSIZE__T GroupMask = GroupCount() - 1;
+        WSIZE__T GroupIndex = H1(Mixed) & GroupMask;
+        for (WSIZE__T Step = 1; ; Step++)
+        {
+            uint32 Mask = MatchEmptyOrDeleted(Controls + GroupIndex * BK_FLAT_HASH_MAP_GROUP_WIDTH);
+            if (Mask) return GroupIndex * BK_FLAT_HASH_MAP_GROUP_WIDTH + LowestBit(Mask);
+            GroupIndex = (GroupIndex + Step) & GroupMask;
+        }
+    }
+
+    void SetControl(WSIZE__T Index, int8 Value)
+    {
+        Controls[Index] = Value;
+    }
+
+    void Allocate(WSIZE__T NewCapacity)
+    {
+        Capacity = NewCapacity;
+        Controls = static_cast<int8*>(::operator new(Capacity));
+        std::memset(Controls, ControlEmpty, Capacity);
+        Slots = static_cast<FSlot*>(::operator new(Capacity * sizeof(FSlot)));
+    }
+
+    void DestroyAll()
+    {
+        for (WSIZE__T i = 0; i < Capacity; i++)
+        {
+            if (Controls[i] >= 0)
+            {
+                Slots[i].~FSlot();
+            }
+        }
+    }
+    void Deallocate()
+    {
+        ::operator delete(Controls);
+        ::operator delete(Slots);
+        Controls = nullptr;
+        Slots = nullptr;
+        Capacity = 0;
+        Size = 0;
+        Deleted = 0;
+    }
+
+    void Rehash(WSIZE__T NewCapacity)
+    {
+        int8* OldControls = Controls;
+        FSlot* OldSlots = Slots;
+        WSIZE__T OldCapacity = Capacity;
+
+        Allocate(NewCapacity);
+        Deleted = 0;
+        for (WSIZE__T i = 0; i < OldCapacity; i++)
+        {
+            if (OldControls[i] >= 0)
+            {
+                WSIZE__T Mixed = MixHash(Hasher(OldSlots[i].Key));
+                WSIZE__T Index = FindInsertIndex(Mixed);
+                SetControl(Index, H2(Mixed));
+                new (&Slots[Index]) FSlot(std::move(OldSlots[i].Key), std::move(OldSlots[i].Value));
+                OldSlots[i].~FSlot();
+            }
+        }
+        ::operator delete(OldControls);
+        ::operator delete(OldSlots);
+    }
+
+    //Keeps the load (including tombstones) at or below 7/8.
+    void ReserveForOneMore()
+    {
+        if (Capacity == 0)
+        {
+            Allocate(BK_FLAT_HASH_MAP_GROUP_WIDTH);
+            return;
+        }
+        if ((Size + Deleted + 1) * 8 > Capacity * 7)
+        {
+            Rehash((Size + 1) * 2 * 8 > Capacity * 7 ? Capacity * 2 : Capacity);
+        }
+    }
+
+    void EraseAt(WSIZE__T Index)
+    {
+        Slots[Index].~FSlot();
+        Size--;
+
+        //A group that still has an empty slot was never full, so no probe sequence continues past it.
+        WSIZE__T GroupStart = Index & ~static_cast<WSIZE__T>(BK_FLAT_HASH_MAP_GROUP_WIDTH - 1);
+        if (MatchByte(Controls + GroupStart, ControlEmpty))
+        {
+            SetControl(Index, ControlEmpty);
+        }
+        else
+        {
+            SetControl(Index, ControlDeleted);
+            Deleted++;
+        }
+    }
+
+    template <typename KeyType, typename ValueType>
+    V* EmplaceNew(WSIZE__T Mixed, KeyType&& Key, ValueType&& Value)
+    {
+        ReserveForOneMore();
+        WSIZE__T Index = FindInsertIndex(Mixed);
+        if (Controls[Index] == ControlDeleted) Deleted--;
+        SetControl(Index, H2(Mixed));
+        new (&Slots[Index]) FSlot(std::forward<KeyType>(Key), std::forward<ValueType>(Value));
+        Size++;
+        return &Slots[Index].Value;
+    }
+
+    void CopyFrom(const BKFlatHashMap& Other)
+    {
+        if (Other.Capacity == 0) return;
+        Allocate(Other.Capacity);
+        std::memcpy(Controls, Other.Controls, Capacity);
+        for (WSIZE__T i = 0; i < Capacity; i++)
+        {
+            if (Controls[i] >= 0)
+            {
+                new (&Slots[i]) FSlot(Other.Slots[i].Key, Other.Slots[i].Value);
+            }
+        }
+        Size = Other.Size;
+        Deleted = Other.Deleted;
+    }
+
+public:
+    BKFlatHashMap() = default;
+    BKFlatHashMap(const BKFlatHashMap& Other) : Hasher(Other.Hasher), Equal(Other.Equal)
+    {
+        CopyFrom(Other);
+    }
+    BKFlatHashMap(BKFlatHashMap&& Other) noexcept : Controls(Other.Controls), Slots(Other.Slots), Capacity(Other.Capacity), Size(Other.Size), Deleted(Other.Deleted), Hasher(Other.Hasher), Equal(Other.Equal)
+    {
+        Other.Controls = nullptr;
+        Other.Slots = nullptr;
+        Other.Capacity = 0;
+        Other.Size = 0;
+        Other.Deleted = 0;
+    }
+    BKFlatHashMap& operator=(const BKFlatHashMap& Other)
+    {
+        if (this != &Other)
+        {
+            Empty();
+            Hasher = Other.Hasher;
+            Equal = Other.Equal;
+            CopyFrom(Other);
+        }
+        return *this;
+    }
+    BKFlatHashMap& operator=(BKFlatHashMap&& Other) noexcept
+    {
+        if (this != &Other)
+        {
+            Empty();
+            std::swap(Controls, Other.Controls);
+            std::swap(Slots, Other.Slots);
+            std::swap(Capacity, Other.Capacity);
+            std::swap(Size, Other.Size);
+            std::swap(Deleted, Other.Deleted);
+            Hasher = Other.Hasher;
+            Equal = Other.Equal;
+        }
+        return *this;
+    }
+    ~BKFlatHashMap()
+    {
+        Empty();
+    }
+
+    //Destroys all elements and frees the table.
+    void Empty()
+    {
+        if (Capacity == 0) return;
+        DestroyAll();
+        Deallocate();
+    }
+    //Destroys all elements but keeps the table for reuse.
+    void Reset()
+    {
+        if (Capacity == 0) return;
+        DestroyAll();
+        std::memset(Controls, ControlEmpty, Capacity);
+        Size = 0;
+        Deleted = 0;
+    }
+
+    void Reserve(int32 Count)
+    {
+        WSIZE__T NewCapacity = BK_FLAT_HASH_MAP_GROUP_WIDTH;
+        while (static_cast<WSIZE__T>(Count) * 8 > NewCapacity * 7) NewCapacity *= 2;
+        if (NewCapacity <= Capacity) return;
+
+        if (Capacity == 0)
+        {
+            Allocate(NewCapacity);
+        }
+        else
+        {
+            Rehash(NewCapacity);
+        }
+    }
+
+    int32 Num() const
+    {
+        return static_cast<int32>(Size);
+    }
+    bool IsEmpty() const
+    {
+        return Size == 0;
+    }
+
+    //Q may differ from K when the hasher and equality accept it (e.g. const UTFCHAR* for FString keys).
+    template <typename Q>
+    V* Find(const Q& Key)
+    {
+        WSIZE__T Index = FindIndex(Key);
+        return Index == Capacity ? nullptr : &Slots[Index].Value;
+    }
+    template <typename Q>
+    const V* Find(const Q& Key) const
+    {
+        WSIZE__T Index = FindIndex(Key);
+        return Index == Capacity ? nullptr : &Slots[Index].Value;
+    }
+    template <typename Q>
+    bool Contains(const Q& Key) const
+    {
+        return FindIndex(Key) != Capacity;
+    }
+
+    //Does not overwrite an existing value. Returns true if the pair was added.
+    template <typename KeyType, typename ValueType>
+    bool Add(KeyType&& Key, ValueType&& Value)
+    {
+        if (FindIndex(Key) != Capacity) return false;
+        EmplaceNew(MixHash(Hasher(Key)), std::forward<KeyType>(Key), std::forward<ValueType>(Value));
+        return true;
+    }
+
+    //Overwrites an existing value.
+    template <typename KeyType, typename ValueType>
+    V& Emplace(KeyType&& Key, ValueType&& Value)
+    {
+        WSIZE__T Index = FindIndex(Key);
+        if (Index != Capacity)
+        {
+            Slots[Index].Value = std::forward<ValueType>(Value);
+            return Slots[Index].Value;
+        }
+        return *EmplaceNew(MixHash(Hasher(Key)), std::forward<KeyType>(Key), std::forward<ValueType>(Value));
+    }
+
+    //Returns the existing value or a value-initialized one added for the key.
+    V& FindOrAdd(const K& Key)
+    {
+        WSIZE__T Index = FindIndex(Key);
+        if (Index != Capacity) return Slots[Index].Value;
+        return *EmplaceNew(MixHash(Hasher(Key)), Key, V());
+    }
+
+    template <typename Q>
+    bool Remove(const Q& Key)
+    {
+        WSIZE__T Index = FindIndex(Key);
+        if (Index == Capacity) return false;
+        EraseAt(Index);
+        return true;
+    }
+
+    //Callback(const K&, V&). Removing entries from inside the callback is allowed; adding is not.
+    template <typename F>
+    void ForEach(F&& Callback)
+    {
+        for (WSIZE__T i = 0; i < Capacity; i++)
+        {
+            if (Controls[i] >= 0)
+            {
+                Callback(static_cast<const K&>(Slots[i].Key), Slots[i].Value);
+            }
+        }
+    }
+    template <typename F>
+    void ForEach(F&& Callback) const
+    {
+        for (WSIZE__T i = 0; i < Capacity; i++)
+        {
+            if (Controls[i] >= 0)
+            {
+                Callback(static_cast<const K&>(Slots[i].Key), static_cast<const V&>(Slots[i].Value));
+            }
+        }
+    }
+
+    //Removes every entry for which Predicate(const K&, V&) returns true. Returns the number removed.
+    template <typename F>
+    int32 RemoveIf(F&& Predicate)
+    {
+        int32 RemovedNo = 0;
+        for (WSIZE__T i = 0; i < Capacity; i++)
+        {
+            if (Controls[i] >= 0 && Predicate(static_cast<const K&>(Slots[i].Key), Slots[i].Value))
+            {
+                EraseAt(i);
+                RemovedNo++;
+            }
+        }
+        return RemovedNo;
+    }
+};
+
+#endif //Pragma_Once_BKFlatHashMap
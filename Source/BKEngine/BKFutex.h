@@ -0,0 +1,78 @@
+// Copyright Burak Kara, All rights reserved.
+
+#ifndef Pragma_Once_BKFutex
+#define Pragma_Once_BKFutex
+
+#include "BKEngine.h"
+#include <atomic>
+#if PLATFORM_WINDOWS
+    #include <windows.h>
+    #if defined(_MSC_VER)
+        #pragma comment(lib, "Synchronization.lib")
+    #endif
+#elif PLATFORM_LINUX
+    #include <linux/futex.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+    #include <ctime>
+    #include <cerrno>
+#else
+    #include <thread>
+#endif
+
+static_assert(sizeof(std::atomic<uint32>) == sizeof(uint32), "std::atomic<uint32> must be address-compatible with uint32.");
+
+// Park/wake on a 32-bit word: futex on Linux, WaitOnAddress on Windows.
+// Other platforms fall back to yielding, which callers see as a spurious wake-up.
+class BKFutex
+{
+
+public:
+    //Sleeps while *Address == Expected. May return early; callers must re-check their condition.
+    //TimeoutMs < 0 waits without a deadline. Returns false only when the timeout elapsed.
+    static bool Wait(std::atomic<uint32>* Address, uint32 Expected, int32 TimeoutMs = -1)
+    {
+#if PLATFORM_WINDOWS
+        if (WaitOnAddress(Address, &Expected, sizeof(uint32), TimeoutMs < 0 ? INFINITE : static_cast<DWORD>(TimeoutMs))) return true;
+        return GetLastError() != ERROR_TIMEOUT;
+#elif PLATFORM_LINUX
+        timespec Timeout{};
+        timespec* TimeoutPtr = nullptr;
+        if (TimeoutMs >= 0)
+        {
+            Timeout.tv_sec = TimeoutMs / 1000;
+            Timeout.tv_nsec = static_cast<long>(TimeoutMs % 1000) * 1000000L;
+            TimeoutPtr = &Timeout;
+        }
+        long Result = syscall(SYS_futex, reinterpret_cast<uint32*>(Address), FUTEX_WAIT_PRIVATE, Expected, TimeoutPtr, nullptr, 0);
+        return !(Result == -1 && errno == ETIMEDOUT);
+#else
+        if (Address->load(std::memory_order_relaxed) == Expected) std::this_thread::yield();
+        return true;
+#endif
+    }
+
+    static void WakeOne(std::atomic<uint32>* Address)
+    {
+#if PLATFORM_WINDOWS
+        WakeByAddressSingle(Address);
+#elif PLATFORM_LINUX
+        syscall(SYS_futex, reinterpret_cast<uint32*>(Address), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+        (void)Address;
+#endif
+    }
+
+    static void WakeAll(std::atomic<uint32>* Address)
+    {
+#if PLATFORM_WINDOWS
+        WakeByAddressAll(Address);
+#elif PLATFORM_LINUX
+        syscall(SYS_futex, reinterpret_cast<uint32*>(Address), FUTEX_WAKE_PRIVATE, 0x7fffffff, nullptr, nullptr, 0);
+#else
+        (void)Address;
+#endif
+    }
+};
+
+#endif //Pragma_Once_BKFutex
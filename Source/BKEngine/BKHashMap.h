@@ -3,7 +3,8 @@
 #ifndef Pragma_Once_BKHashMap
 #define Pragma_Once_BKHashMap
 
-#include <unordered_map>
+#include <functional>
+#include "BKFlatHashMap.h"
 #include "BKSharedPtr.h"
 
 #define BK_HASH_MAP_TABLE_SIZE 20
@@ -30,7 +31,7 @@ private:
     V ValueMember;
 };
 
-// Hash map class template
+// Hash map class template, backed by BKFlatHashMap
 template <typename K, typename V>
 class BKHashMap
 {
@@ -44,49 +45,104 @@ public:
 
     void Clear()
     {
-        HashMap.clear();
+        HashMap.Empty();
     }
 
+    //Kept for existing callers; allocates a node per entry. Prefer ForEach or RemoveIf.
     void Iterate(std::function<void(BKSharedPtr<class BKHashNode<K, V>>)> _Callback)
     {
         TArray<BKSharedPtr<class BKHashNode<K, V>>> TmpArray;
-        for (auto& Iterator : HashMap)
+        TmpArray.SetNumUninitialized(HashMap.Num());
+        HashMap.ForEach([&TmpArray](const K& Key, V& Value)
         {
-            TmpArray.Add(BKSharedPtr<class BKHashNode<K, V>>(new BKHashNode<K, V>(Iterator.first, Iterator.second)));
-        }
+            TmpArray.Add(BKMakeShared<BKHashNode<K, V>>(Key, Value));
+        });
         for (int32 i = TmpArray.Num() - 1; i >= 0; i--)
         {
             _Callback(TmpArray[i]);
         }
     }
 
+    //Callback(const K&, V&) is called in place, without copying the entries. Entries may be removed from inside it.
+    template <typename F>
+    void ForEach(F&& _Callback)
+    {
+        HashMap.ForEach(std::forward<F>(_Callback));
+    }
+
+    //Removes every entry for which _Predicate(const K&, V&) returns true. Returns the number removed.
+    template <typename F>
+    int32 RemoveIf(F&& _Predicate)
+    {
+        return HashMap.RemoveIf(std::forward<F>(_Predicate));
+    }
+
+    //Copies the keys or values out, e.g. to process them in parallel without holding the map's lock.
+    void GenerateKeyArray(TArray<K>& OutKeys) const
+    {
+        OutKeys.Reset();
+        OutKeys.Reserve(HashMap.Num());
+        HashMap.ForEach([&OutKeys](const K& Key, const V&)
+        {
+            OutKeys.Add(Key);
+        });
+    }
+    void GenerateValueArray(TArray<V>& OutValues) const
+    {
+        OutValues.Reset();
+        OutValues.Reserve(HashMap.Num());
+        HashMap.ForEach([&OutValues](const K&, const V& Value)
+        {
+            OutValues.Add(Value);
+        });
+    }
+
     bool Get(const K &_Key, V &_Value)
     {
-        if (HashMap.find(_Key) != HashMap.end())
+        if (const V* Found = HashMap.Find(_Key))
         {
-            _Value = HashMap.at(_Key);
+            _Value = *Found;
             return true;
         }
         return false;
     }
 
+    //Returns a pointer to the stored value, or nullptr. Invalidated by the next Put.
+    template <typename Q>
+    V* Find(const Q &_Key)
+    {
+        return HashMap.Find(_Key);
+    }
+
+    template <typename Q>
+    bool Contains(const Q &_Key) const
+    {
+        return HashMap.Contains(_Key);
+    }
+
+    //Does not overwrite an existing value.
     void Put(const K &_Key, const V &_Value)
     {
-        HashMap.insert(std::make_pair(_Key, _Value));
+        HashMap.Add(_Key, _Value);
     }
 
     void Remove(const K &_Key)
     {
-        HashMap.erase(_Key);
+        HashMap.Remove(_Key);
+    }
+
+    int32 Num() const
+    {
+        return HashMap.Num();
     }
 
     bool IsEmpty()
     {
-        return HashMap.empty();
+        return HashMap.IsEmpty();
     }
 
 private:
-    std::unordered_map<K, V> HashMap;
+    BKFlatHashMap<K, V> HashMap;
 };
 
-#endif //Pragma_Once_BKHashMap
\ No newline at end of file
+#endif //Pragma_Once_BKHashMap
@@ -0,0 +1,297 @@
+// Copyright Burak Kara, All rights reserved.
+
+#ifndef Pragma_Once_BKInlineArray
+#define Pragma_Once_BKInlineArray
+
+#include "BKEngine.h"
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Array that keeps its first InlineCount elements inside the object and only touches the heap when it grows past them.
+// Meant for short-lived, usually small buffers on hot paths (packet building, per-task parameters).
+// Trivially copyable element types are moved around with memcpy.
+template <typename T, int32 InlineCount>
+class TInlineArray
+{
+    static_assert(InlineCount > 0, "InlineCount must be positive.");
+
+private:
+    typename std::aligned_storage<sizeof(T) * InlineCount, alignof(T)>::type InlineData;
+    T* Data;
+    int32 Length = 0;
+    int32 Capacity = InlineCount;
+
+    static constexpr bool bTrivial = std::is_trivially_copyable<T>::value;
+
+    T* GetInlineData() { return reinterpret_cast<T*>(&InlineData); }
+    bool IsInline() const { return Data == reinterpret_cast<const T*>(&InlineData); }
+
+    //Moves [0, Length) into NewData, destroying the originals.
+    void RelocateTo(T* NewData)
+    {
+        if (bTrivial)
+        {
+            if (Length > 0) std::memcpy(static_cast<void*>(NewData), Data, sizeof(T) * Length);
+        }
+        else
+        {
+            for (int32 i = 0; i < Length; i++)
+            {
+                new (NewData + i) T(std::move(Data[i]));
+                Data[i].~T();
+            }
+        }
+    }
+    void FreeHeap()
+    {
+        if (!IsInline())
+        {
+            ::operator delete(Data);
+            Data = GetInlineData();
+            Capacity = InlineCount;
+        }
+    }
+    void Grow(int32 MinCapacity)
+    {
+        int32 NewCapacity = Capacity + Capacity / 2;
+        if (NewCapacity < MinCapacity) NewCapacity = MinCapacity;
+
+        auto NewData = static_cast<T*>(::operator new(sizeof(T) * NewCapacity));
+        RelocateTo(NewData);
+        if (!IsInline()) ::operator delete(Data);
+        Data = NewData;
+        Capacity = NewCapacity;
+    }
+    void DestroyRange(int32 From, int32 To)
+    {
+        if (!bTrivial)
+        {
+            for (int32 i = From; i < To; i++) Data[i].~T();
+        }
+    }
+    void CopyFrom(const T* Source, int32 Count)
+    {
+        Reserve(Count);
+        if (bTrivial)
+        {
+            if (Count > 0) std::memcpy(static_cast<void*>(Data), Source, sizeof(T) * Count);
+        }
+        else
+        {
+            for (int32 i = 0; i < Count; i++) new (Data + i) T(Source[i]);
+        }
+        Length = Count;
+    }
+    void MoveFrom(TInlineArray& Other)
+    {
+        //Expects this array to be empty and inline.
+        if (Other.IsInline())
+        {
+            Other.RelocateTo(Data);
+        }
+        else
+        {
+            Data = Other.Data;
+            Capacity = Other.Capacity;
+            Other.Data = Other.GetInlineData();
+            Other.Capacity = InlineCount;
+        }
+        Length = Other.Length;
+        Other.Length = 0;
+    }
+
+public:
+    TInlineArray() : Data(GetInlineData())
+    {
+    }
+    TInlineArray(const T* Source, int32 Count) : Data(GetInlineData())
+    {
+        if (Source && Count > 0) CopyFrom(Source, Count);
+    }
+    TInlineArray(const TInlineArray& Other) : Data(GetInlineData())
+    {
+        CopyFrom(Other.Data, Other.Length);
+    }
+    TInlineArray(TInlineArray&& Other) noexcept : Data(GetInlineData())
+    {
+        MoveFrom(Other);
+    }
+    TInlineArray& operator=(const TInlineArray& Other)
+    {
+        if (this != &Other)
+        {
+            Reset();
+            CopyFrom(Other.Data, Other.Length);
+        }
+        return *this;
+    }
+    TInlineArray& operator=(TInlineArray&& Other) noexcept
+    {
+        if (this != &Other)
+        {
+            Empty();
+            MoveFrom(Other);
+        }
+        return *this;
+    }
+    ~TInlineArray()
+    {
+        Empty();
+    }
+
+    //Keeps the allocation.
+    void Reset()
+    {
+        DestroyRange(0, Length);
+        Length = 0;
+    }
+    //Releases any heap allocation.
+    void Empty()
+    {
+        Reset();
+        FreeHeap();
+    }
+    void Reserve(int32 NewCapacity)
+    {
+        if (NewCapacity > Capacity) Grow(NewCapacity);
+    }
+
+    void Add(const T& Item)
+    {
+        if (Length == Capacity)
+        {
+            //Item may live in this array; copy it before the storage moves.
+            T Copy(Item);
+            Grow(Length + 1);
+            new (Data + Length) T(std::move(Copy));
+        }
+        else
+        {
+            new (Data + Length) T(Item);
+        }
+        Length++;
+    }
+    void Add(T&& Item)
+    {
+        Emplace(std::move(Item));
+    }
+    void Add(const T* Source, int32 Count)
+    {
+        Insert(Source, Count, Length);
+    }
+    template<class... Args>
+    int32 Emplace(Args&&... args)
+    {
+        if (Length == Capacity)
+        {
+            T Item(std::forward<Args>(args)...);
+            Grow(Length + 1);
+            new (Data + Length) T(std::move(Item));
+        }
+        else
+        {
+            new (Data + Length) T(std::forward<Args>(args)...);
+        }
+        return Length++;
+    }
+    //Grows by Count default-initialized elements (left unset for trivial types) and returns the first new index.
+    int32 AddUninitialized(int32 Count = 1)
+    {
+        Reserve(Length + Count);
+        if (!bTrivial)
+        {
+            for (int32 i = Length; i < Length + Count; i++) new (Data + i) T();
+        }
+        auto OldNum = Length;
+        Length += Count;
+        return OldNum;
+    }
+    void Insert(const T* Source, int32 Count, int32 Index)
+    {
+        if (!Source || Count <= 0) return;
+        if (Source >= Data && Source < Data + Length)
+        {
+            //Inserting a slice of ourselves; take a copy first.
+            TInlineArray Copy(Source, Count);
+            Insert(Copy.GetData(), Count, Index);
+            return;
+        }
+
+        Reserve(Length + Count);
+        if (bTrivial)
+        {
+            std::memmove(static_cast<void*>(Data + Index + Count), Data + Index, sizeof(T) * (Length - Index));
+            std::memcpy(static_cast<void*>(Data + Index), Source, sizeof(T) * Count);
+        }
+        else
+        {
+            for (int32 i = Length - 1; i >= Index; i--)
+            {
+                new (Data + i + Count) T(std::move(Data[i]));
+                Data[i].~T();
+            }
+            for (int32 i = 0; i < Count; i++) new (Data + Index + i) T(Source[i]);
+        }
+        Length += Count;
+    }
+    void RemoveAt(int32 Index, int32 Count = 1)
+    {
+        if (Count <= 0) return;
+        if (bTrivial)
+        {
+            std::memmove(static_cast<void*>(Data + Index), Data + Index + Count, sizeof(T) * (Length - Index - Count));
+        }
+        else
+        {
+            for (int32 i = Index; i < Length - Count; i++) Data[i] = std::move(Data[i + Count]);
+            DestroyRange(Length - Count, Length);
+        }
+        Length -= Count;
+    }
+    //Removes and returns the last element, or T() when empty.
+    T Pop()
+    {
+        if (Length == 0) return T();
+        T Item(std::move(Data[Length - 1]));
+        DestroyRange(Length - 1, Length);
+        Length--;
+        return Item;
+    }
+    void SetNum(int32 NewNum)
+    {
+        if (NewNum < Length)
+        {
+            DestroyRange(NewNum, Length);
+            Length = NewNum;
+        }
+        else if (NewNum > Length)
+        {
+            Reserve(NewNum);
+            for (int32 i = Length; i < NewNum; i++) new (Data + i) T();
+            Length = NewNum;
+        }
+    }
+
+    int32 Num() const { return Length; }
+    int32 Max() const { return Capacity; }
+    bool IsEmpty() const { return Length == 0; }
+    bool IsValidIndex(int32 Index) const { return Index >= 0 && Index < Length; }
+
+    T* GetData() { return Data; }
+    const T* GetData() const { return Data; }
+    T* GetMutableData() { return Data; }
+
+    T& operator[](int32 Index) { return Data[Index]; }
+    const T& operator[](int32 Index) const { return Data[Index]; }
+
+    typedef T* iterator;
+    typedef const T* const_iterator;
+    iterator begin() { return Data; }
+    const_iterator begin() const { return Data; }
+    iterator end() { return Data + Length; }
+    const_iterator end() const { return Data + Length; }
+};
+
+#endif //Pragma_Once_BKInlineArray
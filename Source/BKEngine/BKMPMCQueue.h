@@ -0,0 +1,279 @@
+// Copyright Burak Kara, All rights reserved.
+
+#ifndef Pragma_Once_BKMPMCQueue
+#define Pragma_Once_BKMPMCQueue
+
+#include "BKEngine.h"
+#include "BKSafeQueue.h"
+#include <atomic>
+#include <utility>
+
+// A lock-free bounded multi-producer multi-consumer ring buffer (D. Vyukov's sequence-per-cell design).
+// Producers and consumers only contend on their own cache-line-padded position counter.
+template <class T, uint32 Capacity>
+class BKMPMCQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "BKMPMCQueue capacity must be a power of two.");
+
+private:
+    struct FCell
+    {
+        std::atomic<WSIZE__T> Sequence;
+        T Data;
+    };
+
+    static const WSIZE__T IndexMask = Capacity - 1;
+
+    ANSICHAR Pad0[BK_CACHE_LINE_SIZE]{};
+    FCell* const Cells;
+    ANSICHAR Pad1[BK_CACHE_LINE_SIZE - sizeof(FCell*)]{};
+    std::atomic<WSIZE__T> EnqueuePos;
+    ANSICHAR Pad2[BK_CACHE_LINE_SIZE - sizeof(std::atomic<WSIZE__T>)]{};
+    std::atomic<WSIZE__T> DequeuePos;
+    ANSICHAR Pad3[BK_CACHE_LINE_SIZE - sizeof(std::atomic<WSIZE__T>)]{};
+
+    BKMPMCQueue(const BKMPMCQueue&);
+    BKMPMCQueue& operator=(const BKMPMCQueue&);
+
+    //Claims a free cell for a single producer. Returns nullptr if the queue is full.
+    FCell* ClaimForPush()
+    {
+        WSIZE__T Pos = EnqueuePos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            FCell* Cell = &Cells[Pos & IndexMask];
+            WSIZE__T Sequence = Cell->Sequence.load(std::memory_order_acquire);
+            auto Diff = static_cast<WSSIZE__T>(Sequence) - static_cast<WSSIZE__T>(Pos);
+            if (Diff == 0)
+            {
+                if (EnqueuePos.compare_exchange_weak(Pos, Pos + 1, std::memory_order_relaxed))
+                {
+                    return Cell;
+                }
+            }
+            else if (Diff < 0)
+            {
+                return nullptr;
+            }
+            else
+            {
+                Pos = EnqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+public:
+    BKMPMCQueue() : Cells(new FCell[Capacity]), EnqueuePos(0), DequeuePos(0)
+    {
+        for (WSIZE__T i = 0; i < Capacity; i++)
+        {
+            Cells[i].Sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    ~BKMPMCQueue()
+    {
+        delete[] Cells;
+    }
+
+    static uint32 GetCapacity()
+    {
+        return Capacity;
+    }
+
+    bool TryPush(const T& Item)
+    {
+        FCell* Cell = ClaimForPush();
+        if (!Cell) return false;
+
+        Cell->Data = Item;
+        Cell->Sequence.store(static_cast<WSIZE__T>(Cell->Sequence.load(std::memory_order_relaxed) + 1), std::memory_order_release);
+        return true;
+    }
+    bool TryPush(T&& Item)
+    {
+        FCell* Cell = ClaimForPush();
+        if (!Cell) return false;
+
+        Cell->Data = std::move(Item);
+        Cell->Sequence.store(static_cast<WSIZE__T>(Cell->Sequence.load(std::memory_order_relaxed) + 1), std::memory_order_release);
+        return true;
+    }
+
+    bool TryPop(T& OutItem)
+    {
+        WSIZE__T Pos = DequeuePos.load(std::memory_order_relaxed);
+        FCell* Cell;
+        while (true)
+        {
+            Cell = &Cells[Pos & IndexMask];
+            WSIZE__T Sequence = Cell->Sequence.load(std::memory_order_acquire);
+            auto Diff = static_cast<WSSIZE__T>(Sequence) - static_cast<WSSIZE__T>(Pos + 1);
+            if (Diff == 0)
+            {
+                if (DequeuePos.compare_exchange_weak(Pos, Pos + 1, std::memory_order_relaxed)) break;
+            }
+            else if (Diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                Pos = DequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        OutItem = std::move(Cell->Data);
+        Cell->Sequence.store(Pos + IndexMask + 1, std::memory_order_release);
+        return true;
+    }
+
+    //Claims up to Count consecutive cells with a single CAS. Returns the number of pushed items.
+    int32 TryPushBulk(const T* Items, int32 Count)
+    {
+        if (!Items || Count <= 0) return 0;
+
+        WSIZE__T Pos = EnqueuePos.load(std::memory_order_relaxed);
+        int32 Claimed;
+        while (true)
+        {
+            Claimed = 0;
+            while (Claimed < Count && Claimed < static_cast<int32>(Capacity))
+            {
+                WSIZE__T Sequence = Cells[(Pos + Claimed) & IndexMask].Sequence.load(std::memory_order_acquire);
+                if (Sequence != Pos + Claimed) break;
+                Claimed++;
+            }
+            if (Claimed == 0)
+            {
+                WSIZE__T Sequence = Cells[Pos & IndexMask].Sequence.load(std::memory_order_acquire);
+                if (static_cast<WSSIZE__T>(Sequence) - static_cast<WSSIZE__T>(Pos) < 0) return 0;
+
+                Pos = EnqueuePos.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (EnqueuePos.compare_exchange_weak(Pos, Pos + Claimed, std::memory_order_relaxed)) break;
+        }
+
+        for (int32 i = 0; i < Claimed; i++)
+        {
+            FCell& Cell = Cells[(Pos + i) & IndexMask];
+            Cell.Data = Items[i];
+            Cell.Sequence.store(Pos + i + 1, std::memory_order_release);
+        }
+        return Claimed;
+    }
+
+    //Claims up to MaxCount consecutive filled cells with a single CAS. Returns the number of popped items.
+    int32 TryPopBulk(T* OutItems, int32 MaxCount)
+    {
+        if (!OutItems || MaxCount <= 0) return 0;
+
+        WSIZE__T Pos = DequeuePos.load(std::memory_order_relaxed);
+        int32 Claimed;
+        while (true)
+        {
+            Claimed = 0;
+            while (Claimed < MaxCount && Claimed < static_cast<int32>(Capacity))
+            {
+                WSIZE__T Sequence = Cells[(Pos + Claimed) & IndexMask].Sequence.load(std::memory_order_acquire);
+                if (Sequence != Pos + Claimed + 1) break;
+                Claimed++;
+            }
+            if (Claimed == 0)
+            {
+                WSIZE__T Sequence = Cells[Pos & IndexMask].Sequence.load(std::memory_order_acquire);
+                if (static_cast<WSSIZE__T>(Sequence) - static_cast<WSSIZE__T>(Pos + 1) < 0) return 0;
+
+                Pos = DequeuePos.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (DequeuePos.compare_exchange_weak(Pos, Pos + Claimed, std::memory_order_relaxed)) break;
+        }
+
+        for (int32 i = 0; i < Claimed; i++)
+        {
+            FCell& Cell = Cells[(Pos + i) & IndexMask];
+            OutItems[i] = std::move(Cell.Data);
+            Cell.Sequence.store(Pos + i + IndexMask + 1, std::memory_order_release);
+        }
+        return Claimed;
+    }
+
+    //Approximate while producers or consumers are active.
+    int32 Size() const
+    {
+        WSIZE__T Enqueued = EnqueuePos.load(std::memory_order_relaxed);
+        WSIZE__T Dequeued = DequeuePos.load(std::memory_order_relaxed);
+        return Enqueued > Dequeued ? static_cast<int32>(Enqueued - Dequeued) : 0;
+    }
+    bool IsEmpty() const
+    {
+        return Size() == 0;
+    }
+};
+
+// BKMPMCQueue for the fast path; items that do not fit spill over to a locked BKSafeQueue instead of being rejected.
+// FIFO order is only kept among items of the ring and among items of the spill queue.
+template <class T, uint32 Capacity>
+class BKMPMCSpillQueue
+{
+
+private:
+    BKMPMCQueue<T, Capacity> Ring;
+
+    BKSafeQueue<T> Spill;
+    std::atomic<int32> SpilledNum;
+
+public:
+    BKMPMCSpillQueue() : SpilledNum(0)
+    {
+    }
+
+    void Push(const T& Item)
+    {
+        if (!Ring.TryPush(Item))
+        {
+            Spill.Push(Item);
+            SpilledNum.fetch_add(1, std::memory_order_release);
+        }
+    }
+    void PushBulk(const T* Items, int32 Count)
+    {
+        int32 Pushed = Ring.TryPushBulk(Items, Count);
+        for (int32 i = Pushed; i < Count; i++)
+        {
+            Push(Items[i]);
+        }
+    }
+
+    bool Pop(T& OutItem)
+    {
+        if (Ring.TryPop(OutItem)) return true;
+        if (SpilledNum.load(std::memory_order_acquire) > 0 && Spill.Pop(OutItem))
+        {
+            SpilledNum.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+    int32 PopBulk(T* OutItems, int32 MaxCount)
+    {
+        int32 Popped = Ring.TryPopBulk(OutItems, MaxCount);
+        while (Popped < MaxCount && Pop(OutItems[Popped]))
+        {
+            Popped++;
+        }
+        return Popped;
+    }
+
+    int32 Size() const
+    {
+        return Ring.Size() + SpilledNum.load(std::memory_order_relaxed);
+    }
+    bool IsEmpty() const
+    {
+        return Size() == 0;
+    }
+};
+
+#endif //Pragma_Once_BKMPMCQueue
@@ -8,7 +8,10 @@
 	#include <windows.h>
 #else
     #include <pthread.h>
+    #include <cerrno>
+    #include <ctime>
 #endif
+#include <atomic>
 
 class BKMutex
 {
@@ -21,7 +24,8 @@ private:
     pthread_mutex_t MutexValue{};
 #endif
 
-    bool bLocked = false;
+    //Advisory only, used by the copy operations below. Atomic so that reading it while another thread locks is not a data race.
+    std::atomic<bool> bLocked{false};
 
     void Initialize()
     {
@@ -34,7 +38,7 @@ private:
         pthread_mutex_init(&MutexValue, &Attr);
         pthread_mutexattr_destroy(&Attr);
 #endif
-        bLocked = false;
+        bLocked.store(false, std::memory_order_relaxed);
     }
 
 
@@ -48,11 +52,11 @@ public:
     {
         Initialize();
 
-        if (_MutexValue.bLocked && !bLocked)
+        if (_MutexValue.bLocked.load(std::memory_order_relaxed) && !bLocked.load(std::memory_order_relaxed))
         {
             Lock();
         }
-        else if (!_MutexValue.bLocked && bLocked)
+        else if (!_MutexValue.bLocked.load(std::memory_order_relaxed) && bLocked.load(std::memory_order_relaxed))
         {
             Unlock();
         }
@@ -60,11 +64,11 @@ public:
 
     BKMutex& operator=(const BKMutex& _MutexValue)
     {
-        if (_MutexValue.bLocked && !bLocked)
+        if (_MutexValue.bLocked.load(std::memory_order_relaxed) && !bLocked.load(std::memory_order_relaxed))
         {
             Lock();
         }
-        else if (!_MutexValue.bLocked && bLocked)
+        else if (!_MutexValue.bLocked.load(std::memory_order_relaxed) && bLocked.load(std::memory_order_relaxed))
         {
             Unlock();
         }
@@ -96,18 +100,20 @@ public:
 
     bool Lock()
     {
-        bLocked = true;
 #if PLATFORM_WINDOWS
         EnterCriticalSection(&MutexValue);
+        bLocked.store(true, std::memory_order_relaxed);
         return true;
 #else
-        return pthread_mutex_lock(&MutexValue) == 0;
+        bool bResult = pthread_mutex_lock(&MutexValue) == 0;
+        if (bResult) bLocked.store(true, std::memory_order_relaxed);
+        return bResult;
 #endif
     }
 
     bool Unlock()
     {
-        bLocked = false;
+        bLocked.store(false, std::memory_order_relaxed);
 #if PLATFORM_WINDOWS
         LeaveCriticalSection(&MutexValue);
         return true;
@@ -175,6 +181,36 @@ public:
         SleepConditionVariableCS(Condition, RelativeMutex->Handle(), INFINITE);
 #else
         pthread_cond_wait(Condition, RelativeMutex->Handle());
+#endif
+    }
+
+    //Returns false if the timeout elapsed. On Linux the condition must use CLOCK_MONOTONIC, as BKConditionVariable does.
+#if PLATFORM_WINDOWS
+    bool SleepWithConditionFor(CONDITION_VARIABLE* Condition, uint32 TimeoutMs) volatile
+#else
+    bool SleepWithConditionFor(pthread_cond_t* Condition, uint32 TimeoutMs) volatile
+#endif
+    {
+        if (!Condition) return false;
+
+#if PLATFORM_WINDOWS
+        return SleepConditionVariableCS(Condition, RelativeMutex->Handle(), TimeoutMs) != 0;
+#elif PLATFORM_APPLE
+        timespec Relative{};
+        Relative.tv_sec = TimeoutMs / 1000;
+        Relative.tv_nsec = static_cast<long>(TimeoutMs % 1000) * 1000000L;
+        return pthread_cond_timedwait_relative_np(Condition, RelativeMutex->Handle(), &Relative) != ETIMEDOUT;
+#else
+        timespec Deadline{};
+        clock_gettime(CLOCK_MONOTONIC, &Deadline);
+        Deadline.tv_sec += TimeoutMs / 1000;
+        Deadline.tv_nsec += static_cast<long>(TimeoutMs % 1000) * 1000000L;
+        if (Deadline.tv_nsec >= 1000000000L)
+        {
+            Deadline.tv_sec++;
+            Deadline.tv_nsec -= 1000000000L;
+        }
+        return pthread_cond_timedwait(Condition, RelativeMutex->Handle(), &Deadline) != ETIMEDOUT;
 #endif
     }
 };
@@ -0,0 +1,603 @@
+// Copyright Burak Kara, All rights reserved.
+
+#ifndef Pragma_Once_BKNumberFormat
+#define Pragma_Once_BKNumberFormat
+
+#include "BKEngine.h"
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+//Enough for any int64/uint64 or double/float output, plus the terminator.
+#define BK_NUMBER_BUFFER_SIZE 32
+//Longer numbers that need strtod are copied to the heap.
+#define BK_NUMBER_PARSE_BUFFER_SIZE 128
+
+// Number <-> text conversion; only parsing very long numbers allocates. Integers are written two digits at a time
+// from a lookup table; floating point values use Grisu2 (Loitsch, "Printing Floating-Point Numbers Quickly and
+// Accurately with Integers"), which prints a digit string that always reads back to the same value. It is the
+// shortest one for the vast majority of inputs; the rest get a digit or so more, never beyond 17 significant digits.
+// All functions are templated on the character type so FString can format straight into wide chars.
+class BKNumberFormat
+{
+
+private:
+    struct FDiyFp
+    {
+        uint64 F;
+        int32 E;
+
+        FDiyFp(uint64 _F, int32 _E) : F(_F), E(_E)
+        {
+        }
+
+        FDiyFp operator-(const FDiyFp& Other) const
+        {
+            return FDiyFp(F - Other.F, E);
+        }
+        //Upper 64 bits of the 128-bit product, rounded.
+        FDiyFp operator*(const FDiyFp& Other) const
+        {
+            const uint64 M32 = 0xFFFFFFFFull;
+            uint64 A = F >> 32, B = F & M32, C = Other.F >> 32, D = Other.F & M32;
+            uint64 AC = A * C, BC = B * C, AD = A * D, BD = B * D;
+            uint64 Temp = (BD >> 32) + (AD & M32) + (BC & M32);
+            Temp += 1ull << 31;
+            return FDiyFp(AC + (AD >> 32) + (BC >> 32) + (Temp >> 32), E + Other.E + 64);
+        }
+        FDiyFp Normalize() const
+        {
+            FDiyFp Result = *this;
+            while (!(Result.F & (1ull << 63)))
+            {
+                Result.F <<= 1;
+                Result.E--;
+            }
+            return Result;
+        }
+    };
+
+    static const ANSICHAR* DigitPairs()
+    {
+        static const ANSICHAR Table[201] =
+            "00010203040506070809"
+            "10111213141516171819"
+            "20212223242526272829"
+            "30313233343536373839"
+            "40414243444546474849"
+            "50515253545556575859"
+            "60616263646566676869"
+            "70717273747576777879"
+            "80818283848586878889"
+            "90919293949596979899";
+        return Table;
+    }
+
+    //Normalized 10^(-348 + 8 * Index).
+    static FDiyFp CachedPower(int32 Exponent, int32& OutK)
+    {
+        static const uint64 PowersF[] =
+        {
+            0xfa8fd5a0081c0288ull, 0xbaaee17fa23ebf76ull, 0x8b16fb203055ac76ull, 0xcf42894a5dce35eaull,
+            0x9a6bb0aa55653b2dull, 0xe61acf033d1a45dfull, 0xab70fe17c79ac6caull, 0xff77b1fcbebcdc4full,
+            0xbe5691ef416bd60cull, 0x8dd01fad907ffc3cull, 0xd3515c2831559a83ull, 0x9d71ac8fada6c9b5ull,
+            0xea9c227723ee8bcbull, 0xaecc49914078536dull, 0x823c12795db6ce57ull, 0xc21094364dfb5637ull,
+            0x9096ea6f3848984full, 0xd77485cb25823ac7ull, 0xa086cfcd97bf97f4ull, 0xef340a98172aace5ull,
+            0xb23867fb2a35b28eull, 0x84c8d4dfd2c63f3bull, 0xc5dd44271ad3cdbaull, 0x936b9fcebb25c996ull,
+            0xdbac6c247d62a584ull, 0xa3ab66580d5fdaf6ull, 0xf3e2f893dec3f126ull, 0xb5b5ada8aaff80b8ull,
+            0x87625f056c7c4a8bull, 0xc9bcff6034c13053ull, 0x964e858c91ba2655ull, 0xdff9772470297ebdull,
+            0xa6dfbd9fb8e5b88full, 0xf8a95fcf88747d94ull, 0xb94470938fa89bcfull, 0x8a08f0f8bf0f156bull,
+            0xcdb02555653131b6ull, 0x993fe2c6d07b7facull, 0xe45c10c42a2b3b06ull, 0xaa242499697392d3ull,
+            0xfd87b5f28300ca0eull, 0xbce5086492111aebull, 0x8cbccc096f5088ccull, 0xd1b71758e219652cull,
+            0x9c40000000000000ull, 0xe8d4a51000000000ull, 0xad78ebc5ac620000ull, 0x813f3978f8940984ull,
+            0xc097ce7bc90715b3ull, 0x8f7e32ce7bea5c70ull, 0xd5d238a4abe98068ull, 0x9f4f2726179a2245ull,
+            0xed63a231d4c4fb27ull, 0xb0de65388cc8ada8ull, 0x83c7088e1aab65dbull, 0xc45d1df942711d9aull,
+            0x924d692ca61be758ull, 0xda01ee641a708deaull, 0xa26da3999aef774aull, 0xf209787bb47d6b85ull,
+            0xb454e4a179dd1877ull, 0x865b86925b9bc5c2ull, 0xc83553c5c8965d3dull, 0x952ab45cfa97a0b3ull,
+            0xde469fbd99a05fe3ull, 0xa59bc234db398c25ull, 0xf6c69a72a3989f5cull, 0xb7dcbf5354e9beceull,
+            0x88fcf317f22241e2ull, 0xcc20ce9bd35c78a5ull, 0x98165af37b2153dfull, 0xe2a0b5dc971f303aull,
+            0xa8d9d1535ce3b396ull, 0xfb9b7cd9a4a7443cull, 0xbb764c4ca7a44410ull, 0x8bab8eefb6409c1aull,
+            0xd01fef10a657842cull, 0x9b10a4e5e9913129ull, 0xe7109bfba19c0c9dull, 0xac2820d9623bf429ull,
+            0x80444b5e7aa7cf85ull, 0xbf21e44003acdd2dull, 0x8e679c2f5e44ff8full, 0xd433179d9c8cb841ull,
+            0x9e19db92b4e31ba9ull, 0xeb96bf6ebadf77d9ull, 0xaf87023b9bf0ee6bull
+        };
+        static const int16 PowersE[] =
+        {
+            -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927,
+            -901, -874, -847, -821, -794, -768, -741, -715, -688, -661, -635, -608,
+            -582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316, -289,
+            -263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30,
+            56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+            375, 402, 428, 455, 481, 508, 534, 561, 588, 614, 641, 667,
+            694, 720, 747, 774, 800, 827, 853, 880, 907, 933, 960, 986,
+            1013, 1039, 1066
+        };
+
+        double DK = (-61 - Exponent) * 0.30102999566398114 + 347;
+        auto K = static_cast<int32>(DK);
+        if (DK - K > 0.0) K++;
+
+        auto Index = static_cast<uint32>((K >> 3) + 1);
+        OutK = -(-348 + static_cast<int32>(Index << 3));
+        return FDiyFp(PowersF[Index], PowersE[Index]);
+    }
+
+    static void GrisuRound(ANSICHAR* Buffer, int32 Length, uint64 Delta, uint64 Rest, uint64 TenKappa, uint64 WpW)
+    {
+        while (Rest < WpW && Delta - Rest >= TenKappa && (Rest + TenKappa < WpW || WpW - Rest > Rest + TenKappa - WpW))
+        {
+            Buffer[Length - 1]--;
+            Rest += TenKappa;
+        }
+    }
+
+    static int32 CountDecimalDigits(uint32 Value)
+    {
+        if (Value < 10) return 1;
+        if (Value < 100) return 2;
+        if (Value < 1000) return 3;
+        if (Value < 10000) return 4;
+        if (Value < 100000) return 5;
+        if (Value < 1000000) return 6;
+        if (Value < 10000000) return 7;
+        if (Value < 100000000) return 8;
+        if (Value < 1000000000) return 9;
+        return 10;
+    }
+
+    static void DigitGen(const FDiyFp& W, const FDiyFp& Mp, uint64 Delta, ANSICHAR* Buffer, int32& Length, int32& K)
+    {
+        static const uint64 Pow10[] =
+        {
+            1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 100000000ull, 1000000000ull,
+            10000000000ull, 100000000000ull, 1000000000000ull, 10000000000000ull, 100000000000000ull,
+            1000000000000000ull, 10000000000000000ull, 100000000000000000ull, 1000000000000000000ull, 10000000000000000000ull
+        };
+
+        const FDiyFp One(1ull << -Mp.E, Mp.E);
+        const FDiyFp WpW = Mp - W;
+        auto P1 = static_cast<uint32>(Mp.F >> -One.E);
+        uint64 P2 = Mp.F & (One.F - 1);
+        int32 Kappa = CountDecimalDigits(P1);
+        Length = 0;
+
+        while (Kappa > 0)
+        {
+            auto Divisor = static_cast<uint32>(Pow10[Kappa - 1]);
+            uint32 Digit = P1 / Divisor;
+            P1 %= Divisor;
+            if (Digit || Length)
+            {
+                Buffer[Length++] = static_cast<ANSICHAR>('0' + Digit);
+            }
+            Kappa--;
+            uint64 Rest = (static_cast<uint64>(P1) << -One.E) + P2;
+            if (Rest <= Delta)
+            {
+                K += Kappa;
+                GrisuRound(Buffer, Length, Delta, Rest, Pow10[Kappa] << -One.E, WpW.F);
+                return;
+            }
+        }
+
+        for (;;)
+        {
+            P2 *= 10;
+            Delta *= 10;
+            auto Digit = static_cast<ANSICHAR>(P2 >> -One.E);
+            if (Digit || Length)
+            {
+                Buffer[Length++] = static_cast<ANSICHAR>('0' + Digit);
+            }
+            P2 &= One.F - 1;
+            Kappa--;
+            if (P2 < Delta)
+            {
+                K += Kappa;
+                int32 Index = -Kappa;
+                GrisuRound(Buffer, Length, Delta, P2, One.F, WpW.F * (Index < 20 ? Pow10[Index] : 0));
+                return;
+            }
+        }
+    }
+
+    //Near-shortest digits of a positive finite value with the given significand width (52 for double, 23 for float).
+    //Value = Buffer * 10^K.
+    static void Grisu2(uint64 Significand, int32 BiasedExponent, int32 SignificandBits, int32 ExponentBias, ANSICHAR* Buffer, int32& Length, int32& K)
+    {
+        const uint64 Hidden = 1ull << SignificandBits;
+        FDiyFp V(Significand, 1 - ExponentBias);
+        if (BiasedExponent != 0)
+        {
+            V = FDiyFp(Significand + Hidden, BiasedExponent - ExponentBias);
+        }
+
+        //Boundaries halfway to the neighbouring representable values; the lower gap is halved at a power of two.
+        FDiyFp Plus((V.F << 1) + 1, V.E - 1);
+        while (!(Plus.F & (Hidden << 1)))
+        {
+            Plus.F <<= 1;
+            Plus.E--;
+        }
+        Plus.F <<= 64 - SignificandBits - 2;
+        Plus.E -= 64 - SignificandBits - 2;
+
+        FDiyFp Minus = (V.F == Hidden) ? FDiyFp((V.F << 2) - 1, V.E - 2) : FDiyFp((V.F << 1) - 1, V.E - 1);
+        Minus.F <<= Minus.E - Plus.E;
+        Minus.E = Plus.E;
+
+        const FDiyFp CachedPowerValue = CachedPower(Plus.E, K);
+        const FDiyFp W = V.Normalize() * CachedPowerValue;
+        FDiyFp Wp = Plus * CachedPowerValue;
+        FDiyFp Wm = Minus * CachedPowerValue;
+        Wm.F++;
+        Wp.F--;
+        DigitGen(W, Wp, Wp.F - Wm.F, Buffer, Length, K);
+    }
+
+    //Lays out Length digits scaled by 10^K: plain decimal for exponents in [-6, 21), otherwise d.ddde+XX.
+    template <typename CharType>
+    static int32 WriteDecimal(const ANSICHAR* Digits, int32 Length, int32 K, CharType* Out)
+    {
+        int32 Written = 0;
+        const int32 PointPosition = Length + K;
+
+        if (Length <= PointPosition && PointPosition <= 21)
+        {
+            for (int32 i = 0; i < Length; i++) Out[Written++] = static_cast<CharType>(Digits[i]);
+            for (int32 i = Length; i < PointPosition; i++) Out[Written++] = static_cast<CharType>('0');
+        }
+        else if (0 < PointPosition && PointPosition <= 21)
+        {
+            for (int32 i = 0; i < PointPosition; i++) Out[Written++] = static_cast<CharType>(Digits[i]);
+            Out[Written++] = static_cast<CharType>('.');
+            for (int32 i = PointPosition; i < Length; i++) Out[Written++] = static_cast<CharType>(Digits[i]);
+        }
+        else if (-6 < PointPosition && PointPosition <= 0)
+        {
+            Out[Written++] = static_cast<CharType>('0');
+            Out[Written++] = static_cast<CharType>('.');
+            for (int32 i = PointPosition; i < 0; i++) Out[Written++] = static_cast<CharType>('0');
+            for (int32 i = 0; i < Length; i++) Out[Written++] = static_cast<CharType>(Digits[i]);
+        }
+        else
+        {
+            Out[Written++] = static_cast<CharType>(Digits[0]);
+            if (Length > 1)
+            {
+                Out[Written++] = static_cast<CharType>('.');
+                for (int32 i = 1; i < Length; i++) Out[Written++] = static_cast<CharType>(Digits[i]);
+            }
+            int32 Exponent = PointPosition - 1;
+            Out[Written++] = static_cast<CharType>('e');
+            Out[Written++] = static_cast<CharType>(Exponent < 0 ? '-' : '+');
+            if (Exponent < 0) Exponent = -Exponent;
+            if (Exponent >= 100)
+            {
+                Out[Written++] = static_cast<CharType>('0' + Exponent / 100);
+                Exponent %= 100;
+            }
+            Out[Written++] = static_cast<CharType>(DigitPairs()[Exponent * 2]);
+            Out[Written++] = static_cast<CharType>(DigitPairs()[Exponent * 2 + 1]);
+        }
+        return Written;
+    }
+
+    template <typename CharType>
+    static int32 WriteSpecial(bool bNegative, bool bNaN, bool bZero, CharType* Out)
+    {
+        int32 Written = 0;
+        if (bNegative && !bNaN) Out[Written++] = static_cast<CharType>('-');
+
+        const ANSICHAR* Text = bNaN ? "nan" : (bZero ? "0" : "inf");
+        while (*Text) Out[Written++] = static_cast<CharType>(*Text++);
+        Out[Written] = static_cast<CharType>('\0');
+        return Written;
+    }
+
+    template <typename CharType>
+    static bool IsSpace(CharType Character)
+    {
+        return Character == ' ' || Character == '\t' || Character == '\n' || Character == '\r' || Character == '\f' || Character == '\v';
+    }
+
+public:
+    //Writes the decimal form and a terminator; Out must hold BK_NUMBER_BUFFER_SIZE characters. Returns the length.
+    template <typename CharType>
+    static int32 FormatInteger(uint64 Value, CharType* Out)
+    {
+        ANSICHAR Temp[BK_NUMBER_BUFFER_SIZE];
+        int32 Position = BK_NUMBER_BUFFER_SIZE;
+        const ANSICHAR* Pairs = DigitPairs();
+
+        while (Value >= 100)
+        {
+            auto Pair = static_cast<uint32>(Value % 100) * 2;
+            Value /= 100;
+            Temp[--Position] = Pairs[Pair + 1];
+            Temp[--Position] = Pairs[Pair];
+        }
+        if (Value >= 10)
+        {
+            auto Pair = static_cast<uint32>(Value) * 2;
+            Temp[--Position] = Pairs[Pair + 1];
+            Temp[--Position] = Pairs[Pair];
+        }
+        else
+        {
+            Temp[--Position] = static_cast<ANSICHAR>('0' + Value);
+        }
+
+        int32 Length = BK_NUMBER_BUFFER_SIZE - Position;
+        for (int32 i = 0; i < Length; i++) Out[i] = static_cast<CharType>(Temp[Position + i]);
+        Out[Length] = static_cast<CharType>('\0');
+        return Length;
+    }
+    template <typename CharType>
+    static int32 FormatInteger(int64 Value, CharType* Out)
+    {
+        if (Value >= 0) return FormatInteger(static_cast<uint64>(Value), Out);
+
+        Out[0] = static_cast<CharType>('-');
+        //Negate in unsigned space so INT64_MIN does not overflow.
+        return 1 + FormatInteger(static_cast<uint64>(0) - static_cast<uint64>(Value), Out + 1);
+    }
+    template <typename CharType>
+    static int32 FormatInteger(int32 Value, CharType* Out)
+    {
+        return FormatInteger(static_cast<int64>(Value), Out);
+    }
+    template <typename CharType>
+    static int32 FormatInteger(uint32 Value, CharType* Out)
+    {
+        return FormatInteger(static_cast<uint64>(Value), Out);
+    }
+
+    //Shortest (see Grisu2 above) representation that reads back as the same double.
+    template <typename CharType>
+    static int32 FormatDouble(double Value, CharType* Out)
+    {
+        uint64 Bits;
+        std::memcpy(&Bits, &Value, sizeof(Bits));
+        bool bNegative = (Bits >> 63) != 0;
+        auto BiasedExponent = static_cast<int32>((Bits >> 52) & 0x7FF);
+        uint64 Significand = Bits & ((1ull << 52) - 1);
+
+        if (BiasedExponent == 0x7FF) return WriteSpecial(bNegative, Significand != 0, false, Out);
+        if (BiasedExponent == 0 && Significand == 0) return WriteSpecial(bNegative, false, true, Out);
+
+        ANSICHAR Digits[BK_NUMBER_BUFFER_SIZE];
+        int32 Length = 0, K = 0;
+        Grisu2(Significand, BiasedExponent, 52, 1075, Digits, Length, K);
+
+        int32 Written = 0;
+        if (bNegative) Out[Written++] = static_cast<CharType>('-');
+        Written += WriteDecimal(Digits, Length, K, Out + Written);
+        Out[Written] = static_cast<CharType>('\0');
+        return Written;
+    }
+    //Shortest (see Grisu2 above) representation that reads back as the same float, e.g. 0.1f prints as 0.1 rather than 0.100000001.
+    template <typename CharType>
+    static int32 FormatFloat(float Value, CharType* Out)
+    {
+        uint32 Bits;
+        std::memcpy(&Bits, &Value, sizeof(Bits));
+        bool bNegative = (Bits >> 31) != 0;
+        auto BiasedExponent = static_cast<int32>((Bits >> 23) & 0xFF);
+        uint64 Significand = Bits & ((1u << 23) - 1);
+
+        if (BiasedExponent == 0xFF) return WriteSpecial(bNegative, Significand != 0, false, Out);
+        if (BiasedExponent == 0 && Significand == 0) return WriteSpecial(bNegative, false, true, Out);
+
+        ANSICHAR Digits[BK_NUMBER_BUFFER_SIZE];
+        int32 Length = 0, K = 0;
+        Grisu2(Significand, BiasedExponent, 23, 150, Digits, Length, K);
+
+        int32 Written = 0;
+        if (bNegative) Out[Written++] = static_cast<CharType>('-');
+        Written += WriteDecimal(Digits, Length, K, Out + Written);
+        Out[Written] = static_cast<CharType>('\0');
+        return Written;
+    }
+
+    //Strict parse: optional leading whitespace and sign, then at least one digit. Stops at the first non-digit.
+    //Returns false on no digits or overflow.
+    template <typename T, typename CharType>
+    static bool ParseInteger(const CharType* Data, int32 Length, T& OutValue)
+    {
+        if (!Data) return false;
+
+        int32 Index = 0;
+        while (Index < Length && IsSpace(Data[Index])) Index++;
+
+        bool bNegative = false;
+        if (Index < Length && (Data[Index] == '-' || Data[Index] == '+'))
+        {
+            bNegative = Data[Index] == '-';
+            Index++;
+        }
+        if (bNegative && !std::numeric_limits<T>::is_signed) return false;
+
+        const uint64 Limit = bNegative ? static_cast<uint64>(std::numeric_limits<T>::max()) + 1 : static_cast<uint64>(std::numeric_limits<T>::max());
+        uint64 Magnitude = 0;
+        int32 DigitCount = 0;
+        for (; Index < Length && Data[Index] >= '0' && Data[Index] <= '9'; Index++, DigitCount++)
+        {
+            auto Digit = static_cast<uint64>(Data[Index] - '0');
+            if (Magnitude > (Limit - Digit) / 10) return false;
+            Magnitude = Magnitude * 10 + Digit;
+        }
+        if (DigitCount == 0) return false;
+
+        OutValue = bNegative ? static_cast<T>(0ull - Magnitude) : static_cast<T>(Magnitude);
+        return true;
+    }
+
+    //Lenient parse used by FString::ConvertToInteger: every character other than digits and '-' is ignored
+    //(so "1,024 bytes" reads as 1024). Returns T() when nothing parses or the value overflows.
+    template <typename T, typename CharType>
+    static T ParseIntegerLenient(const CharType* Data, int32 Length)
+    {
+        if (!Data) return T();
+
+        bool bNegative = false;
+        bool bStarted = false;
+        const uint64 Max = static_cast<uint64>(std::numeric_limits<T>::max());
+        uint64 Magnitude = 0;
+        int32 DigitCount = 0;
+        for (int32 i = 0; i < Length; i++)
+        {
+            CharType Character = Data[i];
+            if (Character == '-')
+            {
+                if (bStarted) break;
+                bStarted = true;
+                bNegative = true;
+            }
+            else if (Character >= '0' && Character <= '9')
+            {
+                bStarted = true;
+                auto Digit = static_cast<uint64>(Character - '0');
+                uint64 Limit = (bNegative && std::numeric_limits<T>::is_signed) ? Max + 1 : Max;
+                if (Magnitude > (Limit - Digit) / 10) return T();
+                Magnitude = Magnitude * 10 + Digit;
+                DigitCount++;
+            }
+        }
+        if (DigitCount == 0) return T();
+        return bNegative ? static_cast<T>(0ull - Magnitude) : static_cast<T>(Magnitude);
+    }
+
+    //Optional whitespace and sign, digits with an optional fraction and exponent. Exact for up to 15 significant digits
+    //and powers of ten up to 22; anything else is handed to strtod from a stack buffer, or a heap one for inputs of
+    //BK_NUMBER_PARSE_BUFFER_SIZE characters or more.
+    template <typename CharType>
+    static bool ParseDouble(const CharType* Data, int32 Length, double& OutValue)
+    {
+        return ParseReal(Data, Length, OutValue, 15, 22);
+    }
+    //Parses straight to float rather than rounding through double: exact for up to 7 significant digits and powers of
+    //ten up to 10, strtof otherwise.
+    template <typename CharType>
+    static bool ParseFloat(const CharType* Data, int32 Length, float& OutValue)
+    {
+        return ParseReal(Data, Length, OutValue, 7, 10);
+    }
+
+private:
+    static void StringToReal(const ANSICHAR* Narrow, double& OutValue)
+    {
+        OutValue = std::strtod(Narrow, nullptr);
+    }
+    static void StringToReal(const ANSICHAR* Narrow, float& OutValue)
+    {
+        OutValue = std::strtof(Narrow, nullptr);
+    }
+
+    //Mantissas of up to MaxExactDigits digits and powers of ten up to MaxExactPow10 are exact in RealType, so one
+    //multiplication or division rounds correctly.
+    template <typename CharType, typename RealType>
+    static bool ParseReal(const CharType* Data, int32 Length, RealType& OutValue, int32 MaxExactDigits, int32 MaxExactPow10)
+    {
+        static const double ExactPow10[] =
+        {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+        if (!Data) return false;
+
+        int32 Index = 0;
+        while (Index < Length && IsSpace(Data[Index])) Index++;
+        const int32 Start = Index;
+
+        bool bNegative = false;
+        if (Index < Length && (Data[Index] == '-' || Data[Index] == '+'))
+        {
+            bNegative = Data[Index] == '-';
+            Index++;
+        }
+
+        uint64 Mantissa = 0;
+        int32 SignificantDigits = 0;
+        int32 DigitCount = 0;
+        int32 DecimalExponent = 0;
+        for (; Index < Length && Data[Index] >= '0' && Data[Index] <= '9'; Index++, DigitCount++)
+        {
+            if (Mantissa == 0 && Data[Index] == '0') continue;
+            if (SignificantDigits < 19)
+            {
+                Mantissa = Mantissa * 10 + static_cast<uint64>(Data[Index] - '0');
+            }
+            else
+            {
+                DecimalExponent++;
+            }
+            SignificantDigits++;
+        }
+        if (Index < Length && Data[Index] == '.')
+        {
+            Index++;
+            for (; Index < Length && Data[Index] >= '0' && Data[Index] <= '9'; Index++, DigitCount++)
+            {
+                if (Mantissa == 0 && Data[Index] == '0')
+                {
+                    DecimalExponent--;
+                    continue;
+                }
+                if (SignificantDigits < 19)
+                {
+                    Mantissa = Mantissa * 10 + static_cast<uint64>(Data[Index] - '0');
+                    DecimalExponent--;
+                }
+                SignificantDigits++;
+            }
+        }
+        if (DigitCount == 0) return false;
+
+        if (Index < Length && (Data[Index] == 'e' || Data[Index] == 'E'))
+        {
+            int32 ExponentIndex = Index + 1;
+            bool bNegativeExponent = false;
+            if (ExponentIndex < Length && (Data[ExponentIndex] == '-' || Data[ExponentIndex] == '+'))
+            {
+                bNegativeExponent = Data[ExponentIndex] == '-';
+                ExponentIndex++;
+            }
+            if (ExponentIndex < Length && Data[ExponentIndex] >= '0' && Data[ExponentIndex] <= '9')
+            {
+                int32 Exponent = 0;
+                for (; ExponentIndex < Length && Data[ExponentIndex] >= '0' && Data[ExponentIndex] <= '9'; ExponentIndex++)
+                {
+                    if (Exponent < 100000) Exponent = Exponent * 10 + (Data[ExponentIndex] - '0');
+                }
+                DecimalExponent += bNegativeExponent ? -Exponent : Exponent;
+                Index = ExponentIndex;
+            }
+        }
+
+        if (Mantissa == 0)
+        {
+            OutValue = static_cast<RealType>(bNegative ? -0.0 : 0.0);
+            return true;
+        }
+        if (SignificantDigits <= MaxExactDigits && DecimalExponent >= -MaxExactPow10 && DecimalExponent <= MaxExactPow10)
+        {
+            auto Value = static_cast<RealType>(Mantissa);
+            auto Scale = static_cast<RealType>(ExactPow10[DecimalExponent < 0 ? -DecimalExponent : DecimalExponent]);
+            Value = DecimalExponent < 0 ? Value / Scale : Value * Scale;
+            OutValue = bNegative ? -Value : Value;
+            return true;
+        }
+
+        ANSICHAR StackNarrow[BK_NUMBER_PARSE_BUFFER_SIZE];
+        int32 NarrowLength = Index - Start;
+        ANSICHAR* Narrow = NarrowLength < BK_NUMBER_PARSE_BUFFER_SIZE ? StackNarrow : new ANSICHAR[NarrowLength + 1];
+        for (int32 i = 0; i < NarrowLength; i++) Narrow[i] = static_cast<ANSICHAR>(Data[Start + i]);
+        Narrow[NarrowLength] = '\0';
+        StringToReal(Narrow, OutValue);
+        if (Narrow != StackNarrow) delete[] Narrow;
+        return true;
+    }
+};
+
+#endif //Pragma_Once_BKNumberFormat
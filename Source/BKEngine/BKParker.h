@@ -0,0 +1,129 @@
+// Copyright Burak Kara, All rights reserved.
+
+#ifndef Pragma_Once_BKParker
+#define Pragma_Once_BKParker
+
+#include "BKEngine.h"
+#include "BKFutex.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// How a thread waits for work before it is put to sleep. Spinning burns a core but reacts within nanoseconds;
+// parking costs a wake-up syscall on the producer side and a few microseconds of scheduler latency.
+struct FBKIdleStrategy
+{
+    //Busy-spin with a pause hint for this long.
+    uint32 SpinMicroseconds = 0;
+    //Then yield the core for this long.
+    uint32 YieldMicroseconds = 0;
+    //Then park on a futex until woken.
+
+    FBKIdleStrategy() = default;
+    FBKIdleStrategy(uint32 _SpinMicroseconds, uint32 _YieldMicroseconds) : SpinMicroseconds(_SpinMicroseconds), YieldMicroseconds(_YieldMicroseconds)
+    {
+    }
+
+    //Parks immediately; no CPU is spent while idle.
+    static FBKIdleStrategy Blocking() { return FBKIdleStrategy(); }
+    //Short spin to absorb bursts, then park.
+    static FBKIdleStrategy Balanced() { return FBKIdleStrategy(20, 30); }
+    //For dedicated cores: stays hot through typical inter-packet gaps.
+    static FBKIdleStrategy LowLatency() { return FBKIdleStrategy(200, 800); }
+};
+
+// Single-consumer wake-up permit (like a binary semaphore). Unpark makes the next Park return, or lets the current one return.
+// Only the owning thread may Park; any thread may Unpark. Unpark skips the wake-up syscall unless the owner is actually asleep.
+class BKParker
+{
+
+private:
+    //0: no permit, 1: permit available, 2: owner asleep in the futex.
+    std::atomic<uint32> State;
+
+    BKParker(const BKParker&);
+    BKParker& operator=(const BKParker&);
+
+    bool TryConsume()
+    {
+        uint32 Expected = 1;
+        return State.compare_exchange_strong(Expected, 0, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+public:
+    BKParker() : State(0)
+    {
+    }
+
+    void Unpark()
+    {
+        if (State.exchange(1, std::memory_order_release) == 2)
+        {
+            BKFutex::WakeOne(&State);
+        }
+    }
+
+    //Returns true when a permit was consumed, false if TimeoutMs (when >= 0) elapsed first.
+    bool Park(const FBKIdleStrategy& Strategy = FBKIdleStrategy(), int32 TimeoutMs = -1)
+    {
+        if (TryConsume()) return true;
+
+        typedef std::chrono::steady_clock FClock;
+        FClock::time_point Start = FClock::now();
+
+        if (Strategy.SpinMicroseconds > 0 || Strategy.YieldMicroseconds > 0)
+        {
+            const auto SpinUntil = Start + std::chrono::microseconds(Strategy.SpinMicroseconds);
+            const auto YieldUntil = SpinUntil + std::chrono::microseconds(Strategy.YieldMicroseconds);
+            uint32 Iteration = 0;
+            while (true)
+            {
+                if (State.load(std::memory_order_relaxed) == 1 && TryConsume()) return true;
+
+                //Reading the clock costs more than a pause; sample it every few rounds.
+                if ((++Iteration & 63) != 0)
+                {
+                    BK_CPU_PAUSE();
+                    continue;
+                }
+                FClock::time_point Now = FClock::now();
+                if (Now >= YieldUntil) break;
+                if (Now >= SpinUntil) std::this_thread::yield();
+            }
+        }
+
+        uint32 Expected = 0;
+        if (!State.compare_exchange_strong(Expected, 2, std::memory_order_acquire, std::memory_order_acquire))
+        {
+            //Permit arrived meanwhile.
+            State.store(0, std::memory_order_relaxed);
+            return true;
+        }
+        while (true)
+        {
+            int32 RemainingMs = -1;
+            if (TimeoutMs >= 0)
+            {
+                auto ElapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(FClock::now() - Start).count();
+                RemainingMs = ElapsedMs >= TimeoutMs ? 0 : static_cast<int32>(TimeoutMs - ElapsedMs);
+            }
+            if (RemainingMs != 0) BKFutex::Wait(&State, 2, RemainingMs);
+
+            if (State.load(std::memory_order_acquire) == 1)
+            {
+                State.store(0, std::memory_order_relaxed);
+                return true;
+            }
+            if (RemainingMs == 0)
+            {
+                //Leave the sleeping state; an Unpark that raced in still counts as a wake-up.
+                Expected = 2;
+                if (State.compare_exchange_strong(Expected, 0, std::memory_order_acquire, std::memory_order_acquire)) return false;
+                State.store(0, std::memory_order_relaxed);
+                return true;
+            }
+        }
+    }
+};
+
+#endif //Pragma_Once_BKParker
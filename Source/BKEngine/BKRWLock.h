@@ -0,0 +1,138 @@
+// Copyright Burak Kara, All rights reserved.
+
+#ifndef Pragma_Once_BKRWLock
+#define Pragma_Once_BKRWLock
+
+#include "BKEngine.h"
+#if PLATFORM_WINDOWS
+    #include <windows.h>
+#else
+    #include <pthread.h>
+#endif
+
+// Reader-writer lock for read-mostly data. Not recursive; a thread must not take it again in either mode while holding it.
+// On glibc waiting writers block new readers, so a steady stream of readers cannot starve them.
+class BKRWLock
+{
+
+private:
+#if PLATFORM_WINDOWS
+    SRWLOCK LockValue = SRWLOCK_INIT;
+#else
+    pthread_rwlock_t LockValue{};
+#endif
+
+    BKRWLock(const BKRWLock&);
+    BKRWLock& operator=(const BKRWLock&);
+
+public:
+    BKRWLock()
+    {
+#if !PLATFORM_WINDOWS
+        pthread_rwlockattr_t Attr{};
+        pthread_rwlockattr_init(&Attr);
+    #if defined(__GLIBC__)
+        pthread_rwlockattr_setkind_np(&Attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    #endif
+        pthread_rwlock_init(&LockValue, &Attr);
+        pthread_rwlockattr_destroy(&Attr);
+#endif
+    }
+    ~BKRWLock()
+    {
+#if !PLATFORM_WINDOWS
+        pthread_rwlock_destroy(&LockValue);
+#endif
+    }
+
+    void ReadLock()
+    {
+#if PLATFORM_WINDOWS
+        AcquireSRWLockShared(&LockValue);
+#else
+        pthread_rwlock_rdlock(&LockValue);
+#endif
+    }
+    void ReadUnlock()
+    {
+#if PLATFORM_WINDOWS
+        ReleaseSRWLockShared(&LockValue);
+#else
+        pthread_rwlock_unlock(&LockValue);
+#endif
+    }
+    void WriteLock()
+    {
+#if PLATFORM_WINDOWS
+        AcquireSRWLockExclusive(&LockValue);
+#else
+        pthread_rwlock_wrlock(&LockValue);
+#endif
+    }
+    void WriteUnlock()
+    {
+#if PLATFORM_WINDOWS
+        ReleaseSRWLockExclusive(&LockValue);
+#else
+        pthread_rwlock_unlock(&LockValue);
+#endif
+    }
+    bool TryReadLock()
+    {
+#if PLATFORM_WINDOWS
+        return TryAcquireSRWLockShared(&LockValue) != 0;
+#else
+        return pthread_rwlock_tryrdlock(&LockValue) == 0;
+#endif
+    }
+    bool TryWriteLock()
+    {
+#if PLATFORM_WINDOWS
+        return TryAcquireSRWLockExclusive(&LockValue) != 0;
+#else
+        return pthread_rwlock_trywrlock(&LockValue) == 0;
+#endif
+    }
+};
+
+class BKReadScopeGuard
+{
+
+private:
+    BKRWLock* RelativeLock = nullptr;
+
+    BKReadScopeGuard(const BKReadScopeGuard&);
+    BKReadScopeGuard& operator=(const BKReadScopeGuard&);
+
+public:
+    explicit BKReadScopeGuard(BKRWLock* Lock) : RelativeLock(Lock)
+    {
+        if (RelativeLock) RelativeLock->ReadLock();
+    }
+    ~BKReadScopeGuard()
+    {
+        if (RelativeLock) RelativeLock->ReadUnlock();
+    }
+};
+
+class BKWriteScopeGuard
+{
+
+private:
+    BKRWLock* RelativeLock = nullptr;
+
+    BKWriteScopeGuard(const BKWriteScopeGuard&);
+    BKWriteScopeGuard& operator=(const BKWriteScopeGuard&);
+
+public:
+    explicit BKWriteScopeGuard(BKRWLock* Lock) : RelativeLock(Lock)
+    {
+        if (RelativeLock) RelativeLock->WriteLock();
+    }
+    ~BKWriteScopeGuard()
+    {
+        if (RelativeLock) RelativeLock->WriteUnlock();
+    }
+};
+
+#endif //Pragma_Once_BKRWLock
@@ -4,7 +4,7 @@
 #define Pragma_Once_BKReferenceCounter
 
 #include "BKEngine.h"
-#include "BKMutex.h"
+#include "BKAtomic.h"
 
 class BKReferenceCountable
 {
@@ -12,8 +12,7 @@ class BKReferenceCountable
 private:
     friend class BKReferenceCounter_Internal;
 
-    int32 ReferenceCounter = 0;
-    BKMutex ReferenceCounter_Mutex;
+    BKAtomic<int32> ReferenceCounter{0};
 
 protected:
     BKReferenceCountable() = default;
@@ -21,7 +20,7 @@ protected:
 public:
     bool IsReferenced()
     {
-        return ReferenceCounter > 0;
+        return ReferenceCounter.Load() > 0;
     }
 };
 
@@ -38,17 +37,14 @@ public:
         if (_CountableObject)
         {
             CountableObject = _CountableObject;
-
-            BKScopeGuard ReferenceCounter_Guard(&CountableObject->ReferenceCounter_Mutex);
-            CountableObject->ReferenceCounter++;
+            CountableObject->ReferenceCounter.Increment();
         }
     }
     ~BKReferenceCounter_Internal()
     {
         if (CountableObject)
         {
-            BKScopeGuard ReferenceCounter_Guard(&CountableObject->ReferenceCounter_Mutex);
-            CountableObject->ReferenceCounter--;
+            CountableObject->ReferenceCounter.Decrement();
         }
     }
 };
@@ -3,25 +3,90 @@
 #ifndef Pragma_Once_BKSharedPtr
 #define Pragma_Once_BKSharedPtr
 
+#include "BKEngine.h"
+#include <atomic>
+#include <new>
+#include <type_traits>
+#include <utility>
+
 class BKSharedPtr_ReferenceCounter
 {
 private:
-    int Count;
+    std::atomic<int32> Count;
 
     void AddRef()
     {
-        Count++;
+        Count.fetch_add(1, std::memory_order_relaxed);
     }
 
-    int Release()
+    int32 Release()
     {
-        return --Count;
+        return Count.fetch_sub(1, std::memory_order_acq_rel) - 1;
     }
 
     template<class T>
     friend class BKSharedPtr;
 
-    BKSharedPtr_ReferenceCounter() = default;
+protected:
+    BKSharedPtr_ReferenceCounter() : Count(1)
+    {
+    }
+
+    //Destroys the managed object; the counter itself is freed afterwards by its destructor.
+    virtual void DestroyObject() = 0;
+
+public:
+    virtual ~BKSharedPtr_ReferenceCounter() = default;
+
+    int32 GetCount() const
+    {
+        return Count.load(std::memory_order_relaxed);
+    }
+};
+
+//Counter for objects allocated separately, e.g. BKSharedPtr<T>(new T).
+template <typename T>
+class BKSharedPtr_PointerReferenceCounter : public BKSharedPtr_ReferenceCounter
+{
+private:
+    T* Pointer;
+
+protected:
+    void DestroyObject() override
+    {
+        delete Pointer;
+    }
+
+public:
+    explicit BKSharedPtr_PointerReferenceCounter(T* _Pointer) : Pointer(_Pointer)
+    {
+    }
+};
+
+//Counter with the object stored right after it, created by BKMakeShared in a single allocation.
+template <typename T>
+class BKSharedPtr_InlineReferenceCounter : public BKSharedPtr_ReferenceCounter
+{
+private:
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type Storage;
+
+protected:
+    void DestroyObject() override
+    {
+        GetObject()->~T();
+    }
+
+public:
+    template <typename... Args>
+    explicit BKSharedPtr_InlineReferenceCounter(Args&&... Arguments)
+    {
+        new (&Storage) T(std::forward<Args>(Arguments)...);
+    }
+
+    T* GetObject()
+    {
+        return reinterpret_cast<T*>(&Storage);
+    }
 };
 
 template <typename T>
@@ -29,72 +94,258 @@ class BKSharedPtr
 {
 private:
     T* Pointer;
+
+    //Null for empty pointers; no allocation is made for them.
     BKSharedPtr_ReferenceCounter* ReferenceCounter;
 
+    BKSharedPtr(T* _PointerValue, BKSharedPtr_ReferenceCounter* _ReferenceCounter) : Pointer(_PointerValue), ReferenceCounter(_ReferenceCounter)
+    {
+    }
+
+    void ReleaseReference()
+    {
+        if (ReferenceCounter && ReferenceCounter->Release() == 0)
+        {
+            ReferenceCounter->DestroyObject();
+            delete ReferenceCounter;
+        }
+        Pointer = nullptr;
+        ReferenceCounter = nullptr;
+    }
+
+    template <typename U, typename... Args>
+    friend BKSharedPtr<U> BKMakeShared(Args&&... Arguments);
+
 public:
     BKSharedPtr() : Pointer(nullptr), ReferenceCounter(nullptr)
     {
-        ReferenceCounter = new BKSharedPtr_ReferenceCounter();
-        ReferenceCounter->AddRef();
     }
 
     BKSharedPtr(T* _PointerValue) : Pointer(_PointerValue), ReferenceCounter(nullptr)
     {
-        ReferenceCounter = new BKSharedPtr_ReferenceCounter();
-        ReferenceCounter->AddRef();
+        if (Pointer)
+        {
+            ReferenceCounter = new BKSharedPtr_PointerReferenceCounter<T>(Pointer);
+        }
     }
 
     BKSharedPtr(const BKSharedPtr<T>& _OtherSharedPtr) : Pointer(_OtherSharedPtr.Pointer), ReferenceCounter(_OtherSharedPtr.ReferenceCounter)
     {
         // Copy constructor
-        ReferenceCounter->AddRef();
+        if (ReferenceCounter)
+        {
+            ReferenceCounter->AddRef();
+        }
+    }
+
+    BKSharedPtr(BKSharedPtr<T>&& _OtherSharedPtr) noexcept : Pointer(_OtherSharedPtr.Pointer), ReferenceCounter(_OtherSharedPtr.ReferenceCounter)
+    {
+        // Move constructor
+        _OtherSharedPtr.Pointer = nullptr;
+        _OtherSharedPtr.ReferenceCounter = nullptr;
     }
 
     ~BKSharedPtr()
     {
-        if(ReferenceCounter->Release() == 0)
-        {
-            delete Pointer;
-            delete ReferenceCounter;
-        }
+        ReleaseReference();
     }
 
-    T& operator* ()
+    T& operator* () const
     {
         return *Pointer;
     }
 
-    T* operator-> ()
+    T* operator-> () const
+    {
+        return Pointer;
+    }
+
+    T* Get() const
     {
         return Pointer;
     }
 
-    bool IsValid()
+    bool IsValid() const
     {
         return Pointer != nullptr;
     }
 
+    int32 GetSharedReferenceCount() const
+    {
+        return ReferenceCounter ? ReferenceCounter->GetCount() : 0;
+    }
+
+    void Reset()
+    {
+        ReleaseReference();
+    }
+
     BKSharedPtr<T>& operator = (const BKSharedPtr<T>& _OtherSharedPtr)
     {
         // Assignment operator
         if (this != &_OtherSharedPtr) // Avoid self assignment
         {
-            // Decrement the old reference count
-            // if reference become zero delete the old data
-            if(ReferenceCounter->Release() == 0)
+            // Read and reference the other pointer first; releasing ours may destroy the object that holds it
+            T* NewPointer = _OtherSharedPtr.Pointer;
+            BKSharedPtr_ReferenceCounter* NewReferenceCounter = _OtherSharedPtr.ReferenceCounter;
+            if (NewReferenceCounter)
             {
-                delete Pointer;
-                delete ReferenceCounter;
+                NewReferenceCounter->AddRef();
             }
+            ReleaseReference();
 
-            // Copy the data and reference pointer
-            // and increment the reference count
-            Pointer = _OtherSharedPtr.Pointer;
-            ReferenceCounter = _OtherSharedPtr.ReferenceCounter;
-            ReferenceCounter->AddRef();
+            Pointer = NewPointer;
+            ReferenceCounter = NewReferenceCounter;
+        }
+        return *this;
+    }
+
+    BKSharedPtr<T>& operator = (BKSharedPtr<T>&& _OtherSharedPtr) noexcept
+    {
+        // Move assignment operator
+        if (this != &_OtherSharedPtr)
+        {
+            // Detach the other pointer before releasing ours, which may destroy the object that holds it
+            T* NewPointer = _OtherSharedPtr.Pointer;
+            BKSharedPtr_ReferenceCounter* NewReferenceCounter = _OtherSharedPtr.ReferenceCounter;
+            _OtherSharedPtr.Pointer = nullptr;
+            _OtherSharedPtr.ReferenceCounter = nullptr;
+            ReleaseReference();
+
+            Pointer = NewPointer;
+            ReferenceCounter = NewReferenceCounter;
         }
         return *this;
     }
 };
 
+//Allocates the object and its reference counter together.
+template <typename T, typename... Args>
+BKSharedPtr<T> BKMakeShared(Args&&... Arguments)
+{
+    auto Counter = new BKSharedPtr_InlineReferenceCounter<T>(std::forward<Args>(Arguments)...);
+    return BKSharedPtr<T>(Counter->GetObject(), Counter);
+}
+
+//Base for objects that carry their own reference count; used with BKIntrusivePtr.
+class BKIntrusiveRefCounted
+{
+private:
+    mutable std::atomic<int32> IntrusiveReferenceCount;
+
+    template<class T>
+    friend class BKIntrusivePtr;
+
+protected:
+    BKIntrusiveRefCounted() : IntrusiveReferenceCount(0)
+    {
+    }
+    BKIntrusiveRefCounted(const BKIntrusiveRefCounted&) : IntrusiveReferenceCount(0)
+    {
+    }
+    BKIntrusiveRefCounted& operator=(const BKIntrusiveRefCounted&)
+    {
+        return *this;
+    }
+    ~BKIntrusiveRefCounted() = default;
+
+public:
+    int32 GetIntrusiveReferenceCount() const
+    {
+        return IntrusiveReferenceCount.load(std::memory_order_relaxed);
+    }
+};
+
+//Shared pointer without a separate counter: T must derive from BKIntrusiveRefCounted and is deleted with the last reference.
+template <typename T>
+class BKIntrusivePtr
+{
+private:
+    T* Pointer;
+
+    void AddReference()
+    {
+        if (Pointer)
+        {
+            Pointer->IntrusiveReferenceCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    void ReleaseReference()
+    {
+        if (Pointer && Pointer->IntrusiveReferenceCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            delete Pointer;
+        }
+        Pointer = nullptr;
+    }
+
+public:
+    BKIntrusivePtr() : Pointer(nullptr)
+    {
+    }
+    BKIntrusivePtr(T* _PointerValue) : Pointer(_PointerValue)
+    {
+        AddReference();
+    }
+    BKIntrusivePtr(const BKIntrusivePtr<T>& _OtherPtr) : Pointer(_OtherPtr.Pointer)
+    {
+        AddReference();
+    }
+    BKIntrusivePtr(BKIntrusivePtr<T>&& _OtherPtr) noexcept : Pointer(_OtherPtr.Pointer)
+    {
+        _OtherPtr.Pointer = nullptr;
+    }
+    ~BKIntrusivePtr()
+    {
+        ReleaseReference();
+    }
+
+    BKIntrusivePtr<T>& operator = (const BKIntrusivePtr<T>& _OtherPtr)
+    {
+        if (this != &_OtherPtr)
+        {
+            T* NewPointer = _OtherPtr.Pointer;
+            if (NewPointer)
+            {
+                NewPointer->IntrusiveReferenceCount.fetch_add(1, std::memory_order_relaxed);
+            }
+            ReleaseReference();
+            Pointer = NewPointer;
+        }
+        return *this;
+    }
+    BKIntrusivePtr<T>& operator = (BKIntrusivePtr<T>&& _OtherPtr) noexcept
+    {
+        if (this != &_OtherPtr)
+        {
+            T* NewPointer = _OtherPtr.Pointer;
+            _OtherPtr.Pointer = nullptr;
+            ReleaseReference();
+            Pointer = NewPointer;
+        }
+        return *this;
+    }
+
+    T& operator* () const
+    {
+        return *Pointer;
+    }
+    T* operator-> () const
+    {
+        return Pointer;
+    }
+    T* Get() const
+    {
+        return Pointer;
+    }
+    bool IsValid() const
+    {
+        return Pointer != nullptr;
+    }
+    void Reset()
+    {
+        ReleaseReference();
+    }
+};
+
 #endif //Pragma_Once_BKSharedPtr
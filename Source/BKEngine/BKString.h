@@ -5,6 +5,7 @@
 
 #include "BKEngine.h"
 #include "BKArray.h"
+#include "BKNumberFormat.h"
 #include <string>
 #include <cstdarg>
 #include <regex>
@@ -44,13 +45,23 @@ class FString
 private:
     std::wstring DataWide;
 
+    static std::wstring StringToWString(const ANSICHAR* Chars, int32 Length)
+    {
+        //Widens byte by byte; like the stream conversion this replaced, stops at the first null.
+        if (Length < 0) Length = static_cast<int32>(strlen(Chars));
+
+        std::wstring Converted;
+        Converted.reserve(static_cast<WSIZE__T>(Length));
+        for (int32 i = 0; i < Length && Chars[i] != '\0'; i++)
+        {
+            Converted += static_cast<UTFCHAR>(static_cast<uint8>(Chars[i]));
+        }
+        return Converted;
+    }
     static std::wstring StringToWString(const std::string& t_str, int32 Length)
     {
         if (Length == -1) Length = t_str.size();
-
-        std::wstringstream Converter;
-        Converter << (Length == t_str.size() ? t_str : t_str.substr(0, Length)).c_str();
-        return Converter.str();
+        return StringToWString(t_str.data(), Length);
     }
     static std::string WStringToString(const std::wstring& _str, int32 Length)
     {
@@ -76,82 +87,64 @@ public:
     {
         if (Data)
         {
-            std::string AsString;
-            std::stringstream StringBuilder;
-
-            auto Length = static_cast<int32>(strlen(Data));
-            for (int32 i = 0; i < Length; i++)
-            {
-                if (isdigit(Data[i]) || Data[i] == '-')
-                {
-                    StringBuilder << Data[i];
-                }
-            }
-            AsString = StringBuilder.str();
-            if (AsString.empty())
-            {
-                return T();
-            }
-
-            T Val;
-            std::istringstream ISS(AsString);
-            ISS >> std::dec >> Val;
-
-            if (ISS.fail())
-            {
-                return T();
-            }
-            return Val;
+            return BKNumberFormat::ParseIntegerLenient<T>(Data, static_cast<int32>(strlen(Data)));
         }
         return T();
     }
     template <typename T>
     static T ConvertToInteger(const FString &Input)
     {
-        std::string NormalString = WStringToString(Input.DataWide, Input.Len());
-        return ConvertToInteger<T>(NormalString.c_str());
+        return BKNumberFormat::ParseIntegerLenient<T>(Input.DataWide.data(), Input.Len());
     }
 
-    #define FromNumeric_Define( CastTo ) \
-        std::wstringstream Stream; \
-        Stream << (CastTo)Num; \
-        return FString(Stream.str());
+    #define FromInteger_Define( CastTo ) \
+        UTFCHAR Buffer[BK_NUMBER_BUFFER_SIZE]; \
+        int32 Length = BKNumberFormat::FormatInteger(static_cast<CastTo>(Num), Buffer); \
+        return FString(Buffer, static_cast<uint32>(Length));
 
     static FString FromInt(int8 Num)
     {
-        FromNumeric_Define(int8);
+        FromInteger_Define(int32);
     }
     static FString FromInt(int16 Num)
     {
-        FromNumeric_Define(int16);
+        FromInteger_Define(int32);
     }
     static FString FromInt(int32 Num)
     {
-        FromNumeric_Define(int32);
+        FromInteger_Define(int32);
     }
     static FString FromInt(int64 Num)
     {
-        FromNumeric_Define(int64);
+        FromInteger_Define(int64);
     }
     static FString FromInt(uint8 Num)
     {
-        FromNumeric_Define(int16);
+        FromInteger_Define(uint32);
     }
     static FString FromInt(uint16 Num)
     {
-        FromNumeric_Define(int32);
+        FromInteger_Define(uint32);
     }
     static FString FromInt(uint32 Num)
     {
-        FromNumeric_Define(int64);
+        FromInteger_Define(uint32);
+    }
+    static FString FromInt(uint64 Num)
+    {
+        FromInteger_Define(uint64);
     }
     static FString FromFloat(float Num)
     {
-        FromNumeric_Define(float);
+        UTFCHAR Buffer[BK_NUMBER_BUFFER_SIZE];
+        int32 Length = BKNumberFormat::FormatFloat(Num, Buffer);
+        return FString(Buffer, static_cast<uint32>(Length));
     }
     static FString FromFloat(double Num)
     {
-        FromNumeric_Define(double);
+        UTFCHAR Buffer[BK_NUMBER_BUFFER_SIZE];
+        int32 Length = BKNumberFormat::FormatDouble(Num, Buffer);
+        return FString(Buffer, static_cast<uint32>(Length));
     }
 
     int32 Len() const
@@ -207,8 +200,7 @@ public:
     FString(int32 InCount, const ANSICHAR* InSrc)
     {
         Initialize();
-        std::string Narrow = std::string(InSrc, InCount);
-        DataWide = StringToWString(Narrow, -1);
+        DataWide = StringToWString(InSrc, InCount);
     }
     FString(uint32 InCount, const UTFCHAR InSrc)
     {
@@ -228,8 +220,7 @@ public:
     FString(const ANSICHAR* Other, uint32 Size)
     {
         Initialize();
-        std::string Narrow = std::string(Other, Size);
-        DataWide = StringToWString(Narrow, -1);
+        DataWide = StringToWString(Other, static_cast<int32>(Size));
     }
     FString& operator=(const FString& Other)
     {
@@ -365,8 +356,7 @@ public:
     }
     FString& Append(const ANSICHAR* Text, int32 Count)
     {
-        std::wstring AsUTFString = StringToWString(Text, Count);
-        DataWide = DataWide.append(AsUTFString.c_str(), Count);
+        DataWide.append(StringToWString(Text, Count));
         return *this;
     }
     FString& Append(const FString& Text)
@@ -876,13 +866,60 @@ inline FString operator+ (const FString& Left, const FString& Right)
     return NewString;
 }
 
+//FNV-1a over whole code units; hashes the string in place instead of copying it into a std::wstring first.
+inline size_t BKHashWideChars(const UTFCHAR* Data, WSIZE__T Length)
+{
+    uint64 Hash = 14695981039346656037ull;
+    for (WSIZE__T i = 0; i < Length; i++)
+    {
+        Hash = (Hash ^ static_cast<uint64>(Data[i])) * 1099511628211ull;
+    }
+    return static_cast<size_t>(Hash);
+}
+
+//Transparent hash and equality: FString keys can be looked up with const UTFCHAR* or std::wstring without building an FString.
+struct FStringHash
+{
+    typedef void is_transparent;
+
+    size_t operator()(const FString& Value) const
+    {
+        return BKHashWideChars(Value.GetWideCharArray(), static_cast<WSIZE__T>(Value.Len()));
+    }
+    size_t operator()(const UTFCHAR* Value) const
+    {
+        return BKHashWideChars(Value, wcslen(Value));
+    }
+    size_t operator()(const std::wstring& Value) const
+    {
+        return BKHashWideChars(Value.data(), Value.length());
+    }
+};
+struct FStringEqual
+{
+    typedef void is_transparent;
+
+    bool operator()(const FString& Left, const FString& Right) const
+    {
+        return Left == Right;
+    }
+    bool operator()(const FString& Left, const UTFCHAR* Right) const
+    {
+        return wcscmp(Left.GetWideCharArray(), Right) == 0;
+    }
+    bool operator()(const FString& Left, const std::wstring& Right) const
+    {
+        return static_cast<WSIZE__T>(Left.Len()) == Right.length() && wmemcmp(Left.GetWideCharArray(), Right.data(), Right.length()) == 0;
+    }
+};
+
 namespace std
 {
     template <> struct hash<FString>
     {
         size_t operator()(const FString & c) const
         {
-            return std::hash<std::wstring>()(c.GetWideCharString());
+            return FStringHash()(c);
         }
     };
 }
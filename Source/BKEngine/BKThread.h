@@ -7,6 +7,7 @@
 #include "BKUtilities.h"
 #include "BKString.h"
 #include <functional>
+#include <thread>
 #if PLATFORM_WINDOWS
     #include <windows.h>
 #else
@@ -18,6 +19,104 @@
 typedef std::function<void()> WThreadRunCallback;
 typedef std::function<uint32()> WThreadStopCallback;
 
+#define BK_THREAD_DEFAULT_STACK_SIZE 1048576
+
+enum class EBKThreadPolicy : uint8
+{
+    //Normal time-sharing scheduling. On Windows the thread runs at THREAD_PRIORITY_HIGHEST, as before.
+    Default,
+    //SCHED_FIFO / THREAD_PRIORITY_TIME_CRITICAL. Needs CAP_SYS_NICE on Linux; falls back to Default if refused.
+    RealTimeFIFO,
+    //SCHED_RR / THREAD_PRIORITY_TIME_CRITICAL.
+    RealTimeRoundRobin,
+    //SCHED_BATCH / THREAD_PRIORITY_BELOW_NORMAL, for throughput work that should yield to latency-sensitive threads.
+    Background
+};
+
+struct FBKThreadOptions
+{
+    //Shown in top -H, perf and debuggers. Linux keeps the first 15 characters.
+    FString Name;
+
+    uint32 StackSize = BK_THREAD_DEFAULT_STACK_SIZE;
+
+    //Bit i allows logical CPU i; 0 leaves placement to the OS. Only the first 64 CPUs can be addressed. Ignored on Mac.
+    uint64 AffinityMask = 0;
+
+    EBKThreadPolicy Policy = EBKThreadPolicy::Default;
+
+    //Real-time priority; 0 picks the policy's maximum. Clamped to the valid range.
+    int32 Priority = 0;
+
+    FBKThreadOptions() = default;
+    explicit FBKThreadOptions(const FString& _Name, uint64 _AffinityMask = 0) : Name(_Name), AffinityMask(_AffinityMask)
+    {
+    }
+};
+
+// Which CPUs the framework's threads may use. Listener threads are the UDP/HTTP receive loops; workers are the async task workers.
+// A zero mask leaves placement to the OS.
+struct FBKCoreLayout
+{
+    uint64 ListenerAffinityMask = 0;
+    uint64 WorkerAffinityMask = 0;
+
+    //If set, worker i is pinned to the i-th allowed CPU of WorkerAffinityMask (wrapping) instead of floating over all of them.
+    bool bPinEachWorker = false;
+
+    //Listeners on the first ListenerCoreNo cores, each worker pinned to one of the remaining cores.
+    static FBKCoreLayout SplitListenersAndWorkers(int32 ListenerCoreNo = 1)
+    {
+        FBKCoreLayout Layout;
+        int32 CoreNo = ClampCoreCount(static_cast<int32>(std::thread::hardware_concurrency()));
+        if (ListenerCoreNo <= 0 || ListenerCoreNo >= CoreNo) return Layout;
+
+        for (int32 i = 0; i < CoreNo; i++)
+        {
+            if (i < ListenerCoreNo) Layout.ListenerAffinityMask |= (uint64)1 << i;
+            else Layout.WorkerAffinityMask |= (uint64)1 << i;
+        }
+        Layout.bPinEachWorker = true;
+        return Layout;
+    }
+
+    //Mask that a worker with the given index should use.
+    uint64 GetWorkerAffinityMask(int32 WorkerIndex) const
+    {
+        if (!bPinEachWorker || WorkerAffinityMask == 0) return WorkerAffinityMask;
+        return GetNthAllowedCore(WorkerAffinityMask, WorkerIndex);
+    }
+
+    //Mask for one of ListenerNo listeners sharing ListenerAffinityMask; with several, each gets its own core (wrapping).
+    uint64 GetListenerAffinityMask(int32 ListenerIndex, int32 ListenerNo) const
+    {
+        if (ListenerNo <= 1 || ListenerAffinityMask == 0) return ListenerAffinityMask;
+        return GetNthAllowedCore(ListenerAffinityMask, ListenerIndex);
+    }
+
+private:
+    static int32 ClampCoreCount(int32 Reported)
+    {
+        if (Reported <= 0) return 1;
+        return Reported > 64 ? 64 : Reported;
+    }
+
+    static uint64 GetNthAllowedCore(uint64 Mask, int32 Index)
+    {
+        int32 AllowedNo = 0;
+        for (int32 i = 0; i < 64; i++)
+        {
+            if (Mask & ((uint64)1 << i)) AllowedNo++;
+        }
+        int32 Wanted = Index % AllowedNo;
+        for (int32 i = 0; i < 64; i++)
+        {
+            if ((Mask & ((uint64)1 << i)) && Wanted-- == 0) return (uint64)1 << i;
+        }
+        return Mask;
+    }
+};
+
 class BKThread
 {
 
@@ -36,6 +135,9 @@ private:
         auto wThread = static_cast<BKThread*>(pVoid);
         if (wThread)
         {
+            if (wThread->Options.Name.Len() > 0) SetCurrentThreadName(wThread->Options.Name);
+            if (wThread->Options.AffinityMask != 0) SetCurrentThreadAffinity(wThread->Options.AffinityMask);
+
             if (wThread->RunCallback)
             {
                 wThread->bThreadJoinable = true;
@@ -91,34 +193,72 @@ private:
     WThreadRunCallback RunCallback;
     WThreadStopCallback StopCallback;
 
-    bool bThreadJoinable = false;
+    FBKThreadOptions Options;
 
-public:
-    explicit BKThread(WThreadRunCallback _RunCallback, WThreadStopCallback _StopCallback)
-    {
-        RunCallback = std::move(_RunCallback);
-        StopCallback = std::move(_StopCallback);
+    bool bThreadJoinable = false;
 
 #if PLATFORM_WINDOWS
+    void CreateWithOptions()
+    {
         DWORD threadID;
-        hThread = CreateThread(nullptr, 1048576, &BKThread::Run, this, STACK_SIZE_PARAM_IS_A_RESERVATION, &threadID);
+        hThread = CreateThread(nullptr, Options.StackSize, &BKThread::Run, this, STACK_SIZE_PARAM_IS_A_RESERVATION, &threadID);
         if (hThread)
         {
-            SetThreadPriority(hThread, THREAD_PRIORITY_HIGHEST);
+            int32 WindowsPriority = THREAD_PRIORITY_HIGHEST;
+            if (Options.Policy == EBKThreadPolicy::RealTimeFIFO || Options.Policy == EBKThreadPolicy::RealTimeRoundRobin) WindowsPriority = THREAD_PRIORITY_TIME_CRITICAL;
+            else if (Options.Policy == EBKThreadPolicy::Background) WindowsPriority = THREAD_PRIORITY_BELOW_NORMAL;
+            SetThreadPriority(hThread, WindowsPriority);
         }
+    }
 #else
+    bool CreateWithOptions(bool bApplyPolicy)
+    {
         pthread_attr_t hThreadAttribute{};
-        pthread_attr_init (&hThreadAttribute);
+        pthread_attr_init(&hThreadAttribute);
+        pthread_attr_setstacksize(&hThreadAttribute, Options.StackSize);
 
-        sched_param hScheduleParameter{};
-        pthread_attr_getschedparam (&hThreadAttribute, &hScheduleParameter);
-        hScheduleParameter.sched_priority = sched_get_priority_max(SCHED_FIFO);
-        pthread_attr_setschedparam (&hThreadAttribute, &hScheduleParameter);
+        if (bApplyPolicy && Options.Policy != EBKThreadPolicy::Default)
+        {
+            int32 PosixPolicy = SCHED_OTHER;
+            if (Options.Policy == EBKThreadPolicy::RealTimeFIFO) PosixPolicy = SCHED_FIFO;
+            else if (Options.Policy == EBKThreadPolicy::RealTimeRoundRobin) PosixPolicy = SCHED_RR;
+    #if defined(SCHED_BATCH)
+            else if (Options.Policy == EBKThreadPolicy::Background) PosixPolicy = SCHED_BATCH;
+    #endif
 
-		pthread_attr_setstacksize(&hThreadAttribute, 1048576);
+            //Without PTHREAD_EXPLICIT_SCHED the creator's policy is inherited and the attribute is silently ignored.
+            pthread_attr_setinheritsched(&hThreadAttribute, PTHREAD_EXPLICIT_SCHED);
+            pthread_attr_setschedpolicy(&hThreadAttribute, PosixPolicy);
 
-        pthread_create(&hThread, &hThreadAttribute, &BKThread::Run, this);
+            sched_param hScheduleParameter{};
+            int32 MinPriority = sched_get_priority_min(PosixPolicy);
+            int32 MaxPriority = sched_get_priority_max(PosixPolicy);
+            int32 Priority = Options.Priority > 0 ? Options.Priority : MaxPriority;
+            hScheduleParameter.sched_priority = Priority < MinPriority ? MinPriority : (Priority > MaxPriority ? MaxPriority : Priority);
+            pthread_attr_setschedparam(&hThreadAttribute, &hScheduleParameter);
+        }
+
+        int32 Result = pthread_create(&hThread, &hThreadAttribute, &BKThread::Run, this);
         pthread_attr_destroy(&hThreadAttribute);
+        return Result == 0;
+    }
+#endif
+
+public:
+    explicit BKThread(WThreadRunCallback _RunCallback, WThreadStopCallback _StopCallback, const FBKThreadOptions& _Options = FBKThreadOptions())
+    {
+        RunCallback = std::move(_RunCallback);
+        StopCallback = std::move(_StopCallback);
+        Options = _Options;
+
+#if PLATFORM_WINDOWS
+        CreateWithOptions();
+#else
+        if (!CreateWithOptions(true) && Options.Policy != EBKThreadPolicy::Default)
+        {
+            BKUtilities::Print(EBKLogType::Warning, FString(L"BKThread: Requested scheduling policy was refused, starting with the default policy: ") + Options.Name);
+            CreateWithOptions(false);
+        }
 #endif
     }
 
@@ -137,6 +277,48 @@ public:
 #endif
     }
 
+    //Linux keeps the first 15 characters.
+    static void SetCurrentThreadName(const FString& Name)
+    {
+#if PLATFORM_WINDOWS
+        SetThreadDescription(GetCurrentThread(), *Name);
+#elif PLATFORM_MAC
+        pthread_setname_np(Name.GetAnsiCharArray().c_str());
+#else
+        std::string AsAnsi = Name.GetAnsiCharArray();
+        if (AsAnsi.size() > 15) AsAnsi.resize(15);
+        pthread_setname_np(pthread_self(), AsAnsi.c_str());
+#endif
+    }
+
+    //Bit i allows logical CPU i. Returns false if the OS refused the mask or pinning is unsupported (Mac).
+    static bool SetCurrentThreadAffinity(uint64 AffinityMask)
+    {
+        if (AffinityMask == 0) return false;
+#if PLATFORM_WINDOWS
+        return SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(AffinityMask)) != 0;
+#elif PLATFORM_LINUX
+        cpu_set_t CPUSet;
+        CPU_ZERO(&CPUSet);
+        for (int32 i = 0; i < 64; i++)
+        {
+            if (AffinityMask & ((uint64)1 << i)) CPU_SET(i, &CPUSet);
+        }
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &CPUSet) == 0) return true;
+
+        BKUtilities::Print(EBKLogType::Warning, FString(L"BKThread: Could not set thread affinity."));
+        return false;
+#else
+        return false;
+#endif
+    }
+
+    static int32 GetNumberOfCores()
+    {
+        auto CoreNo = static_cast<int32>(std::thread::hardware_concurrency());
+        return CoreNo > 0 ? CoreNo : 1;
+    }
+
     static void SleepThread(uint32 DurationMs)
     {
 #if PLATFORM_WINDOWS
@@ -0,0 +1,427 @@
+// Copyright Burak Kara, All rights reserved.
+
+#ifndef Pragma_Once_BKUtf8String
+#define Pragma_Once_BKUtf8String
+
+#include "BKEngine.h"
+#include "BKString.h"
+#include <cstring>
+#include <functional>
+
+//Strings up to this many bytes (excluding the terminator) are stored without a heap allocation.
+#define BK_UTF8_STRING_INLINE_CAPACITY 23
+
+// UTF-8 byte string with small-string optimization. Meant for wire data: the bytes can be handed to
+// send() or filled by recv() as they are, without the wide-char round trip FString needs.
+// Always null-terminated; Len() is in bytes.
+class FUtf8String
+{
+
+private:
+    ANSICHAR* Data;
+    int32 Length = 0;
+    int32 Capacity = BK_UTF8_STRING_INLINE_CAPACITY;
+    ANSICHAR InlineData[BK_UTF8_STRING_INLINE_CAPACITY + 1];
+
+    bool IsInline() const
+    {
+        return Data == InlineData;
+    }
+
+    void Grow(int32 MinCapacity)
+    {
+        if (MinCapacity <= Capacity) return;
+
+        int32 NewCapacity = Capacity * 2;
+        if (NewCapacity < MinCapacity) NewCapacity = MinCapacity;
+
+        auto NewData = new ANSICHAR[NewCapacity + 1];
+        std::memcpy(NewData, Data, static_cast<size_t>(Length) + 1);
+        if (!IsInline())
+        {
+            delete[] Data;
+        }
+        Data = NewData;
+        Capacity = NewCapacity;
+    }
+
+    void MoveFrom(FUtf8String& Other)
+    {
+        if (Other.IsInline())
+        {
+            Data = InlineData;
+            Capacity = BK_UTF8_STRING_INLINE_CAPACITY;
+            std::memcpy(InlineData, Other.InlineData, static_cast<size_t>(Other.Length) + 1);
+        }
+        else
+        {
+            Data = Other.Data;
+            Capacity = Other.Capacity;
+            Other.Data = Other.InlineData;
+            Other.Capacity = BK_UTF8_STRING_INLINE_CAPACITY;
+        }
+        Length = Other.Length;
+        Other.Length = 0;
+        Other.InlineData[0] = '\0';
+    }
+
+    void AppendCodePoint(uint32 CodePoint)
+    {
+        Grow(Length + 4);
+        auto Out = reinterpret_cast<uint8*>(Data + Length);
+        if (CodePoint < 0x80)
+        {
+            Out[0] = static_cast<uint8>(CodePoint);
+            Length += 1;
+        }
+        else if (CodePoint < 0x800)
+        {
+            Out[0] = static_cast<uint8>(0xC0 | (CodePoint >> 6));
+            Out[1] = static_cast<uint8>(0x80 | (CodePoint & 0x3F));
+            Length += 2;
+        }
+        else if (CodePoint < 0x10000)
+        {
+            Out[0] = static_cast<uint8>(0xE0 | (CodePoint >> 12));
+            Out[1] = static_cast<uint8>(0x80 | ((CodePoint >> 6) & 0x3F));
+            Out[2] = static_cast<uint8>(0x80 | (CodePoint & 0x3F));
+            Length += 3;
+        }
+        else
+        {
+            Out[0] = static_cast<uint8>(0xF0 | (CodePoint >> 18));
+            Out[1] = static_cast<uint8>(0x80 | ((CodePoint >> 12) & 0x3F));
+            Out[2] = static_cast<uint8>(0x80 | ((CodePoint >> 6) & 0x3F));
+            Out[3] = static_cast<uint8>(0x80 | (CodePoint & 0x3F));
+            Length += 4;
+        }
+        Data[Length] = '\0';
+    }
+
+    //Decodes one sequence at Index. Malformed bytes decode as themselves (Latin-1), which is what FString's narrow constructors produce.
+    uint32 DecodeCodePoint(int32& Index) const
+    {
+        auto In = reinterpret_cast<const uint8*>(Data);
+        uint32 Lead = In[Index];
+
+        int32 Count = 0;
+        uint32 CodePoint = 0;
+        if (Lead < 0x80)
+        {
+            Index++;
+            return Lead;
+        }
+        else if ((Lead & 0xE0) == 0xC0) { Count = 1; CodePoint = Lead & 0x1F; }
+        else if ((Lead & 0xF0) == 0xE0) { Count = 2; CodePoint = Lead & 0x0F; }
+        else if ((Lead & 0xF8) == 0xF0) { Count = 3; CodePoint = Lead & 0x07; }
+
+        if (Count == 0 || Index + Count >= Length)
+        {
+            Index++;
+            return Lead;
+        }
+        for (int32 i = 1; i <= Count; i++)
+        {
+            if ((In[Index + i] & 0xC0) != 0x80)
+            {
+                Index++;
+                return Lead;
+            }
+            CodePoint = (CodePoint << 6) | (In[Index + i] & 0x3F);
+        }
+        static const uint32 MinimumForCount[4] = {0, 0x80, 0x800, 0x10000};
+        if (CodePoint < MinimumForCount[Count] || CodePoint > 0x10FFFF || (CodePoint >= 0xD800 && CodePoint <= 0xDFFF))
+        {
+            Index++;
+            return Lead;
+        }
+        Index += Count + 1;
+        return CodePoint;
+    }
+
+public:
+    FUtf8String() : Data(InlineData)
+    {
+        InlineData[0] = '\0';
+    }
+    FUtf8String(const ANSICHAR* Other, int32 Size) : Data(InlineData)
+    {
+        InlineData[0] = '\0';
+        Append(Other, Size);
+    }
+    explicit FUtf8String(const ANSICHAR* Other) : Data(InlineData)
+    {
+        InlineData[0] = '\0';
+        if (Other)
+        {
+            Append(Other, static_cast<int32>(std::strlen(Other)));
+        }
+    }
+    explicit FUtf8String(const std::string& Other) : Data(InlineData)
+    {
+        InlineData[0] = '\0';
+        Append(Other.data(), static_cast<int32>(Other.length()));
+    }
+    //Encodes the wide string as UTF-8.
+    explicit FUtf8String(const FString& Other) : Data(InlineData)
+    {
+        InlineData[0] = '\0';
+        Append(Other);
+    }
+    FUtf8String(const FUtf8String& Other) : Data(InlineData)
+    {
+        InlineData[0] = '\0';
+        Append(Other.Data, Other.Length);
+    }
+    FUtf8String(FUtf8String&& Other) noexcept
+    {
+        MoveFrom(Other);
+    }
+    FUtf8String& operator=(const FUtf8String& Other)
+    {
+        if (this != &Other)
+        {
+            Length = 0;
+            Append(Other.Data, Other.Length);
+        }
+        return *this;
+    }
+    FUtf8String& operator=(FUtf8String&& Other) noexcept
+    {
+        if (this != &Other)
+        {
+            if (!IsInline())
+            {
+                delete[] Data;
+            }
+            MoveFrom(Other);
+        }
+        return *this;
+    }
+    ~FUtf8String()
+    {
+        if (!IsInline())
+        {
+            delete[] Data;
+        }
+    }
+
+    //Null-terminated bytes, ready for send() or C APIs.
+    const ANSICHAR* GetData() const
+    {
+        return Data;
+    }
+    const ANSICHAR* operator*() const
+    {
+        return Data;
+    }
+    //For recv() into the string: size it with SetNumUninitialized, fill, then SetNum to the received count.
+    ANSICHAR* GetMutableData()
+    {
+        return Data;
+    }
+
+    int32 Len() const
+    {
+        return Length;
+    }
+    bool IsEmpty() const
+    {
+        return Length == 0;
+    }
+    int32 GetCapacity() const
+    {
+        return Capacity;
+    }
+
+    void Reserve(int32 Count)
+    {
+        Grow(Count);
+    }
+    //Resizes without initializing new bytes.
+    void SetNumUninitialized(int32 Count)
+    {
+        Grow(Count);
+        Length = Count;
+        Data[Length] = '\0';
+    }
+    //Shrinks the logical length; the buffer is kept.
+    void SetNum(int32 Count)
+    {
+        if (Count < 0 || Count > Length) return;
+        Length = Count;
+        Data[Length] = '\0';
+    }
+    void Reset()
+    {
+        SetNum(0);
+    }
+    //Returns the previous length, i.e. where the new bytes start.
+    int32 AddUninitialized(int32 Count)
+    {
+        int32 OldLength = Length;
+        SetNumUninitialized(Length + Count);
+        return OldLength;
+    }
+
+    FUtf8String& Append(const ANSICHAR* Text, int32 Count)
+    {
+        if (!Text || Count <= 0) return *this;
+        if (Text >= Data && Text < Data + Length)
+        {
+            //Appending a part of itself; Grow may move the buffer.
+            WSIZE__T Offset = static_cast<WSIZE__T>(Text - Data);
+            Grow(Length + Count);
+            Text = Data + Offset;
+        }
+        else
+        {
+            Grow(Length + Count);
+        }
+        std::memmove(Data + Length, Text, static_cast<size_t>(Count));
+        Length += Count;
+        Data[Length] = '\0';
+        return *this;
+    }
+    FUtf8String& Append(const ANSICHAR* Text)
+    {
+        return Text ? Append(Text, static_cast<int32>(std::strlen(Text))) : *this;
+    }
+    FUtf8String& Append(const FUtf8String& Other)
+    {
+        return Append(Other.Data, Other.Length);
+    }
+    //Encodes directly into this string, without an intermediate narrow copy.
+    FUtf8String& Append(const FString& Other)
+    {
+        const UTFCHAR* Wide = Other.GetWideCharArray();
+        int32 WideLength = Other.Len();
+        Grow(Length + WideLength);
+        for (int32 i = 0; i < WideLength; i++)
+        {
+            auto Unit = static_cast<uint32>(Wide[i]);
+            if (Unit < 0x80)
+            {
+                Grow(Length + 1);
+                Data[Length++] = static_cast<ANSICHAR>(Unit);
+                continue;
+            }
+            //UTF-16 platforms: join surrogate pairs; lone surrogates become U+FFFD.
+            if (Unit >= 0xD800 && Unit <= 0xDBFF && i + 1 < WideLength && static_cast<uint32>(Wide[i + 1]) >= 0xDC00 && static_cast<uint32>(Wide[i + 1]) <= 0xDFFF)
+            {
+                Unit = 0x10000 + ((Unit - 0xD800) << 10) + (static_cast<uint32>(Wide[++i]) - 0xDC00);
+            }
+            else if ((Unit >= 0xD800 && Unit <= 0xDFFF) || Unit > 0x10FFFF)
+            {
+                Unit = 0xFFFD;
+            }
+            AppendCodePoint(Unit);
+        }
+        Data[Length] = '\0';
+        return *this;
+    }
+    FUtf8String& AppendChar(ANSICHAR Character)
+    {
+        Grow(Length + 1);
+        Data[Length++] = Character;
+        Data[Length] = '\0';
+        return *this;
+    }
+
+    FUtf8String& operator+=(const FUtf8String& Other)
+    {
+        return Append(Other);
+    }
+    FUtf8String& operator+=(const ANSICHAR* Text)
+    {
+        return Append(Text);
+    }
+    FUtf8String& operator+=(const FString& Other)
+    {
+        return Append(Other);
+    }
+    FUtf8String& operator+=(ANSICHAR Character)
+    {
+        return AppendChar(Character);
+    }
+
+    bool operator==(const FUtf8String& Other) const
+    {
+        return Length == Other.Length && std::memcmp(Data, Other.Data, static_cast<size_t>(Length)) == 0;
+    }
+    bool operator!=(const FUtf8String& Other) const
+    {
+        return !(*this == Other);
+    }
+    bool operator==(const ANSICHAR* Other) const
+    {
+        return Other && std::strcmp(Data, Other) == 0;
+    }
+
+    //Byte index of the first occurrence, or INDEX_NONE.
+    int32 Find(const ANSICHAR* SubStr, int32 StartIndex = 0) const
+    {
+        if (!SubStr || StartIndex < 0 || StartIndex > Length) return INDEX_NONE;
+        const ANSICHAR* Found = std::strstr(Data + StartIndex, SubStr);
+        return Found ? static_cast<int32>(Found - Data) : INDEX_NONE;
+    }
+    bool StartsWith(const ANSICHAR* Prefix) const
+    {
+        auto PrefixLength = static_cast<int32>(std::strlen(Prefix));
+        return PrefixLength <= Length && std::memcmp(Data, Prefix, static_cast<size_t>(PrefixLength)) == 0;
+    }
+    bool EndsWith(const ANSICHAR* Suffix) const
+    {
+        auto SuffixLength = static_cast<int32>(std::strlen(Suffix));
+        return SuffixLength <= Length && std::memcmp(Data + Length - SuffixLength, Suffix, static_cast<size_t>(SuffixLength)) == 0;
+    }
+    FUtf8String Mid(int32 Start, int32 Count) const
+    {
+        if (Start < 0) Start = 0;
+        if (Start > Length) Start = Length;
+        if (Count < 0 || Start + Count > Length) Count = Length - Start;
+        return FUtf8String(Data + Start, Count);
+    }
+
+    //Decodes to a wide FString.
+    FString ToFString() const
+    {
+        FString Result;
+        int32 Index = 0;
+        while (Index < Length)
+        {
+            uint32 CodePoint = DecodeCodePoint(Index);
+            if (sizeof(UTFCHAR) == 2 && CodePoint >= 0x10000)
+            {
+                CodePoint -= 0x10000;
+                Result.AppendChar(static_cast<UTFCHAR>(0xD800 + (CodePoint >> 10)));
+                Result.AppendChar(static_cast<UTFCHAR>(0xDC00 + (CodePoint & 0x3FF)));
+            }
+            else
+            {
+                Result.AppendChar(static_cast<UTFCHAR>(CodePoint));
+            }
+        }
+        return Result;
+    }
+};
+
+namespace std
+{
+    template <> struct hash<FUtf8String>
+    {
+        size_t operator()(const FUtf8String& c) const
+        {
+            //FNV-1a over the bytes.
+            uint64 Hash = 14695981039346656037ull;
+            auto Bytes = reinterpret_cast<const uint8*>(c.GetData());
+            for (int32 i = 0; i < c.Len(); i++)
+            {
+                Hash = (Hash ^ Bytes[i]) * 1099511628211ull;
+            }
+            return static_cast<size_t>(Hash);
+        }
+    };
+}
+
+#endif //Pragma_Once_BKUtf8String
@@ -0,0 +1,153 @@
+// Copyright Burak Kara, All rights reserved.
+
+#ifndef Pragma_Once_BKWorkStealingDeque
+#define Pragma_Once_BKWorkStealingDeque
+
+#include "BKEngine.h"
+#include <atomic>
+
+// Chase-Lev work-stealing deque (with the C11 memory orderings of Le et al.).
+// Push and Pop may only be called by the owner thread, Steal by any thread. T must be trivially copyable.
+template <class T>
+class BKWorkStealingDeque
+{
+
+private:
+    struct FRingArray
+    {
+        int64 Capacity;
+        int64 Mask;
+        std::atomic<T>* Items;
+
+        //Arrays replaced by Grow are kept alive until the deque dies, since stealers may still read them.
+        FRingArray* Previous;
+
+        explicit FRingArray(int64 _Capacity) : Capacity(_Capacity), Mask(_Capacity - 1), Items(new std::atomic<T>[_Capacity]), Previous(nullptr)
+        {
+        }
+        ~FRingArray()
+        {
+            delete[] Items;
+        }
+
+        T Get(int64 Index) const
+        {
+            return Items[Index & Mask].load(std::memory_order_relaxed);
+        }
+        void Put(int64 Index, T Item)
+        {
+            Items[Index & Mask].store(Item, std::memory_order_relaxed);
+        }
+        FRingArray* Grow(int64 Bottom, int64 Top)
+        {
+            auto NewArray = new FRingArray(Capacity * 2);
+            for (int64 i = Top; i < Bottom; i++)
+            {
+                NewArray->Put(i, Get(i));
+            }
+            NewArray->Previous = this;
+            return NewArray;
+        }
+    };
+
+    std::atomic<int64> Top;
+    ANSICHAR Pad0[BK_CACHE_LINE_SIZE - sizeof(std::atomic<int64>)]{};
+    std::atomic<int64> Bottom;
+    std::atomic<FRingArray*> Array;
+
+    BKWorkStealingDeque(const BKWorkStealingDeque&);
+    BKWorkStealingDeque& operator=(const BKWorkStealingDeque&);
+
+public:
+    explicit BKWorkStealingDeque(int64 InitialCapacity = 256) : Top(0), Bottom(0)
+    {
+        int64 Capacity = 2;
+        while (Capacity < InitialCapacity) Capacity <<= 1;
+        Array.store(new FRingArray(Capacity), std::memory_order_relaxed);
+    }
+    ~BKWorkStealingDeque()
+    {
+        FRingArray* Current = Array.load(std::memory_order_relaxed);
+        while (Current)
+        {
+            FRingArray* Previous = Current->Previous;
+            delete (Current);
+            Current = Previous;
+        }
+    }
+
+    //Owner only.
+    void Push(T Item)
+    {
+        int64 B = Bottom.load(std::memory_order_relaxed);
+        int64 T_ = Top.load(std::memory_order_acquire);
+        FRingArray* A = Array.load(std::memory_order_relaxed);
+        if (B - T_ > A->Capacity - 1)
+        {
+            A = A->Grow(B, T_);
+            Array.store(A, std::memory_order_release);
+        }
+        A->Put(B, Item);
+        Bottom.store(B + 1, std::memory_order_release);
+    }
+
+    //Owner only. Takes from the bottom (LIFO).
+    bool Pop(T& OutItem)
+    {
+        int64 B = Bottom.load(std::memory_order_relaxed) - 1;
+        FRingArray* A = Array.load(std::memory_order_relaxed);
+        Bottom.store(B, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64 T_ = Top.load(std::memory_order_relaxed);
+
+        if (T_ > B)
+        {
+            Bottom.store(B + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        T Item = A->Get(B);
+        if (T_ == B)
+        {
+            //Last item; race against stealers.
+            bool bWon = Top.compare_exchange_strong(T_, T_ + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            Bottom.store(B + 1, std::memory_order_relaxed);
+            if (!bWon) return false;
+        }
+        OutItem = Item;
+        return true;
+    }
+
+    //Any thread. Takes from the top (FIFO). May fail spuriously when racing with another thief or the owner.
+    bool Steal(T& OutItem)
+    {
+        int64 T_ = Top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64 B = Bottom.load(std::memory_order_acquire);
+
+        if (T_ >= B) return false;
+
+        FRingArray* A = Array.load(std::memory_order_acquire);
+        T Item = A->Get(T_);
+        if (!Top.compare_exchange_strong(T_, T_ + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            return false;
+        }
+        OutItem = Item;
+        return true;
+    }
+
+    //Approximate when called from a non-owner thread.
+    int32 Size() const
+    {
+        int64 B = Bottom.load(std::memory_order_relaxed);
+        int64 T_ = Top.load(std::memory_order_relaxed);
+        return B > T_ ? static_cast<int32>(B - T_) : 0;
+    }
+    bool IsEmpty() const
+    {
+        return Size() == 0;
+    }
+};
+
+#endif //Pragma_Once_BKWorkStealingDeque
@@ -17,6 +17,9 @@ void Start(uint16 HTTPServerPort, uint16 UDPServerPort)
 {
     BKAsyncTaskManager::StartSystem(5);
     BKScheduledAsyncTaskManager::StartSystem(20);
+#if BK_WITH_COROUTINES
+    BKSocketReactor::StartSystem();
+#endif
 
     UDPServerInstance = new BKUDPServer([](BKUDPHandler* HandlerInstance, WUDPTaskParameter* Parameter)
     {
@@ -49,9 +52,9 @@ void Start(uint16 HTTPServerPort, uint16 UDPServerPort)
         auto Headers = Parameter->GetRequestHeaders();
         FString HeaderString;
 
-        Headers.Iterate([&HeaderString](BKSharedPtr<BKHashNode<FString, FString>> Header)
+        Headers.ForEach([&HeaderString](const FString& Key, const FString& Value)
         {
-            HeaderString.Append(Header->GetKey() + FString(L" -> ") + Header->GetValue() + FString(L", "));
+            HeaderString.Append(Key + FString(L" -> ") + Value + FString(L", "));
         });
         BKUtilities::Print(EBKLogType::Log, FString(L"Request Headers: ") + HeaderString);
 
@@ -88,6 +91,9 @@ void Stop()
         delete (UDPServerInstance);
     }
 
+#if BK_WITH_COROUTINES
+    BKSocketReactor::EndSystem();
+#endif
     BKScheduledAsyncTaskManager::EndSystem();
     BKAsyncTaskManager::EndSystem();
 }
@@ -98,38 +104,20 @@ void Quit()
 
 void SendPingToGoogle()
 {
-    BKFutureAsyncTask RequestLambda = [](TArray<BKAsyncTaskParameter*> TaskParameters)
-    {
-        if (TaskParameters.Num() > 0 && TaskParameters[0])
-        {
-            if (auto Request = reinterpret_cast<BKHTTPClient*>(TaskParameters[0]))
+    BKHTTPClient::NewHTTPRequest(FString(L"google.com"), 80, FString(L"Ping..."), FString(L"GET"), FString(L""), DEFAULT_HTTP_REQUEST_HEADERS, DEFAULT_TIMEOUT_MS)
+            .Then([](const FBKHTTPResponse& Response)
             {
-                if (Request->ProcessRequest())
-                {
-                    FString Response = FString(Request->GetResponsePayload());
-                    BKUtilities::Print(EBKLogType::Log, FString(L"Response length from Google: ") + FString::FromInt(Response.Len()));
-                }
-                else
-                {
-                    BKUtilities::Print(EBKLogType::Error, FString(L"Ping send request to Google has failed."));
-                }
-
-                if (Request->DestroyApproval()) delete (Request);
-            }
-        }
-    };
-    BKFutureAsyncTask TimeoutLambda = [](TArray<BKAsyncTaskParameter*> TaskParameters)
-    {
-        if (TaskParameters.Num() > 0 && TaskParameters[0])
-        {
-            if (auto Request = reinterpret_cast<BKHTTPClient*>(TaskParameters[0]))
+                return Response.Payload.Len();
+            })
+            .Then([](int32 ResponseLength)
             {
-                Request->CancelRequest();
-                if (Request->DestroyApproval()) delete (Request);
-            }
-        }
-    };
-    BKHTTPClient::NewHTTPRequest(FString(L"google.com"), 80, FString(L"Ping..."), FString(L"GET"), FString(L""), DEFAULT_HTTP_REQUEST_HEADERS, DEFAULT_TIMEOUT_MS, RequestLambda, TimeoutLambda);
+                BKUtilities::Print(EBKLogType::Log, FString(L"Response length from Google: ") + FString::FromInt(ResponseLength));
+            })
+            .Recover([](const FString& Error)
+            {
+                BKUtilities::Print(EBKLogType::Error, FString(L"Ping send request to Google has failed: ") + Error);
+                return FBKVoid();
+            });
 }
 
 void SendUDPPacketToServer()
@@ -4,6 +4,11 @@
 #include "BKAsyncTaskManager.h"
 #include "BKScheduledTaskManager.h"
 #include "BKHTTPClient.h"
+#include "BKUtf8String.h"
+#if BK_WITH_COROUTINES && !PLATFORM_WINDOWS
+    #include <fcntl.h>
+    #include <cerrno>
+#endif
 
 void BKHTTPClient::NewHTTPRequest(
         const FString& _ServerAddress,
@@ -15,6 +20,176 @@ void BKHTTPClient::NewHTTPRequest(
         uint32 _TimeoutMs,
         BKFutureAsyncTask& _RequestCallback,
         BKFutureAsyncTask& _TimeoutCallback)
+{
+    auto NewClient = CreateClient(_ServerAddress, _ServerPort, _Payload, _Verb, _Path, _Headers);
+
+    TArray<BKAsyncTaskParameter*> AsArray(NewClient);
+    BKAsyncTaskManager::NewAsyncTask(_RequestCallback, AsArray, true);
+    BKScheduledAsyncTaskManager::NewScheduledAsyncTask(_TimeoutCallback, AsArray, _TimeoutMs, false, true);
+}
+
+BKFuture<FBKHTTPResponse> BKHTTPClient::NewHTTPRequest(
+        const FString& _ServerAddress,
+        uint16 _ServerPort,
+        const FString& _Payload,
+        const FString& _Verb,
+        const FString& _Path,
+        const BKHashMap<FString, FString>& _Headers,
+        uint32 _TimeoutMs)
+{
+#if BK_WITH_COROUTINES
+    auto NewClient = CreateClient(_ServerAddress, _ServerPort, _Payload, _Verb, _Path, _Headers);
+    BKFuture<FBKHTTPResponse> Result = NewClient->ResponsePromise.GetFuture();
+    BKSpawn(RunRequest(NewClient, _TimeoutMs));
+    return Result;
+#else
+    BKFutureAsyncTask RequestLambda = [](const TArray<BKAsyncTaskParameter*>& TaskParameters)
+    {
+        if (TaskParameters.Num() > 0 && TaskParameters[0])
+        {
+            if (auto Request = reinterpret_cast<BKHTTPClient*>(TaskParameters[0]))
+            {
+                if (Request->ProcessRequest())
+                {
+                    FBKHTTPResponse Response;
+                    Response.Headers = Request->Parser.GetHeaders();
+                    Response.Payload = Request->Parser.GetPayload();
+                    Request->ResponsePromise.SetValue(std::move(Response));
+                }
+                else
+                {
+                    Request->ResponsePromise.SetFailed(FString(L"HTTP request has failed."));
+                }
+
+                if (Request->DestroyApproval()) delete (Request);
+            }
+        }
+    };
+    BKFutureAsyncTask TimeoutLambda = [](const TArray<BKAsyncTaskParameter*>& TaskParameters)
+    {
+        if (TaskParameters.Num() > 0 && TaskParameters[0])
+        {
+            if (auto Request = reinterpret_cast<BKHTTPClient*>(TaskParameters[0]))
+            {
+                //Fail first so the cancelled request cannot report a different reason.
+                Request->ResponsePromise.SetFailed(FString(L"HTTP request has timed out."));
+                Request->CancelRequest();
+
+                if (Request->DestroyApproval()) delete (Request);
+            }
+        }
+    };
+
+    auto NewClient = CreateClient(_ServerAddress, _ServerPort, _Payload, _Verb, _Path, _Headers);
+    BKFuture<FBKHTTPResponse> Result = NewClient->ResponsePromise.GetFuture();
+
+    TArray<BKAsyncTaskParameter*> AsArray(NewClient);
+    //Callers get a future, so a full lane fails the request instead of blocking them.
+    if (!BKAsyncTaskManager::NewAsyncTask(RequestLambda, AsArray, true, EBKTaskPriority::Normal, EBKOverloadPolicy::Reject))
+    {
+        NewClient->ResponsePromise.SetFailed(FString(L"HTTP request could not be queued."));
+        delete (NewClient);
+        return Result;
+    }
+    if (BKScheduledAsyncTaskManager::NewScheduledAsyncTask(TimeoutLambda, AsArray, _TimeoutMs, false, true) == 0)
+    {
+        //Nothing would ever time the request out; it is failed and cancelled here instead, as the timeout would.
+        NewClient->ResponsePromise.SetFailed(FString(L"HTTP request timeout could not be scheduled."));
+        NewClient->CancelRequest();
+
+        if (NewClient->DestroyApproval()) delete (NewClient);
+    }
+    return Result;
+#endif
+}
+
+#if BK_WITH_COROUTINES
+BKTask<void> BKHTTPClient::RunRequest(BKHTTPClient* Client, uint32 TimeoutMs)
+{
+    uint64 DeadlineMs = BKUtilities::GetMonotonicTimeStampInMS() + TimeoutMs;
+    bool bResult = false;
+
+    Client->bRequestInitialized = true;
+    if (Client->InitializeSocket())
+    {
+        Client->SendData();
+
+#if PLATFORM_WINDOWS
+        DWORD ReceiveTimeout = TimeoutMs;
+        setsockopt(Client->HTTPSocket, SOL_SOCKET, SO_RCVTIMEO, (const ANSICHAR*)&ReceiveTimeout, sizeof(DWORD));
+#else
+        if (BKSocketReactor::IsSystemStarted())
+        {
+            fcntl(Client->HTTPSocket, F_SETFL, fcntl(Client->HTTPSocket, F_GETFL, 0) | O_NONBLOCK);
+        }
+        else
+        {
+            //Without the reactor recv blocks, but still gives up at the timeout.
+            struct timeval ReceiveTimeout{};
+            ReceiveTimeout.tv_sec = TimeoutMs / 1000;
+            ReceiveTimeout.tv_usec = (TimeoutMs % 1000) * 1000;
+            setsockopt(Client->HTTPSocket, SOL_SOCKET, SO_RCVTIMEO, &ReceiveTimeout, sizeof(ReceiveTimeout));
+        }
+#endif
+
+        bResult = co_await Client->ReceiveDataAsync(DeadlineMs);
+        Client->CloseSocket();
+    }
+
+    if (bResult)
+    {
+        FBKHTTPResponse Response;
+        Response.Headers = Client->Parser.GetHeaders();
+        Response.Payload = Client->Parser.GetPayload();
+        Client->ResponsePromise.SetValue(std::move(Response));
+    }
+    else
+    {
+        Client->ResponsePromise.SetFailed(Client->bTimedOut ? FString(L"HTTP request has timed out.") : FString(L"HTTP request has failed."));
+    }
+    delete (Client);
+}
+
+BKTask<bool> BKHTTPClient::ReceiveDataAsync(uint64 DeadlineMs)
+{
+    bool bHeadersReady = false;
+    bool bBodyReady = false;
+
+    while (!bHeadersReady || !bBodyReady)
+    {
+        BytesReceived = static_cast<int32>(recv(HTTPSocket, RecvBuffer, static_cast<size_t>(RecvBufferLen), 0));
+
+        if (BytesReceived > 0)
+        {
+            if (!ConsumeReceivedChunk(bHeadersReady, bBodyReady)) co_return false;
+            continue;
+        }
+#if !PLATFORM_WINDOWS
+        if (BytesReceived < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            uint64 NowMs = BKUtilities::GetMonotonicTimeStampInMS();
+            if (!BKSocketReactor::IsSystemStarted() || NowMs >= DeadlineMs ||
+                !co_await BKAwaitSocket(HTTPSocket, EBKSocketEvent::Readable, static_cast<uint32>(DeadlineMs - NowMs)))
+            {
+                bTimedOut = true;
+                co_return false;
+            }
+            continue;
+        }
+#endif
+        co_return false;
+    }
+    co_return true;
+}
+#endif
+
+BKHTTPClient* BKHTTPClient::CreateClient(
+        const FString& _ServerAddress,
+        uint16 _ServerPort,
+        const FString& _Payload,
+        const FString& _Verb,
+        const FString& _Path,
+        const BKHashMap<FString, FString>& _Headers)
 {
     auto NewClient = new BKHTTPClient();
     NewClient->ServerAddress = _ServerAddress;
@@ -22,10 +197,7 @@ void BKHTTPClient::NewHTTPRequest(
     NewClient->Headers = _Headers;
     NewClient->Payload = _Payload;
     NewClient->RequestLine = _Verb + FString(L" ") + _Path + FString(L" HTTP/1.1");
-
-    TArray<BKAsyncTaskParameter*> AsArray(NewClient);
-    BKAsyncTaskManager::NewAsyncTask(_RequestCallback, AsArray, true);
-    BKScheduledAsyncTaskManager::NewScheduledAsyncTask(_TimeoutCallback, AsArray, _TimeoutMs, false, true);
+    return NewClient;
 }
 
 bool BKHTTPClient::ProcessRequest()
@@ -179,25 +351,22 @@ void BKHTTPClient::SendData()
 {
     if (!bRequestInitialized) return;
 
-    FStringStream HeaderBuilder;
-    HeaderBuilder << RequestLine;
-    HeaderBuilder << L"\r\n";
-    Headers.Iterate([&HeaderBuilder](BKSharedPtr<BKHashNode<FString, FString>> Node)
+    FUtf8String Request;
+    Request.Append(RequestLine);
+    Request.Append("\r\n");
+    Headers.ForEach([&Request](const FString& Key, const FString& Value)
     {
-        HeaderBuilder << Node->GetKey();
-        HeaderBuilder << L':';
-        HeaderBuilder << Node->GetValue();
-        HeaderBuilder << L"\r\n";
+        Request.Append(Key);
+        Request.AppendChar(':');
+        Request.Append(Value);
+        Request.Append("\r\n");
     });
-
-    FString Response = HeaderBuilder.Str() + Payload;
-
-    std::string ResponseString = Response.GetAnsiCharString();
+    Request.Append(Payload);
 
 #if PLATFORM_WINDOWS
-    send(HTTPSocket, ResponseString.c_str(), ResponseString.size(), 0);
+    send(HTTPSocket, Request.GetData(), Request.Len(), 0);
 #else
-    send(HTTPSocket, ResponseString.c_str(), ResponseString.size(), MSG_NOSIGNAL);
+    send(HTTPSocket, Request.GetData(), static_cast<size_t>(Request.Len()), MSG_NOSIGNAL);
 #endif
 }
 
@@ -205,50 +374,42 @@ bool BKHTTPClient::ReceiveData()
 {
     if (!bRequestInitialized) return false;
 
-    bool HeadersReady = false;
-    bool BodyReady = false;
+    bool bHeadersReady = false;
+    bool bBodyReady = false;
 
-    while (!HeadersReady)
+    while (!bHeadersReady || !bBodyReady)
     {
         BytesReceived = static_cast<int32>(recv(HTTPSocket, RecvBuffer, static_cast<size_t>(RecvBufferLen), 0));
 
         if (!bRequestInitialized) return false;
 
-        if (BytesReceived > 0)
-        {
-            FString PreParseString = FString(RecvBuffer, static_cast<uint32>(BytesReceived));
-
-            Parser.ProcessChunkForHeaders(PreParseString);
-
-            HeadersReady = Parser.AllHeadersAvailable();
-            BodyReady = Parser.AllBodyAvailable();
-        }
-        else return false;
+        if (BytesReceived <= 0 || !ConsumeReceivedChunk(bHeadersReady, bBodyReady)) return false;
     }
+    return true;
+}
 
-    while (!BodyReady)
-    {
-        BytesReceived = static_cast<int32>(recv(HTTPSocket, RecvBuffer, static_cast<size_t>(RecvBufferLen), 0));
+bool BKHTTPClient::ConsumeReceivedChunk(bool& bHeadersReady, bool& bBodyReady)
+{
+    FString PreParseString = FString(RecvBuffer, static_cast<uint32>(BytesReceived));
 
-        if (!bRequestInitialized) return false;
+    if (!bHeadersReady)
+    {
+        Parser.ProcessChunkForHeaders(PreParseString);
 
-        if (BytesReceived > 0)
-        {
-            FString PreParseString = FString(RecvBuffer, static_cast<uint32>(BytesReceived));
+        bHeadersReady = Parser.AllHeadersAvailable();
+        bBodyReady = Parser.AllBodyAvailable();
+        return true;
+    }
 
-            Parser.ProcessChunkForBody(PreParseString);
+    Parser.ProcessChunkForBody(PreParseString);
 
-            if (Parser.ErrorOccuredInBodyParsing()) return false;
+    if (Parser.ErrorOccuredInBodyParsing()) return false;
 
-            BodyReady = Parser.AllBodyAvailable();
-        }
-        else return false;
-    }
+    bBodyReady = Parser.AllBodyAvailable();
     return true;
 }
 
 bool BKHTTPClient::DestroyApproval()
 {
-    BKScopeGuard ReceivedDestroyApproval_Guard(&ReceivedDestroyApproval_Mutex);
-    return ++ReceivedDestroyApproval >= 2;
+    return ReceivedDestroyApproval.Increment() >= 2;
 }
\ No newline at end of file
@@ -185,12 +185,11 @@ public:
         if (bBodyAvailable) return;
 
         int32 ContentLength = 0;
-        FString FoundValue;
-        if (Headers.Get(FString(L"Content-Length"), FoundValue))
+        if (const FString* FoundValue = Headers.Find(L"Content-Length"))
         {
             try
             {
-                ContentLength = FString::ConvertToInteger<int32>(FoundValue.GetAnsiCharArray().c_str());
+                ContentLength = FString::ConvertToInteger<int32>(*FoundValue);
             }
             catch (const std::invalid_argument &ia)
             {
@@ -87,7 +87,7 @@ void BKHTTPServer::ListenSocket()
             if (!bSystemStarted) return;
 
             EndSystem();
-            StartSystem(HTTPPort, TimeoutInMs);
+            StartSystem(HTTPPort, TimeoutInMs, CoreLayout);
             return;
         }
 
@@ -107,7 +107,7 @@ void BKHTTPServer::ListenSocket()
         PassParameters.Add(this);
         PassParameters.Add(new BKHTTPAcceptedClient(ClientSocket, Client, TimeoutInMs));
 
-        BKFutureAsyncTask TaskLambda = [](TArray<BKAsyncTaskParameter*> TaskParameters)
+        BKFutureAsyncTask TaskLambda = [](const TArray<BKAsyncTaskParameter*>& TaskParameters)
         {
             if (TaskParameters.Num() >= 2 && TaskParameters[0] && TaskParameters[1])
             {
@@ -125,8 +125,11 @@ void BKHTTPServer::ListenSocket()
                 {
                     ServerInstance->HTTPListenCallback(Parameter);
 
+                    //The body goes out as UTF-8, so content-length is its encoded size rather than its character count.
+                    FUtf8String EncodedBody(Parameter->ResponseBody);
+
                     Parameter->SetResponseHeader_Internal(FString(L"content-type"), Parameter->ResponseContentType + FString(L"; charset=UTF-8"), false);
-                    Parameter->SetResponseHeader_Internal(FString(L"content-length"), FString::FromInt(Parameter->ResponseBody.Len()), false);
+                    Parameter->SetResponseHeader_Internal(FString(L"content-length"), FString::FromInt(EncodedBody.Len()), false);
 
                     //TODO: this will be rejected due to missing Secure, Path and Domain directives. Fix.
                     FStringStream CookieStringBuilder;
@@ -144,54 +147,67 @@ void BKHTTPServer::ListenSocket()
                         }
                     }
 
-                    FStringStream HeaderStringBuilder;
-                    HeaderStringBuilder << L"HTTP/1.1 ";
-                    HeaderStringBuilder << Parameter->ResponseCode;
-                    HeaderStringBuilder << " ";
-                    HeaderStringBuilder << Parameter->ResponseCodeDescription;
-                    HeaderStringBuilder << "\r\n";
+                    FUtf8String Response;
+                    Response.Reserve(256 + EncodedBody.Len());
+                    Response.Append("HTTP/1.1 ");
+                    Response.Append(FString::FromInt(Parameter->ResponseCode));
+                    Response.Append(" ");
+                    Response.Append(Parameter->ResponseCodeDescription);
+                    Response.Append("\r\n");
 
                     for (int i = 0; i < Parameter->ResponseHeaders.Num(); i++)
                     {
                         if (Parameter->ResponseHeaders[i].IsValid())
                         {
-                            HeaderStringBuilder << Parameter->ResponseHeaders[i]->Item1;
+                            Response.Append(Parameter->ResponseHeaders[i]->Item1);
 
-                            HeaderStringBuilder << L": ";
+                            Response.Append(": ");
 
-                            HeaderStringBuilder << Parameter->ResponseHeaders[i]->Item2;
+                            Response.Append(Parameter->ResponseHeaders[i]->Item2);
 
-                            HeaderStringBuilder << L"\r\n";
+                            Response.Append("\r\n");
                         }
                     }
-                    HeaderStringBuilder << L"\r\n";
+                    Response.Append("\r\n");
+                    Response.Append(EncodedBody);
 
-                    Parameter->SendData(Parameter->ResponseBody, FString(HeaderStringBuilder.Str()));
+                    Parameter->SendData(Response);
 
                     Parameter->Finalize();
                 }
             }
         };
-        BKAsyncTaskManager::NewAsyncTask(TaskLambda, PassParameters, true);
+        if (!BKAsyncTaskManager::NewAsyncTask(TaskLambda, PassParameters, true, EBKTaskPriority::Normal, EBKOverloadPolicy::Reject))
+        {
+            auto Parameter = reinterpret_cast<BKHTTPAcceptedClient*>(PassParameters[1]);
+            Parameter->Initialize();
+            Parameter->Overloaded_Internal();
+        }
     }
 }
 uint32 BKHTTPServer::ListenerStopped()
 {
     if (!bSystemStarted) return 0;
     if (HTTPSystemThread) delete (HTTPSystemThread);
-    HTTPSystemThread = new BKThread(std::bind(&BKHTTPServer::ListenSocket, this), std::bind(&BKHTTPServer::ListenerStopped, this));
+    CreateListenerThread();
     return 0;
 }
+void BKHTTPServer::CreateListenerThread()
+{
+    HTTPSystemThread = new BKThread(std::bind(&BKHTTPServer::ListenSocket, this), std::bind(&BKHTTPServer::ListenerStopped, this),
+            FBKThreadOptions(FString(L"BKHTTPListener"), CoreLayout.ListenerAffinityMask));
+}
 
-bool BKHTTPServer::StartSystem(uint16 Port, uint32 TimeoutMs)
+bool BKHTTPServer::StartSystem(uint16 Port, uint32 TimeoutMs, const FBKCoreLayout& Layout)
 {
     if (bSystemStarted) return true;
     bSystemStarted = true;
 
+    CoreLayout = Layout;
     TimeoutInMs = TimeoutMs == 0 ? 2500 : TimeoutMs;
     if (InitializeSocket(Port))
     {
-        HTTPSystemThread = new BKThread(std::bind(&BKHTTPServer::ListenSocket, this), std::bind(&BKHTTPServer::ListenerStopped, this));
+        CreateListenerThread();
         return true;
     }
     return false;
@@ -9,6 +9,8 @@
 #include "BKHTTPHelper.h"
 #include "BKTuple.h"
 #include "BKSharedPtr.h"
+#include "BKUtf8String.h"
+#include "BKAtomic.h"
 
 struct BKHTTPAcceptedSocket
 {
@@ -75,15 +77,14 @@ public:
         TryDeinitializing(this);
     }
 
-    void Send(FString& Response)
+    void Send(const FUtf8String& Response)
     {
         BKScopeGuard SendData_Guard(&HTTPSocket_Mutex);
         if (!bSocketOperational) return;
-        std::string ResponseString = Response.GetAnsiCharString();
 #if PLATFORM_WINDOWS
-        send(ClientSocket, ResponseString.c_str(), ResponseString.size(), 0);
+        send(ClientSocket, Response.GetData(), Response.Len(), 0);
 #else
-        send(ClientSocket, ResponseString.c_str(), ResponseString.size(), MSG_NOSIGNAL);
+        send(ClientSocket, Response.GetData(), static_cast<size_t>(Response.Len()), MSG_NOSIGNAL);
 #endif
     }
 
@@ -117,14 +118,10 @@ private:
     ANSICHAR RecvBuffer[HTTP_BUFFER_SIZE]{};
     int32 BytesReceived{};
 
-    BKMutex bInitialized_Mutex;
-    bool bInitialized = false;
+    BKAtomic<bool> bInitialized{false};
     bool GetAndDeinitialize()
     {
-        BKScopeGuard bInitialized_Guard(&bInitialized_Mutex);
-        bool bOldValue = bInitialized;
-        bInitialized = false;
-        return bOldValue;
+        return bInitialized.Exchange(false);
     }
 
     void Cancel()
@@ -143,20 +140,23 @@ private:
         Cancel();
     }
 
-    void SendData(const FString& Body, const FString& Header, bool bCancelAfter = false)
+    void SendData(const FUtf8String& Response, bool bCancelAfter = false)
     {
-        FString Response = Header + Body;
         ClientSocket->Send(Response);
         if (bCancelAfter)
         {
             Cancel();
         }
     }
-    static FString CorruptedResponseBody;
-    static FString CorruptedResponseHeaders;
+    static FUtf8String CorruptedResponse;
     void Corrupted_Internal()
     {
-        SendData(CorruptedResponseBody, CorruptedResponseHeaders, true);
+        SendData(CorruptedResponse, true);
+    }
+    static FUtf8String OverloadedResponse;
+    void Overloaded_Internal()
+    {
+        SendData(OverloadedResponse, true);
     }
     void SocketError_Internal()
     {
@@ -276,7 +276,7 @@ private:
 
         if (!bFound)
         {
-            ResponseHeaders.Add(BKSharedPtr<BKTuple_Two<FString, FString>>(new BKTuple_Two<FString, FString>(CaseLoweredKey, _HeaderValue)));
+            ResponseHeaders.Add(BKMakeShared<BKTuple_Two<FString, FString>>(CaseLoweredKey, _HeaderValue));
             return true;
         }
         return false;
@@ -294,7 +294,7 @@ private:
             assert(CaseLoweredKey != FString(L"set-cookie"));
         }
 
-        ResponseHeaders.Add(BKSharedPtr<BKTuple_Two<FString, FString>>(new BKTuple_Two<FString, FString>(CaseLoweredKey, _HeaderValue)));
+        ResponseHeaders.Add(BKMakeShared<BKTuple_Two<FString, FString>>(CaseLoweredKey, _HeaderValue));
     }
 
     friend class BKHTTPServer;
@@ -365,7 +365,7 @@ public:
 
         if (!bFound)
         {
-            ResponseCookies.Add(BKSharedPtr<BKTuple_Two<FString, FString>>(new BKTuple_Two<FString, FString>(_CookieKey, _CookieValue)));
+            ResponseCookies.Add(BKMakeShared<BKTuple_Two<FString, FString>>(_CookieKey, _CookieValue));
             return true;
         }
         return false;
@@ -460,7 +460,7 @@ std::map<int32, FString> BKHTTPAcceptedClient::HttpCodeDescriptionMap =
     {505, FString(L"HTTP Version not supported")}
 };
 
-FString BKHTTPAcceptedClient::CorruptedResponseBody = FString(L"<html>Corrupted</html>");
-FString BKHTTPAcceptedClient::CorruptedResponseHeaders(FString(L"HTTP/1.1 400 Bad Request\r\nContent-Type: text/html; charset=UTF-8\r\nContent-Length: 22 \r\n\r\n"));
+FUtf8String BKHTTPAcceptedClient::CorruptedResponse("HTTP/1.1 400 Bad Request\r\nContent-Type: text/html; charset=UTF-8\r\nContent-Length: 22 \r\n\r\n<html>Corrupted</html>");
+FUtf8String BKHTTPAcceptedClient::OverloadedResponse("HTTP/1.1 503 Service Unavailable\r\nContent-Type: text/html; charset=UTF-8\r\nRetry-After: 1\r\nContent-Length: 27\r\n\r\n<html>Server is busy</html>");
 
 #endif //Pragma_Once_BKHTTPServerHelper
\ No newline at end of file
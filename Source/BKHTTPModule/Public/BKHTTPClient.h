@@ -6,12 +6,21 @@
 #include "BKEngine.h"
 #include "BKTaskDefines.h"
 #include "BKHashMap.h"
+#include "BKAtomic.h"
+#include "BKFuture.h"
+#include "BKCoroutine.h"
 #include "../Private/BKHTTPRequestParser.h"
 #include "../Private/BKHTTPHelper.h"
 
 #define DEFAULT_HTTP_REQUEST_HEADERS BKHashMap<FString, FString>()
 #define DEFAULT_TIMEOUT_MS 2500
 
+struct FBKHTTPResponse
+{
+    BKHashMap<FString, FString> Headers;
+    FString Payload;
+};
+
 class BKHTTPClient : public BKAsyncTaskParameter
 {
 
@@ -27,8 +36,10 @@ private:
     bool bRequestInitialized = false;
     BKMutex RequestMutex;
 
-    BKMutex ReceivedDestroyApproval_Mutex;
-    int32 ReceivedDestroyApproval = 0;
+    BKAtomic<int32> ReceivedDestroyApproval{0};
+
+    //Completed by whichever of the request and the timeout task finishes first.
+    BKPromise<FBKHTTPResponse> ResponsePromise;
 
     bool InitializeSocket();
     void CloseSocket();
@@ -42,9 +53,27 @@ private:
     int32 RecvBufferLen = HTTP_BUFFER_SIZE;
     ANSICHAR RecvBuffer[HTTP_BUFFER_SIZE]{};
     int32 BytesReceived{};
+    bool bTimedOut = false;
+
+    //Feeds the last received chunk to the parser; false on a malformed body.
+    bool ConsumeReceivedChunk(bool& bHeadersReady, bool& bBodyReady);
+
+#if BK_WITH_COROUTINES
+    //Waits for data on the socket reactor instead of a blocking recv, so no worker is held while the server answers.
+    static BKTask<void> RunRequest(BKHTTPClient* Client, uint32 TimeoutMs);
+    BKTask<bool> ReceiveDataAsync(uint64 DeadlineMs);
+#endif
 
     BKHTTPClient() = default;
 
+    static BKHTTPClient* CreateClient(
+        const FString& _ServerAddress,
+        uint16 _ServerPort,
+        const FString& _Payload,
+        const FString& _Verb,
+        const FString& _Path,
+        const BKHashMap<FString, FString>& _Headers);
+
 public:
     static void NewHTTPRequest(
         const FString& _ServerAddress,
@@ -57,6 +86,17 @@ public:
         BKFutureAsyncTask& _RequestCallback,
         BKFutureAsyncTask& _TimeoutCallback);
 
+    //Continuations attached with Then run on the worker that processed the request; the client is freed internally.
+    //In coroutine builds with a running BKSocketReactor the request does not occupy a worker while waiting for the response.
+    static BKFuture<FBKHTTPResponse> NewHTTPRequest(
+        const FString& _ServerAddress,
+        uint16 _ServerPort,
+        const FString& _Payload,
+        const FString& _Verb,
+        const FString& _Path,
+        const BKHashMap<FString, FString>& _Headers,
+        uint32 _TimeoutMs);
+
     bool ProcessRequest();
     void CancelRequest();
 
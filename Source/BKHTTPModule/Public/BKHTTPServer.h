@@ -14,7 +14,8 @@ class BKHTTPServer : public BKAsyncTaskParameter
 {
 
 public:
-    bool StartSystem(uint16 Port, uint32 TimeoutMs);
+    //The listener thread runs on Layout.ListenerAffinityMask.
+    bool StartSystem(uint16 Port, uint32 TimeoutMs, const FBKCoreLayout& Layout = FBKCoreLayout());
     void EndSystem();
 
     explicit BKHTTPServer(std::function<void(BKHTTPAcceptedClient*)> Callback)
@@ -45,7 +46,9 @@ private:
 
     std::function<void(BKHTTPAcceptedClient*)> HTTPListenCallback;
 
+    FBKCoreLayout CoreLayout;
     BKThread* HTTPSystemThread{};
+    void CreateListenerThread();
 };
 
 #endif //Pragma_Once_BKHTTPServer
\ No newline at end of file
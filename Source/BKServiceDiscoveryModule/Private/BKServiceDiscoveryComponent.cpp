@@ -106,7 +106,7 @@ void BKServiceDiscoveryComponent::RegisterService(const std::function<void(bool)
         WrappedData.DeallocateValue();
 
         static TArray<BKAsyncTaskParameter*> NoParameter;
-        BKFutureAsyncTask Lambda = [ResultCallback](TArray<BKAsyncTaskParameter*> TaskParameters)
+        BKFutureAsyncTask Lambda = [ResultCallback](const TArray<BKAsyncTaskParameter*>& TaskParameters)
         {
             if (ComponentInstance)
             {
@@ -121,7 +121,7 @@ void BKServiceDiscoveryComponent::RegisterService(const std::function<void(bool)
                 }
             }
         };
-        BKScheduledAsyncTaskManager::NewScheduledAsyncTask(Lambda, NoParameter, 5000, false);
+        BKScheduledAsyncTaskManager::NewScheduledAsyncTask(Lambda, NoParameter, 5000, false, false, EBKTaskPriority::Background);
     }
     else
     {
@@ -169,7 +169,7 @@ FString BKServiceDiscoveryComponent::CompileUnregisterServiceMessage(const FStri
 void BKServiceDiscoveryComponent::StartHeartbeating()
 {
     static TArray<BKAsyncTaskParameter*> NoParameter;
-    BKFutureAsyncTask Lambda = [](TArray<BKAsyncTaskParameter*> TaskParameters)
+    BKFutureAsyncTask Lambda = [](const TArray<BKAsyncTaskParameter*>& TaskParameters)
     {
         if (bComponentStarted && ComponentInstance && ComponentInstance->ComponentUDPClient && ComponentInstance->ComponentUDPClient->GetUDPHandler())
         {
@@ -192,7 +192,7 @@ void BKServiceDiscoveryComponent::StartHeartbeating()
             StartComponent([](bool bResult){}, ComponentInstance->DiscoveryServerIP, ComponentInstance->DiscoveryServerPort, ComponentInstance->ServiceName, ComponentInstance->ServiceIP, ComponentInstance->ServicePort);
         }
     };
-    HeartbeatTaskUniqueIx = BKScheduledAsyncTaskManager::NewScheduledAsyncTask(Lambda, NoParameter, 1000, true);
+    HeartbeatTaskUniqueIx = BKScheduledAsyncTaskManager::NewScheduledAsyncTask(Lambda, NoParameter, 1000, true, false, EBKTaskPriority::Background);
 }
 
 void BKServiceDiscoveryComponent::SetCurrentUserNo(int32 _NewUsersNo)
@@ -12,7 +12,7 @@ bool BKSystemManager::StartSystem(uint32& _UniqueCallbackID, WSystemInfoCallback
 
     ManagerInstance = new BKSystemManager();
     {
-        BKScopeGuard LocalGuard(&ManagerInstance->Callbacks_Mutex);
+        BKFastScopeGuard LocalGuard(&ManagerInstance->Callbacks_Lock);
         ManagerInstance->Callbacks.Reset();
 
         _UniqueCallbackID = ManagerInstance->CurrentCallbackUniqueIx++;
@@ -34,7 +34,7 @@ bool BKSystemManager::StartSystem(uint32& _UniqueCallbackID, WSystemInfoCallback
 }
 bool BKSystemManager::StartSystem_Internal()
 {
-    SystemManagerThread = new BKThread(std::bind(&BKSystemManager::SystemThreadsDen, this), std::bind(&BKSystemManager::SystemThreadStopped, this));
+    SystemManagerThread = new BKThread(std::bind(&BKSystemManager::SystemThreadsDen, this), std::bind(&BKSystemManager::SystemThreadStopped, this), FBKThreadOptions(FString(L"BKSystemMonitor")));
     return true;
 }
 
@@ -78,15 +78,34 @@ void BKSystemManager::SystemThreadsDen()
         }
         LastSystemInfo = new BKSystemInfo(Total_CPU_Utilization, Total_Memory_Utilization);
 
-        for (int32 i = Callbacks.Num() - 1; i >=0; i--)
+        //Callbacks run on a copy, outside the lock, so they may add or remove callbacks themselves.
+        CallbacksToRun.Reset();
+        uint32 RemovedBeforeRun;
         {
-            if (Callbacks[i].NonComparable)
+            BKFastScopeGuard LocalGuard(&Callbacks_Lock);
+            for (int32 i = Callbacks.Num() - 1; i >=0; i--)
             {
-                Callbacks[i].NonComparable(LastSystemInfo);
+                if (Callbacks[i].NonComparable)
+                {
+                    CallbacksToRun.Add(Callbacks[i]);
+                }
+                else
+                {
+                    Callbacks.RemoveAt(i);
+                }
             }
-            else
+            RemovedBeforeRun = RemovedCallbackCount;
+        }
+        {
+            BKScopeGuard InvokeGuard(&Invoke_Mutex);
+            for (int32 i = 0; i < CallbacksToRun.Num(); i++)
             {
-                Callbacks.RemoveAt(i);
+                {
+                    //Skips callbacks removed since the copy was made, e.g. by an earlier callback of this pass.
+                    BKFastScopeGuard LocalGuard(&Callbacks_Lock);
+                    if (RemovedCallbackCount != RemovedBeforeRun && !Callbacks.Contains(CallbacksToRun[i])) continue;
+                }
+                CallbacksToRun[i].NonComparable(LastSystemInfo);
             }
         }
 
@@ -97,7 +116,7 @@ uint32 BKSystemManager::SystemThreadStopped()
 {
     if (!bSystemStarted) return 0;
     if (SystemManagerThread) delete (SystemManagerThread);
-    SystemManagerThread = new BKThread(std::bind(&BKSystemManager::SystemThreadsDen, this), std::bind(&BKSystemManager::SystemThreadStopped, this));
+    SystemManagerThread = new BKThread(std::bind(&BKSystemManager::SystemThreadsDen, this), std::bind(&BKSystemManager::SystemThreadStopped, this), FBKThreadOptions(FString(L"BKSystemMonitor")));
     return 0;
 }
 
@@ -105,7 +124,7 @@ void BKSystemManager::AddCallback(uint32& _UniqueCallbackID, WSystemInfoCallback
 {
     if (!bSystemStarted || !ManagerInstance || !_Callback) return;
 
-    BKScopeGuard LocalGuard(&ManagerInstance->Callbacks_Mutex);
+    BKFastScopeGuard LocalGuard(&ManagerInstance->Callbacks_Lock);
 
     _UniqueCallbackID = ManagerInstance->CurrentCallbackUniqueIx++;
     if (ManagerInstance->CurrentCallbackUniqueIx >= 32767)
@@ -119,6 +138,12 @@ void BKSystemManager::RemoveCallback(uint32 _UniqueCallbackID, WSystemInfoCallba
 {
     if (!bSystemStarted || !ManagerInstance || !_Callback) return;
 
-    BKScopeGuard LocalGuard(&ManagerInstance->Callbacks_Mutex);
-    ManagerInstance->Callbacks.Remove(BKNonComparable_ElementWrapper<uint32, WSystemInfoCallback>(_UniqueCallbackID, _Callback));
+    {
+        BKFastScopeGuard LocalGuard(&ManagerInstance->Callbacks_Lock);
+        if (ManagerInstance->Callbacks.Remove(BKNonComparable_ElementWrapper<uint32, WSystemInfoCallback>(_UniqueCallbackID, _Callback)) == 0) return;
+        ManagerInstance->RemovedCallbackCount++;
+    }
+
+    //Waits out a pass that may have copied the callback before it was removed.
+    BKScopeGuard InvokeGuard(&ManagerInstance->Invoke_Mutex);
 }
\ No newline at end of file
@@ -9,6 +9,8 @@
 #include "../Private/BKMemoryMonitor.h"
 #include "BKJson.h"
 #include "BKElementWrapper.h"
+#include "BKFastMutex.h"
+#include "BKMutex.h"
 
 class BKSystemInfo
 {
@@ -50,6 +52,8 @@ public:
     static void EndSystem();
 
     static void AddCallback(uint32& _UniqueCallbackID, WSystemInfoCallback _Callback);
+    //The callback is not called once this returns. A call in progress on the monitor thread is waited for, so do not
+    //hold a lock the callback takes; removing from inside a callback is fine.
     static void RemoveCallback(uint32 _UniqueCallbackID, WSystemInfoCallback _Callback);
 
 private:
@@ -72,7 +76,13 @@ private:
     BKSystemInfo* LastSystemInfo = nullptr;
 
     TArray<BKNonComparable_ElementWrapper<uint32, WSystemInfoCallback>> Callbacks;
-    BKMutex Callbacks_Mutex;
+    BKFastMutex Callbacks_Lock;
+    //Bumped by every removal, so the monitor thread only re-checks its copy when something was removed.
+    uint32 RemovedCallbackCount = 0;
+    //Held by the monitor thread while it calls the callbacks; recursive, so callbacks may still remove themselves.
+    BKMutex Invoke_Mutex;
+    //Used by the monitor thread only.
+    TArray<BKNonComparable_ElementWrapper<uint32, WSystemInfoCallback>> CallbacksToRun;
     uint32 CurrentCallbackUniqueIx = 1;
 };
 
@@ -35,7 +35,12 @@ bool BKUDPClient::StartUDPClient(FString& _ServerAddress, uint16 _ServerPort)
 
     if (InitializeClient())
     {
-        UDPClientThread = new BKThread(std::bind(&BKUDPClient::ListenServer, this), std::bind(&BKUDPClient::ServerListenerStopped, this));
+        if (ReceiveBatch)
+        {
+            delete (ReceiveBatch);
+        }
+        ReceiveBatch = new BKUDPReceiveBatch(UDP_RECEIVE_BATCH_SIZE, false, UDP_CLIENT_PACKET_POOL_SIZE, UDP_BUFFER_SIZE);
+        UDPClientThread = new BKThread(std::bind(&BKUDPClient::ListenServer, this), std::bind(&BKUDPClient::ServerListenerStopped, this), FBKThreadOptions(FString(L"BKUDPClient")));
         if (UDPHandler)
         {
             delete (UDPHandler);
@@ -59,7 +64,7 @@ void BKUDPClient::LazySuicide()
     TArray<BKAsyncTaskParameter*> PassParameters;
     PassParameters.Add(this);
 
-    BKFutureAsyncTask Lambda = [](TArray<BKAsyncTaskParameter*> TaskParameters)
+    BKFutureAsyncTask Lambda = [](const TArray<BKAsyncTaskParameter*>& TaskParameters)
     {
         if (TaskParameters.Num() >= 1 && TaskParameters[0])
         {
@@ -83,6 +88,7 @@ void BKUDPClient::EndUDPClient()
     {
         UDPHandler->EndSystem();
         delete (UDPHandler);
+        UDPHandler = nullptr;
     }
     CloseSocket();
     if (SocketAddress)
@@ -98,6 +104,23 @@ void BKUDPClient::EndUDPClient()
         }
         delete (UDPClientThread);
     }
+    if (ReceiveBatch)
+    {
+        delete (ReceiveBatch);
+        ReceiveBatch = nullptr;
+    }
+}
+
+void BKUDPClient::GetIOStats(FBKUDPIOStats& OutStats) const
+{
+    OutStats = FBKUDPIOStats();
+    if (ReceiveBatch) ReceiveBatch->FillStats(OutStats);
+    if (UDPHandler) UDPHandler->GetSendStats(OutStats);
+}
+void BKUDPClient::ResetIOStats()
+{
+    if (ReceiveBatch) ReceiveBatch->ResetStats();
+    if (UDPHandler) UDPHandler->ResetSendStats();
 }
 
 bool BKUDPClient::InitializeClient()
@@ -195,62 +218,50 @@ void BKUDPClient::CloseSocket()
 }
 void BKUDPClient::ListenServer()
 {
+    BKAsyncTaskBatch Batch(EBKTaskPriority::LatencyCritical);
     while (bClientStarted)
     {
-        auto Buffer = new ANSICHAR[UDP_BUFFER_SIZE];
+        //Blocks for the first datagram of a burst and takes the ones that already arrived with it in the same call.
+        int32 Count = ReceiveBatch->Receive(UDPSocket);
+        if (!bClientStarted) return;
 
-        auto RetrievedSize = static_cast<int32>(recvfrom(UDPSocket, Buffer, UDP_BUFFER_SIZE, 0, SocketAddress, &SocketAddressLength));
-        if (RetrievedSize < 0 || !bClientStarted)
+        for (int32 i = 0; i < Count; i++)
         {
-            delete[] Buffer;
-            if (!bClientStarted) return;
-            continue;
-        }
-        if (RetrievedSize == 0) continue;
-
-        TArray<BKAsyncTaskParameter*> PassParameters;
-        PassParameters.Add(this);
-        PassParameters.Add(new WUDPTaskParameter(RetrievedSize, Buffer, SocketAddress, false));
+            auto RetrievedSize = ReceiveBatch->GetSize(i);
+            if (RetrievedSize <= 0) continue;
 
-        BKFutureAsyncTask Lambda = [](TArray<BKAsyncTaskParameter*> TaskParameters)
-        {
-            if (TaskParameters.Num() >= 2 && TaskParameters[0] && TaskParameters[1])
+            //Under overload the packet stays in its slot and is overwritten by the next receive.
+            if (!BKAsyncTaskManager::AdmitTasks(EBKTaskPriority::LatencyCritical, 1, EBKOverloadPolicy::DropNewest))
             {
-                auto ClientInstance = reinterpret_cast<BKUDPClient*>(TaskParameters[0]);
-                auto Parameter = reinterpret_cast<WUDPTaskParameter*>(TaskParameters[1]);
-
-                if (!ClientInstance || !ClientInstance->bClientStarted || !ClientInstance->UDPListenCallback || !ClientInstance->UDPHandler)
-                {
-                    if (Parameter)
-                    {
-                        delete (Parameter);
-                    }
-                    return;
-                }
+                ReceiveBatch->DroppedDatagrams.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
 
-                if (Parameter)
+            WUDPTaskParameter* Parameter = ReceiveBatch->DetachPacket(i);
+            Batch.Add(MakeUDPPacketTask(Parameter, [this](WUDPTaskParameter* Packet)
+            {
+                if (bClientStarted && UDPListenCallback && UDPHandler)
                 {
-                    FBKCHARWrapper BufferWrapped(Parameter->Buffer, Parameter->BufferSize, false);
+                    FBKCHARWrapper BufferWrapped(Packet->Buffer, Packet->BufferSize, false);
 
-                    BKJson::Node AnalyzedData = ClientInstance->UDPHandler->AnalyzeNetworkDataWithByteArray(BufferWrapped, Parameter->OtherParty);
+                    BKJson::Node AnalyzedData = UDPHandler->AnalyzeNetworkDataWithByteArray(BufferWrapped, SocketAddress);
 
                     if (AnalyzedData.GetType() != BKJson::Node::Type::T_VALIDATION &&
                         AnalyzedData.GetType() != BKJson::Node::Type::T_INVALID &&
                         AnalyzedData.GetType() != BKJson::Node::Type::T_NULL)
                     {
-                        ClientInstance->UDPListenCallback(ClientInstance, AnalyzedData);
+                        UDPListenCallback(this, AnalyzedData);
                     }
-                    delete (Parameter);
                 }
-            }
-        };
-        BKAsyncTaskManager::NewAsyncTask(Lambda, PassParameters, true);
+            }));
+        }
+        BKAsyncTaskManager::NewAsyncTasks(Batch);
     }
 }
 uint32 BKUDPClient::ServerListenerStopped()
 {
     if (!bClientStarted) return 0;
     if (UDPClientThread) delete (UDPClientThread);
-    UDPClientThread = new BKThread(std::bind(&BKUDPClient::ListenServer, this), std::bind(&BKUDPClient::ServerListenerStopped, this));
+    UDPClientThread = new BKThread(std::bind(&BKUDPClient::ListenServer, this), std::bind(&BKUDPClient::ServerListenerStopped, this), FBKThreadOptions(FString(L"BKUDPClient")));
     return 0;
 }
\ No newline at end of file
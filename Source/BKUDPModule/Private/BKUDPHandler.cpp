@@ -1,27 +1,50 @@
 // Copyright Burak Kara, All rights reserved.
 
 #include "BKUDPHandler.h"
+#include "BKUtf8String.h"
 #include "BKUDPHelper.h"
 #include "BKMath.h"
 #include "BKScheduledTaskManager.h"
 
 #if PLATFORM_WINDOWS
-BKUDPHandler::BKUDPHandler(SOCKET _UDPSocket)
+BKUDPHandler::BKUDPHandler(SOCKET _UDPSocket, int32 _SendBatchSize)
 #else
-BKUDPHandler::BKUDPHandler(int32 _UDPSocket)
+BKUDPHandler::BKUDPHandler(int32 _UDPSocket, int32 _SendBatchSize)
 #endif
 {
     UDPSocket_Ref = _UDPSocket;
+
+    SendBatchSize = FBKUDPIOOptions::Clamp(_SendBatchSize);
+    PendingSends = new FBKPendingSend[SendBatchSize];
+    InFlightSends = new FBKPendingSend[SendBatchSize];
+#if PLATFORM_LINUX
+    SendHeaders = new struct mmsghdr[SendBatchSize];
+    SendVectors = new struct iovec[SendBatchSize];
+    FMemory::Memzero(SendHeaders, sizeof(struct mmsghdr) * SendBatchSize);
+    for (int32 i = 0; i < SendBatchSize; i++)
+    {
+        SendHeaders[i].msg_hdr.msg_iov = &SendVectors[i];
+        SendHeaders[i].msg_hdr.msg_iovlen = 1;
+        SendHeaders[i].msg_hdr.msg_namelen = sizeof(sockaddr);
+    }
+#endif
+}
+BKUDPHandler::~BKUDPHandler()
+{
+    delete[] PendingSends;
+    delete[] InFlightSends;
+#if PLATFORM_LINUX
+    delete[] SendHeaders;
+    delete[] SendVectors;
+#endif
 }
 
 void BKUDPHandler::ClearReliableConnections()
 {
     if (!bSystemStarted) return;
 
-    BKScopeGuard Guard(&ReliableConnectionRecords_Mutex);
-    ReliableConnectionRecords.Iterate([this](BKSharedPtr<BKHashNode<FString, BKReliableConnectionRecord*>> Node)
+    ReliableConnectionRecords.ForEach([this](const FString& /*Key*/, BKReliableConnectionRecord* Record)
     {
-        BKReliableConnectionRecord* Record = Node->GetValue();
         if (Record && !Record->bBeingDeleted)
         {
             BKReferenceCounter SafetyCounter(Record);
@@ -34,13 +57,12 @@ void BKUDPHandler::ClearOtherPartiesRecords()
 {
     if (!bSystemStarted) return;
 
-    BKScopeGuard Guard(&OtherPartiesRecords_Mutex);
-    OtherPartiesRecords.Iterate([this](BKSharedPtr<BKHashNode<FString, BKOtherPartyRecord*>> Node)
+    OtherPartiesRecords.ForEach([this](const FString& /*Key*/, BKOtherPartyRecord* Record)
     {
-        if (Node->GetValue() && !Node->GetValue()->bBeingDeleted)
+        if (Record && !Record->bBeingDeleted)
         {
-            BKReferenceCounter SafetyCounter(Node->GetValue());
-            AddRecordToPendingDeletePool(Node->GetValue());
+            BKReferenceCounter SafetyCounter(Record);
+            AddRecordToPendingDeletePool(Record);
         }
     });
     OtherPartiesRecords.Clear();
@@ -48,91 +70,69 @@ void BKUDPHandler::ClearOtherPartiesRecords()
 
 BKJson::Node BKUDPHandler::AnalyzeNetworkDataWithByteArray(FBKCHARWrapper& Parameter, sockaddr* OtherParty)
 {
-    if (!bSystemStarted || !OtherParty) return BKJson::Node(BKJson::Node::T_INVALID);
-    if (Parameter.GetSize() < 5) return BKJson::Node(BKJson::Node::T_INVALID);
-
-    //Boolean flags operation starts.
-    TArray<bool> ResultOfDecompress;
-    if (!BKUtilities::DecompressBitAsBoolArray(ResultOfDecompress, Parameter, 0, 0)) return BKJson::Node(BKJson::Node::T_INVALID);
-    bool bReliableSYN = ResultOfDecompress[0];
-    bool bReliableSYNSuccess = ResultOfDecompress[1];
-    bool bReliableSYNFailure = ResultOfDecompress[2];
-    bool bReliableSYNACKSuccess = ResultOfDecompress[3];
-    bool bReliableACK = ResultOfDecompress[4];
-    bool bIgnoreTimestamp = ResultOfDecompress[5];
-    bool bDoubleContentCount = ResultOfDecompress[6];
-    //
+    FBKUDPPacketView View;
+    switch (DecodeNetworkData(Parameter, OtherParty, View))
+    {
+        case EBKUDPDecodeResult::Data:
+            return View.ToJson();
+        case EBKUDPDecodeResult::Control:
+            return BKJson::Node(BKJson::Node::T_VALIDATION);
+        default:
+            return BKJson::Node(BKJson::Node::T_INVALID);
+    }
+}
 
-    bool bReliable = bReliableSYN || bReliableSYNSuccess || bReliableSYNFailure || bReliableSYNACKSuccess || bReliableACK;
+EBKUDPDecodeResult BKUDPHandler::DecodeNetworkData(const FBKCHARWrapper& Parameter, sockaddr* OtherParty, FBKUDPPacketView& OutView)
+{
+    if (!bSystemStarted || !OtherParty) return EBKUDPDecodeResult::Invalid;
+    if (!OutView.Parse(Parameter.GetValue(), Parameter.GetSize())) return EBKUDPDecodeResult::Invalid;
 
-    if (bPendingKill && (bReliableSYN || !bReliable)) return BKJson::Node(BKJson::Node::T_INVALID);
+    const bool bReliableSYN = OutView.bReliableSYN;
+    const bool bReliable = OutView.IsReliable();
+    const uint32 MessageID = OutView.MessageID;
 
-    //Reliable operation starts.
-    uint32 MessageID = 0;
-    if (bReliable)
-    {
-        FMemory::Memcpy(&MessageID, Parameter.GetValue() + 1, 4);
-    }
-    //
+    if (bPendingKill && (bReliableSYN || !bReliable)) return EBKUDPDecodeResult::Invalid;
 
+    //Reliable operation starts.
     if (!bReliableSYN && MessageID > 0)
     {
-        if (bReliableSYNSuccess)
+        if (OutView.bReliableSYNSuccess)
         {
             HandleReliableSYNSuccess(OtherParty, MessageID);
         }
-        else if (bReliableSYNFailure)
+        else if (OutView.bReliableSYNFailure)
         {
             HandleReliableSYNFailure(OtherParty, MessageID);
         }
-        else if (bReliableSYNACKSuccess)
+        else if (OutView.bReliableSYNACKSuccess)
         {
             HandleReliableSYNACKSuccess(OtherParty, MessageID);
         }
-        else if (bReliableACK)
+        else if (OutView.bReliableACK)
         {
             HandleReliableACKArrival(OtherParty, MessageID);
         }
         else
         {
-            return BKJson::Node(BKJson::Node::T_INVALID);
+            return EBKUDPDecodeResult::Invalid;
         }
 
-        return BKJson::Node(BKJson::Node::T_VALIDATION);
+        return EBKUDPDecodeResult::Control;
     }
     else if (bReliable && !bReliableSYN && MessageID == 0)
     {
-        return BKJson::Node(BKJson::Node::T_INVALID);
+        return EBKUDPDecodeResult::Invalid;
     }
+    //
 
     //Checksum operations start.
-    const int32 AfterChecksumStartIx = bReliable ? 9 : 5;
-    if (Parameter.GetSize() < (AfterChecksumStartIx + 1))
+    if (!OutView.HasValidChecksum())
     {
         if (bReliableSYN)
         {
             AsReceiverReliableSYNFailure(OtherParty, MessageID);
         }
-        return BKJson::Node(BKJson::Node::T_INVALID);
-    }
-    const int32 ChecksumStartIx = bReliable ? 5 : 1;
-
-    FBKCHARWrapper Hashed = BKUtilities::WBasicRawHash(Parameter, AfterChecksumStartIx, Parameter.GetSize() - AfterChecksumStartIx);
-    for (int32 i = 0; i < 4; i++)
-    {
-        if (Hashed.GetArrayElement(i) != Parameter.GetArrayElement(i + ChecksumStartIx))
-        {
-            if (bReliableSYN)
-            {
-                AsReceiverReliableSYNFailure(OtherParty, MessageID);
-            }
-            Hashed.DeallocateValue();
-            return BKJson::Node(BKJson::Node::T_INVALID);
-        }
-    }
-    if (Hashed.IsValid())
-    {
-        Hashed.DeallocateValue();
+        return EBKUDPDecodeResult::Invalid;
     }
     //
 
@@ -142,53 +142,44 @@ BKJson::Node BKUDPHandler::AnalyzeNetworkDataWithByteArray(FBKCHARWrapper& Param
         {
             FString OtherPartyKey = BKUDPHelper::GetAddressPortFromOtherParty(OtherParty, MessageID, true);
 
-            BKScopeGuard Guard(&OtherPartiesRecords_Mutex);
-
-            BKOtherPartyRecord* FoundValue = nullptr;
-            if (OtherPartiesRecords.Get(OtherPartyKey, FoundValue))
+            OtherPartiesRecords.FindOrInsert(OtherPartyKey, [this, &OtherPartyKey, &OtherPartyRecord](BKOtherPartyRecord*& Record, bool /*bAdded*/)
             {
-                if (!FoundValue || FoundValue->bBeingDeleted)
+                //A record being deleted is replaced, so the map never points to it once the pool frees it.
+                if (!Record || Record->bBeingDeleted)
                 {
-                    FoundValue = new BKOtherPartyRecord(this, OtherPartyKey);
+                    Record = new BKOtherPartyRecord(this, OtherPartyKey);
                 }
                 else
                 {
-                    FoundValue->UpdateLastInteraction();
+                    Record->UpdateLastInteraction();
                 }
-                OtherPartyRecord = FoundValue;
-            }
-            else
-            {
-                OtherPartyRecord = new BKOtherPartyRecord(this, OtherPartyKey);
-                OtherPartiesRecords.Put(OtherPartyKey, OtherPartyRecord);
-            }
+                OtherPartyRecord = Record;
+                return true;
+            });
         }
 
-        uint16 Timestamp = 0;
-        if (!bIgnoreTimestamp)
+        if (!OutView.bIgnoreTimestamp)
         {
-            if (Parameter.GetSize() < (AfterChecksumStartIx + 3 /* + 2 + 1 */))
+            if (!OutView.HasTimestamp())
             {
                 if (bReliableSYN)
                 {
                     AsReceiverReliableSYNFailure(OtherParty, MessageID);
                 }
-                return BKJson::Node(BKJson::Node::T_INVALID);
+                return EBKUDPDecodeResult::Invalid;
             }
 
-            FMemory::Memcpy(&Timestamp, Parameter.GetValue() + AfterChecksumStartIx, 2);
-
             const uint16 LastSendersideTimestamp = OtherPartyRecord->GetLastSendersideTimestamp();
-            if (LastSendersideTimestamp != 0 && Timestamp < LastSendersideTimestamp)
+            if (LastSendersideTimestamp != 0 && OutView.Timestamp < LastSendersideTimestamp)
             {
                 if (bReliableSYN)
                 {
                     AsReceiverReliableSYNFailure(OtherParty, MessageID);
                 }
-                return BKJson::Node(BKJson::Node::T_INVALID);
+                return EBKUDPDecodeResult::Invalid;
             }
 
-            OtherPartyRecord->SetLastSendersideTimestamp(Timestamp);
+            OtherPartyRecord->SetLastSendersideTimestamp(OutView.Timestamp);
         }
         else
         {
@@ -204,194 +195,144 @@ BKJson::Node BKUDPHandler::AnalyzeNetworkDataWithByteArray(FBKCHARWrapper& Param
     }
     //
 
-    //Generic parts decoding starts.
-    const int32 GenericPartStartIx =
-            (bIgnoreTimestamp && bReliable) ? 9 :
-            ((!bIgnoreTimestamp && bReliable) ? 11 :
-             (!bIgnoreTimestamp ? 7 : 5));
+    if (Parameter.GetSize() < (OutView.GetPayloadIndex() + 1)) return EBKUDPDecodeResult::Invalid;
 
-    if (Parameter.GetSize() < (GenericPartStartIx + 1)) return BKJson::Node(BKJson::Node::T_INVALID);
+    return EBKUDPDecodeResult::Data;
+}
 
-    BKJson::Node ResultMap = BKJson::Node(BKJson::Node::T_OBJECT);
+bool BKUDPHandler::BeginPacket(BKUDPPacketBuilder& Builder, uint8 Flags, uint32 ReliableMessageID)
+{
+    if (!bSystemStarted) return false;
 
-    int32 RemainedBytes = Parameter.GetSize() - GenericPartStartIx;
-    while (RemainedBytes > 0)
+    if (LastThissideGeneratedTimestamp == 65535)
     {
-        if (RemainedBytes <= (bDoubleContentCount ? 2 : 1)) break;
+        Flags |= UDP_FLAG_RELIABLE_SYN | UDP_FLAG_IGNORE_TIMESTAMP;
+    }
 
-        ANSICHAR CurrentChar = Parameter.GetArrayElement(Parameter.GetSize() - RemainedBytes);
+    bool bReliable = (Flags & UDP_FLAGS_RELIABLE) != 0;
 
-        //Variable Type
-        auto VariableType = static_cast<uint8>(CurrentChar & 0b00000111);
+    if (bPendingKill && ((Flags & UDP_FLAG_RELIABLE_SYN) || !bReliable)) return false;
 
-        //Variable Content Count
-        uint16 VariableContentCount = 0;
-        auto VariableContentCount_1 = static_cast<uint8>((CurrentChar & 0b11111000) >> 3);
-        if (bDoubleContentCount)
+    //Reliable operations start.
+    bool bReliableValidation = false;
+    uint32 MessageID = 0;
+    if (bReliable)
+    {
+        if (ReliableMessageID != 0)
         {
-            FBKCHARWrapper Wrapper(new ANSICHAR[2], 2, true);
-            Wrapper.SetArrayElement(0, VariableContentCount_1);
-            auto VariableContentCount_2 = Parameter.GetArrayElement(Parameter.GetSize() - RemainedBytes + 1);
-            Wrapper.SetArrayElement(1, VariableContentCount_2);
-            VariableContentCount = static_cast<uint16>(BKUtilities::ConvertByteArrayToInteger(Wrapper, 0, 2));
+            MessageID = ReliableMessageID;
+            bReliableValidation = true;
         }
         else
         {
-            VariableContentCount = VariableContentCount_1;
+            MessageID = LastThissideMessageID.Update([](uint32 Old)
+            {
+                return Old == (uint32)4294967295 ? (uint32)1 : Old + 1;
+            });
         }
+    }
+    //
 
-        RemainedBytes -= (bDoubleContentCount ? 2 : 1);
-
-        if (VariableContentCount == 0) continue;
+    //Timestamp operations start.
+    uint16 Timestamp = 0;
+    if (!bReliableValidation && !(Flags & UDP_FLAG_IGNORE_TIMESTAMP))
+    {
+        //Wraps from 65535 to 0.
+        Timestamp = LastThissideGeneratedTimestamp.Increment();
+    }
+    //
 
-        int32 StartIndex = Parameter.GetSize() - RemainedBytes;
+    return Builder.Start(Flags, MessageID, !bReliableValidation, Timestamp);
+}
 
-        //Boolean Array
-        if (VariableType == 0)
-        {
-            //Variable Content Count: Number of booleans (per: 1 bit)
+bool BKUDPHandler::BeginNetworkData(BKUDPPacketBuilder& Builder, bool bDoubleContentCount, bool bTimeOrderCriticalData, bool bReliableSYN)
+{
+    auto Flags = static_cast<uint8>(
+            (bReliableSYN ? UDP_FLAG_RELIABLE_SYN : 0) |
+            (bTimeOrderCriticalData ? 0 : UDP_FLAG_IGNORE_TIMESTAMP) |
+            (bDoubleContentCount ? UDP_FLAG_DOUBLE_CONTENT_COUNT : 0));
 
-            auto AsByteNo = (uint8)FMath::CeilToInt(((float)VariableContentCount) / 8.0f);
-            if (RemainedBytes < AsByteNo) break;
+    return BeginPacket(Builder, Flags, 0);
+}
 
-            TArray<bool> BoolArray;
-            if (!BKUtilities::DecompressBitAsBoolArray(BoolArray, Parameter, StartIndex, StartIndex + AsByteNo - 1)) break;
+FBKCHARWrapper BKUDPHandler::FinishNetworkData(sockaddr* OtherParty, BKUDPPacketBuilder& Builder)
+{
+    if (!bSystemStarted || !OtherParty) return FBKCHARWrapper();
+    if (!Builder.SealChecksum()) return FBKCHARWrapper();
 
-            RemainedBytes -= AsByteNo;
+    FBKCHARWrapper Result(Builder.GetMutableData(), Builder.Num(), false);
+    if (Builder.GetFlags() & UDP_FLAG_RELIABLE_SYN)
+    {
+        //The record keeps a copy of the packet.
+        HandleReliableSYNDeparture(OtherParty, Result, Builder.GetMessageID());
+    }
+    return Result;
+}
 
-            BoolArray.SetNum(VariableContentCount);
+FBKCHARWrapper BKUDPHandler::MakeValidationPacket(BKUDPPacketBuilder& Builder, sockaddr* OtherParty, uint8 ReliableFlag, uint32 MessageID)
+{
+    if (MessageID == 0) return FBKCHARWrapper();
+    if (!BeginPacket(Builder, static_cast<uint8>(ReliableFlag | UDP_FLAG_IGNORE_TIMESTAMP), MessageID)) return FBKCHARWrapper();
+    return FinishNetworkData(OtherParty, Builder);
+}
 
-            static const FString BooleanArrayString(L"BooleanArray");
+void BKUDPHandler::AddVariablesFromJson(BKUDPPacketBuilder& Builder, BKJson::Node& Parameter)
+{
+    for (const BKJson::NamedNode& NamedNode : Parameter)
+    {
+        EBKUDPVariableType Type;
+        if (!FBKUDPPacketView::FindVariableType(NamedNode.first, Type)) continue;
 
-            BKJson::Node Exists = ResultMap.Get(BooleanArrayString);
-            if (Exists.GetType() == BKJson::Node::Type::T_ARRAY)
-            {
-                for (int32 i = 0; i < VariableContentCount; i++) Exists.Add(BKJson::Node(BoolArray[i]));
-                ResultMap.Remove(BooleanArrayString);
-                ResultMap.Add(BooleanArrayString, Exists);
-            }
-            else
-            {
-                BKJson::Node NewList = BKJson::Node(BKJson::Node::T_ARRAY);
-                for (int32 i = 0; i < VariableContentCount; i++) NewList.Add(BKJson::Node(BoolArray[i]));
-                ResultMap.Add(BooleanArrayString, NewList);
-            }
-        }
-            //Byte Array
-        else if (VariableType == 1)
+        if (Type == EBKUDPVariableType::CharArray)
         {
-            //Variable Content Count: Number of bytes (per: 1 byte)
-
-            if (RemainedBytes < VariableContentCount) break;
-
-            TArray<uint8> ByteArray;
-            for (int32 i = 0; i < VariableContentCount; i++) ByteArray.Add((uint8)Parameter.GetArrayElement(i + StartIndex));
-
-            RemainedBytes -= VariableContentCount;
-
-            static const FString ByteArrayString(L"ByteArray");
-
-            BKJson::Node Exists = ResultMap.Get(ByteArrayString);
-            if (Exists.GetType() == BKJson::Node::Type::T_ARRAY)
-            {
-                for (int32 i = 0; i < VariableContentCount; i++) Exists.Add(BKJson::Node(ByteArray[i]));
-                ResultMap.Remove(ByteArrayString);
-                ResultMap.Add(ByteArrayString, Exists);
-            }
-            else
-            {
-                BKJson::Node NewList = BKJson::Node(BKJson::Node::T_ARRAY);
-                for (int32 i = 0; i < VariableContentCount; i++) NewList.Add(BKJson::Node(ByteArray[i]));
-                ResultMap.Add(ByteArrayString, NewList);
-            }
+            FUtf8String StringAsUtf8(NamedNode.second.ToString(EMPTY_FSTRING_UTF8));
+            Builder.AddChars(StringAsUtf8.GetData(), StringAsUtf8.Len());
+            continue;
         }
-            //Char Array
-        else if (VariableType == 2)
-        {
-            //Variable Content Count: Number of chars (per: 1 byte)
 
-            if (RemainedBytes < VariableContentCount) break;
+        BKJson::Node ValueList = NamedNode.second;
+        if (ValueList.GetType() != BKJson::Node::Type::T_ARRAY) continue;
 
-            const ANSICHAR* StringPart = Parameter.GetValue() + StartIndex;
+        auto Length = static_cast<int32>(ValueList.GetSize());
+        uint8* Section = Builder.AddSection(Type, Length);
+        if (!Section) continue;
 
-            FString CharArray;
-            for (int32 i = 0; i < VariableContentCount; i++)
-            {
-                CharArray.AppendChar(StringPart[i]);
-            }
-
-            RemainedBytes -= VariableContentCount;
-
-            static const FString CharArrayString(L"CharArray");
-
-            BKJson::Node Exists = ResultMap.Get(CharArrayString);
-            if (Exists.GetType() == BKJson::Node::Type::T_STRING)
-            {
-                CharArray = FString(Exists.ToString(EMPTY_FSTRING_UTF8)) + CharArray;
-                ResultMap.Remove(CharArrayString);
-            }
-            ResultMap.Add(CharArrayString, BKJson::Node(CharArray));
-        }
-            //Short, Integer, Float Array
-        else if (VariableType == 3 || VariableType == 4 || VariableType == 5)
+        //Values are written in place; non-numeric elements become zero, non-boolean ones false.
+        for (int32 i = 0; i < Length; i++)
         {
-            //Variable Content Count: Number of shorts (per: 2 bytes)
-            //Variable Content Count: Number of integers (per: 4 bytes)
-            //Variable Content Count: Number of floats (per: 4 bytes)
-
-            auto UnitSize = static_cast<uint8>(VariableType == 3 ? 2 : 4);
-
-            int32 AsArraySize = VariableContentCount * UnitSize;
-            if (RemainedBytes < AsArraySize) break;
-
-            TArray<int32> IntArray;
-            TArray<float> FloatArray;
-            for (int32 i = 0; i < AsArraySize; i += UnitSize)
+            BKJson::Node CurrentData = ValueList.Get(static_cast<size_t>(i));
+            switch (Type)
             {
-                if (VariableType == 5)	FloatArray.Add(BKUtilities::ConvertByteArrayToFloat(Parameter, StartIndex + i, UnitSize));
-                else					IntArray.Add(BKUtilities::ConvertByteArrayToInteger(Parameter, StartIndex + i, UnitSize));
-            }
-
-            RemainedBytes -= AsArraySize;
-
-            static const FString ShortArrayString(L"ShortArray");
-            static const FString IntegerArrayString(L"IntegerArray");
-            static const FString FloatArrayString(L"FloatArray");
-
-            FString Key = VariableType == 3 ? ShortArrayString : (VariableType == 4 ? IntegerArrayString : FloatArrayString);
-            BKJson::Node Exists = ResultMap.Get(Key);
-            if (Exists.GetType() == BKJson::Node::Type::T_ARRAY)
-            {
-                if (VariableType == 5)
-                {
-                    for (int32 i = 0; i < VariableContentCount; i++) Exists.Add(BKJson::Node(FloatArray[i]));
-                }
-                else
+                case EBKUDPVariableType::BooleanArray:
+                    if (CurrentData.IsBoolean() && CurrentData.ToBoolean(false))
+                    {
+                        Section[i >> 3] |= static_cast<uint8>(1 << (i & 7));
+                    }
+                    break;
+                case EBKUDPVariableType::ByteArray:
+                    Section[i] = static_cast<uint8>(CurrentData.ToInteger(0));
+                    break;
+                case EBKUDPVariableType::ShortArray:
                 {
-                    for (int32 i = 0; i < VariableContentCount; i++) Exists.Add(BKJson::Node(IntArray[i]));
+                    auto Value = static_cast<int16>(CurrentData.ToInteger(0));
+                    FMemory::Memcpy(Section + i * 2, &Value, 2);
+                    break;
                 }
-                ResultMap.Remove(Key);
-                ResultMap.Add(Key, Exists);
-            }
-            else
-            {
-                BKJson::Node NewList = BKJson::Node(BKJson::Node::T_ARRAY);
-
-                if (VariableType == 5)
+                case EBKUDPVariableType::IntegerArray:
                 {
-                    for (int32 i = 0; i < VariableContentCount; i++) NewList.Add(BKJson::Node(FloatArray[i]));
+                    int32 Value = CurrentData.ToInteger(0);
+                    FMemory::Memcpy(Section + i * 4, &Value, 4);
+                    break;
                 }
-                else
+                default:
                 {
-                    for (int32 i = 0; i < VariableContentCount; i++) NewList.Add(BKJson::Node(IntArray[i]));
+                    float Value = CurrentData.ToFloat(0.0f);
+                    FMemory::Memcpy(Section + i * 4, &Value, 4);
+                    break;
                 }
-                ResultMap.Add(Key, NewList);
             }
         }
     }
-    //
-
-    return ResultMap;
 }
 
 FBKCHARWrapper BKUDPHandler::MakeByteArrayForNetworkData(
@@ -412,265 +353,31 @@ FBKCHARWrapper BKUDPHandler::MakeByteArrayForNetworkData(
          (Parameter.IsValidation() && ReliableMessageID == 0)))
         return FBKCHARWrapper();
 
-    TArray<ANSICHAR> Result;
+    auto Flags = static_cast<uint8>(
+            (bReliableSYN ? UDP_FLAG_RELIABLE_SYN : 0) |
+            (bReliableSYNSuccess ? UDP_FLAG_RELIABLE_SYN_SUCCESS : 0) |
+            (bReliableSYNFailure ? UDP_FLAG_RELIABLE_SYN_FAILURE : 0) |
+            (bReliableSYNACKSuccess ? UDP_FLAG_RELIABLE_SYN_ACK_SUCCESS : 0) |
+            (bReliableACK ? UDP_FLAG_RELIABLE_ACK : 0) |
+            (bTimeOrderCriticalData ? 0 : UDP_FLAG_IGNORE_TIMESTAMP) |
+            (bDoubleContentCount ? UDP_FLAG_DOUBLE_CONTENT_COUNT : 0));
 
-    if (LastThissideGeneratedTimestamp == 65535)
-    {
-        bReliableSYN = true;
-        bTimeOrderCriticalData = false;
-    }
-
-    //Boolean flags operation starts.
-    TArray<bool> Flags;
-    Flags.Add(bReliableSYN);
-    Flags.Add(bReliableSYNSuccess);
-    Flags.Add(bReliableSYNFailure);
-    Flags.Add(bReliableSYNACKSuccess);
-    Flags.Add(bReliableACK);
-    Flags.Add(!bTimeOrderCriticalData);
-    Flags.Add(bDoubleContentCount);
-
-    bool bReliable = bReliableSYN || bReliableSYNSuccess || bReliableSYNFailure || bReliableSYNACKSuccess || bReliableACK;
-
-    if (bPendingKill && (bReliableSYN || !bReliable)) return FBKCHARWrapper();
-
-    FBKCHARWrapper CompressedFlags(new ANSICHAR[1], 1, true);
-    if (!BKUtilities::CompressBooleanAsBit(CompressedFlags, Flags)) return FBKCHARWrapper();
-
-    Result.Add(CompressedFlags.GetArrayElement(0));
-    //
+    //Packets usually fit in UDP_BUFFER_SIZE, so they are built on the stack.
+    ANSICHAR Storage[UDP_BUFFER_SIZE];
+    BKUDPPacketBuilder Builder(Storage, UDP_BUFFER_SIZE, true);
+    if (!BeginPacket(Builder, Flags, static_cast<uint32>(ReliableMessageID))) return FBKCHARWrapper();
 
-    //Reliable operations start.
-    bool bReliableValidation = false;
-    uint32 MessageID = 0;
-    if (bReliable)
+    if (Builder.CanHoldVariables())
     {
-        if (ReliableMessageID != 0)
-        {
-            MessageID = (uint32)ReliableMessageID;
-            bReliableValidation = true;
-        }
-        else
-        {
-            BKScopeGuard Guard(&LastThissideMessageID_Mutex);
-
-            if (LastThissideMessageID == (uint32)4294967295) LastThissideMessageID = 1;
-            else LastThissideMessageID++;
-
-            MessageID = LastThissideMessageID;
-        }
-
-        FBKCHARWrapper ConvertedMessageID(new ANSICHAR[4], 4, true);
-        FMemory::Memcpy(ConvertedMessageID.GetValue(), &MessageID, 4);
-        for (int32 i = 0; i < 4; i++) Result.Add(ConvertedMessageID.GetArrayElement(i));
+        AddVariablesFromJson(Builder, Parameter);
     }
-    //
-
-    if (!bReliableValidation)
-    {
-        //Checksum initial operation starts.
-        int32 ChecksumInsertIx = Result.Num();
-        //
-
-        //Timestamp operations start.
-        if (bTimeOrderCriticalData)
-        {
-            uint16 Timestamp;
-            {
-                BKScopeGuard Guard(&LastThissideGeneratedTimestamp_Mutex);
-
-                if (LastThissideGeneratedTimestamp == (uint16)65535) LastThissideGeneratedTimestamp = 0;
-                else LastThissideGeneratedTimestamp++;
-
-                Timestamp = LastThissideGeneratedTimestamp;
-            }
 
-            FBKCHARWrapper ConvertedTimestamp(new ANSICHAR[2], 2, true);
-            FMemory::Memcpy(ConvertedTimestamp.GetValue(), &Timestamp, 2);
-            for (int32 i = 0; i < 2; i++) Result.Add(ConvertedTimestamp.GetArrayElement(i));
-        }
-        //
-
-        auto MaxValue = static_cast<uint16>(bDoubleContentCount ? 8192 : 32);
-
-        //Generic parts encoding starts.
-        for (const BKJson::NamedNode& NamedNode : Parameter)
-        {
-            uint16 InfoByte;
+    FBKCHARWrapper Packet = FinishNetworkData(OtherParty, Builder);
+    if (!Packet.IsValid()) return FBKCHARWrapper();
 
-            static const FString CharArrayString(L"CharArray");
-
-            FString KeyString = NamedNode.first;
-            if (KeyString == CharArrayString)
-            {
-                FString ValueString = NamedNode.second.ToString(EMPTY_FSTRING_UTF8);
-
-                auto StringAsAnsiArray = ValueString.GetAnsiCharString();
-                int32 Length = StringAsAnsiArray.length();
-                if (Length > 0 && Length < MaxValue)
-                {
-                    InfoByte = 2;
-                    InfoByte |= Length << 3;
-
-                    FBKCHARWrapper Wrapper(new ANSICHAR[2], 2, true);
-                    BKUtilities::ConvertIntegerToByteArray(InfoByte, Wrapper, 2);
-                    Result.Add(Wrapper.GetArrayElement(0));
-                    if (bDoubleContentCount)
-                    {
-                        Result.Add(Wrapper.GetArrayElement(1));
-                    }
-
-                    for (uint32 i = 0; i < Length; i++) Result.Add(StringAsAnsiArray.at(i));
-                }
-            }
-            else
-            {
-                BKJson::Node ValueList = NamedNode.second;
-                if (ValueList.GetType() == BKJson::Node::Type::T_ARRAY)
-                {
-                    auto Length = (ANSICHAR)ValueList.GetSize();
-                    if (Length > 0 && Length < MaxValue)
-                    {
-                        static const FString BooleanArrayString(L"BooleanArray");
-
-                        if (KeyString == BooleanArrayString)
-                        {
-                            InfoByte = 0;
-
-                            auto ByteSizeOfCompressed = static_cast<uint8>(BKUtilities::GetDestinationLengthBeforeCompressBoolArray(Length));
-                            if (ByteSizeOfCompressed <= 0) continue;
-
-                            TArray<bool> DecompressedArray;
-                            for (int32 i = 0; i < Length; i++)
-                            {
-                                if (BKJson::Node AsValue = ValueList.Get(static_cast<size_t>(i)))
-                                {
-                                    if (AsValue.IsBoolean())
-                                    {
-                                        DecompressedArray.Add(AsValue.ToBoolean(false));
-                                    }
-                                }
-                            }
-                            if (DecompressedArray.Num() == 0) continue;
-
-                            FBKCHARWrapper CompressedArray(new ANSICHAR[ByteSizeOfCompressed], ByteSizeOfCompressed, true);
-                            if (!BKUtilities::CompressBooleanAsBit(CompressedArray, DecompressedArray)) continue;
-                            if (CompressedArray.GetSize() == 0) continue;
-
-                            InfoByte |= Length << 3;
-
-                            FBKCHARWrapper Wrapper(new ANSICHAR[2], 2, true);
-                            BKUtilities::ConvertIntegerToByteArray(InfoByte, Wrapper, 2);
-                            Result.Add(Wrapper.GetArrayElement(0));
-                            if (bDoubleContentCount)
-                            {
-                                Result.Add(Wrapper.GetArrayElement(1));
-                            }
-
-                            for (int32 i = 0; i < CompressedArray.GetSize(); i++) Result.Add(CompressedArray.GetArrayElement(i));
-                        }
-                        else
-                        {
-                            static const FString ByteArrayString(L"ByteArray");
-                            static const FString ShortArrayString(L"ShortArray");
-                            static const FString IntegerArrayString(L"IntegerArray");
-                            static const FString FloatArrayString(L"FloatArray");
-
-                            uint8 UnitSize;
-                            uint8 BasicType = 0;
-                            if (KeyString == ByteArrayString)
-                            {
-                                InfoByte = 1;
-                                UnitSize = 1;
-                                BasicType = 0;
-                            }
-                            else if (KeyString == ShortArrayString)
-                            {
-                                InfoByte = 3;
-                                UnitSize = 2;
-                                BasicType = 1;
-                            }
-                            else if (KeyString == IntegerArrayString)
-                            {
-                                InfoByte = 4;
-                                UnitSize = 4;
-                                BasicType = 2;
-                            }
-                            else if (KeyString == FloatArrayString)
-                            {
-                                InfoByte = 5;
-                                UnitSize = 4;
-                                BasicType = 3;
-                            }
-                            else continue;
-
-                            InfoByte |= Length << 3;
-
-                            FBKCHARWrapper Wrapper(new ANSICHAR[2], 2, true);
-                            BKUtilities::ConvertIntegerToByteArray(InfoByte, Wrapper, 2);
-                            Result.Add(Wrapper.GetArrayElement(0));
-                            if (bDoubleContentCount)
-                            {
-                                Result.Add(Wrapper.GetArrayElement(1));
-                            }
-
-                            bool bFilled = false;
-                            for (int32 i = 0; i < Length; i++)
-                            {
-                                if (BKJson::Node CurrentData = ValueList.Get(static_cast<size_t>(i)))
-                                {
-                                    FBKCHARWrapper ConvertedValue(new ANSICHAR[UnitSize], UnitSize, true);
-
-                                    if (BasicType == 0)
-                                    {
-                                        auto Val = static_cast<uint8>(CurrentData.ToInteger(0));
-                                        FMemory::Memcpy(ConvertedValue.GetValue(), &Val, UnitSize);
-                                    }
-                                    else if (BasicType == 1 || BasicType == 2)
-                                    {
-                                        int32 Val = CurrentData.ToInteger(0);
-                                        FMemory::Memcpy(ConvertedValue.GetValue(), &Val, UnitSize);
-                                    }
-                                    else
-                                    {
-                                        float Val = CurrentData.ToFloat(0.0f);
-                                        FMemory::Memcpy(ConvertedValue.GetValue(), &Val, UnitSize);
-                                    }
-
-                                    for (int32 j = 0; j < UnitSize; j++) Result.Add(ConvertedValue.GetArrayElement(j));
-                                    bFilled = true;
-                                }
-                            }
-                            if (!bFilled) Result.RemoveAt(Result.Num() - 1);
-                        }
-                    }
-                }
-            }
-        }
-        //
-
-        //Checksum final operation starts.
-        int32 ChecksumDestinationSize = Result.Num() - ChecksumInsertIx;
-        if (ChecksumDestinationSize == 0) return FBKCHARWrapper();
-
-        FBKCHARWrapper WCHARWrapper(Result.GetMutableData() + ChecksumInsertIx, ChecksumDestinationSize, false);
-
-        FBKCHARWrapper Hashed = BKUtilities::WBasicRawHash(WCHARWrapper, 0, ChecksumDestinationSize);
-        Result.Insert(Hashed.GetValue(), 4, ChecksumInsertIx);
-        Hashed.DeallocateValue();
-        //
-    }
-
-    auto ResultArray = new ANSICHAR[Result.Num()];
-    FMemory::Memcpy(ResultArray, Result.GetData(), static_cast<WSIZE__T>(Result.Num()));
-
-    FBKCHARWrapper ResultWrapper(ResultArray, Result.Num(), false);
-    if (bReliableSYN)
-    {
-        HandleReliableSYNDeparture(OtherParty, ResultWrapper, MessageID);
-    }
-
-    return ResultWrapper;
+    auto ResultArray = new ANSICHAR[Packet.GetSize()];
+    FMemory::Memcpy(ResultArray, Packet.GetValue(), static_cast<WSIZE__T>(Packet.GetSize()));
+    return FBKCHARWrapper(ResultArray, Packet.GetSize(), false);
 }
 
 BKReliableConnectionRecord* BKUDPHandler::Create_AddOrGet_ReliableConnectionRecord(sockaddr* OtherParty, uint32 MessageID, FBKCHARWrapper& Buffer, bool bAsSender, uint8 EnsureHandshakingStatusEqualsTo, bool bIgnoreFailure)
@@ -681,48 +388,42 @@ BKReliableConnectionRecord* BKUDPHandler::Create_AddOrGet_ReliableConnectionReco
 
     FString OtherPartyKey = BKUDPHelper::GetAddressPortFromOtherParty(OtherParty, MessageID);
 
-    uint8 ExistingHandshakeStatus = RELIABLE_CONNECTION_NOT_FOUND;
     BKReliableConnectionRecord* ReliableConnection = nullptr;
+    bool bKept = ReliableConnectionRecords.FindOrInsert(OtherPartyKey, [&](BKReliableConnectionRecord*& Record, bool /*bAdded*/)
     {
-        BKScopeGuard Guard(&ReliableConnectionRecords_Mutex);
-
-        BKReliableConnectionRecord* FoundValue = nullptr;
-        if (ReliableConnectionRecords.Get(OtherPartyKey, FoundValue))
+        if (Record)
         {
-            BKReliableConnectionRecord* Record = FoundValue;
-            if (Record)
+            if (Record->bBeingDeleted)
             {
-                if (Record->bBeingDeleted)
-                {
-                    return nullptr;
-                }
-
-                BKReferenceCounter SafetyCounter(Record);
+                return true;
+            }
 
-                ExistingHandshakeStatus = Record->GetHandshakingStatus();
+            BKReferenceCounter SafetyCounter(Record);
 
-                if (Record->GetSendersideMessageID() == MessageID &&
-                    Record->GetHandshakingStatus() == EnsureHandshakingStatusEqualsTo &&
-                    (bIgnoreFailure || Record->FailureTrialCount < 5))
+            if (Record->GetSendersideMessageID() == MessageID &&
+                Record->GetHandshakingStatus() == EnsureHandshakingStatusEqualsTo &&
+                (bIgnoreFailure || Record->FailureTrialCount < 5))
+            {
+                ReliableConnection = Record;
+                if (Buffer.IsValid())
                 {
-                    ReliableConnection = Record;
-                    if (Buffer.IsValid())
-                    {
-                        ReliableConnection->ReplaceBuffer(Buffer);
-                    }
+                    ReliableConnection->ReplaceBuffer(Buffer);
                 }
-                Record->UpdateLastInteraction();
             }
-            else
-            {
-                RemoveFromReliableConnections(OtherPartyKey);
-            }
-        }
-        if (EnsureHandshakingStatusEqualsTo == 0 && ExistingHandshakeStatus == RELIABLE_CONNECTION_NOT_FOUND && !ReliableConnection)
-        {
-            ReliableConnection = new BKReliableConnectionRecord(this, MessageID, *OtherParty, OtherPartyKey, Buffer, bAsSender);
-            ReliableConnectionRecords.Put(OtherPartyKey, ReliableConnection);
+            Record->UpdateLastInteraction();
+            return true;
         }
+
+        //Newly added, or a stale null entry: only create a record when allowed to, otherwise drop the entry.
+        if (EnsureHandshakingStatusEqualsTo != 0) return false;
+
+        Record = new BKReliableConnectionRecord(this, MessageID, *OtherParty, OtherPartyKey, Buffer, bAsSender);
+        ReliableConnection = Record;
+        return true;
+    });
+    if (!bKept)
+    {
+        TryCallReadyToDieCallback();
     }
     return ReliableConnection;
 }
@@ -731,7 +432,6 @@ void BKUDPHandler::CloseCase(BKReliableConnectionRecord* Record)
     if (!Record || Record->bBeingDeleted) return;
     BKReferenceCounter SafetyCounter(Record);
 
-    BKScopeGuard Guard(&ReliableConnectionRecords_Mutex);
     RemoveFromReliableConnections(Record->GetOtherPartyKey());
 
     AddRecordToPendingDeletePool(Record);
@@ -743,7 +443,9 @@ void BKUDPHandler::AsReceiverReliableSYNSuccess(sockaddr* OtherParty, uint32 Mes
     //Send SYN-ACK
     //BKUtilities::Print(EBKLogType::Log, "Send SYN-ACK: " + FString::FromInt(MessageID));
 
-    FBKCHARWrapper WrappedFinalData = MakeByteArrayForNetworkData(OtherParty, BKJson::Node(BKJson::Node::T_VALIDATION), false, false, false, true, false, false, false, MessageID);
+    ANSICHAR PacketStorage[UDP_PACKET_MAX_HEADER_SIZE];
+    BKUDPPacketBuilder Builder(PacketStorage, UDP_PACKET_MAX_HEADER_SIZE);
+    FBKCHARWrapper WrappedFinalData = MakeValidationPacket(Builder, OtherParty, UDP_FLAG_RELIABLE_SYN_SUCCESS, MessageID);
 
     BKReliableConnectionRecord* Record = Create_AddOrGet_ReliableConnectionRecord(OtherParty, MessageID, WrappedFinalData, false, 0, false);
     if (Record)
@@ -761,8 +463,6 @@ void BKUDPHandler::AsReceiverReliableSYNSuccess(sockaddr* OtherParty, uint32 Mes
             Record->FailureTrialCount = 0;
         }
     }
-
-    WrappedFinalData.DeallocateValue();
 }
 void BKUDPHandler::AsReceiverReliableSYNFailure(sockaddr* OtherParty, uint32 MessageID) //Receiver
 {
@@ -771,7 +471,9 @@ void BKUDPHandler::AsReceiverReliableSYNFailure(sockaddr* OtherParty, uint32 Mes
     //Send SYN-fail
     //BKUtilities::Print(EBKLogType::Log, "Send SYN-fail: " + FString::FromInt(MessageID));
 
-    FBKCHARWrapper WrappedFinalData = MakeByteArrayForNetworkData(OtherParty, BKJson::Node(BKJson::Node::T_VALIDATION), false, false, false, false, true, false, false, MessageID);
+    ANSICHAR PacketStorage[UDP_PACKET_MAX_HEADER_SIZE];
+    BKUDPPacketBuilder Builder(PacketStorage, UDP_PACKET_MAX_HEADER_SIZE);
+    FBKCHARWrapper WrappedFinalData = MakeValidationPacket(Builder, OtherParty, UDP_FLAG_RELIABLE_SYN_FAILURE, MessageID);
 
     BKReliableConnectionRecord* Record = Create_AddOrGet_ReliableConnectionRecord(OtherParty, MessageID, WrappedFinalData, false, 0, true);
     if (Record)
@@ -780,12 +482,10 @@ void BKUDPHandler::AsReceiverReliableSYNFailure(sockaddr* OtherParty, uint32 Mes
         //We are receiver, to receive actual buffer again, we should not increase FailureCount.
         Record->FailureTrialCount = 0;
     }
-
-    WrappedFinalData.DeallocateValue();
 }
 void BKUDPHandler::HandleReliableSYNDeparture(sockaddr* OtherParty, FBKCHARWrapper& Buffer, uint32 MessageID) //Sender
 {
-    //This is called by MakeByteArrayForNetworkData
+    //This is called by FinishNetworkData
     if (!bSystemStarted) return;
 
     //Set the case
@@ -805,7 +505,9 @@ void BKUDPHandler::HandleReliableSYNSuccess(sockaddr* OtherParty, uint32 Message
     //Send ACK
     //BKUtilities::Print(EBKLogType::Log, "Send ACK: " + FString::FromInt(MessageID));
 
-    FBKCHARWrapper WrappedFinalData = MakeByteArrayForNetworkData(OtherParty, BKJson::Node(BKJson::Node::T_VALIDATION), false, false, false, false, false, true, false, MessageID);
+    ANSICHAR PacketStorage[UDP_PACKET_MAX_HEADER_SIZE];
+    BKUDPPacketBuilder Builder(PacketStorage, UDP_PACKET_MAX_HEADER_SIZE);
+    FBKCHARWrapper WrappedFinalData = MakeValidationPacket(Builder, OtherParty, UDP_FLAG_RELIABLE_SYN_ACK_SUCCESS, MessageID);
 
     BKReliableConnectionRecord* Record = Create_AddOrGet_ReliableConnectionRecord(OtherParty, MessageID, WrappedFinalData, true, 1, false);
     if (Record)
@@ -823,8 +525,6 @@ void BKUDPHandler::HandleReliableSYNSuccess(sockaddr* OtherParty, uint32 Message
             Record->FailureTrialCount = 0;
         }
     }
-
-    WrappedFinalData.DeallocateValue();
 }
 void BKUDPHandler::HandleReliableSYNFailure(sockaddr* OtherParty, uint32 MessageID) //Sender
 {
@@ -849,7 +549,9 @@ void BKUDPHandler::HandleReliableSYNACKSuccess(sockaddr* OtherParty, uint32 Mess
     //ACK received. Send ACK-ACK, then close the case.
     //BKUtilities::Print(EBKLogType::Log, "ACK received. Send ACK-ACK, then close the case: " + FString::FromInt(MessageID));
 
-    FBKCHARWrapper WrappedFinalData = MakeByteArrayForNetworkData(OtherParty, BKJson::Node(BKJson::Node::T_VALIDATION), false, false, false, false, false, false, true, MessageID);
+    ANSICHAR PacketStorage[UDP_PACKET_MAX_HEADER_SIZE];
+    BKUDPPacketBuilder Builder(PacketStorage, UDP_PACKET_MAX_HEADER_SIZE);
+    FBKCHARWrapper WrappedFinalData = MakeValidationPacket(Builder, OtherParty, UDP_FLAG_RELIABLE_ACK, MessageID);
 
     BKReliableConnectionRecord* Record = Create_AddOrGet_ReliableConnectionRecord(OtherParty, MessageID, WrappedFinalData, false, 2, false);
     if (Record)
@@ -868,8 +570,6 @@ void BKUDPHandler::HandleReliableSYNACKSuccess(sockaddr* OtherParty, uint32 Mess
         }
     }
 
-    WrappedFinalData.DeallocateValue();
-
     if (Record)
     {
         CloseCase(Record);
@@ -894,19 +594,21 @@ void BKUDPHandler::HandleReliableACKArrival(sockaddr* OtherParty, uint32 Message
 void BKUDPHandler::ClearUDPRecordsForTimeoutCheck()
 {
     if (!bSystemStarted) return;
-    UDPRecordsForTimeoutCheck.Clear();
+
+    BKUDPRecord* Record = nullptr;
+    while (UDPRecordsForTimeoutCheck.Pop(Record)) {}
 }
 
 void BKUDPHandler::ClearPendingDeletePool()
 {
     if (!bSystemStarted) return;
 
-    BKScopeGuard Guard(&UDPRecords_PendingDeletePool_Mutex);
-    UDPRecords_PendingDeletePool.Iterate([this](BKSharedPtr<BKHashNode<BKUDPRecord*, uint64>> Node)
+    BKFastScopeGuard Guard(&UDPRecords_PendingDeletePool_Mutex);
+    UDPRecords_PendingDeletePool.ForEach([](BKUDPRecord* DeleteRecord, uint64 /*PooledTimestamp*/)
     {
-        if (Node->GetKey())
+        if (DeleteRecord)
         {
-            delete (Node->GetKey());
+            delete (DeleteRecord);
         }
     });
     UDPRecords_PendingDeletePool.Clear();
@@ -933,7 +635,7 @@ void BKUDPHandler::StartSystem()
     bSystemStarted = true;
 
     TArray<BKAsyncTaskParameter*> SelfAsArray(this);
-    BKFutureAsyncTask TimeoutLambda = [](TArray<BKAsyncTaskParameter*> TaskParameters)
+    BKFutureAsyncTask TimeoutLambda = [](const TArray<BKAsyncTaskParameter*>& TaskParameters)
     {
         BKUDPHandler* HandlerInstance = nullptr;
         if (TaskParameters.Num() > 0 && TaskParameters[0])
@@ -944,12 +646,15 @@ void BKUDPHandler::StartSystem()
 
         uint64 CurrentTimestamp = BKUtilities::GetTimeStampInMS();
 
-        BKQueue<BKUDPRecord*> Tmp_RecordsForTimeoutCheck;
-
+        //Records pushed while the check runs stay in the queue for the next run.
         BKQueue<BKUDPRecord*> CurrentSnapshotOf_RecordsForTimeoutCheck;
-        HandlerInstance->UDPRecordsForTimeoutCheck.CopyTo(CurrentSnapshotOf_RecordsForTimeoutCheck, true);
-
         BKUDPRecord* Record = nullptr;
+        for (int32 SnapshotSize = HandlerInstance->UDPRecordsForTimeoutCheck.Size(); SnapshotSize > 0; SnapshotSize--)
+        {
+            if (!HandlerInstance->UDPRecordsForTimeoutCheck.Pop(Record)) break;
+            CurrentSnapshotOf_RecordsForTimeoutCheck.Push(Record);
+        }
+
         while (CurrentSnapshotOf_RecordsForTimeoutCheck.Pop(Record))
         {
             if (Record)
@@ -972,8 +677,7 @@ void BKUDPHandler::StartSystem()
                             auto AsOtherPartyRecord = reinterpret_cast<BKOtherPartyRecord*>(Record);
                             if (AsOtherPartyRecord)
                             {
-                                BKScopeGuard OtherPartiesRecords_Guard(&HandlerInstance->OtherPartiesRecords_Mutex);
-                                HandlerInstance->OtherPartiesRecords.Remove(AsOtherPartyRecord->GetOtherPartyKey());
+                                HandlerInstance->OtherPartiesRecords.RemoveValue(AsOtherPartyRecord->GetOtherPartyKey(), AsOtherPartyRecord);
                             }
                         }
                         else if (Record->GetType() == EBKReliableRecordType::ReliableConnectionRecord)
@@ -981,7 +685,6 @@ void BKUDPHandler::StartSystem()
                             auto AsReliableConnectionRecord = reinterpret_cast<BKReliableConnectionRecord*>(Record);
                             if (AsReliableConnectionRecord)
                             {
-                                BKScopeGuard ReliableConnectionRecords_Guard(&HandlerInstance->ReliableConnectionRecords_Mutex);
                                 HandlerInstance->RemoveFromReliableConnections(AsReliableConnectionRecord->GetOtherPartyKey());
                             }
                         }
@@ -992,16 +695,14 @@ void BKUDPHandler::StartSystem()
 
                 if (!bDeleted)
                 {
-                    Tmp_RecordsForTimeoutCheck.Push(Record);
+                    HandlerInstance->UDPRecordsForTimeoutCheck.Push(Record);
                 }
             }
         }
-
-        HandlerInstance->UDPRecordsForTimeoutCheck.AddAll_NotTSTemporaryQueue(Tmp_RecordsForTimeoutCheck);
     };
-    BKScheduledAsyncTaskManager::NewScheduledAsyncTask(TimeoutLambda, SelfAsArray, TIMEOUT_CHECK_TIME_INTERVAL, true, true);
+    BKScheduledAsyncTaskManager::NewScheduledAsyncTask(TimeoutLambda, SelfAsArray, TIMEOUT_CHECK_TIME_INTERVAL, true, true, EBKTaskPriority::LatencyCritical);
 
-    BKFutureAsyncTask DeallocatorLambda = [](TArray<BKAsyncTaskParameter*> TaskParameters)
+    BKFutureAsyncTask DeallocatorLambda = [](const TArray<BKAsyncTaskParameter*>& TaskParameters)
     {
         BKUDPHandler* HandlerInstance = nullptr;
         if (TaskParameters.Num() > 0 && TaskParameters[0])
@@ -1012,23 +713,18 @@ void BKUDPHandler::StartSystem()
 
         uint64 CurrentTimestamp = BKUtilities::GetTimeStampInMS();
 
-        BKScopeGuard Guard(&HandlerInstance->UDPRecords_PendingDeletePool_Mutex);
-        HandlerInstance->UDPRecords_PendingDeletePool.Iterate([HandlerInstance, CurrentTimestamp](BKSharedPtr<BKHashNode<BKUDPRecord*, uint64>> Node)
+        BKFastScopeGuard Guard(&HandlerInstance->UDPRecords_PendingDeletePool_Mutex);
+        HandlerInstance->UDPRecords_PendingDeletePool.RemoveIf([CurrentTimestamp](BKUDPRecord* DeleteRecord, uint64 PooledTimestamp)
         {
-            BKUDPRecord* DeleteRecord = Node->GetKey();
-            uint64 PooledTimestamp = Node->GetValue();
-
-            if (DeleteRecord)
+            if (DeleteRecord && !DeleteRecord->IsReferenced() && (CurrentTimestamp - PooledTimestamp) > PENDING_DELETE_CHECK_TIME_INTERVAL)
             {
-                if (!DeleteRecord->IsReferenced() && (CurrentTimestamp - PooledTimestamp) > PENDING_DELETE_CHECK_TIME_INTERVAL)
-                {
-                    HandlerInstance->UDPRecords_PendingDeletePool.Remove(DeleteRecord);
-                    delete (DeleteRecord);
-                }
+                delete (DeleteRecord);
+                return true;
             }
+            return false;
         });
     };
-    BKScheduledAsyncTaskManager::NewScheduledAsyncTask(DeallocatorLambda, SelfAsArray, PENDING_DELETE_CHECK_TIME_INTERVAL, true, true);
+    BKScheduledAsyncTaskManager::NewScheduledAsyncTask(DeallocatorLambda, SelfAsArray, PENDING_DELETE_CHECK_TIME_INTERVAL, true, true, EBKTaskPriority::Background);
 }
 void BKUDPHandler::EndSystem()
 {
@@ -1045,66 +741,157 @@ void BKUDPHandler::EndSystem()
     LastThissideGeneratedTimestamp = 0;
 }
 
-#if PLATFORM_WINDOWS
 void BKUDPHandler::Send(sockaddr* OtherParty, const FBKCHARWrapper& SendBuffer)
-#else
-void BKUDPHandler::Send(sockaddr* OtherParty, const FBKCHARWrapper& SendBuffer)
-#endif
 {
     if (!bSystemStarted) return;
 
     if (!OtherParty) return;
     if (SendBuffer.GetSize() == 0) return;
 
-#if PLATFORM_WINDOWS
-    int32 OtherPartyLen = sizeof(*OtherParty);
-#else
-    socklen_t OtherPartyLen = sizeof(*OtherParty);
-#endif
-    int32 SentLength;
-    BKScopeGuard SendGuard(&SendMutex);
+    const auto Size = static_cast<int32>(SendBuffer.GetSize());
+    bool bSender = false;
     {
-#if PLATFORM_WINDOWS
-        SentLength = static_cast<int32>(sendto(UDPSocket_Ref, SendBuffer.GetValue(), static_cast<size_t>(SendBuffer.GetSize()), 0, OtherParty, OtherPartyLen));
-#else
-        SentLength = static_cast<int32>(sendto(UDPSocket_Ref, SendBuffer.GetValue(), static_cast<size_t>(SendBuffer.GetSize()), MSG_NOSIGNAL, OtherParty, OtherPartyLen));
-#endif
+        BKFastScopeGuard SendGuard(&SendMutex);
+        if (!bSending)
+        {
+            bSending = true;
+            bSender = true;
+        }
+        else if (PendingSendCount < SendBatchSize && Size <= UDP_BUFFER_SIZE)
+        {
+            FBKPendingSend& Pending = PendingSends[PendingSendCount++];
+            FMemory::Memcpy(&Pending.OtherParty, OtherParty, sizeof(sockaddr));
+            FMemory::Memcpy(Pending.Data, SendBuffer.GetValue(), static_cast<WSIZE__T>(Size));
+            Pending.Size = Size;
+            return;
+        }
+        //Otherwise the queue is full (or the packet does not fit a slot); send it right away.
     }
 
+    SendOne(OtherParty, SendBuffer.GetValue(), Size);
+    if (!bSender) return;
+
+    //Takes over what the other threads queued meanwhile, until the queue stays empty.
+    while (true)
+    {
+        int32 Count;
+        {
+            BKFastScopeGuard SendGuard(&SendMutex);
+            if (PendingSendCount == 0)
+            {
+                bSending = false;
+                return;
+            }
+            FBKPendingSend* Swap = PendingSends;
+            PendingSends = InFlightSends;
+            InFlightSends = Swap;
+            Count = PendingSendCount;
+            PendingSendCount = 0;
+        }
+        SendInFlight(Count);
+    }
+}
+
+void BKUDPHandler::SendOne(sockaddr* OtherParty, const ANSICHAR* Data, int32 Size)
+{
 #if PLATFORM_WINDOWS
+    int32 OtherPartyLen = sizeof(*OtherParty);
+    auto SentLength = static_cast<int32>(sendto(UDPSocket_Ref, Data, static_cast<size_t>(Size), 0, OtherParty, OtherPartyLen));
     if (SentLength == SOCKET_ERROR)
     {
         BKUtilities::Print(EBKLogType::Error, FString(L"BKUDPHandler: Socket send failed with error: ") + BKUtilities::WGetSafeErrorMessage());
+        return;
     }
 #else
+    socklen_t OtherPartyLen = sizeof(*OtherParty);
+    auto SentLength = static_cast<int32>(sendto(UDPSocket_Ref, Data, static_cast<size_t>(Size), MSG_NOSIGNAL, OtherParty, OtherPartyLen));
     if (SentLength == -1)
     {
         BKUtilities::Print(EBKLogType::Error, FString(L"BKUDPHandler: Socket send failed with error: ") + BKUtilities::WGetSafeErrorMessage());
+        return;
+    }
+#endif
+    SendCounters.Record(1);
+}
+
+void BKUDPHandler::SendInFlight(int32 Count)
+{
+#if PLATFORM_LINUX
+    for (int32 i = 0; i < Count; i++)
+    {
+        SendVectors[i].iov_base = InFlightSends[i].Data;
+        SendVectors[i].iov_len = static_cast<size_t>(InFlightSends[i].Size);
+        SendHeaders[i].msg_hdr.msg_name = &InFlightSends[i].OtherParty;
+    }
+
+    int32 Sent = 0;
+    while (Sent < Count)
+    {
+        int32 Result = sendmmsg(UDPSocket_Ref, SendHeaders + Sent, static_cast<uint32>(Count - Sent), MSG_NOSIGNAL);
+        if (Result <= 0)
+        {
+            //The first packet of the call failed; drop it and carry on with the rest.
+            BKUtilities::Print(EBKLogType::Error, FString(L"BKUDPHandler: Socket send failed with error: ") + BKUtilities::WGetSafeErrorMessage());
+            Sent++;
+            continue;
+        }
+        SendCounters.Record(static_cast<uint64>(Result));
+        Sent += Result;
+    }
+#else
+    for (int32 i = 0; i < Count; i++)
+    {
+        SendOne(&InFlightSends[i].OtherParty, InFlightSends[i].Data, InFlightSends[i].Size);
     }
 #endif
 }
 
+void BKUDPHandler::GetSendStats(FBKUDPIOStats& OutStats) const
+{
+    OutStats.SendBatchSize = SendBatchSize;
+    OutStats.SendCalls = SendCounters.Calls.load(std::memory_order_relaxed);
+    OutStats.SentDatagrams = SendCounters.Datagrams.load(std::memory_order_relaxed);
+    OutStats.LargestSendBatch = SendCounters.LargestBatch.load(std::memory_order_relaxed);
+}
+void BKUDPHandler::ResetSendStats()
+{
+    SendCounters.Reset();
+}
+
 void BKUDPHandler::RemoveFromReliableConnections(const FString& Key)
 {
-    ReliableConnectionRecords.Remove(Key);
-    if (bPendingKill && ReliableConnectionRecords.IsEmpty() && ReadyToDieCallback)
+    if (ReliableConnectionRecords.Remove(Key))
     {
-        ReadyToDieCallback();
+        TryCallReadyToDieCallback();
     }
 }
 
-void BKUDPHandler::MarkPendingKill(std::function<void()> _ReadyToDieCallback)
+void BKUDPHandler::TryCallReadyToDieCallback()
 {
-    if (bPendingKill) return;
-    bPendingKill = true;
+    if (!bPendingKill || !ReliableConnectionRecords.IsEmpty()) return;
 
-    ReadyToDieCallback = std::move(_ReadyToDieCallback);
+    //Called at most once, by whichever thread sees the map empty first after MarkPendingKill.
+    std::function<void()> Callback;
+    {
+        BKScopeGuard Guard(&ReadyToDieCallback_Mutex);
+        Callback = std::move(ReadyToDieCallback);
+        ReadyToDieCallback = nullptr;
+    }
+    if (Callback)
+    {
+        Callback();
+    }
+}
 
-    BKScopeGuard Guard(&ReliableConnectionRecords_Mutex);
-    if (ReliableConnectionRecords.IsEmpty())
+void BKUDPHandler::MarkPendingKill(std::function<void()> _ReadyToDieCallback)
+{
     {
-        ReadyToDieCallback();
+        BKScopeGuard Guard(&ReadyToDieCallback_Mutex);
+        if (bPendingKill) return;
+        ReadyToDieCallback = std::move(_ReadyToDieCallback);
+        bPendingKill = true;
     }
+    TryCallReadyToDieCallback();
 }
 
 void BKUDPHandler::AddRecordToPendingDeletePool(BKUDPRecord* PendingDeleteRecord)
@@ -1112,7 +899,7 @@ void BKUDPHandler::AddRecordToPendingDeletePool(BKUDPRecord* PendingDeleteRecord
     if (!PendingDeleteRecord || PendingDeleteRecord->bBeingDeleted) return;
     PendingDeleteRecord->bBeingDeleted = true;
 
-    BKScopeGuard Guard(&UDPRecords_PendingDeletePool_Mutex);
+    BKFastScopeGuard Guard(&UDPRecords_PendingDeletePool_Mutex);
 
     uint64 FoundValue;
     if (!UDPRecords_PendingDeletePool.Get(PendingDeleteRecord, FoundValue))
@@ -4,16 +4,106 @@
 #define Pragma_Once_BKUDPHelper
 
 #include "BKEngine.h"
+#include "BKMemory.h"
 #include "BKTaskDefines.h"
+#include "BKUtilities.h"
 
 #if PLATFORM_WINDOWS
     #pragma comment(lib, "ws2_32.lib")
     #include <winsock2.h>
+    #include <ws2tcpip.h>
 #else
     #include <arpa/inet.h>
+    #include <sys/socket.h>
 #endif
+#include <atomic>
+#include <new>
+#include <utility>
 
 #define UDP_BUFFER_SIZE 1024
+//Largest payload of a UDP datagram over IPv4.
+#define UDP_MAX_DATAGRAM_SIZE 65507
+//Datagrams already waiting in the socket are read without blocking and submitted together, up to this many.
+#define UDP_RECEIVE_BATCH_SIZE 64
+//Packets queued while another thread is sending are sent together, up to this many.
+#define UDP_SEND_BATCH_SIZE 64
+//Configured batch sizes are clamped to [1, UDP_MAX_IO_BATCH_SIZE].
+#define UDP_MAX_IO_BATCH_SIZE 1024
+//Received packets that can be in flight (queued or in a callback) per server socket before packets come from the heap.
+#define UDP_PACKET_POOL_SIZE 1024
+#define UDP_CLIENT_PACKET_POOL_SIZE 256
+
+struct FBKUDPIOOptions
+{
+    //Datagrams taken per receive call (recvmmsg on Linux).
+    int32 ReceiveBatchSize = UDP_RECEIVE_BATCH_SIZE;
+    //Packets handed over per send call (sendmmsg on Linux).
+    int32 SendBatchSize = UDP_SEND_BATCH_SIZE;
+    //Capacity of a receive buffer; longer datagrams are truncated.
+    int32 ReceiveBufferSize = UDP_BUFFER_SIZE;
+    //Pre-allocated receive packets per socket. Must cover the receive batch plus the packets still being processed.
+    int32 PacketPoolSize = UDP_PACKET_POOL_SIZE;
+
+    static int32 Clamp(int32 BatchSize)
+    {
+        return BatchSize < 1 ? 1 : (BatchSize > UDP_MAX_IO_BATCH_SIZE ? UDP_MAX_IO_BATCH_SIZE : BatchSize);
+    }
+};
+
+struct FBKUDPIOStats
+{
+    int32 ReceiveBatchSize = 0;
+    int32 SendBatchSize = 0;
+    int32 ReceiveBufferSize = 0;
+    int32 PacketPoolSize = 0;
+
+    uint64 ReceiveCalls = 0;
+    uint64 ReceivedDatagrams = 0;
+    //Received, then dropped because the LatencyCritical lane was full.
+    uint64 DroppedDatagrams = 0;
+    uint64 LargestReceiveBatch = 0;
+
+    //Pooled packets currently queued or in a callback, and the packets allocated on the heap because none was free.
+    int32 PacketsInUse = 0;
+    uint64 PoolExhaustedPackets = 0;
+
+    uint64 SendCalls = 0;
+    uint64 SentDatagrams = 0;
+    uint64 LargestSendBatch = 0;
+
+    double GetAverageReceiveBatch() const
+    {
+        return ReceiveCalls > 0 ? static_cast<double>(ReceivedDatagrams) / static_cast<double>(ReceiveCalls) : 0;
+    }
+    double GetAverageSendBatch() const
+    {
+        return SendCalls > 0 ? static_cast<double>(SentDatagrams) / static_cast<double>(SendCalls) : 0;
+    }
+};
+
+//Syscall and datagram counts of one direction of a socket.
+struct FBKUDPIOCounters
+{
+    std::atomic<uint64> Calls{0};
+    std::atomic<uint64> Datagrams{0};
+    std::atomic<uint64> LargestBatch{0};
+
+    void Record(uint64 BatchSize)
+    {
+        Calls.fetch_add(1, std::memory_order_relaxed);
+        Datagrams.fetch_add(BatchSize, std::memory_order_relaxed);
+        uint64 Largest = LargestBatch.load(std::memory_order_relaxed);
+        while (BatchSize > Largest && !LargestBatch.compare_exchange_weak(Largest, BatchSize, std::memory_order_relaxed))
+        {
+        }
+    }
+    void Reset()
+    {
+        Calls.store(0, std::memory_order_relaxed);
+        Datagrams.store(0, std::memory_order_relaxed);
+        LargestBatch.store(0, std::memory_order_relaxed);
+    }
+};
 
 class BKUDPHelper
 {
@@ -25,17 +115,22 @@ public:
 
         auto OtherPartyAsBroad = reinterpret_cast<struct sockaddr_in*>(OtherParty);
 
-        FStringStream Stream;
-        Stream << inet_ntoa(OtherPartyAsBroad->sin_addr);
-        Stream << ':';
-        Stream << htons(OtherPartyAsBroad->sin_port);
+        //Built on the stack; this runs for every received datagram.
+        UTFCHAR Buffer[64];
+        int32 Length = 0;
+        for (const ANSICHAR* Address = inet_ntoa(OtherPartyAsBroad->sin_addr); *Address && Length < 16; Address++)
+        {
+            Buffer[Length++] = static_cast<UTFCHAR>(*Address);
+        }
+        Buffer[Length++] = L':';
+        Length += BKNumberFormat::FormatInteger(static_cast<uint32>(htons(OtherPartyAsBroad->sin_port)), Buffer + Length);
         if (!bDoNotAppendMessageID)
         {
-            Stream << ':';
-            Stream << MessageID;
+            Buffer[Length++] = L':';
+            Length += BKNumberFormat::FormatInteger(MessageID, Buffer + Length);
         }
 
-        return Stream.Str();
+        return FString(Buffer, static_cast<uint32>(Length));
     }
 };
 
@@ -47,6 +142,11 @@ private:
 
     bool AsServer = false;
 
+    //Set for packets that live in a BKUDPPacketPool, which owns their buffer and address.
+    class BKUDPPacketPool* OwnerPool = nullptr;
+    WUDPTaskParameter* NextFree = nullptr;
+    friend class BKUDPPacketPool;
+
 public:
     int32 BufferSize = 0;
     ANSICHAR* Buffer = nullptr;
@@ -61,6 +161,8 @@ public:
     }
     ~WUDPTaskParameter() override
     {
+        if (OwnerPool) return;
+
         if (AsServer && OtherParty)
         {
             delete (OtherParty);
@@ -69,4 +171,341 @@ public:
     }
 };
 
-#endif //Pragma_Once_BKUDPHelper
\ No newline at end of file
+// Fixed set of receive packets in one cache-aligned block: every packet is a WUDPTaskParameter followed by its peer
+// address and its buffer, each starting on a cache line. Only the receiving thread acquires; any thread releases.
+// Released packets are pushed onto a lock-free stack that the receiving thread takes over as a whole once its own
+// free list runs dry, so neither side needs a lock. When every packet is in use, packets come from the heap and are
+// counted in PoolExhaustedPackets.
+// The pool is freed by its owner's Destroy call or by the last release after it, whichever comes last, so packets
+// still in callbacks at shutdown stay valid.
+class BKUDPPacketPool
+{
+
+private:
+    int32 PacketCount;
+    int32 BufferSize;
+    WSIZE__T HeaderSize;
+    WSIZE__T Stride;
+
+    void* Allocation;
+    ANSICHAR* Packets;
+
+    //Receiving thread only.
+    WUDPTaskParameter* LocalFree = nullptr;
+    ANSICHAR Pad0[BK_CACHE_LINE_SIZE]{};
+    std::atomic<WUDPTaskParameter*> ReleasedHead{nullptr};
+    //One for the owner, one per pooled packet in use.
+    std::atomic<int32> References{1};
+    ANSICHAR Pad1[BK_CACHE_LINE_SIZE]{};
+
+    std::atomic<uint64> ExhaustedPackets{0};
+
+    BKUDPPacketPool(const BKUDPPacketPool&);
+    BKUDPPacketPool& operator=(const BKUDPPacketPool&);
+
+    static WSIZE__T AlignToCacheLine(WSIZE__T Size)
+    {
+        return (Size + BK_CACHE_LINE_SIZE - 1) & ~static_cast<WSIZE__T>(BK_CACHE_LINE_SIZE - 1);
+    }
+
+    ~BKUDPPacketPool()
+    {
+        for (int32 i = 0; i < PacketCount; i++)
+        {
+            reinterpret_cast<WUDPTaskParameter*>(Packets + Stride * i)->~WUDPTaskParameter();
+        }
+        FMemory::Free(Allocation);
+    }
+
+    void DropReference()
+    {
+        if (References.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            delete this;
+        }
+    }
+
+public:
+    BKUDPPacketPool(int32 _PacketCount, int32 _BufferSize)
+    {
+        PacketCount = _PacketCount < 1 ? 1 : _PacketCount;
+        BufferSize = _BufferSize < 1 ? 1 : (_BufferSize > UDP_MAX_DATAGRAM_SIZE ? UDP_MAX_DATAGRAM_SIZE : _BufferSize);
+        HeaderSize = AlignToCacheLine(sizeof(WUDPTaskParameter)) + AlignToCacheLine(sizeof(sockaddr));
+        Stride = HeaderSize + AlignToCacheLine(static_cast<WSIZE__T>(BufferSize));
+
+        Allocation = FMemory::Malloc(Stride * PacketCount + BK_CACHE_LINE_SIZE);
+        Packets = reinterpret_cast<ANSICHAR*>(AlignToCacheLine(reinterpret_cast<WSIZE__T>(Allocation)));
+
+        for (int32 i = PacketCount - 1; i >= 0; i--)
+        {
+            ANSICHAR* Block = Packets + Stride * i;
+            auto Packet = new (Block) WUDPTaskParameter(0, Block + HeaderSize,
+                    reinterpret_cast<sockaddr*>(Block + AlignToCacheLine(sizeof(WUDPTaskParameter))), false);
+            Packet->OwnerPool = this;
+            Packet->NextFree = LocalFree;
+            LocalFree = Packet;
+        }
+    }
+
+    //Releases the owner's reference; the pool goes away once no packet is in use.
+    void Destroy()
+    {
+        DropReference();
+    }
+
+    int32 GetBufferSize() const
+    {
+        return BufferSize;
+    }
+    int32 GetPacketCount() const
+    {
+        return PacketCount;
+    }
+
+    //Receiving thread only. Never fails; falls back to the heap when the pool is exhausted.
+    WUDPTaskParameter* Acquire()
+    {
+        if (!LocalFree)
+        {
+            LocalFree = ReleasedHead.exchange(nullptr, std::memory_order_acquire);
+        }
+        if (LocalFree)
+        {
+            WUDPTaskParameter* Packet = LocalFree;
+            LocalFree = Packet->NextFree;
+            References.fetch_add(1, std::memory_order_relaxed);
+            return Packet;
+        }
+
+        if (ExhaustedPackets.fetch_add(1, std::memory_order_relaxed) == 0)
+        {
+            BKUtilities::Print(EBKLogType::Warning, FString(L"BKUDPPacketPool: All ") + FString::FromInt(PacketCount) + FString(L" receive packets are in use; allocating from the heap."));
+        }
+        return new WUDPTaskParameter(0, new ANSICHAR[BufferSize], new sockaddr, true);
+    }
+
+    //Any thread. Recycles a pooled packet, deletes one that came from the heap.
+    static void Release(WUDPTaskParameter* Packet)
+    {
+        BKUDPPacketPool* Pool = Packet->OwnerPool;
+        if (!Pool)
+        {
+            delete (Packet);
+            return;
+        }
+
+        Packet->BufferSize = 0;
+        WUDPTaskParameter* Head = Pool->ReleasedHead.load(std::memory_order_relaxed);
+        do
+        {
+            Packet->NextFree = Head;
+        } while (!Pool->ReleasedHead.compare_exchange_weak(Head, Packet, std::memory_order_release, std::memory_order_relaxed));
+
+        Pool->DropReference();
+    }
+
+    void FillStats(FBKUDPIOStats& OutStats) const
+    {
+        OutStats.ReceiveBufferSize = BufferSize;
+        OutStats.PacketPoolSize = PacketCount;
+        OutStats.PacketsInUse = References.load(std::memory_order_relaxed) - 1;
+        OutStats.PoolExhaustedPackets = ExhaustedPackets.load(std::memory_order_relaxed);
+    }
+    void ResetStats()
+    {
+        ExhaustedPackets.store(0, std::memory_order_relaxed);
+    }
+};
+
+// Async task that calls Body(Packet) and returns the packet to its pool when the task is destroyed, so a task that is
+// dropped unrun (submitted to a stopped task manager, or drained by its EndSystem) still gives the packet back.
+template <typename F>
+struct TBKUDPPacketTask
+{
+    F Body;
+    WUDPTaskParameter* Packet;
+
+    TBKUDPPacketTask(F&& _Body, WUDPTaskParameter* _Packet) : Body(std::move(_Body)), Packet(_Packet)
+    {
+    }
+    TBKUDPPacketTask(TBKUDPPacketTask&& Other) noexcept : Body(std::move(Other.Body)), Packet(Other.Packet)
+    {
+        Other.Packet = nullptr;
+    }
+    ~TBKUDPPacketTask()
+    {
+        if (Packet) BKUDPPacketPool::Release(Packet);
+    }
+
+    void operator()()
+    {
+        Body(Packet);
+    }
+
+private:
+    TBKUDPPacketTask(const TBKUDPPacketTask&);
+    TBKUDPPacketTask& operator=(const TBKUDPPacketTask&);
+};
+
+template <typename F>
+TBKUDPPacketTask<F> MakeUDPPacketTask(WUDPTaskParameter* Packet, F Body)
+{
+    return TBKUDPPacketTask<F>(std::move(Body), Packet);
+}
+
+// Receives a burst of datagrams with one call: recvmmsg on Linux; elsewhere a blocking recvfrom followed by
+// non-blocking ones for the datagrams that already arrived. Every slot holds a packet from the pool until the caller
+// detaches it, so a datagram that is dropped leaves its packet in the slot to be reused.
+// Used by the receiving thread only.
+class BKUDPReceiveBatch
+{
+
+private:
+    int32 Capacity;
+    bool bWithAddresses;
+
+    BKUDPPacketPool* Pool;
+    WUDPTaskParameter** Slots;
+    int32* Sizes;
+#if PLATFORM_LINUX
+    struct mmsghdr* Headers;
+    struct iovec* Vectors;
+#endif
+
+    BKUDPReceiveBatch(const BKUDPReceiveBatch&);
+    BKUDPReceiveBatch& operator=(const BKUDPReceiveBatch&);
+
+    void FillSlot(int32 Index)
+    {
+        Slots[Index] = Pool->Acquire();
+#if PLATFORM_LINUX
+        Vectors[Index].iov_base = Slots[Index]->Buffer;
+        Headers[Index].msg_hdr.msg_name = bWithAddresses ? Slots[Index]->OtherParty : nullptr;
+#endif
+    }
+
+public:
+    FBKUDPIOCounters Counters;
+    std::atomic<uint64> DroppedDatagrams{0};
+
+    //Without addresses, the sender of a datagram is not recorded (the client only talks to its server).
+    BKUDPReceiveBatch(int32 _Capacity, bool _bWithAddresses, int32 PacketPoolSize, int32 BufferSize)
+            : Capacity(FBKUDPIOOptions::Clamp(_Capacity)), bWithAddresses(_bWithAddresses)
+    {
+        //Slots hold packets even while idle, so the pool needs at least one more batch to hand out.
+        Pool = new BKUDPPacketPool(PacketPoolSize > Capacity * 2 ? PacketPoolSize : Capacity * 2, BufferSize);
+        Slots = new WUDPTaskParameter*[Capacity];
+        Sizes = new int32[Capacity];
+#if PLATFORM_LINUX
+        Headers = new struct mmsghdr[Capacity];
+        Vectors = new struct iovec[Capacity];
+        FMemory::Memzero(Headers, sizeof(struct mmsghdr) * Capacity);
+#endif
+        for (int32 i = 0; i < Capacity; i++)
+        {
+            Sizes[i] = 0;
+#if PLATFORM_LINUX
+            Vectors[i].iov_len = static_cast<size_t>(Pool->GetBufferSize());
+            Headers[i].msg_hdr.msg_iov = &Vectors[i];
+            Headers[i].msg_hdr.msg_iovlen = 1;
+#endif
+            FillSlot(i);
+        }
+    }
+    ~BKUDPReceiveBatch()
+    {
+        for (int32 i = 0; i < Capacity; i++)
+        {
+            BKUDPPacketPool::Release(Slots[i]);
+        }
+        Pool->Destroy();
+        delete[] Slots;
+        delete[] Sizes;
+#if PLATFORM_LINUX
+        delete[] Headers;
+        delete[] Vectors;
+#endif
+    }
+
+    int32 GetCapacity() const
+    {
+        return Capacity;
+    }
+
+    //Blocks until at least one datagram arrives. Returns the number of filled slots, or -1 on a socket error.
+#if PLATFORM_WINDOWS
+    int32 Receive(SOCKET Socket)
+#else
+    int32 Receive(int32 Socket)
+#endif
+    {
+        int32 Count = 0;
+#if PLATFORM_LINUX
+        for (int32 i = 0; i < Capacity; i++)
+        {
+            Headers[i].msg_hdr.msg_namelen = bWithAddresses ? sizeof(sockaddr) : 0;
+        }
+        Count = recvmmsg(Socket, Headers, static_cast<uint32>(Capacity), MSG_WAITFORONE, nullptr);
+        if (Count <= 0) return -1;
+        for (int32 i = 0; i < Count; i++)
+        {
+            Sizes[i] = static_cast<int32>(Headers[i].msg_len);
+        }
+#else
+        while (Count < Capacity)
+        {
+            socklen_t AddressLength = sizeof(sockaddr);
+#if PLATFORM_WINDOWS
+            //Winsock has no per-call non-blocking flag; one datagram per call.
+            if (Count > 0) break;
+            const int32 Flags = 0;
+#else
+            const int32 Flags = Count == 0 ? 0 : MSG_DONTWAIT;
+#endif
+            auto RetrievedSize = static_cast<int32>(recvfrom(Socket, Slots[Count]->Buffer, Pool->GetBufferSize(), Flags,
+                    bWithAddresses ? Slots[Count]->OtherParty : nullptr, bWithAddresses ? &AddressLength : nullptr));
+            if (RetrievedSize < 0) break;
+            Sizes[Count++] = RetrievedSize;
+        }
+        if (Count == 0) return -1;
+#endif
+        Counters.Record(static_cast<uint64>(Count));
+        return Count;
+    }
+
+    int32 GetSize(int32 Index) const
+    {
+        return Sizes[Index];
+    }
+
+    //Hands the slot's packet, sized to the datagram, over to the caller, who gives it back with
+    //BKUDPPacketPool::Release, or through MakeUDPPacketTask. The slot gets a new packet.
+    WUDPTaskParameter* DetachPacket(int32 Index)
+    {
+        WUDPTaskParameter* Packet = Slots[Index];
+        Packet->BufferSize = Sizes[Index];
+        FillSlot(Index);
+        return Packet;
+    }
+
+    void FillStats(FBKUDPIOStats& OutStats) const
+    {
+        OutStats.ReceiveBatchSize = Capacity;
+        OutStats.ReceiveCalls = Counters.Calls.load(std::memory_order_relaxed);
+        OutStats.ReceivedDatagrams = Counters.Datagrams.load(std::memory_order_relaxed);
+        OutStats.LargestReceiveBatch = Counters.LargestBatch.load(std::memory_order_relaxed);
+        OutStats.DroppedDatagrams = DroppedDatagrams.load(std::memory_order_relaxed);
+        Pool->FillStats(OutStats);
+        //Packets parked in the slots are not in flight.
+        OutStats.PacketsInUse -= Capacity;
+        if (OutStats.PacketsInUse < 0) OutStats.PacketsInUse = 0;
+    }
+    void ResetStats()
+    {
+        Counters.Reset();
+        DroppedDatagrams.store(0, std::memory_order_relaxed);
+        Pool->ResetStats();
+    }
+};
+
+#endif //Pragma_Once_BKUDPHelper
@@ -0,0 +1,96 @@
+// Copyright Burak Kara, All rights reserved.
+
+#include "BKUDPPacketView.h"
+#include "BKUtf8String.h"
+
+static const FString& GetVariableTypeName(int32 Type)
+{
+    static const FString TypeNames[UDP_VARIABLE_TYPE_COUNT] =
+    {
+        FString(L"BooleanArray"), FString(L"ByteArray"), FString(L"CharArray"),
+        FString(L"ShortArray"), FString(L"IntegerArray"), FString(L"FloatArray")
+    };
+    return TypeNames[Type];
+}
+
+bool FBKUDPPacketView::FindVariableType(const FString& Name, EBKUDPVariableType& OutType)
+{
+    //Only names of the same length are compared.
+    const int32 Length = Name.Len();
+    for (int32 i = 0; i < UDP_VARIABLE_TYPE_COUNT; i++)
+    {
+        const FString& TypeName = GetVariableTypeName(i);
+        if (TypeName.Len() == Length && TypeName == Name)
+        {
+            OutType = static_cast<EBKUDPVariableType>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+BKJson::Node FBKUDPPacketView::ToJson() const
+{
+
+    //Keys are ordered by the last variable of their type, as the decoder that merged them into the map one by one did.
+    int32 LastPosition[UDP_VARIABLE_TYPE_COUNT] = {-1, -1, -1, -1, -1, -1};
+    int32 Position = 0;
+    ForEachSection([&LastPosition, &Position](const FBKUDPSectionView& Section)
+    {
+        LastPosition[static_cast<int32>(Section.Type)] = Position++;
+    });
+
+    BKJson::Node ResultMap = BKJson::Node(BKJson::Node::T_OBJECT);
+    for (int32 Emitted = 0; Emitted < Position; Emitted++)
+    {
+        int32 Type = INDEX_NONE;
+        for (int32 i = 0; i < UDP_VARIABLE_TYPE_COUNT; i++)
+        {
+            if (LastPosition[i] == Emitted) Type = i;
+        }
+        if (Type == INDEX_NONE) continue;
+
+        const auto VariableType = static_cast<EBKUDPVariableType>(Type);
+        if (VariableType == EBKUDPVariableType::CharArray)
+        {
+            FString CharArray;
+            ForEachSection([&CharArray](const FBKUDPSectionView& Section)
+            {
+                if (Section.Type != EBKUDPVariableType::CharArray) return;
+                CharArray += FUtf8String(Section.GetChars(), Section.Count).ToFString();
+            });
+            ResultMap.Add(GetVariableTypeName(Type), BKJson::Node(CharArray));
+            continue;
+        }
+
+        BKJson::Node List = BKJson::Node(BKJson::Node::T_ARRAY);
+        ForEachSection([VariableType, &List](const FBKUDPSectionView& Section)
+        {
+            if (Section.Type != VariableType) return;
+            for (int32 i = 0; i < Section.Count; i++)
+            {
+                switch (VariableType)
+                {
+                    case EBKUDPVariableType::BooleanArray:
+                        List.Add(BKJson::Node(Section.GetBool(i)));
+                        break;
+                    case EBKUDPVariableType::ByteArray:
+                        List.Add(BKJson::Node(static_cast<int32>(Section.GetByte(i))));
+                        break;
+                    case EBKUDPVariableType::ShortArray:
+                        //Shorts have always been reported unsigned here.
+                        List.Add(BKJson::Node(static_cast<int32>(static_cast<uint16>(Section.GetShort(i)))));
+                        break;
+                    case EBKUDPVariableType::IntegerArray:
+                        List.Add(BKJson::Node(Section.GetInteger(i)));
+                        break;
+                    default:
+                        List.Add(BKJson::Node(Section.GetFloat(i)));
+                        break;
+                }
+            }
+        });
+        ResultMap.Add(GetVariableTypeName(Type), List);
+    }
+    return ResultMap;
+}
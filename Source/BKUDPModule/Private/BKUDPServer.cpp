@@ -4,7 +4,7 @@
 #include "BKUDPServer.h"
 #include "BKUDPHandler.h"
 
-bool BKUDPServer::InitializeSocket(uint16 Port)
+bool BKUDPServer::InitializeSocket(FBKUDPServerShard* Shard, uint16 Port, bool bReusePort)
 {
 #if PLATFORM_WINDOWS
     WSADATA WSAData{};
@@ -16,16 +16,16 @@ bool BKUDPServer::InitializeSocket(uint16 Port)
     }
 #endif
 
-    UDPSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    Shard->UDPSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
 #if PLATFORM_WINDOWS
-    if (UDPSocket == INVALID_SOCKET)
+    if (Shard->UDPSocket == INVALID_SOCKET)
     {
         BKUtilities::Print(EBKLogType::Error, FString(L"BKUDPServer: Socket initialization failed with error: ") + BKUtilities::WGetSafeErrorMessage());
         WSACleanup();
         return false;
     }
 #else
-    if (UDPSocket == -1)
+    if (Shard->UDPSocket == -1)
     {
         BKUtilities::Print(EBKLogType::Error, FString(L"WUDPServer: Socket initialization failed with error: ") + BKUtilities::WGetSafeErrorMessage());
         return false;
@@ -33,11 +33,19 @@ bool BKUDPServer::InitializeSocket(uint16 Port)
 #endif
 
     int32 optval = 1;
-    setsockopt(UDPSocket, SOL_SOCKET, SO_REUSEADDR, (const ANSICHAR*)&optval, sizeof(int32));
+    setsockopt(Shard->UDPSocket, SOL_SOCKET, SO_REUSEADDR, (const ANSICHAR*)&optval, sizeof(int32));
 #if PLATFORM_WINDOWS
-    setsockopt(UDPSocket, SOL_SOCKET, UDP_NOCHECKSUM, (const ANSICHAR*)&optval, sizeof(int32));
+    setsockopt(Shard->UDPSocket, SOL_SOCKET, UDP_NOCHECKSUM, (const ANSICHAR*)&optval, sizeof(int32));
 #else
-    setsockopt(UDPSocket, SOL_SOCKET, SO_NO_CHECK, (const ANSICHAR*)&optval, sizeof(int32));
+    setsockopt(Shard->UDPSocket, SOL_SOCKET, SO_NO_CHECK, (const ANSICHAR*)&optval, sizeof(int32));
+#endif
+#if PLATFORM_LINUX
+    if (bReusePort && setsockopt(Shard->UDPSocket, SOL_SOCKET, SO_REUSEPORT, (const ANSICHAR*)&optval, sizeof(int32)) == -1)
+    {
+        BKUtilities::Print(EBKLogType::Error, FString(L"BKUDPServer: SO_REUSEPORT failed with error: ") + BKUtilities::WGetSafeErrorMessage());
+        close(Shard->UDPSocket);
+        return false;
+    }
 #endif
 
     FMemory::Memzero((ANSICHAR*)&UDPServer, sizeof(UDPServer));
@@ -45,106 +53,120 @@ bool BKUDPServer::InitializeSocket(uint16 Port)
     UDPServer.sin_addr.s_addr = INADDR_ANY;
     UDPServer.sin_port = htons(Port);
 
-    int32 ret = bind(UDPSocket, (struct sockaddr*)&UDPServer, sizeof(UDPServer));
+    int32 ret = bind(Shard->UDPSocket, (struct sockaddr*)&UDPServer, sizeof(UDPServer));
     if (ret == -1)
     {
         BKUtilities::Print(EBKLogType::Error, FString(L"BKUDPServer: Socket binding failed with error: ") + BKUtilities::WGetSafeErrorMessage());
 #if PLATFORM_WINDOWS
+        closesocket(Shard->UDPSocket);
         WSACleanup();
+#else
+        close(Shard->UDPSocket);
 #endif
         return false;
     }
 
     return true;
 }
-void BKUDPServer::CloseSocket()
+void BKUDPServer::CloseSocket(FBKUDPServerShard* Shard)
 {
 #if PLATFORM_WINDOWS
-    closesocket(UDPSocket);
+    closesocket(Shard->UDPSocket);
     WSACleanup();
 #else
-    shutdown(UDPSocket, SHUT_RDWR);
-    close(UDPSocket);
+    shutdown(Shard->UDPSocket, SHUT_RDWR);
+    close(Shard->UDPSocket);
 #endif
 }
 
-void BKUDPServer::ListenSocket()
+void BKUDPServer::ListenSocket(FBKUDPServerShard* Shard)
 {
+    BKUDPHandler* Handler = Shard->UDPHandler;
+    BKUDPReceiveBatch* ReceiveBatch = Shard->ReceiveBatch;
+
+    BKAsyncTaskBatch Batch(EBKTaskPriority::LatencyCritical);
     while (bSystemStarted)
     {
-        auto Buffer = new ANSICHAR[UDP_BUFFER_SIZE];
-        auto Client = new sockaddr;
-#if PLATFORM_WINDOWS
-        int32 ClientLen = sizeof(*Client);
-#else
-        socklen_t ClientLen = sizeof(*Client);
-#endif
+        //Blocks for the first datagram of a burst and takes the ones that already arrived with it in the same call.
+        int32 Count = ReceiveBatch->Receive(Shard->UDPSocket);
+        if (!bSystemStarted) return;
 
-        auto RetrievedSize = static_cast<int32>(recvfrom(UDPSocket, Buffer, UDP_BUFFER_SIZE, 0, Client, &ClientLen));
-        if (RetrievedSize < 0 || !bSystemStarted)
+        for (int32 i = 0; i < Count; i++)
         {
-            delete[] Buffer;
-            delete (Client);
-            if (!bSystemStarted) return;
-            continue;
-        }
-        if (RetrievedSize == 0) continue;
+            auto RetrievedSize = ReceiveBatch->GetSize(i);
+            if (RetrievedSize <= 0) continue;
 
-        TArray<BKAsyncTaskParameter*> PassParameters;
-        PassParameters.Add(this);
-        PassParameters.Add(new WUDPTaskParameter(RetrievedSize, Buffer, Client, true));
-
-        BKFutureAsyncTask Lambda = [](TArray<BKAsyncTaskParameter*> TaskParameters)
-        {
-            if (TaskParameters.Num() >= 2 && TaskParameters[0] && TaskParameters[1])
+            //Under overload the packet stays in its slot and is overwritten by the next receive.
+            if (!BKAsyncTaskManager::AdmitTasks(EBKTaskPriority::LatencyCritical, 1, EBKOverloadPolicy::DropNewest))
             {
-                auto ServerInstance = reinterpret_cast<BKUDPServer*>(TaskParameters[0]);
-                auto Parameter = reinterpret_cast<WUDPTaskParameter*>(TaskParameters[1]);
-
-                if (!ServerInstance || !ServerInstance->bSystemStarted || !ServerInstance->UDPListenCallback)
-                {
-                    if (Parameter)
-                    {
-                        delete (Parameter);
-                    }
-                    return;
-                }
+                ReceiveBatch->DroppedDatagrams.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
 
-                if (Parameter)
+            WUDPTaskParameter* Parameter = ReceiveBatch->DetachPacket(i);
+            Batch.Add(MakeUDPPacketTask(Parameter, [this, Handler](WUDPTaskParameter* Packet)
+            {
+                if (bSystemStarted && UDPListenCallback)
                 {
-                    ServerInstance->UDPListenCallback(ServerInstance->UDPHandler, Parameter);
-                    delete (Parameter);
+                    UDPListenCallback(Handler, Packet);
                 }
-            }
-        };
-        BKAsyncTaskManager::NewAsyncTask(Lambda, PassParameters, true);
+            }));
+        }
+        BKAsyncTaskManager::NewAsyncTasks(Batch);
     }
 }
-uint32 BKUDPServer::ListenerStopped()
+uint32 BKUDPServer::ListenerStopped(FBKUDPServerShard* Shard)
 {
     if (!bSystemStarted) return 0;
-    if (UDPSystemThread) delete (UDPSystemThread);
-    UDPSystemThread = new BKThread(std::bind(&BKUDPServer::ListenSocket, this), std::bind(&BKUDPServer::ListenerStopped, this));
+    if (Shard->UDPSystemThread) delete (Shard->UDPSystemThread);
+    CreateListenerThread(Shard);
     return 0;
 }
+void BKUDPServer::CreateListenerThread(FBKUDPServerShard* Shard)
+{
+    Shard->UDPSystemThread = new BKThread(std::bind(&BKUDPServer::ListenSocket, this, Shard), std::bind(&BKUDPServer::ListenerStopped, this, Shard),
+            FBKThreadOptions(FString(L"BKUDPListener"), CoreLayout.GetListenerAffinityMask(Shard->Index, Shards.Num())));
+}
 
-bool BKUDPServer::StartSystem(uint16 Port)
+bool BKUDPServer::StartSystem(uint16 Port, const FBKCoreLayout& Layout, const FBKUDPIOOptions& _IOOptions, int32 ShardCount)
 {
     if (bSystemStarted) return true;
     bSystemStarted = true;
 
-    if (InitializeSocket(Port))
+    CoreLayout = Layout;
+    IOOptions = _IOOptions;
+
+    if (ShardCount < 1) ShardCount = 1;
+#if !PLATFORM_LINUX
+    if (ShardCount > 1)
+    {
+        BKUtilities::Print(EBKLogType::Warning, FString(L"BKUDPServer: Sharded sockets need SO_REUSEPORT load balancing; listening on a single socket."));
+        ShardCount = 1;
+    }
+#endif
+
+    //Every socket is bound before any thread starts, so the kernel spreads flows over the final set of sockets.
+    for (int32 i = 0; i < ShardCount; i++)
     {
-        UDPSystemThread = new BKThread(std::bind(&BKUDPServer::ListenSocket, this), std::bind(&BKUDPServer::ListenerStopped, this));
-        if (UDPHandler)
+        auto Shard = new FBKUDPServerShard();
+        Shard->Index = i;
+        if (!InitializeSocket(Shard, Port, ShardCount > 1))
         {
-            delete (UDPHandler);
+            delete (Shard);
+            DestroyShards();
+            bSystemStarted = false;
+            return false;
         }
-        UDPHandler = new BKUDPHandler(UDPSocket);
-        UDPHandler->StartSystem();
-        return true;
+        Shard->ReceiveBatch = new BKUDPReceiveBatch(IOOptions.ReceiveBatchSize, true, IOOptions.PacketPoolSize, IOOptions.ReceiveBufferSize);
+        Shard->UDPHandler = new BKUDPHandler(Shard->UDPSocket, IOOptions.SendBatchSize);
+        Shards.Add(Shard);
+    }
+    for (int32 i = 0; i < Shards.Num(); i++)
+    {
+        Shards[i]->UDPHandler->StartSystem();
+        CreateListenerThread(Shards[i]);
     }
-    return false;
+    return true;
 }
 
 void BKUDPServer::EndSystem()
@@ -152,19 +174,74 @@ void BKUDPServer::EndSystem()
     if (!bSystemStarted) return;
     bSystemStarted = false;
 
-    if (UDPHandler)
+    DestroyShards();
+    UDPListenCallback = nullptr;
+}
+void BKUDPServer::DestroyShards()
+{
+    for (int32 i = 0; i < Shards.Num(); i++)
     {
-        UDPHandler->EndSystem();
-        delete (UDPHandler);
+        FBKUDPServerShard* Shard = Shards[i];
+        if (Shard->UDPHandler)
+        {
+            Shard->UDPHandler->EndSystem();
+        }
+        CloseSocket(Shard);
     }
-    CloseSocket();
-    UDPListenCallback = nullptr;
-    if (UDPSystemThread)
+    for (int32 i = 0; i < Shards.Num(); i++)
     {
-        if (UDPSystemThread->IsJoinable())
+        FBKUDPServerShard* Shard = Shards[i];
+        if (Shard->UDPSystemThread)
         {
-            UDPSystemThread->Join();
+            if (Shard->UDPSystemThread->IsJoinable())
+            {
+                Shard->UDPSystemThread->Join();
+            }
+            delete (Shard->UDPSystemThread);
         }
-        delete (UDPSystemThread);
+        if (Shard->UDPHandler) delete (Shard->UDPHandler);
+        if (Shard->ReceiveBatch) delete (Shard->ReceiveBatch);
+        delete (Shard);
     }
-}
\ No newline at end of file
+    Shards.Empty();
+}
+
+void BKUDPServer::GetIOStats(FBKUDPIOStats& OutStats) const
+{
+    OutStats = FBKUDPIOStats();
+    for (int32 i = 0; i < Shards.Num(); i++)
+    {
+        FBKUDPIOStats ShardStats;
+        GetShardIOStats(i, ShardStats);
+
+        OutStats.ReceiveBatchSize = ShardStats.ReceiveBatchSize;
+        OutStats.SendBatchSize = ShardStats.SendBatchSize;
+        OutStats.ReceiveBufferSize = ShardStats.ReceiveBufferSize;
+        OutStats.PacketPoolSize += ShardStats.PacketPoolSize;
+        OutStats.PacketsInUse += ShardStats.PacketsInUse;
+        OutStats.PoolExhaustedPackets += ShardStats.PoolExhaustedPackets;
+        OutStats.ReceiveCalls += ShardStats.ReceiveCalls;
+        OutStats.ReceivedDatagrams += ShardStats.ReceivedDatagrams;
+        OutStats.DroppedDatagrams += ShardStats.DroppedDatagrams;
+        OutStats.SendCalls += ShardStats.SendCalls;
+        OutStats.SentDatagrams += ShardStats.SentDatagrams;
+        if (ShardStats.LargestReceiveBatch > OutStats.LargestReceiveBatch) OutStats.LargestReceiveBatch = ShardStats.LargestReceiveBatch;
+        if (ShardStats.LargestSendBatch > OutStats.LargestSendBatch) OutStats.LargestSendBatch = ShardStats.LargestSendBatch;
+    }
+}
+void BKUDPServer::GetShardIOStats(int32 ShardIndex, FBKUDPIOStats& OutStats) const
+{
+    OutStats = FBKUDPIOStats();
+    if (ShardIndex < 0 || ShardIndex >= Shards.Num()) return;
+
+    Shards[ShardIndex]->ReceiveBatch->FillStats(OutStats);
+    Shards[ShardIndex]->UDPHandler->GetSendStats(OutStats);
+}
+void BKUDPServer::ResetIOStats()
+{
+    for (int32 i = 0; i < Shards.Num(); i++)
+    {
+        Shards[i]->ReceiveBatch->ResetStats();
+        Shards[i]->UDPHandler->ResetSendStats();
+    }
+}
@@ -25,6 +25,7 @@ private:
 
     BKThread* UDPClientThread = nullptr;
     class BKUDPHandler* UDPHandler = nullptr;
+    class BKUDPReceiveBatch* ReceiveBatch = nullptr;
 
     struct sockaddr* SocketAddress = nullptr;
     socklen_t SocketAddressLength = 0;
@@ -61,6 +62,10 @@ public:
     }
 
     class BKUDPHandler* GetUDPHandler();
+
+    //Receive and send syscall counts since the start or the last ResetIOStats.
+    void GetIOStats(struct FBKUDPIOStats& OutStats) const;
+    void ResetIOStats();
 };
 
 typedef std::function<void(class BKUDPClient*, BKJson::Node)> BKUDPClient_DataReceived;
@@ -7,17 +7,31 @@
 #include "BKMemory.h"
 #include "BKJson.h"
 #include "BKMutex.h"
+#include "BKFastMutex.h"
+#include "BKAtomic.h"
 #include "BKReferenceCounter.h"
 #include "BKUtilities.h"
 #include "BKTaskDefines.h"
-#include "BKSafeQueue.h"
+#include "BKMPMCQueue.h"
 #include "BKHashMap.h"
+#include "BKConcurrentHashMap.h"
 #if PLATFORM_WINDOWS
     #pragma comment(lib, "ws2_32.lib")
     #include <winsock2.h>
 #else
     #include <netinet/in.h>
 #endif
+#include "../Private/BKUDPHelper.h"
+#include "BKUDPPacketView.h"
+#include "BKUDPPacketBuilder.h"
+
+enum class EBKUDPDecodeResult : uint8
+{
+    Invalid,
+    //A reliable handshake or acknowledgement; handled by the handler, carries no data.
+    Control,
+    Data
+};
 
 enum class EBKReliableRecordType : uint8
 {
@@ -33,8 +47,7 @@ private:
     BKUDPRecord() = default;
 
 protected:
-    BKMutex LastInteraction_Mutex;
-    uint64 LastInteraction = 0;
+    BKAtomic<uint64> LastInteraction{0};
 
     class BKUDPHandler* ResponsibleHandler = nullptr;
 
@@ -48,12 +61,11 @@ public:
 
     uint64 GetLastInteraction()
     {
-        return LastInteraction;
+        return LastInteraction.Load(std::memory_order_relaxed);
     }
     virtual void UpdateLastInteraction()
     {
-        BKScopeGuard Guard(&LastInteraction_Mutex);
-        LastInteraction = BKUtilities::GetTimeStampInMS();
+        LastInteraction.Store(BKUtilities::GetTimeStampInMS(), std::memory_order_relaxed);
     }
 
     EBKReliableRecordType GetType()
@@ -70,41 +82,29 @@ class BKOtherPartyRecord : public BKUDPRecord
 {
 
 private:
-    BKMutex LastSendersideTimestamp_Mutex{};
-    uint16 LastSendersideTimestamp = 0;
-
-    BKMutex TimedOutCount_Mutex{};
-    uint32 TimedOutCount = 0;
+    BKAtomic<uint16> LastSendersideTimestamp{0};
+    BKAtomic<uint32> TimedOutCount{0};
 
     FString OtherPartyKey;
 
     bool ResetterFunction() override
     {
         SetLastSendersideTimestamp(0);
-        {
-            BKScopeGuard TimedOutCount_Guard(&TimedOutCount_Mutex);
-            if (++TimedOutCount > 12) //For 2 minutes, 120000 / 10000
-            {
-                return true;
-            }
-        }
-        return false;
+        return TimedOutCount.Increment() > 12; //For 2 minutes, 120000 / 10000
     }
     uint32 TimeoutValueMS() override { return 10000; }
 
 public:
     uint16 GetLastSendersideTimestamp()
     {
-        return LastSendersideTimestamp;
+        return LastSendersideTimestamp.Load();
     }
     void SetLastSendersideTimestamp(uint16 Timestamp)
     {
-        BKScopeGuard Guard(&LastSendersideTimestamp_Mutex);
-        LastSendersideTimestamp = Timestamp;
+        LastSendersideTimestamp.Store(Timestamp);
         if (Timestamp > 0)
         {
-            BKScopeGuard TimedOutCount_Guard(&TimedOutCount_Mutex);
-            TimedOutCount = 0;
+            TimedOutCount.Store(0);
         }
     }
 
@@ -219,27 +219,23 @@ public:
 #define TIMEOUT_CHECK_TIME_INTERVAL 100
 #define PENDING_DELETE_CHECK_TIME_INTERVAL 100
 #define RELIABLE_CONNECTION_NOT_FOUND 255
+#define UDP_TIMEOUT_CHECK_QUEUE_CAPACITY 8192
 
 class BKUDPHandler : public BKAsyncTaskParameter
 {
 
 private:
-    BKMutex ReliableConnectionRecords_Mutex{};
-    BKHashMap<FString, BKReliableConnectionRecord*> ReliableConnectionRecords;
+    BKConcurrentHashMap<FString, BKReliableConnectionRecord*> ReliableConnectionRecords;
     void RemoveFromReliableConnections(const FString& Key);
 
-    BKMutex LastThissideGeneratedTimestamp_Mutex{};
-    uint16 LastThissideGeneratedTimestamp = 0;
+    BKAtomic<uint16> LastThissideGeneratedTimestamp{0};
+    BKAtomic<uint32> LastThissideMessageID{1};
 
-    BKMutex LastThissideMessageID_Mutex{};
-    uint32 LastThissideMessageID = 1;
+    BKConcurrentHashMap<FString, BKOtherPartyRecord*> OtherPartiesRecords;
 
-    BKMutex OtherPartiesRecords_Mutex{};
-    BKHashMap<FString, BKOtherPartyRecord*> OtherPartiesRecords{};
+    BKMPMCSpillQueue<BKUDPRecord*, UDP_TIMEOUT_CHECK_QUEUE_CAPACITY> UDPRecordsForTimeoutCheck;
 
-    BKSafeQueue<BKUDPRecord*> UDPRecordsForTimeoutCheck;
-
-    BKMutex UDPRecords_PendingDeletePool_Mutex;
+    BKFastMutex UDPRecords_PendingDeletePool_Mutex;
 
     BKHashMap<BKUDPRecord*, uint64> UDPRecords_PendingDeletePool;
     void AddRecordToPendingDeletePool(BKUDPRecord* PendingDeleteRecord);
@@ -249,7 +245,28 @@ private:
     void ClearUDPRecordsForTimeoutCheck();
     void ClearPendingDeletePool();
 
-    BKMutex SendMutex;
+    //One thread at a time sends; packets of other threads meanwhile wait in PendingSends and go out together with the
+    //sending thread's next call.
+    struct FBKPendingSend
+    {
+        sockaddr OtherParty;
+        int32 Size;
+        ANSICHAR Data[UDP_BUFFER_SIZE];
+    };
+    BKFastMutex SendMutex;
+    bool bSending = false;
+    int32 SendBatchSize = UDP_SEND_BATCH_SIZE;
+    int32 PendingSendCount = 0;
+    FBKPendingSend* PendingSends = nullptr;
+    FBKPendingSend* InFlightSends = nullptr;
+#if PLATFORM_LINUX
+    struct mmsghdr* SendHeaders = nullptr;
+    struct iovec* SendVectors = nullptr;
+#endif
+    FBKUDPIOCounters SendCounters;
+
+    void SendOne(sockaddr* OtherParty, const ANSICHAR* Data, int32 Size);
+    void SendInFlight(int32 Count);
 
 #if PLATFORM_WINDOWS
     SOCKET UDPSocket_Ref{};
@@ -257,10 +274,12 @@ private:
     int32 UDPSocket_Ref{};
 #endif
 
-    bool bSystemStarted = false;
+    BKAtomic<bool> bSystemStarted{false};
 
-    bool bPendingKill = false;
+    std::atomic<bool> bPendingKill{false};
+    BKMutex ReadyToDieCallback_Mutex;
     std::function<void()> ReadyToDieCallback = nullptr;
+    void TryCallReadyToDieCallback();
 
     //
     void AsReceiverReliableSYNSuccess(sockaddr* OtherParty, uint32 MessageID);
@@ -268,6 +287,11 @@ private:
 
     void HandleReliableSYNDeparture(sockaddr* OtherParty, FBKCHARWrapper& Buffer, uint32 MessageID);
 
+    //ReliableMessageID != 0 makes a validation packet (SYN-ACK and the like), which is only a header.
+    bool BeginPacket(BKUDPPacketBuilder& Builder, uint8 Flags, uint32 ReliableMessageID);
+    FBKCHARWrapper MakeValidationPacket(BKUDPPacketBuilder& Builder, sockaddr* OtherParty, uint8 ReliableFlag, uint32 MessageID);
+    void AddVariablesFromJson(BKUDPPacketBuilder& Builder, BKJson::Node& Parameter);
+
     void HandleReliableSYNSuccess(sockaddr* OtherParty, uint32 MessageID);
     void HandleReliableSYNFailure(sockaddr* OtherParty, uint32 MessageID);
 
@@ -283,10 +307,11 @@ private:
 
 public:
 #if PLATFORM_WINDOWS
-    explicit BKUDPHandler(SOCKET _UDPSocket);
+    explicit BKUDPHandler(SOCKET _UDPSocket, int32 _SendBatchSize = UDP_SEND_BATCH_SIZE);
 #else
-    explicit BKUDPHandler(int32 _UDPSocket);
+    explicit BKUDPHandler(int32 _UDPSocket, int32 _SendBatchSize = UDP_SEND_BATCH_SIZE);
 #endif
+    ~BKUDPHandler() override;
 
     /*
 	* if bIgnoreTimestamp == false && Timestamp == 0, sends one package with bReliableSYN = true, bIgnoreTimestamp = true
@@ -334,7 +359,21 @@ public:
 	*/
     BKJson::Node AnalyzeNetworkDataWithByteArray(FBKCHARWrapper& Parameter, sockaddr* OtherParty);
 
-    //Do not forget to deallocate the result manually.
+    //Same checks and reliable-protocol handling as AnalyzeNetworkDataWithByteArray, without building a JSON tree. On
+    //Data, OutView reads the variables straight from Parameter's buffer, which must outlive it; OutView.ToJson()
+    //gives the AnalyzeNetworkDataWithByteArray result when one is needed.
+    EBKUDPDecodeResult DecodeNetworkData(const FBKCHARWrapper& Parameter, sockaddr* OtherParty, FBKUDPPacketView& OutView);
+
+    //Starts a data packet in Builder: writes the flags, the message ID of a reliable packet and the timestamp, and leaves
+    //room for the checksum. Add the variables with the builder, then call FinishNetworkData. False if the system is
+    //not running, or is being shut down and the packet would need an answer.
+    bool BeginNetworkData(BKUDPPacketBuilder& Builder, bool bDoubleContentCount = false, bool bTimeOrderCriticalData = false, bool bReliableSYN = true);
+    //Fills in the checksum and, for a reliable packet, starts the handshake. The result points into Builder's buffer;
+    //send it before the builder is reused and do not deallocate it. Invalid if no variable was added.
+    FBKCHARWrapper FinishNetworkData(sockaddr* OtherParty, BKUDPPacketBuilder& Builder);
+
+    //Same packet as BeginNetworkData and FinishNetworkData with the variables of Parameter, keyed as in the
+    //AnalyzeNetworkDataWithByteArray result. Do not forget to deallocate the result manually.
     FBKCHARWrapper MakeByteArrayForNetworkData(
             sockaddr* OtherParty,
             BKJson::Node Parameter,
@@ -354,7 +393,12 @@ public:
 
     void MarkPendingKill(std::function<void()> _ReadyToDieCallback);
 
+    //Thread safe. The buffer may be freed as soon as this returns.
     void Send(sockaddr* OtherParty, const FBKCHARWrapper& SendBuffer);
+
+    //Fills the send fields of OutStats.
+    void GetSendStats(FBKUDPIOStats& OutStats) const;
+    void ResetSendStats();
 };
 
 #endif //Pragma_Once_BKUDProtocol
\ No newline at end of file
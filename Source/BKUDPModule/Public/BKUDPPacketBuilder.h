@@ -0,0 +1,211 @@
+// Copyright Burak Kara, All rights reserved.
+
+#ifndef Pragma_Once_BKUDPPacketBuilder
+#define Pragma_Once_BKUDPPacketBuilder
+
+#include "BKEngine.h"
+#include "BKMemory.h"
+#include "BKUDPPacketView.h"
+#include "../Private/BKUDPHelper.h"
+
+//Flags, message ID, checksum and timestamp.
+#define UDP_PACKET_MAX_HEADER_SIZE 11
+
+// Writes one datagram in the BKUDPHandler wire format straight into a caller-provided buffer, in a single pass:
+// BKUDPHandler::BeginNetworkData writes the header and leaves the checksum slot empty, the Add functions append the
+// variables, and BKUDPHandler::FinishNetworkData fills the checksum in place. A growable builder moves to the heap
+// when the buffer runs out, otherwise an Add that does not fit fails and leaves the packet as it was.
+class BKUDPPacketBuilder
+{
+
+private:
+    ANSICHAR* Buffer;
+    int32 Capacity;
+    int32 Size = 0;
+
+    bool bCanGrow;
+    ANSICHAR* HeapBuffer = nullptr;
+
+    uint8 Flags = 0;
+    uint32 MessageID = 0;
+    //INDEX_NONE for reliable validation packets, which carry no checksum and no variables.
+    int32 ChecksumIndex = INDEX_NONE;
+
+    BKUDPPacketBuilder(const BKUDPPacketBuilder&);
+    BKUDPPacketBuilder& operator=(const BKUDPPacketBuilder&);
+
+    bool Reserve(int32 Extra)
+    {
+        if (Capacity - Size >= Extra) return true;
+        if (!bCanGrow || Size + Extra > UDP_MAX_DATAGRAM_SIZE) return false;
+
+        int32 NewCapacity = Capacity * 2 > Size + Extra ? Capacity * 2 : Size + Extra;
+        if (NewCapacity > UDP_MAX_DATAGRAM_SIZE) NewCapacity = UDP_MAX_DATAGRAM_SIZE;
+
+        auto NewBuffer = new ANSICHAR[NewCapacity];
+        FMemory::Memcpy(NewBuffer, Buffer, static_cast<WSIZE__T>(Size));
+        delete[] HeapBuffer;
+        HeapBuffer = NewBuffer;
+        Buffer = NewBuffer;
+        Capacity = NewCapacity;
+        return true;
+    }
+
+public:
+    //_Buffer must outlive the builder and everything made from it.
+    BKUDPPacketBuilder(ANSICHAR* _Buffer, int32 _Capacity, bool _bCanGrow = false) : Buffer(_Buffer), Capacity(_Buffer ? _Capacity : 0), bCanGrow(_bCanGrow)
+    {
+    }
+    ~BKUDPPacketBuilder()
+    {
+        delete[] HeapBuffer;
+    }
+
+    //Called by BKUDPHandler; see AnalyzeNetworkDataWithByteArray for the layout. Fails if the header does not fit.
+    bool Start(uint8 _Flags, uint32 _MessageID, bool bWithChecksum, uint16 Timestamp)
+    {
+        Size = 0;
+        Flags = _Flags;
+        MessageID = _MessageID;
+        ChecksumIndex = INDEX_NONE;
+        if (!Reserve(UDP_PACKET_MAX_HEADER_SIZE)) return false;
+
+        Buffer[Size++] = static_cast<ANSICHAR>(Flags);
+        if (Flags & UDP_FLAGS_RELIABLE)
+        {
+            FMemory::Memcpy(Buffer + Size, &MessageID, 4);
+            Size += 4;
+        }
+        if (bWithChecksum)
+        {
+            ChecksumIndex = Size;
+            Size += 4;
+            if (!(Flags & UDP_FLAG_IGNORE_TIMESTAMP))
+            {
+                FMemory::Memcpy(Buffer + Size, &Timestamp, 2);
+                Size += 2;
+            }
+        }
+        return true;
+    }
+
+    //Writes the byte sum of the checksummed part into the slot Start left. False if there is no variable to cover.
+    bool SealChecksum()
+    {
+        if (ChecksumIndex == INDEX_NONE) return Size > 0;
+        if (Size == ChecksumIndex + 4) return false;
+
+        int32 Sum = 0;
+        for (int32 i = ChecksumIndex + 4; i < Size; i++)
+        {
+            Sum += static_cast<uint8>(Buffer[i]);
+        }
+        FMemory::Memcpy(Buffer + ChecksumIndex, &Sum, 4);
+        return true;
+    }
+
+    bool IsDoubleContentCount() const
+    {
+        return (Flags & UDP_FLAG_DOUBLE_CONTENT_COUNT) != 0;
+    }
+    //Exclusive; 32 or 8192.
+    int32 GetMaxCount() const
+    {
+        return IsDoubleContentCount() ? 8192 : 32;
+    }
+    bool CanHoldVariables() const
+    {
+        return ChecksumIndex != INDEX_NONE;
+    }
+
+    //Appends a variable header and returns where its values go, or nullptr if Count is out of range or it does not
+    //fit. Booleans are zeroed, so only the set bits need to be written.
+    uint8* AddSection(EBKUDPVariableType Type, int32 Count)
+    {
+        if (!CanHoldVariables() || Count <= 0 || Count >= GetMaxCount()) return nullptr;
+
+        const int32 HeaderSize = IsDoubleContentCount() ? 2 : 1;
+        const int32 ByteSize = FBKUDPSectionView::GetByteSize(Type, Count);
+        if (!Reserve(HeaderSize + ByteSize)) return nullptr;
+
+        //Little-endian word: 0-2 bits type, the rest count.
+        const int32 TypeAndCount = static_cast<int32>(Type) | (Count << 3);
+        Buffer[Size++] = static_cast<ANSICHAR>(TypeAndCount & 0xFF);
+        if (HeaderSize == 2)
+        {
+            Buffer[Size++] = static_cast<ANSICHAR>(TypeAndCount >> 8);
+        }
+
+        auto Section = reinterpret_cast<uint8*>(Buffer + Size);
+        if (Type == EBKUDPVariableType::BooleanArray)
+        {
+            FMemory::Memzero(Section, static_cast<WSIZE__T>(ByteSize));
+        }
+        Size += ByteSize;
+        return Section;
+    }
+
+    bool AddBooleans(const bool* Values, int32 Count)
+    {
+        uint8* Section = AddSection(EBKUDPVariableType::BooleanArray, Count);
+        if (!Section) return false;
+        for (int32 i = 0; i < Count; i++)
+        {
+            Section[i >> 3] |= static_cast<uint8>(Values[i] ? 1 << (i & 7) : 0);
+        }
+        return true;
+    }
+    bool AddBytes(const uint8* Values, int32 Count)
+    {
+        return AddCopy(EBKUDPVariableType::ByteArray, Values, Count);
+    }
+    //UTF-8, Count bytes.
+    bool AddChars(const ANSICHAR* Values, int32 Count)
+    {
+        return AddCopy(EBKUDPVariableType::CharArray, Values, Count);
+    }
+    bool AddShorts(const int16* Values, int32 Count)
+    {
+        return AddCopy(EBKUDPVariableType::ShortArray, Values, Count);
+    }
+    bool AddIntegers(const int32* Values, int32 Count)
+    {
+        return AddCopy(EBKUDPVariableType::IntegerArray, Values, Count);
+    }
+    bool AddFloats(const float* Values, int32 Count)
+    {
+        return AddCopy(EBKUDPVariableType::FloatArray, Values, Count);
+    }
+
+    const ANSICHAR* GetData() const
+    {
+        return Buffer;
+    }
+    ANSICHAR* GetMutableData()
+    {
+        return Buffer;
+    }
+    int32 Num() const
+    {
+        return Size;
+    }
+    uint8 GetFlags() const
+    {
+        return Flags;
+    }
+    uint32 GetMessageID() const
+    {
+        return MessageID;
+    }
+
+private:
+    bool AddCopy(EBKUDPVariableType Type, const void* Values, int32 Count)
+    {
+        uint8* Section = AddSection(Type, Count);
+        if (!Section) return false;
+        FMemory::Memcpy(Section, Values, static_cast<WSIZE__T>(FBKUDPSectionView::GetByteSize(Type, Count)));
+        return true;
+    }
+};
+
+#endif //Pragma_Once_BKUDPPacketBuilder
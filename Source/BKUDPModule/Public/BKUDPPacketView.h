@@ -0,0 +1,241 @@
+// Copyright Burak Kara, All rights reserved.
+
+#ifndef Pragma_Once_BKUDPPacketView
+#define Pragma_Once_BKUDPPacketView
+
+#include "BKEngine.h"
+#include "BKMemory.h"
+#include "BKJson.h"
+
+//Variable types of the generic part, see BKUDPHandler::AnalyzeNetworkDataWithByteArray.
+enum class EBKUDPVariableType : uint8
+{
+    BooleanArray = 0,
+    ByteArray = 1,
+    CharArray = 2,
+    ShortArray = 3,
+    IntegerArray = 4,
+    FloatArray = 5
+};
+#define UDP_VARIABLE_TYPE_COUNT 6
+
+//Bits of the flags byte.
+#define UDP_FLAG_RELIABLE_SYN 0b00000001
+#define UDP_FLAG_RELIABLE_SYN_SUCCESS 0b00000010
+#define UDP_FLAG_RELIABLE_SYN_FAILURE 0b00000100
+#define UDP_FLAG_RELIABLE_SYN_ACK_SUCCESS 0b00001000
+#define UDP_FLAG_RELIABLE_ACK 0b00010000
+#define UDP_FLAG_IGNORE_TIMESTAMP 0b00100000
+#define UDP_FLAG_DOUBLE_CONTENT_COUNT 0b01000000
+#define UDP_FLAGS_RELIABLE 0b00011111
+
+// One variable of a packet's generic part. Data points into the received buffer, which must outlive the section.
+struct FBKUDPSectionView
+{
+    EBKUDPVariableType Type = EBKUDPVariableType::ByteArray;
+    //Number of booleans, bytes, chars, shorts, integers or floats.
+    int32 Count = 0;
+    const uint8* Data = nullptr;
+
+    static int32 GetByteSize(EBKUDPVariableType Type, int32 Count)
+    {
+        switch (Type)
+        {
+            case EBKUDPVariableType::BooleanArray:
+                return (Count + 7) / 8;
+            case EBKUDPVariableType::ShortArray:
+                return Count * 2;
+            case EBKUDPVariableType::IntegerArray:
+            case EBKUDPVariableType::FloatArray:
+                return Count * 4;
+            default:
+                return Count;
+        }
+    }
+    int32 GetByteSize() const
+    {
+        return GetByteSize(Type, Count);
+    }
+
+    //Bit Index % 8 of byte Index / 8.
+    bool GetBool(int32 Index) const
+    {
+        return ((Data[Index >> 3] >> (Index & 7)) & 1) != 0;
+    }
+    uint8 GetByte(int32 Index) const
+    {
+        return Data[Index];
+    }
+    //UTF-8, Count bytes, not null terminated.
+    const ANSICHAR* GetChars() const
+    {
+        return reinterpret_cast<const ANSICHAR*>(Data);
+    }
+    //Values are stored unaligned and in host byte order, as MakeByteArrayForNetworkData writes them.
+    int16 GetShort(int32 Index) const
+    {
+        int16 Result;
+        FMemory::Memcpy(&Result, Data + Index * 2, 2);
+        return Result;
+    }
+    int32 GetInteger(int32 Index) const
+    {
+        int32 Result;
+        FMemory::Memcpy(&Result, Data + Index * 4, 4);
+        return Result;
+    }
+    float GetFloat(int32 Index) const
+    {
+        float Result;
+        FMemory::Memcpy(&Result, Data + Index * 4, 4);
+        return Result;
+    }
+};
+
+// Read-only view over one datagram in the BKUDPHandler wire format. Parse reads the header fields; the variables are
+// then walked in place with NextSection or ForEachSection. Nothing is copied or allocated unless ToJson is called.
+// Parse does not check the checksum or the timestamp order; BKUDPHandler::DecodeNetworkData does.
+struct FBKUDPPacketView
+{
+    const uint8* Data = nullptr;
+    int32 Size = 0;
+
+    bool bReliableSYN = false;
+    bool bReliableSYNSuccess = false;
+    bool bReliableSYNFailure = false;
+    bool bReliableSYNACKSuccess = false;
+    bool bReliableACK = false;
+    bool bIgnoreTimestamp = false;
+    bool bDoubleContentCount = false;
+
+    //Zero unless one of the reliable flags is set.
+    uint32 MessageID = 0;
+    //Zero if the packet carries none.
+    uint16 Timestamp = 0;
+
+    //False if the packet is shorter than the smallest header.
+    bool Parse(const ANSICHAR* _Data, int32 _Size)
+    {
+        *this = FBKUDPPacketView();
+        if (!_Data || _Size < 5) return false;
+
+        Data = reinterpret_cast<const uint8*>(_Data);
+        Size = _Size;
+
+        const uint8 Flags = Data[0];
+        bReliableSYN = (Flags & UDP_FLAG_RELIABLE_SYN) != 0;
+        bReliableSYNSuccess = (Flags & UDP_FLAG_RELIABLE_SYN_SUCCESS) != 0;
+        bReliableSYNFailure = (Flags & UDP_FLAG_RELIABLE_SYN_FAILURE) != 0;
+        bReliableSYNACKSuccess = (Flags & UDP_FLAG_RELIABLE_SYN_ACK_SUCCESS) != 0;
+        bReliableACK = (Flags & UDP_FLAG_RELIABLE_ACK) != 0;
+        bIgnoreTimestamp = (Flags & UDP_FLAG_IGNORE_TIMESTAMP) != 0;
+        bDoubleContentCount = (Flags & UDP_FLAG_DOUBLE_CONTENT_COUNT) != 0;
+
+        if (IsReliable())
+        {
+            FMemory::Memcpy(&MessageID, Data + 1, 4);
+        }
+        if (HasTimestamp())
+        {
+            FMemory::Memcpy(&Timestamp, Data + GetChecksummedIndex(), 2);
+        }
+        return true;
+    }
+
+    bool IsReliable() const
+    {
+        return bReliableSYN || bReliableSYNSuccess || bReliableSYNFailure || bReliableSYNACKSuccess || bReliableACK;
+    }
+
+    int32 GetChecksumIndex() const
+    {
+        return IsReliable() ? 5 : 1;
+    }
+    //The checksum covers everything from here to the end.
+    int32 GetChecksummedIndex() const
+    {
+        return IsReliable() ? 9 : 5;
+    }
+    int32 GetPayloadIndex() const
+    {
+        return GetChecksummedIndex() + (bIgnoreTimestamp ? 0 : 2);
+    }
+
+    //A timestamp followed by at least one byte.
+    bool HasTimestamp() const
+    {
+        return !bIgnoreTimestamp && Size >= GetChecksummedIndex() + 3;
+    }
+
+    //Byte sum of the checksummed part, compared with the 4 checksum bytes (see BKUtilities::WBasicRawHash).
+    bool HasValidChecksum() const
+    {
+        const int32 From = GetChecksummedIndex();
+        if (Size < From + 1) return false;
+
+        int32 Sum = 0;
+        for (int32 i = From; i < Size; i++)
+        {
+            Sum += Data[i];
+        }
+        return FMemory::Memcmp(&Sum, Data + GetChecksumIndex(), 4) == 0;
+    }
+
+    //Walks the variables of the generic part; start with Offset = GetPayloadIndex(). Empty variables and unknown types
+    //are skipped. Returns false at the end or at a variable cut short by the end of the packet.
+    bool NextSection(int32& Offset, FBKUDPSectionView& OutSection) const
+    {
+        const int32 HeaderSize = bDoubleContentCount ? 2 : 1;
+        while (Size - Offset > HeaderSize)
+        {
+            const uint8 TypeAndCount = Data[Offset];
+            auto Type = static_cast<uint8>(TypeAndCount & 0b00000111);
+            int32 Count = TypeAndCount >> 3;
+            if (bDoubleContentCount)
+            {
+                //Bits 3-15 of the little-endian word.
+                Count |= static_cast<int32>(Data[Offset + 1]) << 5;
+            }
+            Offset += HeaderSize;
+
+            if (Count == 0 || Type >= UDP_VARIABLE_TYPE_COUNT) continue;
+
+            OutSection.Type = static_cast<EBKUDPVariableType>(Type);
+            OutSection.Count = Count;
+            OutSection.Data = Data + Offset;
+
+            const int32 ByteSize = OutSection.GetByteSize();
+            if (Size - Offset < ByteSize)
+            {
+                Offset = Size;
+                return false;
+            }
+            Offset += ByteSize;
+            return true;
+        }
+        return false;
+    }
+
+    //Calls Visitor(const FBKUDPSectionView&) for every variable, in packet order.
+    template <typename F>
+    void ForEachSection(const F& Visitor) const
+    {
+        if (!Data) return;
+
+        int32 Offset = GetPayloadIndex();
+        FBKUDPSectionView Section;
+        while (NextSection(Offset, Section))
+        {
+            Visitor(Section);
+        }
+    }
+
+    //The object AnalyzeNetworkDataWithByteArray returns: variables of one type are concatenated under "BooleanArray",
+    //"ByteArray", "CharArray", "ShortArray", "IntegerArray" or "FloatArray".
+    BKJson::Node ToJson() const;
+
+    //Inverse of the key names above; false for any other name.
+    static bool FindVariableType(const FString& Name, EBKUDPVariableType& OutType);
+};
+
+#endif //Pragma_Once_BKUDPPacketView
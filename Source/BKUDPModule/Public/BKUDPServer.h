@@ -13,14 +13,44 @@
 #endif
 #include "../Private/BKUDPHelper.h"
 #include "BKUDPHandler.h"
+#include "BKAtomic.h"
+
+// One socket bound to the server's port, with its own receive thread and handler. With SO_REUSEPORT the kernel hashes
+// every flow to one of the sockets, so a peer always lands on the same shard and its reliable-connection records stay
+// in that shard's handler.
+struct FBKUDPServerShard
+{
+    int32 Index = 0;
+#if PLATFORM_WINDOWS
+    SOCKET UDPSocket{};
+#else
+    int32 UDPSocket{};
+#endif
+    BKUDPHandler* UDPHandler = nullptr;
+    BKUDPReceiveBatch* ReceiveBatch = nullptr;
+    BKThread* UDPSystemThread = nullptr;
+};
 
 class BKUDPServer : public BKAsyncTaskParameter
 {
 
 public:
-    bool StartSystem(uint16 Port);
+    //ShardCount sockets share the port through SO_REUSEPORT (Linux only; elsewhere there is always one), each with its
+    //own receive thread and handler. With several shards, receive thread i is pinned to the i-th core of
+    //Layout.ListenerAffinityMask; with one, it runs on the whole mask.
+    bool StartSystem(uint16 Port, const FBKCoreLayout& Layout = FBKCoreLayout(), const FBKUDPIOOptions& IOOptions = FBKUDPIOOptions(), int32 ShardCount = 1);
     void EndSystem();
 
+    int32 GetShardCount() const
+    {
+        return Shards.Num();
+    }
+
+    //Receive and send syscall counts of all shards since the start or the last ResetIOStats.
+    void GetIOStats(FBKUDPIOStats& OutStats) const;
+    void GetShardIOStats(int32 ShardIndex, FBKUDPIOStats& OutStats) const;
+    void ResetIOStats();
+
     explicit BKUDPServer(std::function<void(BKUDPHandler* HandlerInstance, WUDPTaskParameter*)> Callback)
     {
         UDPListenCallback = std::move(Callback);
@@ -29,26 +59,23 @@ public:
 private:
     BKUDPServer() = default;
 
-    bool bSystemStarted = false;
+    BKAtomic<bool> bSystemStarted{false};
 
     struct sockaddr_in UDPServer{};
 
-#if PLATFORM_WINDOWS
-    SOCKET UDPSocket{};
-#else
-    int32 UDPSocket{};
-#endif
+    TArray<FBKUDPServerShard*> Shards;
 
-    BKUDPHandler* UDPHandler = nullptr;
-
-    bool InitializeSocket(uint16 Port);
-    void CloseSocket();
-    void ListenSocket();
-    uint32 ListenerStopped();
+    bool InitializeSocket(FBKUDPServerShard* Shard, uint16 Port, bool bReusePort);
+    void CloseSocket(FBKUDPServerShard* Shard);
+    void ListenSocket(FBKUDPServerShard* Shard);
+    uint32 ListenerStopped(FBKUDPServerShard* Shard);
+    void DestroyShards();
 
     std::function<void(BKUDPHandler* HandlerInstance, WUDPTaskParameter*)> UDPListenCallback = nullptr;
 
-    BKThread* UDPSystemThread = nullptr;
+    FBKCoreLayout CoreLayout;
+    FBKUDPIOOptions IOOptions;
+    void CreateListenerThread(FBKUDPServerShard* Shard);
 };
 
 #endif //Pragma_Once_BKUDPServer
\ No newline at end of file
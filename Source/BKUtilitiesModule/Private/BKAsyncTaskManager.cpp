@@ -1,17 +1,109 @@
 // Copyright Burak Kara, All rights reserved.
 
 #include "BKAsyncTaskManager.h"
+#include "BKMemory.h"
+#include "BKFutex.h"
+#include <chrono>
 
 BKAsyncTaskManager* BKAsyncTaskManager::ManagerInstance = nullptr;
 
+//Worker running on the current thread: routes tasks spawned from a worker to its own deque and attributes its busy time.
+static thread_local FBKAsyncWorker* CurrentThreadWorker = nullptr;
+
+//Position in the weighted lane schedule. Per thread so picking a lane never touches shared state.
+static thread_local uint32 LaneTicket = 0;
+
+static uint64 GetMonotonicNanoseconds()
+{
+    return static_cast<uint64>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+//Index of the shared workers in FreeWorkers.
+#define ASYNC_TASK_SHARED_WORKERS ASYNC_TASK_PRIORITY_COUNT
+
+struct FBKAsyncTaskPool
+{
+    BKMPMCQueue<FBKAwaitingTask*, ASYNC_TASK_POOL_CAPACITY> Tasks;
+
+    ~FBKAsyncTaskPool()
+    {
+        FBKAwaitingTask* Task = nullptr;
+        while (Tasks.TryPop(Task))
+        {
+            delete (Task);
+        }
+    }
+};
+static FBKAsyncTaskPool GlobalTaskPool;
+
+struct FBKAsyncTaskCache
+{
+    FBKAwaitingTask* Tasks[ASYNC_TASK_POOL_LOCAL_CACHE_SIZE];
+    int32 Count = 0;
+
+    ~FBKAsyncTaskCache()
+    {
+        int32 Pushed = GlobalTaskPool.Tasks.TryPushBulk(Tasks, Count);
+        for (int32 i = Pushed; i < Count; i++)
+        {
+            delete (Tasks[i]);
+        }
+        Count = 0;
+    }
+};
+static thread_local FBKAsyncTaskCache LocalTaskCache;
+
+void BKAsyncTaskManager::ReportQueueDelay(FBKAwaitingTask* Task)
+{
+    if (!Task->bQueued) return;
+
+    double DiffMs = BKUtilities::GetTimeStampInMSDetailed() - Task->QueuedTimestamp;
+    if (DiffMs > 1000)
+    {
+        BKUtilities::Print(EBKLogType::Warning, FString(L"WAsyncTask was in queue for ") + FString::FromFloat(DiffMs));
+    }
+
+    if (ManagerInstance)
+    {
+        FBKLaneCounters& Counters = ManagerInstance->LaneCounters[static_cast<int32>(Task->Priority)];
+        uint64 WaitUs = DiffMs > 0 ? static_cast<uint64>(DiffMs * 1000) : 0;
+        BKTaskMetrics::RecordQueueWait(Task->Priority, WaitUs);
+        Counters.DequeuedTasks.fetch_add(1, std::memory_order_relaxed);
+        Counters.TotalWaitUs.fetch_add(WaitUs, std::memory_order_relaxed);
+
+        uint64 CurrentMax = Counters.MaxWaitUs.load(std::memory_order_relaxed);
+        while (WaitUs > CurrentMax && !Counters.MaxWaitUs.compare_exchange_weak(CurrentMax, WaitUs, std::memory_order_relaxed))
+        {
+        }
+
+        //A queue slot was freed.
+        if (Counters.BlockedProducers.load(std::memory_order_seq_cst) > 0)
+        {
+            Counters.SpaceEpoch.fetch_add(1, std::memory_order_release);
+            BKFutex::WakeAll(&Counters.SpaceEpoch);
+        }
+        if (Counters.bAboveHighWatermark.load(std::memory_order_relaxed))
+        {
+            const int32 Lane = static_cast<int32>(Task->Priority);
+            if (ManagerInstance->GetQueuedTaskCount(Lane) < ManagerInstance->LaneOptions.HighWatermark[Lane] / 2)
+            {
+                Counters.bAboveHighWatermark.store(false, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    Task->bQueued = false;
+    Task->QueuedTimestamp = 0;
+}
+
 bool BKAsyncTaskManager::bSystemStarted = false;
-void BKAsyncTaskManager::StartSystem(int32 WorkerThreadNo)
+void BKAsyncTaskManager::StartSystem(int32 WorkerThreadNo, bool bWorkStealing, const FBKCoreLayout& Layout, const FBKIdleStrategy& IdleStrategy, const FBKTaskLaneOptions& LaneOptions)
 {
     if (bSystemStarted) return;
     bSystemStarted = true;
 
     ManagerInstance = new BKAsyncTaskManager;
-    ManagerInstance->StartSystem_Internal(WorkerThreadNo);
+    ManagerInstance->StartSystem_Internal(WorkerThreadNo, bWorkStealing, Layout, IdleStrategy, LaneOptions);
 }
 void BKAsyncTaskManager::EndSystem()
 {
@@ -29,25 +121,303 @@ bool BKAsyncTaskManager::IsSystemStarted()
 {
     return bSystemStarted;
 }
+bool BKAsyncTaskManager::IsWorkStealingEnabled()
+{
+    return bSystemStarted && ManagerInstance && ManagerInstance->bWorkStealingMode;
+}
+int32 BKAsyncTaskManager::GetWorkerCount()
+{
+    return bSystemStarted && ManagerInstance ? ManagerInstance->WorkerThreadCount : 0;
+}
 
-void BKAsyncTaskManager::StartSystem_Internal(int32 WorkerThreadNo)
+FBKTaskLaneStats BKAsyncTaskManager::GetLaneStats(EBKTaskPriority Priority)
 {
+    FBKTaskLaneStats Stats;
+    if (!bSystemStarted || !ManagerInstance) return Stats;
+
+    const int32 Lane = static_cast<int32>(Priority);
+    if (Lane < 0 || Lane >= ASYNC_TASK_PRIORITY_COUNT) return Stats;
+
+    Stats.QueuedTasks = ManagerInstance->GetQueuedTaskCount(Lane);
+
+    const FBKLaneCounters& Counters = ManagerInstance->LaneCounters[Lane];
+    Stats.DequeuedTasks = Counters.DequeuedTasks.load(std::memory_order_relaxed);
+    Stats.TotalWaitMs = static_cast<double>(Counters.TotalWaitUs.load(std::memory_order_relaxed)) / 1000.0;
+    Stats.MaxWaitMs = static_cast<double>(Counters.MaxWaitUs.load(std::memory_order_relaxed)) / 1000.0;
+    Stats.DroppedTasks = Counters.DroppedTasks.load(std::memory_order_relaxed);
+    Stats.RejectedTasks = Counters.RejectedTasks.load(std::memory_order_relaxed);
+    Stats.BlockedSubmissions = Counters.BlockedSubmissions.load(std::memory_order_relaxed);
+    return Stats;
+}
+void BKAsyncTaskManager::ResetLaneStats()
+{
+    if (!bSystemStarted || !ManagerInstance) return;
+
+    for (FBKLaneCounters& Counters : ManagerInstance->LaneCounters)
+    {
+        Counters.DequeuedTasks.store(0, std::memory_order_relaxed);
+        Counters.TotalWaitUs.store(0, std::memory_order_relaxed);
+        Counters.MaxWaitUs.store(0, std::memory_order_relaxed);
+        Counters.DroppedTasks.store(0, std::memory_order_relaxed);
+        Counters.RejectedTasks.store(0, std::memory_order_relaxed);
+        Counters.BlockedSubmissions.store(0, std::memory_order_relaxed);
+    }
+}
+
+void BKAsyncTaskManager::GetWorkerUtilization(TArray<FBKWorkerUtilization>& OutWorkers)
+{
+    OutWorkers.Reset();
+    if (!bSystemStarted || !ManagerInstance || !ManagerInstance->AsyncWorkers) return;
+
+    const uint64 NowNs = GetMonotonicNanoseconds();
+    for (int32 i = 0; i < ManagerInstance->WorkerThreadCount; i++)
+    {
+        FBKAsyncWorker* Worker = ManagerInstance->AsyncWorkers[i];
+        if (!Worker) continue;
+
+        FBKWorkerUtilization Utilization;
+        Utilization.WorkerIndex = Worker->WorkerIndex;
+        Utilization.ReservedLane = Worker->ReservedLane;
+        Utilization.ExecutedTasks = Worker->ExecutedTasks.load(std::memory_order_relaxed);
+
+        uint64 StartNs = Worker->UtilizationStartNs.load(std::memory_order_relaxed);
+        uint64 BusyNs = Worker->BusyNanoseconds.load(std::memory_order_relaxed);
+        if (NowNs > StartNs)
+        {
+            double Ratio = static_cast<double>(BusyNs) / static_cast<double>(NowNs - StartNs);
+            Utilization.BusyRatio = Ratio < 1.0 ? Ratio : 1.0;
+        }
+        OutWorkers.Add(Utilization);
+    }
+}
+void BKAsyncTaskManager::ResetWorkerUtilization()
+{
+    if (!bSystemStarted || !ManagerInstance || !ManagerInstance->AsyncWorkers) return;
+
+    const uint64 NowNs = GetMonotonicNanoseconds();
+    for (int32 i = 0; i < ManagerInstance->WorkerThreadCount; i++)
+    {
+        FBKAsyncWorker* Worker = ManagerInstance->AsyncWorkers[i];
+        if (!Worker) continue;
+
+        Worker->UtilizationStartNs.store(NowNs, std::memory_order_relaxed);
+        Worker->BusyNanoseconds.store(0, std::memory_order_relaxed);
+        Worker->ExecutedTasks.store(0, std::memory_order_relaxed);
+    }
+}
+
+bool BKAsyncTaskManager::AdmitTasks(EBKTaskPriority Priority, int32 Count, EBKOverloadPolicy Overload)
+{
+    if (!bSystemStarted || !ManagerInstance) return false;
+    return ManagerInstance->AdmitTasks_Internal(Priority, Count, Overload);
+}
+bool BKAsyncTaskManager::IsOverloaded(EBKTaskPriority Priority)
+{
+    if (!bSystemStarted || !ManagerInstance || !ManagerInstance->bHasQueueLimits) return false;
+
+    const int32 Lane = static_cast<int32>(Priority);
+    const int32 Limit = ManagerInstance->LaneOptions.MaxQueuedTasks[Lane];
+    return Limit > 0 && ManagerInstance->GetQueuedTaskCount(Lane) >= Limit;
+}
+int32 BKAsyncTaskManager::GetQueuedTaskCount(int32 Lane) const
+{
+    int32 Queued = AwaitingTasks[Lane].Size();
+    if (Lane == static_cast<int32>(EBKTaskPriority::Normal) && WorkerDeques)
+    {
+        for (int32 i = 0; i < WorkerThreadCount; i++)
+        {
+            Queued += WorkerDeques[i]->Size();
+        }
+    }
+    return Queued;
+}
+bool BKAsyncTaskManager::AdmitTasks_Internal(EBKTaskPriority Priority, int32 Count, EBKOverloadPolicy Overload)
+{
+    if (!bHasQueueLimits) return true;
+
+    const int32 Lane = static_cast<int32>(Priority);
+    FBKLaneCounters& Counters = LaneCounters[Lane];
+    const int32 Limit = LaneOptions.MaxQueuedTasks[Lane];
+
+    int32 Queued = GetQueuedTaskCount(Lane);
+    if (Limit > 0 && Queued >= Limit)
+    {
+        switch (Overload)
+        {
+            case EBKOverloadPolicy::DropNewest:
+                Counters.DroppedTasks.fetch_add(static_cast<uint64>(Count), std::memory_order_relaxed);
+                return false;
+            case EBKOverloadPolicy::Reject:
+                Counters.RejectedTasks.fetch_add(static_cast<uint64>(Count), std::memory_order_relaxed);
+                return false;
+            case EBKOverloadPolicy::Block:
+                if (!CurrentThreadWorker)
+                {
+                    WaitForQueueSpace(Lane);
+                    if (!bSystemStarted) return false;
+                    Queued = GetQueuedTaskCount(Lane);
+                }
+                break;
+        }
+    }
+
+    const int32 Watermark = LaneOptions.HighWatermark[Lane];
+    if (Watermark > 0 && Queued + Count >= Watermark && !Counters.bAboveHighWatermark.exchange(true, std::memory_order_relaxed))
+    {
+        if (LaneOptions.HighWatermarkCallback)
+        {
+            LaneOptions.HighWatermarkCallback(Priority, Queued + Count);
+        }
+        else
+        {
+            BKUtilities::Print(EBKLogType::Warning, FString(L"Async task lane ") + FString::FromInt(Lane) + FString(L" has crossed its high watermark with ") + FString::FromInt(Queued + Count) + FString(L" queued tasks."));
+        }
+    }
+    return true;
+}
+void BKAsyncTaskManager::WaitForQueueSpace(int32 Lane)
+{
+    FBKLaneCounters& Counters = LaneCounters[Lane];
+    Counters.BlockedSubmissions.fetch_add(1, std::memory_order_relaxed);
+
+    //Registered before the depth is read, so a consumer freeing a slot afterwards bumps the epoch.
+    Counters.BlockedProducers.fetch_add(1, std::memory_order_seq_cst);
+    while (bSystemStarted)
+    {
+        uint32 Epoch = Counters.SpaceEpoch.load(std::memory_order_acquire);
+        if (GetQueuedTaskCount(Lane) < LaneOptions.MaxQueuedTasks[Lane]) break;
+        BKFutex::Wait(&Counters.SpaceEpoch, Epoch, ASYNC_TASK_BLOCKED_PRODUCER_RECHECK_MS);
+    }
+    Counters.BlockedProducers.fetch_sub(1, std::memory_order_release);
+}
+
+void BKAsyncTaskManager::StartSystem_Internal(int32 WorkerThreadNo, bool bWorkStealing, const FBKCoreLayout& Layout, const FBKIdleStrategy& _IdleStrategy, const FBKTaskLaneOptions& _LaneOptions)
+{
+    bWorkStealingMode = bWorkStealing;
+    CoreLayout = Layout;
+    IdleStrategy = _IdleStrategy;
+    LaneOptions = _LaneOptions;
+    for (int32 Lane = 0; Lane < ASYNC_TASK_PRIORITY_COUNT; Lane++)
+    {
+        if (LaneOptions.MaxQueuedTasks[Lane] > 0 || LaneOptions.HighWatermark[Lane] > 0) bHasQueueLimits = true;
+    }
+    BuildLaneSchedule();
     StartWorkers(WorkerThreadNo);
 }
+void BKAsyncTaskManager::BuildLaneSchedule()
+{
+    uint32 Weights[ASYNC_TASK_PRIORITY_COUNT];
+    uint32 TotalWeight = 0;
+    for (int32 Lane = 0; Lane < ASYNC_TASK_PRIORITY_COUNT; Lane++)
+    {
+        Weights[Lane] = LaneOptions.LaneWeights[Lane];
+        TotalWeight += Weights[Lane];
+    }
+    if (TotalWeight == 0)
+    {
+        //Degenerates to strict priority.
+        LaneScheduleLength = 0;
+        return;
+    }
+    if (TotalWeight > ASYNC_TASK_LANE_SCHEDULE_MAX)
+    {
+        uint32 ScaledTotal = 0;
+        for (int32 Lane = 0; Lane < ASYNC_TASK_PRIORITY_COUNT; Lane++)
+        {
+            if (Weights[Lane] == 0) continue;
+            uint32 Scaled = static_cast<uint32>(static_cast<uint64>(Weights[Lane]) * (ASYNC_TASK_LANE_SCHEDULE_MAX - ASYNC_TASK_PRIORITY_COUNT) / TotalWeight);
+            Weights[Lane] = Scaled > 0 ? Scaled : 1;
+            ScaledTotal += Weights[Lane];
+        }
+        TotalWeight = ScaledTotal;
+    }
+
+    //Smooth weighted round-robin: lanes are interleaved rather than served in runs, so no lane waits a full cycle.
+    int32 Current[ASYNC_TASK_PRIORITY_COUNT] = {};
+    LaneScheduleLength = static_cast<int32>(TotalWeight);
+    for (int32 Slot = 0; Slot < LaneScheduleLength; Slot++)
+    {
+        int32 Best = 0;
+        for (int32 Lane = 0; Lane < ASYNC_TASK_PRIORITY_COUNT; Lane++)
+        {
+            Current[Lane] += static_cast<int32>(Weights[Lane]);
+            if (Current[Lane] > Current[Best]) Best = Lane;
+        }
+        Current[Best] -= static_cast<int32>(TotalWeight);
+        LaneSchedule[Slot] = static_cast<uint8>(Best);
+    }
+}
+int32 BKAsyncTaskManager::GetReservedLane(int32 WorkerIndex) const
+{
+    int32 FirstWorkerOfLane = 0;
+    for (int32 Lane = 0; Lane < ASYNC_TASK_PRIORITY_COUNT; Lane++)
+    {
+        int32 Count = LaneOptions.ReservedWorkers[Lane] > 0 ? LaneOptions.ReservedWorkers[Lane] : 0;
+        if (WorkerIndex < FirstWorkerOfLane + Count) return Lane;
+        FirstWorkerOfLane += Count;
+    }
+    return INDEX_NONE;
+}
+int32 BKAsyncTaskManager::PickPreferredLane() const
+{
+    if (LaneOptions.bStrictPriority || LaneScheduleLength == 0) return INDEX_NONE;
+    return LaneSchedule[LaneTicket++ % static_cast<uint32>(LaneScheduleLength)];
+}
 void BKAsyncTaskManager::StartWorkers(int32 WorkerThreadNo)
 {
     if (WorkerThreadNo <= 0) WorkerThreadNo = 1;
+    if (WorkerThreadNo > ASYNC_TASK_MANAGER_MAX_WORKERS)
+    {
+        BKUtilities::Print(EBKLogType::Warning, FString(L"Requested async worker count exceeds the limit; clamping to ") + FString::FromInt(ASYNC_TASK_MANAGER_MAX_WORKERS));
+        WorkerThreadNo = ASYNC_TASK_MANAGER_MAX_WORKERS;
+    }
     WorkerThreadCount = WorkerThreadNo;
 
+    int32 ReservedTotal = 0;
+    for (int32 Lane = 0; Lane < ASYNC_TASK_PRIORITY_COUNT; Lane++)
+    {
+        if (LaneOptions.ReservedWorkers[Lane] < 0) LaneOptions.ReservedWorkers[Lane] = 0;
+        if (ReservedTotal + LaneOptions.ReservedWorkers[Lane] > WorkerThreadCount - 1)
+        {
+            BKUtilities::Print(EBKLogType::Warning, FString(L"Reserved async workers leave no shared worker; reducing the reservation."));
+            LaneOptions.ReservedWorkers[Lane] = WorkerThreadCount - 1 - ReservedTotal;
+        }
+        ReservedTotal += LaneOptions.ReservedWorkers[Lane];
+    }
+
+    if (bWorkStealingMode && !WorkerDeques)
+    {
+        WorkerDeques = new BKWorkStealingDeque<FBKAwaitingTask*>*[WorkerThreadCount];
+        for (int32 i = 0; i < WorkerThreadCount; i++)
+        {
+            WorkerDeques[i] = new BKWorkStealingDeque<FBKAwaitingTask*>;
+        }
+    }
+
+    //All slots must be valid before any worker thread starts stealing.
     AsyncWorkers = new FBKAsyncWorker*[WorkerThreadCount];
     for (int32 i = 0; i < WorkerThreadCount; i++)
     {
-        AsyncWorkers[i] = new FBKAsyncWorker;
+        AsyncWorkers[i] = new FBKAsyncWorker(i);
+    }
+    for (int32 i = 0; i < WorkerThreadCount; i++)
+    {
         AsyncWorkers[i]->StartWorker();
     }
 }
 void BKAsyncTaskManager::EndSystem_Internal()
 {
+    //bSystemStarted is already false; release blocked producers before the counters they wait on go away.
+    for (FBKLaneCounters& Counters : LaneCounters)
+    {
+        while (Counters.BlockedProducers.load(std::memory_order_acquire) > 0)
+        {
+            Counters.SpaceEpoch.fetch_add(1, std::memory_order_release);
+            BKFutex::WakeAll(&Counters.SpaceEpoch);
+            std::this_thread::yield();
+        }
+    }
+
     for (int32 i = 0; i < WorkerThreadCount; i++)
     {
         if (AsyncWorkers[i])
@@ -59,36 +429,132 @@ void BKAsyncTaskManager::EndSystem_Internal()
     delete[] AsyncWorkers;
 
     FBKAwaitingTask* AwaitingTask = nullptr;
-    while (AwaitingTasks.Pop(AwaitingTask))
+    if (WorkerDeques)
+    {
+        for (int32 i = 0; i < WorkerThreadCount; i++)
+        {
+            while (WorkerDeques[i]->Pop(AwaitingTask))
+            {
+                QueueTask(AwaitingTask);
+            }
+            delete (WorkerDeques[i]);
+        }
+        delete[] WorkerDeques;
+        WorkerDeques = nullptr;
+    }
+
+    for (int32 Lane = 0; Lane < ASYNC_TASK_PRIORITY_COUNT; Lane++)
     {
-        if (AwaitingTask)
+        while (AwaitingTasks[Lane].Pop(AwaitingTask))
         {
-            for (BKAsyncTaskParameter* Param : AwaitingTask->Parameters)
+            if (AwaitingTask)
             {
-                if (Param)
+                for (BKAsyncTaskParameter* Param : AwaitingTask->Parameters)
                 {
-                    delete (Param);
+                    if (Param)
+                    {
+                        delete (Param);
+                    }
                 }
+                ReleaseTask(AwaitingTask);
             }
-            AwaitingTask->Parameters.Empty();
-            delete (AwaitingTask);
         }
     }
 }
 
+void BKAsyncTaskManager::QueueTask(FBKAwaitingTask* Task)
+{
+    AwaitingTasks[static_cast<int32>(Task->Priority)].Push(Task);
+}
+bool BKAsyncTaskManager::PopAwaitingTask(int32 ReservedLane, FBKAwaitingTask*& OutTask)
+{
+    if (ReservedLane != INDEX_NONE) return AwaitingTasks[ReservedLane].Pop(OutTask);
+
+    int32 PreferredLane = PickPreferredLane();
+    if (PreferredLane != INDEX_NONE && AwaitingTasks[PreferredLane].Pop(OutTask)) return true;
+
+    for (int32 Lane = 0; Lane < ASYNC_TASK_PRIORITY_COUNT; Lane++)
+    {
+        if (Lane != PreferredLane && AwaitingTasks[Lane].Pop(OutTask)) return true;
+    }
+    return false;
+}
+bool BKAsyncTaskManager::HasAwaitingTasks(int32 ReservedLane) const
+{
+    if (ReservedLane != INDEX_NONE) return !AwaitingTasks[ReservedLane].IsEmpty();
+
+    for (int32 Lane = 0; Lane < ASYNC_TASK_PRIORITY_COUNT; Lane++)
+    {
+        if (!AwaitingTasks[Lane].IsEmpty()) return true;
+    }
+    return false;
+}
+
 void BKAsyncTaskManager::PushFreeWorker(FBKAsyncWorker* Worker)
 {
     if (!bSystemStarted || !ManagerInstance || !Worker) return;
-    ManagerInstance->FreeWorkers.Push(Worker);
+
+    const int32 WorkerClass = Worker->ReservedLane != INDEX_NONE ? Worker->ReservedLane : ASYNC_TASK_SHARED_WORKERS;
+    ManagerInstance->FreeWorkers[WorkerClass].TryPush(Worker);
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (ManagerInstance->HasAwaitingTasks(Worker->ReservedLane))
+    {
+        ManagerInstance->DispatchAwaitingTasks(WorkerClass);
+    }
+}
+void BKAsyncTaskManager::DispatchAwaitingTasks()
+{
+    for (int32 WorkerClass = 0; WorkerClass <= ASYNC_TASK_SHARED_WORKERS; WorkerClass++)
+    {
+        DispatchAwaitingTasks(WorkerClass);
+    }
+}
+void BKAsyncTaskManager::DispatchAwaitingTasks(int32 WorkerClass)
+{
+    const int32 ReservedLane = WorkerClass == ASYNC_TASK_SHARED_WORKERS ? INDEX_NONE : WorkerClass;
+    while (HasAwaitingTasks(ReservedLane))
+    {
+        FBKAsyncWorker* PossibleFreeWorker = nullptr;
+        if (!FreeWorkers[WorkerClass].TryPop(PossibleFreeWorker) || !PossibleFreeWorker) return;
+
+        FBKAwaitingTask* PossibleAwaitingTask = nullptr;
+        if (!PopAwaitingTask(ReservedLane, PossibleAwaitingTask) || !PossibleAwaitingTask)
+        {
+            FreeWorkers[WorkerClass].TryPush(PossibleFreeWorker);
+            return;
+        }
+        ReportQueueDelay(PossibleAwaitingTask);
+        PossibleFreeWorker->SetData(PossibleAwaitingTask, true);
+    }
 }
 
-void BKAsyncTaskManager::NewAsyncTask(BKFutureAsyncTask& NewTask, TArray<BKAsyncTaskParameter*>& TaskParameters, bool bDoNotDeallocateParameters)
+bool BKAsyncTaskManager::NewAsyncTask(BKFutureAsyncTask& NewTask, TArray<BKAsyncTaskParameter*>& TaskParameters, bool bDoNotDeallocateParameters,
+        EBKTaskPriority Priority, EBKOverloadPolicy Overload)
 {
-    if (!bSystemStarted || !ManagerInstance) return;
+    if (!bSystemStarted || !ManagerInstance) return false;
+    if (!ManagerInstance->AdmitTasks_Internal(Priority, 1, Overload)) return false;
 
-    auto AsTask = new FBKAwaitingTask(NewTask, TaskParameters, bDoNotDeallocateParameters);
+    FBKAwaitingTask* AsTask = AllocateTask();
+    AsTask->FunctionPtr = NewTask;
+    AsTask->Parameters = TaskParameters;
+    AsTask->bDoNotDeallocateParameters = bDoNotDeallocateParameters;
+    AsTask->Priority = Priority;
+    ManagerInstance->SubmitTask(AsTask);
+    return true;
+}
+void BKAsyncTaskManager::SubmitTask(FBKAwaitingTask* AsTask)
+{
+    if (bWorkStealingMode)
+    {
+        EnqueueTask_WorkStealing(AsTask);
+        return;
+    }
+
+    const int32 Lane = static_cast<int32>(AsTask->Priority);
     FBKAsyncWorker* PossibleFreeWorker = nullptr;
-    if (ManagerInstance->FreeWorkers.Pop(PossibleFreeWorker) && PossibleFreeWorker)
+    if ((FreeWorkers[Lane].TryPop(PossibleFreeWorker) && PossibleFreeWorker) ||
+        (FreeWorkers[ASYNC_TASK_SHARED_WORKERS].TryPop(PossibleFreeWorker) && PossibleFreeWorker))
     {
         PossibleFreeWorker->SetData(AsTask, true);
     }
@@ -96,15 +562,231 @@ void BKAsyncTaskManager::NewAsyncTask(BKFutureAsyncTask& NewTask, TArray<BKAsync
     {
         AsTask->QueuedTimestamp = BKUtilities::GetTimeStampInMSDetailed();
         AsTask->bQueued = true;
-        ManagerInstance->AwaitingTasks.Push(AsTask);
+        QueueTask(AsTask);
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!FreeWorkers[Lane].IsEmpty())
+        {
+            DispatchAwaitingTasks(Lane);
+        }
+        if (!FreeWorkers[ASYNC_TASK_SHARED_WORKERS].IsEmpty())
+        {
+            DispatchAwaitingTasks(ASYNC_TASK_SHARED_WORKERS);
+        }
+    }
+}
+void BKAsyncTaskManager::NewAsyncTasks(BKAsyncTaskBatch& Batch)
+{
+    const int32 Count = Batch.TaskNum;
+    Batch.TaskNum = 0;
+    if (Count == 0) return;
+
+    if (!bSystemStarted || !ManagerInstance)
+    {
+        for (int32 i = 0; i < Count; i++)
+        {
+            ReleaseTask(Batch.Tasks[i]);
+        }
+        return;
+    }
+    ManagerInstance->SubmitTasks(Batch.Tasks, Count, Batch.Priority);
+}
+void BKAsyncTaskManager::SubmitTasks(FBKAwaitingTask** Tasks, int32 Count, EBKTaskPriority Priority)
+{
+    const int32 Lane = static_cast<int32>(Priority);
+    const double Now = BKUtilities::GetTimeStampInMSDetailed();
+
+    if (bWorkStealingMode)
+    {
+        for (int32 i = 0; i < Count; i++)
+        {
+            Tasks[i]->QueuedTimestamp = Now;
+            Tasks[i]->bQueued = true;
+        }
+
+        FBKAsyncWorker* Spawner = CurrentThreadWorker;
+        if (Priority == EBKTaskPriority::Normal && Spawner && Spawner->ReservedLane == INDEX_NONE &&
+            Spawner->WorkerIndex < WorkerThreadCount && AsyncWorkers[Spawner->WorkerIndex] == Spawner)
+        {
+            for (int32 i = 0; i < Count; i++)
+            {
+                WorkerDeques[Spawner->WorkerIndex]->Push(Tasks[i]);
+            }
+        }
+        else
+        {
+            AwaitingTasks[Lane].PushBulk(Tasks, Count);
+        }
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        for (int32 i = 0; i < Count && WakeSleepingWorker(Lane); i++)
+        {
+        }
+        return;
+    }
+
+    //Claim the idle workers first, so the rest of the batch is queued in one go before any of them wakes up and looks for more.
+    FBKAsyncWorker* IdleWorkers[ASYNC_TASK_BATCH_CAPACITY];
+    int32 IdleWorkerNum = 0;
+    while (IdleWorkerNum < Count && IdleWorkerNum < ASYNC_TASK_BATCH_CAPACITY)
+    {
+        FBKAsyncWorker* PossibleFreeWorker = nullptr;
+        if ((FreeWorkers[Lane].TryPop(PossibleFreeWorker) && PossibleFreeWorker) ||
+            (FreeWorkers[ASYNC_TASK_SHARED_WORKERS].TryPop(PossibleFreeWorker) && PossibleFreeWorker))
+        {
+            IdleWorkers[IdleWorkerNum++] = PossibleFreeWorker;
+            continue;
+        }
+        break;
+    }
+
+    if (IdleWorkerNum < Count)
+    {
+        for (int32 i = IdleWorkerNum; i < Count; i++)
+        {
+            Tasks[i]->QueuedTimestamp = Now;
+            Tasks[i]->bQueued = true;
+        }
+        AwaitingTasks[Lane].PushBulk(Tasks + IdleWorkerNum, Count - IdleWorkerNum);
+    }
+    for (int32 i = 0; i < IdleWorkerNum; i++)
+    {
+        IdleWorkers[i]->SetData(Tasks[i], true);
+    }
+
+    if (IdleWorkerNum < Count)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!FreeWorkers[Lane].IsEmpty())
+        {
+            DispatchAwaitingTasks(Lane);
+        }
+        if (!FreeWorkers[ASYNC_TASK_SHARED_WORKERS].IsEmpty())
+        {
+            DispatchAwaitingTasks(ASYNC_TASK_SHARED_WORKERS);
+        }
+    }
+}
+void BKAsyncTaskManager::EnqueueTask_WorkStealing(FBKAwaitingTask* Task)
+{
+    Task->QueuedTimestamp = BKUtilities::GetTimeStampInMSDetailed();
+    Task->bQueued = true;
+
+    //Only normal tasks go to the local deque; the other lanes stay in their queues so the lane policy applies to them.
+    FBKAsyncWorker* Spawner = CurrentThreadWorker;
+    if (Task->Priority == EBKTaskPriority::Normal && Spawner && Spawner->ReservedLane == INDEX_NONE &&
+        Spawner->WorkerIndex < WorkerThreadCount && AsyncWorkers[Spawner->WorkerIndex] == Spawner)
+    {
+        WorkerDeques[Spawner->WorkerIndex]->Push(Task);
+    }
+    else
+    {
+        QueueTask(Task);
+    }
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    WakeSleepingWorker(static_cast<int32>(Task->Priority));
+}
+FBKAwaitingTask* BKAsyncTaskManager::FindTask_WorkStealing(FBKAsyncWorker* Worker, uint32& StealSeed)
+{
+    FBKAwaitingTask* Task = nullptr;
+    if (Worker->ReservedLane != INDEX_NONE)
+    {
+        AwaitingTasks[Worker->ReservedLane].Pop(Task);
+        return Task;
+    }
+
+    //The local deque holds normal tasks, so it is searched where the normal lane would be.
+    const int32 NormalLane = static_cast<int32>(EBKTaskPriority::Normal);
+    const int32 WorkerIndex = Worker->WorkerIndex;
+    int32 PreferredLane = PickPreferredLane();
+    if (PreferredLane == NormalLane)
+    {
+        if (WorkerDeques[WorkerIndex]->Pop(Task)) return Task;
+    }
+    if (PreferredLane != INDEX_NONE && AwaitingTasks[PreferredLane].Pop(Task)) return Task;
+
+    for (int32 Lane = 0; Lane < ASYNC_TASK_PRIORITY_COUNT; Lane++)
+    {
+        if (Lane == NormalLane && WorkerDeques[WorkerIndex]->Pop(Task)) return Task;
+        if (Lane != PreferredLane && AwaitingTasks[Lane].Pop(Task)) return Task;
+    }
+
+    //Xorshift to spread thieves over different victims.
+    StealSeed ^= StealSeed << 13;
+    StealSeed ^= StealSeed >> 17;
+    StealSeed ^= StealSeed << 5;
+
+    int32 Start = static_cast<int32>(StealSeed % static_cast<uint32>(WorkerThreadCount));
+    for (int32 i = 0; i < WorkerThreadCount; i++)
+    {
+        int32 Victim = (Start + i) % WorkerThreadCount;
+        if (Victim == WorkerIndex) continue;
+        if (WorkerDeques[Victim]->Steal(Task)) return Task;
+    }
+    return nullptr;
+}
+bool BKAsyncTaskManager::HasPendingTasks_WorkStealing(int32 ReservedLane)
+{
+    if (HasAwaitingTasks(ReservedLane)) return true;
+    if (ReservedLane != INDEX_NONE) return false;
+
+    for (int32 i = 0; i < WorkerThreadCount; i++)
+    {
+        if (!WorkerDeques[i]->IsEmpty()) return true;
+    }
+    return false;
+}
+bool BKAsyncTaskManager::WakeSleepingWorker(int32 Lane)
+{
+    FBKAsyncWorker* SleepingWorker = nullptr;
+    if ((Lane != INDEX_NONE && FreeWorkers[Lane].TryPop(SleepingWorker) && SleepingWorker) ||
+        (FreeWorkers[ASYNC_TASK_SHARED_WORKERS].TryPop(SleepingWorker) && SleepingWorker))
+    {
+        SleepingWorker->bListedAsSleeping.store(false, std::memory_order_release);
+        SleepingWorker->WakeUp();
+        return true;
     }
+    return false;
 }
-FBKAwaitingTask* BKAsyncTaskManager::TryToGetAwaitingTask()
+
+FBKAwaitingTask* BKAsyncTaskManager::AllocateTask()
+{
+    FBKAsyncTaskCache& Cache = LocalTaskCache;
+    if (Cache.Count == 0)
+    {
+        Cache.Count = GlobalTaskPool.Tasks.TryPopBulk(Cache.Tasks, ASYNC_TASK_POOL_LOCAL_CACHE_SIZE / 2);
+        if (Cache.Count == 0) return new FBKAwaitingTask;
+    }
+    return Cache.Tasks[--Cache.Count];
+}
+void BKAsyncTaskManager::ReleaseTask(FBKAwaitingTask* Task)
+{
+    if (!Task) return;
+    Task->ResetForReuse();
+
+    FBKAsyncTaskCache& Cache = LocalTaskCache;
+    if (Cache.Count == ASYNC_TASK_POOL_LOCAL_CACHE_SIZE)
+    {
+        //Hand the older half to the global pool so producer-only threads feed consumer-only threads.
+        const int32 HalfSize = ASYNC_TASK_POOL_LOCAL_CACHE_SIZE / 2;
+        int32 Pushed = GlobalTaskPool.Tasks.TryPushBulk(Cache.Tasks, HalfSize);
+        for (int32 i = Pushed; i < HalfSize; i++)
+        {
+            delete (Cache.Tasks[i]);
+        }
+        FMemory::Memmove(Cache.Tasks, Cache.Tasks + HalfSize, HalfSize * sizeof(FBKAwaitingTask*));
+        Cache.Count = HalfSize;
+    }
+    Cache.Tasks[Cache.Count++] = Task;
+}
+
+FBKAwaitingTask* BKAsyncTaskManager::TryToGetAwaitingTask(int32 ReservedLane)
 {
     if (!bSystemStarted || !ManagerInstance) return nullptr;
 
     FBKAwaitingTask* Destination = nullptr;
-    ManagerInstance->AwaitingTasks.Pop(Destination);
+    ManagerInstance->PopAwaitingTask(ReservedLane, Destination);
 
     return Destination;
 }
@@ -122,7 +804,7 @@ uint32 BKAsyncTaskManager::AsyncWorkerStopped(FBKAsyncWorker* StoppedWorker)
         if (ManagerInstance->AsyncWorkers[i] == StoppedWorker)
         {
             delete (ManagerInstance->AsyncWorkers[i]);
-            ManagerInstance->AsyncWorkers[i] = new FBKAsyncWorker;
+            ManagerInstance->AsyncWorkers[i] = new FBKAsyncWorker(i);
             ManagerInstance->AsyncWorkers[i]->StartWorker();
             BKUtilities::Print(EBKLogType::Warning, FString(L"An AsyncWorker has stopped. Another worker has just been started."));
             return 0;
@@ -132,104 +814,183 @@ uint32 BKAsyncTaskManager::AsyncWorkerStopped(FBKAsyncWorker* StoppedWorker)
     return 0;
 }
 
-FBKAsyncWorker::FBKAsyncWorker()
+FBKAsyncWorker::FBKAsyncWorker(int32 _WorkerIndex) : DataReady(false), WorkerIndex(_WorkerIndex), bListedAsSleeping(false),
+        BusyNanoseconds(0), ExecutedTasks(0), UtilizationStartNs(GetMonotonicNanoseconds())
 {
-    BKAsyncTaskManager::PushFreeWorker(this);
+    if (BKAsyncTaskManager::ManagerInstance)
+    {
+        ReservedLane = BKAsyncTaskManager::ManagerInstance->GetReservedLane(WorkerIndex);
+    }
+    if (!BKAsyncTaskManager::IsWorkStealingEnabled())
+    {
+        BKAsyncTaskManager::PushFreeWorker(this);
+    }
 }
 void FBKAsyncWorker::SetData(FBKAwaitingTask* Task, bool bSendSignal)
 {
     if (!Task) return;
 
-    BKScopeGuard Lock(&Mutex);
     CurrentData = Task;
-    DataReady = true;
+    DataReady.store(true, std::memory_order_release);
     if (bSendSignal)
     {
-        Condition.signal();
+        Parker.Unpark();
+    }
+}
+void FBKAsyncWorker::WakeUp()
+{
+    Parker.Unpark();
+}
+void FBKAsyncWorker::WaitForData(const FBKIdleStrategy& IdleStrategy)
+{
+    while (!DataReady.load(std::memory_order_acquire) && BKAsyncTaskManager::IsSystemStarted())
+    {
+        Parker.Park(IdleStrategy);
     }
 }
 void FBKAsyncWorker::WorkersDen()
 {
+    if (BKAsyncTaskManager::IsWorkStealingEnabled())
+    {
+        WorkersDen_WorkStealing();
+        return;
+    }
+
+    CurrentThreadWorker = this;
+
+    const FBKIdleStrategy IdleStrategy = BKAsyncTaskManager::ManagerInstance->IdleStrategy;
     while (BKAsyncTaskManager::IsSystemStarted())
     {
+        WaitForData(IdleStrategy);
+        if (!BKAsyncTaskManager::IsSystemStarted()) break;
+        ProcessData();
+    }
+
+    CurrentThreadWorker = nullptr;
+}
+void FBKAsyncWorker::WorkersDen_WorkStealing()
+{
+    CurrentThreadWorker = this;
+
+    BKAsyncTaskManager* Manager = BKAsyncTaskManager::ManagerInstance;
+    uint32 StealSeed = static_cast<uint32>(WorkerIndex) * 2654435761u + 1;
+
+    while (BKAsyncTaskManager::IsSystemStarted())
+    {
+        FBKAwaitingTask* Task = Manager->FindTask_WorkStealing(this, StealSeed);
+        if (Task)
         {
-            BKScopeGuard Lock(&Mutex);
-            while (!DataReady && BKAsyncTaskManager::IsSystemStarted())
+            //More work is visible; let a sleeping worker help.
+            if (!Manager->FreeWorkers[ASYNC_TASK_SHARED_WORKERS].IsEmpty() && Manager->HasPendingTasks_WorkStealing(INDEX_NONE))
             {
-                Condition.wait(Lock);
+                Manager->WakeSleepingWorker(INDEX_NONE);
             }
+
+            BKAsyncTaskManager::ReportQueueDelay(Task);
+            ExecuteTask(Task);
+            continue;
         }
-        if (!BKAsyncTaskManager::IsSystemStarted()) return;
-        ProcessData();
+        if (!SleepUntilWoken()) break;
     }
+
+    CurrentThreadWorker = nullptr;
+}
+bool FBKAsyncWorker::SleepUntilWoken()
+{
+    BKAsyncTaskManager* Manager = BKAsyncTaskManager::ManagerInstance;
+
+    bool bExpected = false;
+    if (bListedAsSleeping.compare_exchange_strong(bExpected, true))
+    {
+        Manager->FreeWorkers[ReservedLane != INDEX_NONE ? ReservedLane : ASYNC_TASK_SHARED_WORKERS].TryPush(this);
+    }
+
+    //Pairs with the fence in EnqueueTask_WorkStealing: either the producer sees this worker listed or this worker sees the task.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (Manager->HasPendingTasks_WorkStealing(ReservedLane)) return true;
+
+    //WakeSleepingWorker unlists the worker before unparking it, so a stale permit only costs one extra scan.
+    Parker.Park(Manager->IdleStrategy);
+    return BKAsyncTaskManager::IsSystemStarted();
 }
 uint32 FBKAsyncWorker::WorkersStopCallback()
 {
     return BKAsyncTaskManager::AsyncWorkerStopped(this);
 }
-void FBKAsyncWorker::ProcessData_CriticalPart()
+void FBKAsyncWorker::ExecuteTask(FBKAwaitingTask* Task)
 {
-    if (CurrentData)
+    if (!Task) return;
+
+    const EBKTaskPriority Priority = Task->Priority;
+    const uint64 StartNs = GetMonotonicNanoseconds();
+
+    if (Task->InlineFunction.IsBound())
     {
-        if (CurrentData->FunctionPtr)
+        Task->InlineFunction();
+    }
+    else
+    {
+        if (Task->FunctionPtr)
         {
-            CurrentData->FunctionPtr(CurrentData->Parameters);
+            Task->FunctionPtr(Task->Parameters);
         }
-        if (!CurrentData->bDoNotDeallocateParameters)
+        if (!Task->bDoNotDeallocateParameters)
         {
-            for (BKAsyncTaskParameter* Parameter : CurrentData->Parameters)
+            for (BKAsyncTaskParameter* Parameter : Task->Parameters)
             {
                 if (Parameter)
                 {
                     delete (Parameter);
                 }
             }
-            CurrentData->Parameters.Empty();
         }
-        delete (CurrentData);
+    }
+
+    const uint64 DurationNs = GetMonotonicNanoseconds() - StartNs;
+    BKTaskMetrics::RecordExecution(Priority, DurationNs / 1000);
+    if (FBKAsyncWorker* Worker = CurrentThreadWorker)
+    {
+        Worker->BusyNanoseconds.fetch_add(DurationNs, std::memory_order_relaxed);
+        Worker->ExecutedTasks.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    BKAsyncTaskManager::ReleaseTask(Task);
+}
+void FBKAsyncWorker::ProcessData_CriticalPart()
+{
+    if (CurrentData)
+    {
+        ExecuteTask(CurrentData);
         CurrentData = nullptr;
     }
 }
 void FBKAsyncWorker::ProcessData()
 {
-    ProcessData_CriticalPart();
-    DataReady = false;
-
-    FBKAwaitingTask* PossibleAwaitingTask = BKAsyncTaskManager::TryToGetAwaitingTask();
-    if (PossibleAwaitingTask)
+    //Drains the awaiting queue iteratively; a deep backlog must not grow the worker's stack.
+    while (true)
     {
-        if (PossibleAwaitingTask->bQueued)
-        {
-            double DiffMs = BKUtilities::GetTimeStampInMSDetailed() - PossibleAwaitingTask->QueuedTimestamp;
-            if (DiffMs > 1000)
-            {
-                BKUtilities::Print(EBKLogType::Warning, FString(L"WAsyncTask was in queue for ") + FString::FromFloat(DiffMs));
-            }
+        ProcessData_CriticalPart();
+        DataReady.store(false, std::memory_order_relaxed);
 
-            PossibleAwaitingTask->bQueued = false;
-            PossibleAwaitingTask->QueuedTimestamp = 0;
-        }
+        FBKAwaitingTask* PossibleAwaitingTask = BKAsyncTaskManager::TryToGetAwaitingTask(ReservedLane);
+        if (!PossibleAwaitingTask) break;
+
+        BKAsyncTaskManager::ReportQueueDelay(PossibleAwaitingTask);
         SetData(PossibleAwaitingTask, false);
-        ProcessData();
-    }
-    else
-    {
-        BKAsyncTaskManager::PushFreeWorker(this);
     }
+    BKAsyncTaskManager::PushFreeWorker(this);
 }
 void FBKAsyncWorker::StartWorker()
 {
-    WorkerThread = new BKThread(std::bind(&FBKAsyncWorker::WorkersDen, this), std::bind(&FBKAsyncWorker::WorkersStopCallback, this));
+    uint64 AffinityMask = BKAsyncTaskManager::ManagerInstance ? BKAsyncTaskManager::ManagerInstance->CoreLayout.GetWorkerAffinityMask(WorkerIndex) : 0;
+    WorkerThread = new BKThread(std::bind(&FBKAsyncWorker::WorkersDen, this), std::bind(&FBKAsyncWorker::WorkersStopCallback, this),
+            FBKThreadOptions(FString(L"BKWorker-") + FString::FromInt(WorkerIndex), AffinityMask));
 }
 void FBKAsyncWorker::EndWorker()
 {
     if (WorkerThread)
     {
-        if (!DataReady)
-        {
-            BKScopeGuard Lock(&Mutex);
-            Condition.signal();
-        }
+        Parker.Unpark();
         if (WorkerThread->IsJoinable())
         {
             WorkerThread->Join();
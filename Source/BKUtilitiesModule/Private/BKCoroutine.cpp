@@ -0,0 +1,291 @@
+// Copyright Burak Kara, All rights reserved.
+
+#include "BKCoroutine.h"
+
+#if BK_WITH_COROUTINES
+
+#if !PLATFORM_WINDOWS
+    #include <poll.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <cerrno>
+#endif
+#include <new>
+
+#define BK_COROUTINE_FRAME_CLASS_COUNT (BK_COROUTINE_FRAME_POOL_MAX / BK_COROUTINE_FRAME_GRANULARITY)
+
+struct FBKCoroutineFrameNode
+{
+    FBKCoroutineFrameNode* Next;
+};
+
+struct FBKCoroutineFrameCache
+{
+    FBKCoroutineFrameNode* FreeLists[BK_COROUTINE_FRAME_CLASS_COUNT] = {};
+    uint32 FreeCounts[BK_COROUTINE_FRAME_CLASS_COUNT] = {};
+
+    ~FBKCoroutineFrameCache()
+    {
+        for (int32 i = 0; i < BK_COROUTINE_FRAME_CLASS_COUNT; i++)
+        {
+            while (FBKCoroutineFrameNode* Node = FreeLists[i])
+            {
+                FreeLists[i] = Node->Next;
+                ::operator delete(Node);
+            }
+        }
+    }
+};
+//Frames finished on another thread simply join that thread's cache.
+static thread_local FBKCoroutineFrameCache LocalFrameCache;
+
+void* BKCoroutineFrameAllocator::Allocate(size_t Size)
+{
+    if (Size == 0 || Size > BK_COROUTINE_FRAME_POOL_MAX) return ::operator new(Size);
+
+    size_t ClassIx = (Size - 1) / BK_COROUTINE_FRAME_GRANULARITY;
+    FBKCoroutineFrameCache& Cache = LocalFrameCache;
+    if (FBKCoroutineFrameNode* Node = Cache.FreeLists[ClassIx])
+    {
+        Cache.FreeLists[ClassIx] = Node->Next;
+        Cache.FreeCounts[ClassIx]--;
+        return Node;
+    }
+    return ::operator new((ClassIx + 1) * BK_COROUTINE_FRAME_GRANULARITY);
+}
+
+void BKCoroutineFrameAllocator::Deallocate(void* Frame, size_t Size)
+{
+    if (!Frame) return;
+    if (Size == 0 || Size > BK_COROUTINE_FRAME_POOL_MAX)
+    {
+        ::operator delete(Frame);
+        return;
+    }
+
+    size_t ClassIx = (Size - 1) / BK_COROUTINE_FRAME_GRANULARITY;
+    FBKCoroutineFrameCache& Cache = LocalFrameCache;
+    if (Cache.FreeCounts[ClassIx] >= BK_COROUTINE_FRAME_CACHE_COUNT)
+    {
+        ::operator delete(Frame);
+        return;
+    }
+    auto Node = static_cast<FBKCoroutineFrameNode*>(Frame);
+    Node->Next = Cache.FreeLists[ClassIx];
+    Cache.FreeLists[ClassIx] = Node;
+    Cache.FreeCounts[ClassIx]++;
+}
+
+BKAtomic<bool> BKSocketReactor::bSystemStarted(false);
+BKSocketReactor* BKSocketReactor::ReactorInstance = nullptr;
+BKRWLock BKSocketReactor::Instance_Lock;
+
+bool BKSocketReactor::StartSystem()
+{
+#if PLATFORM_WINDOWS
+    BKUtilities::Print(EBKLogType::Warning, FString(L"Socket reactor is not supported on this platform; awaited sockets stay blocking."));
+    return false;
+#else
+    if (bSystemStarted.Exchange(true)) return true;
+
+    auto NewInstance = new BKSocketReactor;
+    if (!NewInstance->StartSystem_Internal())
+    {
+        bSystemStarted = false;
+        delete (NewInstance);
+        return false;
+    }
+
+    BKWriteScopeGuard Guard(&Instance_Lock);
+    ReactorInstance = NewInstance;
+    return true;
+#endif
+}
+void BKSocketReactor::EndSystem()
+{
+    if (!bSystemStarted.Exchange(false)) return;
+
+    //Once detached no Register can reach the instance; stopping it outside the lock lets the coroutines it resumes
+    //call Register, which then fails cleanly.
+    BKSocketReactor* OldInstance;
+    {
+        BKWriteScopeGuard Guard(&Instance_Lock);
+        OldInstance = ReactorInstance;
+        ReactorInstance = nullptr;
+    }
+    if (OldInstance)
+    {
+        OldInstance->EndSystem_Internal();
+        delete (OldInstance);
+    }
+}
+bool BKSocketReactor::IsSystemStarted()
+{
+    return bSystemStarted;
+}
+
+bool BKSocketReactor::Register(FBKSocketWaiter* Waiter)
+{
+    if (!Waiter) return false;
+
+    BKReadScopeGuard Guard(&Instance_Lock);
+    if (!bSystemStarted || !ReactorInstance) return false;
+    {
+        BKFastScopeGuard PendingGuard(&ReactorInstance->Pending_Mutex);
+        ReactorInstance->PendingWaiters.Add(Waiter);
+    }
+    ReactorInstance->Wake();
+    return true;
+}
+
+void BKSocketReactor::Complete(FBKSocketWaiter* Waiter, bool bReady)
+{
+    Waiter->bReady = bReady;
+
+    //Never blocks the reactor behind a full lane.
+    FBKResumeTask Resume(Waiter->Handle);
+    if (BKAsyncTaskManager::NewAsyncTask(std::move(Resume), EBKTaskPriority::Normal, EBKOverloadPolicy::Reject)) return;
+    Resume();
+}
+
+bool BKSocketReactor::StartSystem_Internal()
+{
+#if !PLATFORM_WINDOWS
+    int32 WakeHandles[2];
+    if (pipe(WakeHandles) != 0)
+    {
+        BKUtilities::Print(EBKLogType::Error, FString(L"Socket reactor could not create its wake-up pipe."));
+        return false;
+    }
+    for (int32 Handle : WakeHandles)
+    {
+        fcntl(Handle, F_SETFL, fcntl(Handle, F_GETFL, 0) | O_NONBLOCK);
+        fcntl(Handle, F_SETFD, FD_CLOEXEC);
+    }
+    WakeReadHandle = WakeHandles[0];
+    WakeWriteHandle = WakeHandles[1];
+#endif
+
+    ReactorThread = new BKThread(std::bind(&BKSocketReactor::ReactorRun, this), std::bind(&BKSocketReactor::ReactorStop, this), FBKThreadOptions(FString(L"BKSocketReactor")));
+    return true;
+}
+void BKSocketReactor::EndSystem_Internal()
+{
+    Wake();
+    if (ReactorThread)
+    {
+        if (ReactorThread->IsJoinable())
+        {
+            ReactorThread->Join();
+        }
+        delete (ReactorThread);
+        ReactorThread = nullptr;
+    }
+
+    //Whatever is still waiting is resumed as timed out so the coroutines can unwind.
+    {
+        BKFastScopeGuard Guard(&Pending_Mutex);
+        Waiters.Append(PendingWaiters);
+        PendingWaiters.Reset();
+    }
+    for (FBKSocketWaiter* Waiter : Waiters)
+    {
+        Complete(Waiter, false);
+    }
+    Waiters.Reset();
+
+#if !PLATFORM_WINDOWS
+    close(WakeReadHandle);
+    close(WakeWriteHandle);
+#endif
+}
+
+void BKSocketReactor::Wake()
+{
+#if !PLATFORM_WINDOWS
+    //A full pipe already guarantees a wake-up.
+    ANSICHAR Byte = 1;
+    if (write(WakeWriteHandle, &Byte, 1) < 0) return;
+#endif
+}
+
+void BKSocketReactor::ReactorRun()
+{
+#if !PLATFORM_WINDOWS
+    TArray<struct pollfd> PollSet;
+    while (bSystemStarted)
+    {
+        {
+            BKFastScopeGuard Guard(&Pending_Mutex);
+            Waiters.Append(PendingWaiters);
+            PendingWaiters.Reset();
+        }
+
+        PollSet.Reset();
+        struct pollfd WakeEntry{};
+        WakeEntry.fd = WakeReadHandle;
+        WakeEntry.events = POLLIN;
+        PollSet.Add(WakeEntry);
+
+        uint64 NowMs = BKUtilities::GetMonotonicTimeStampInMS();
+        int32 PollTimeoutMs = -1;
+        for (FBKSocketWaiter* Waiter : Waiters)
+        {
+            struct pollfd Entry{};
+            Entry.fd = static_cast<int32>(Waiter->SocketHandle);
+            Entry.events = Waiter->Event == EBKSocketEvent::Readable ? POLLIN : POLLOUT;
+            PollSet.Add(Entry);
+
+            if (Waiter->DeadlineMs > 0)
+            {
+                int32 RemainingMs = Waiter->DeadlineMs <= NowMs ? 0 : static_cast<int32>(Waiter->DeadlineMs - NowMs);
+                if (PollTimeoutMs < 0 || RemainingMs < PollTimeoutMs) PollTimeoutMs = RemainingMs;
+            }
+        }
+
+        int32 ReadyCount = poll(PollSet.GetMutableData(), static_cast<nfds_t>(PollSet.Num()), PollTimeoutMs);
+        if (ReadyCount < 0)
+        {
+            if (errno != EINTR)
+            {
+                BKUtilities::Print(EBKLogType::Error, FString(L"Socket reactor poll() failed with error: ") + FString::FromInt(errno));
+                BKThread::SleepThread(1);
+            }
+            continue;
+        }
+        if (PollSet[0].revents & POLLIN)
+        {
+            ANSICHAR Drain[64];
+            while (read(WakeReadHandle, Drain, sizeof(Drain)) > 0)
+            {
+            }
+        }
+
+        NowMs = BKUtilities::GetMonotonicTimeStampInMS();
+        //Backwards so removals keep PollSet indices valid; errors and hang-ups count as ready so the caller sees them.
+        for (int32 i = Waiters.Num() - 1; i >= 0; i--)
+        {
+            FBKSocketWaiter* Waiter = Waiters[i];
+            if (ReadyCount > 0 && PollSet[i + 1].revents != 0)
+            {
+                Waiters.RemoveAt(i);
+                Complete(Waiter, true);
+            }
+            else if (Waiter->DeadlineMs > 0 && NowMs >= Waiter->DeadlineMs)
+            {
+                Waiters.RemoveAt(i);
+                Complete(Waiter, false);
+            }
+        }
+    }
+#endif
+}
+uint32 BKSocketReactor::ReactorStop()
+{
+    if (!bSystemStarted) return 0;
+    if (ReactorThread) delete (ReactorThread);
+    ReactorThread = new BKThread(std::bind(&BKSocketReactor::ReactorRun, this), std::bind(&BKSocketReactor::ReactorStop, this), FBKThreadOptions(FString(L"BKSocketReactor")));
+    return 0;
+}
+
+#endif //BK_WITH_COROUTINES
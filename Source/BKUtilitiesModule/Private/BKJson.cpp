@@ -117,22 +117,34 @@ namespace BKJson
             return def;
         }
     }
-#define GET_NUMBER(T) \
-	if (IsNumber())\
-	{\
-		FStringStream sstr(data->valueStr);\
-		T val;\
-		sstr >> val;\
-		return val;\
-	}\
-	else\
-	{\
-		return def;\
-	}
-    int32 Node::ToInteger(int32 def) const { GET_NUMBER(int) }
-    float Node::ToFloat(float def) const { GET_NUMBER(float) }
-    double Node::ToDouble(double def) const { GET_NUMBER(double) }
-#undef GET_NUMBER
+    int32 Node::ToInteger(int32 def) const
+    {
+        int32 val = def;
+        if (IsNumber())
+        {
+            //Like the stream read it replaces, stops at the first non-digit (1.5 reads as 1).
+            BKNumberFormat::ParseInteger(data->valueStr.GetWideCharArray(), data->valueStr.Len(), val);
+        }
+        return val;
+    }
+    float Node::ToFloat(float def) const
+    {
+        float val = def;
+        if (IsNumber())
+        {
+            BKNumberFormat::ParseFloat(data->valueStr.GetWideCharArray(), data->valueStr.Len(), val);
+        }
+        return val;
+    }
+    double Node::ToDouble(double def) const
+    {
+        double val = def;
+        if (IsNumber())
+        {
+            BKNumberFormat::ParseDouble(data->valueStr.GetWideCharArray(), data->valueStr.Len(), val);
+        }
+        return val;
+    }
     bool Node::ToBoolean(bool def) const
     {
         if (IsBoolean())
@@ -188,21 +200,21 @@ namespace BKJson
             data->valueStr = UnescapeString(FString(value));
         }
     }
-#define SET_NUMBER \
+#define SET_NUMBER(Format) \
 	if (IsValue())\
 	{\
 		Detach();\
 		data->type = T_NUMBER;\
-		FStringStream sstr;\
-		sstr << value;\
-		data->valueStr = sstr.Str();\
+		UTFCHAR Buffer[BK_NUMBER_BUFFER_SIZE];\
+		int32 Length = BKNumberFormat::Format(value, Buffer);\
+		data->valueStr = FString(Buffer, static_cast<uint32>(Length));\
 	}
-    void Node::Set(int32 value) { SET_NUMBER }
-    void Node::Set(uint32 value) { SET_NUMBER }
-    void Node::Set(int64 value) { SET_NUMBER }
-    void Node::Set(uint64 value) { SET_NUMBER }
-    void Node::Set(float value) { SET_NUMBER }
-    void Node::Set(double value) { SET_NUMBER }
+    void Node::Set(int32 value) { SET_NUMBER(FormatInteger) }
+    void Node::Set(uint32 value) { SET_NUMBER(FormatInteger) }
+    void Node::Set(int64 value) { SET_NUMBER(FormatInteger) }
+    void Node::Set(uint64 value) { SET_NUMBER(FormatInteger) }
+    void Node::Set(float value) { SET_NUMBER(FormatFloat) }
+    void Node::Set(double value) { SET_NUMBER(FormatDouble) }
 #undef SET_NUMBER
     void Node::Set(bool value)
     {
@@ -2,8 +2,47 @@
 
 #include "BKScheduledTaskManager.h"
 #include "BKAsyncTaskManager.h"
+#include "BKTimerWheel.h"
+
+#define TIMER_HANDLE_SLOT_MASK ((1u << TIMER_HANDLE_SLOT_BITS) - 1)
+#define TIMER_HANDLE_GENERATION_MASK ((1u << (32 - TIMER_HANDLE_SLOT_BITS)) - 1)
+
+//Owns an expired timer until a worker runs it. If the task is refused, or destroyed unrun (EndSystem of the task
+//manager drains its queues), the timer is re-armed instead of being left marked as running.
+struct FBKTimerDispatch
+{
+    FBKTimerNode* Node;
+
+    explicit FBKTimerDispatch(FBKTimerNode* _Node) : Node(_Node)
+    {
+    }
+    FBKTimerDispatch(FBKTimerDispatch&& Other) noexcept : Node(Other.Node)
+    {
+        Other.Node = nullptr;
+    }
+    ~FBKTimerDispatch()
+    {
+        if (Node) BKScheduledAsyncTaskManager::RearmTimer(Node);
+    }
+
+    FBKTimerNode* Release()
+    {
+        FBKTimerNode* Result = Node;
+        Node = nullptr;
+        return Result;
+    }
+    void operator()()
+    {
+        BKScheduledAsyncTaskManager::RunTimer(Release());
+    }
+
+private:
+    FBKTimerDispatch(const FBKTimerDispatch&);
+    FBKTimerDispatch& operator=(const FBKTimerDispatch&);
+};
 
 BKScheduledAsyncTaskManager* BKScheduledAsyncTaskManager::ManagerInstance = nullptr;
+BKMutex BKScheduledAsyncTaskManager::Ticker_Mutex;
 
 bool BKScheduledAsyncTaskManager::bSystemStarted = false;
 void BKScheduledAsyncTaskManager::StartSystem(uint32 SleepDurationMs)
@@ -22,6 +61,8 @@ void BKScheduledAsyncTaskManager::EndSystem()
     if (ManagerInstance)
     {
         ManagerInstance->EndSystem_Internal();
+
+        BKScopeGuard LocalGuard(&Ticker_Mutex);
         delete (ManagerInstance);
         ManagerInstance = nullptr;
     }
@@ -34,7 +75,9 @@ bool BKScheduledAsyncTaskManager::IsSystemStarted()
 void BKScheduledAsyncTaskManager::StartSystem_Internal(uint32 SleepDurationMs)
 {
     SleepMsBetweenCheck = SleepDurationMs;
-    TickThread = new BKThread(std::bind(&BKScheduledAsyncTaskManager::TickerRun, this), std::bind(&BKScheduledAsyncTaskManager::TickerStop, this));
+    StartTimestampMs = BKUtilities::GetMonotonicTimeStampInMS();
+    TimerWheel = new BKTimerWheel(0);
+    TickThread = new BKThread(std::bind(&BKScheduledAsyncTaskManager::TickerRun, this), std::bind(&BKScheduledAsyncTaskManager::TickerStop, this), FBKThreadOptions(FString(L"BKScheduler")));
 }
 void BKScheduledAsyncTaskManager::EndSystem_Internal()
 {
@@ -47,113 +90,251 @@ void BKScheduledAsyncTaskManager::EndSystem_Internal()
         delete (TickThread);
     }
 
-    FBKAwaitingTask* AwaitingScheduledTask = nullptr;
-    while (AwaitingScheduledTasks.Pop(AwaitingScheduledTask))
+    TArray<FBKTimerNode*> DroppedTimers;
     {
-        if (AwaitingScheduledTask)
+        BKScopeGuard LocalGuard(&Ticker_Mutex);
+
+        //Running timers are left to RunTimer, which frees them once it sees the manager is gone.
+        for (int32 i = 0; i < TimerSlots.Num(); i++)
         {
-            if (!AwaitingScheduledTask->bDoNotDeallocateParameters)
+            FBKTimerNode* Node = TimerSlots.GetMutableData()[i].Node;
+            if (Node && !Node->bRunning)
             {
-                for (BKAsyncTaskParameter* Param : AwaitingScheduledTask->Parameters)
-                {
-                    if (Param)
-                    {
-                        delete (Param);
-                    }
-                }
-                AwaitingScheduledTask->Parameters.Empty();
+                TimerWheel->Unschedule(Node);
+                DroppedTimers.Add(Node);
             }
-            delete (AwaitingScheduledTask);
         }
+        TimerSlots.Empty();
+        FirstFreeTimerSlot = INDEX_NONE;
+
+        delete (TimerWheel);
+        TimerWheel = nullptr;
+    }
+
+    for (FBKTimerNode* Node : DroppedTimers)
+    {
+        DeallocateTimer(Node);
+    }
+}
+
+uint64 BKScheduledAsyncTaskManager::GetCurrentTick() const
+{
+    return BKUtilities::GetMonotonicTimeStampInMS() - StartTimestampMs;
+}
+
+FBKTimerNode* BKScheduledAsyncTaskManager::AllocateTimer(FBKAwaitingTask* Task)
+{
+    int32 SlotIndex = FirstFreeTimerSlot;
+    if (SlotIndex == INDEX_NONE)
+    {
+        if (TimerSlots.Num() > static_cast<int32>(TIMER_HANDLE_SLOT_MASK))
+        {
+            BKUtilities::Print(EBKLogType::Error, FString(L"Too many scheduled tasks; the task has been dropped."));
+            return nullptr;
+        }
+        SlotIndex = TimerSlots.Num();
+        TimerSlots.Add(FBKTimerSlot());
     }
+
+    FBKTimerSlot& Slot = TimerSlots.GetMutableData()[SlotIndex];
+    FirstFreeTimerSlot = Slot.NextFreeSlot;
+    Slot.NextFreeSlot = INDEX_NONE;
+
+    auto Node = new FBKTimerNode;
+    Node->Task = Task;
+    Node->Owner = this;
+    Node->Handle = (Slot.Generation << TIMER_HANDLE_SLOT_BITS) | static_cast<uint32>(SlotIndex);
+    Slot.Node = Node;
+    return Node;
 }
+FBKTimerNode* BKScheduledAsyncTaskManager::FindTimer(uint32 Handle)
+{
+    auto SlotIndex = static_cast<int32>(Handle & TIMER_HANDLE_SLOT_MASK);
+    if (SlotIndex >= TimerSlots.Num()) return nullptr;
+
+    FBKTimerSlot& Slot = TimerSlots.GetMutableData()[SlotIndex];
+    if (Slot.Generation != (Handle >> TIMER_HANDLE_SLOT_BITS)) return nullptr;
+    return Slot.Node;
+}
+void BKScheduledAsyncTaskManager::ReleaseTimer(FBKTimerNode* Node)
+{
+    auto SlotIndex = static_cast<int32>(Node->Handle & TIMER_HANDLE_SLOT_MASK);
+    FBKTimerSlot& Slot = TimerSlots.GetMutableData()[SlotIndex];
 
-uint32 BKScheduledAsyncTaskManager::NewScheduledAsyncTask(BKFutureAsyncTask NewTask, TArray<BKAsyncTaskParameter*>& TaskParameters, uint32 WaitFor, bool bLoop, bool bDoNotDeallocateParameters)
+    //Generation 0 is skipped so that no handle is ever 0.
+    Slot.Generation = (Slot.Generation + 1) & TIMER_HANDLE_GENERATION_MASK;
+    if (Slot.Generation == 0) Slot.Generation = 1;
+    Slot.Node = nullptr;
+    Slot.NextFreeSlot = FirstFreeTimerSlot;
+    FirstFreeTimerSlot = SlotIndex;
+}
+void BKScheduledAsyncTaskManager::DeallocateTimer(FBKTimerNode* Node)
+{
+    FBKAwaitingTask* Task = Node->Task;
+    if (Task)
+    {
+        if (!Task->bDoNotDeallocateParameters)
+        {
+            DeallocateParameters(Task->Parameters);
+        }
+        delete (Task);
+    }
+    delete (Node);
+}
+void BKScheduledAsyncTaskManager::DeallocateParameters(TArray<BKAsyncTaskParameter*>& Parameters)
 {
-    if (!bSystemStarted || !ManagerInstance) return 0;
+    for (BKAsyncTaskParameter* Param : Parameters)
+    {
+        if (Param)
+        {
+            delete (Param);
+        }
+    }
+    Parameters.Empty();
+}
 
-    uint32 TaskUniqueIx;
+uint32 BKScheduledAsyncTaskManager::NewScheduledAsyncTask(BKFutureAsyncTask NewTask, TArray<BKAsyncTaskParameter*>& TaskParameters, uint32 WaitFor, bool bLoop, bool bDoNotDeallocateParameters, EBKTaskPriority Priority)
+{
+    if (!bSystemStarted || !ManagerInstance)
     {
-        BKScopeGuard LocalGuard(&ManagerInstance->CurrentTaskIx_Mutex);
-        TaskUniqueIx = ManagerInstance->CurrentTaskIx++;
-        if (TaskUniqueIx >= 16383) TaskUniqueIx = 1;
+        if (!bDoNotDeallocateParameters) DeallocateParameters(TaskParameters);
+        return 0;
     }
+
     if (WaitFor == 0)
     {
-        BKAsyncTaskManager::NewAsyncTask(NewTask, TaskParameters, bDoNotDeallocateParameters);
-        return TaskUniqueIx;
+        if (BKAsyncTaskManager::NewAsyncTask(NewTask, TaskParameters, bDoNotDeallocateParameters, Priority)) return SCHEDULED_TASK_DISPATCHED;
+
+        if (!bDoNotDeallocateParameters) DeallocateParameters(TaskParameters);
+        return 0;
     }
 
-    auto AsTask = new FBKAwaitingTask(TaskUniqueIx, NewTask, TaskParameters, WaitFor, bLoop, bDoNotDeallocateParameters);
-    ManagerInstance->AwaitingScheduledTasks.Push(AsTask);
-    return TaskUniqueIx;
+    auto AsTask = new FBKAwaitingTask(0, NewTask, TaskParameters, WaitFor, bLoop, bDoNotDeallocateParameters, Priority);
+
+    BKScopeGuard LocalGuard(&Ticker_Mutex);
+    FBKTimerNode* Node = ManagerInstance ? ManagerInstance->AllocateTimer(AsTask) : nullptr;
+    if (!Node)
+    {
+        if (!bDoNotDeallocateParameters) DeallocateParameters(AsTask->Parameters);
+        delete (AsTask);
+        return 0;
+    }
+    AsTask->TaskUniqueIx = Node->Handle;
+    Node->ExpireTick = ManagerInstance->GetCurrentTick() + WaitFor;
+    ManagerInstance->TimerWheel->Schedule(Node);
+    return Node->Handle;
 }
 void BKScheduledAsyncTaskManager::CancelScheduledAsyncTask(uint32 TaskUniqueIx)
 {
-    if (!bSystemStarted || !ManagerInstance) return;
+    if (!bSystemStarted || !ManagerInstance || TaskUniqueIx == 0) return;
+
+    FBKTimerNode* Node;
+    {
+        BKScopeGuard LocalGuard(&Ticker_Mutex);
+        if (!ManagerInstance) return;
+
+        Node = ManagerInstance->FindTimer(TaskUniqueIx);
+        if (!Node) return;
 
-    BKScopeGuard LocalGuard(&ManagerInstance->Ticker_Mutex);
-    ManagerInstance->CancelledScheduledTasks.AddUnique(TaskUniqueIx);
+        if (Node->bRunning)
+        {
+            Node->bCancelled = true;
+            return;
+        }
+        ManagerInstance->TimerWheel->Unschedule(Node);
+        ManagerInstance->ReleaseTimer(Node);
+    }
+    DeallocateTimer(Node);
 }
 
 void BKScheduledAsyncTaskManager::TickerRun()
 {
+    TArray<FBKTimerNode*> ExpiredTimers;
     while (bSystemStarted)
     {
         BKThread::SleepThread(SleepMsBetweenCheck);
         if (!bSystemStarted) return;
 
-        BKSafeQueue<FBKAwaitingTask*> NewQueueAfterTick;
+        ExpiredTimers.Reset();
+        {
+            BKScopeGuard LocalGuard(&Ticker_Mutex);
+            TimerWheel->Advance(GetCurrentTick(), ExpiredTimers);
+            for (FBKTimerNode* Node : ExpiredTimers)
+            {
+                Node->bRunning = true;
+            }
+        }
+
+        for (FBKTimerNode* Node : ExpiredTimers)
+        {
+            DispatchTimer(Node);
+        }
+    }
+}
+void BKScheduledAsyncTaskManager::DispatchTimer(FBKTimerNode* Node)
+{
+    if (!BKAsyncTaskManager::IsSystemStarted())
+    {
+        RunTimer(Node);
+        return;
+    }
+
+    //Never blocks the ticker behind a full lane; a refused timer is retried on the next tick.
+    FBKTimerDispatch Dispatch(Node);
+    if (BKAsyncTaskManager::NewAsyncTask(std::move(Dispatch), Node->Task->Priority, EBKOverloadPolicy::Reject)) return;
 
-        FBKAwaitingTask* PossibleAwaitingTask = nullptr;
+    //Stopped in the meantime; run it here as above.
+    if (!BKAsyncTaskManager::IsSystemStarted())
+    {
+        RunTimer(Dispatch.Release());
+    }
+}
+void BKScheduledAsyncTaskManager::RunTimer(FBKTimerNode* Node)
+{
+    FBKAwaitingTask* Task = Node->Task;
+    if (bSystemStarted && Task->FunctionPtr)
+    {
+        Task->FunctionPtr(Task->Parameters);
+    }
 
+    {
         BKScopeGuard LocalGuard(&Ticker_Mutex);
-
-        while (AwaitingScheduledTasks.Pop(PossibleAwaitingTask))
+        if (ManagerInstance && Node->Owner == ManagerInstance)
+        {
+            Node->bRunning = false;
+            if (Task->bLoop && !Node->bCancelled && bSystemStarted)
+            {
+                Node->ExpireTick = ManagerInstance->GetCurrentTick() + Task->WaitTimeMs;
+                ManagerInstance->TimerWheel->Schedule(Node);
+                return;
+            }
+            ManagerInstance->ReleaseTimer(Node);
+        }
+    }
+    DeallocateTimer(Node);
+}
+void BKScheduledAsyncTaskManager::RearmTimer(FBKTimerNode* Node)
+{
+    {
+        BKScopeGuard LocalGuard(&Ticker_Mutex);
+        if (ManagerInstance && Node->Owner == ManagerInstance)
         {
-            if (PossibleAwaitingTask && !CancelledScheduledTasks.Contains(PossibleAwaitingTask->TaskUniqueIx))
+            Node->bRunning = false;
+            if (!Node->bCancelled && bSystemStarted)
             {
-                PossibleAwaitingTask->PassedTimeMs += SleepMsBetweenCheck;
-                if (PossibleAwaitingTask->PassedTimeMs >= PossibleAwaitingTask->WaitTimeMs)
-                {
-                    if (PossibleAwaitingTask->FunctionPtr)
-                    {
-                        PossibleAwaitingTask->FunctionPtr(PossibleAwaitingTask->Parameters);
-                    }
-                    if (!PossibleAwaitingTask->bLoop)
-                    {
-                        if (!PossibleAwaitingTask->bDoNotDeallocateParameters)
-                        {
-                            for (BKAsyncTaskParameter* Parameter : PossibleAwaitingTask->Parameters)
-                            {
-                                if (Parameter)
-                                {
-                                    delete (Parameter);
-                                }
-                            }
-                            PossibleAwaitingTask->Parameters.Empty();
-                        }
-                        delete (PossibleAwaitingTask);
-                    }
-                    else
-                    {
-                        PossibleAwaitingTask->PassedTimeMs = 0;
-                        NewQueueAfterTick.Push(PossibleAwaitingTask);
-                    }
-                }
-                else
-                {
-                    NewQueueAfterTick.Push(PossibleAwaitingTask);
-                }
+                Node->ExpireTick = ManagerInstance->GetCurrentTick() + 1;
+                ManagerInstance->TimerWheel->Schedule(Node);
+                return;
             }
+            ManagerInstance->ReleaseTimer(Node);
         }
-        AwaitingScheduledTasks.AddAll_NotTSTemporaryQueue(NewQueueAfterTick);
     }
+    DeallocateTimer(Node);
 }
 uint32 BKScheduledAsyncTaskManager::TickerStop()
 {
     if (!bSystemStarted) return 0;
     if (TickThread) delete (TickThread);
-    TickThread = new BKThread(std::bind(&BKScheduledAsyncTaskManager::TickerRun, this), std::bind(&BKScheduledAsyncTaskManager::TickerStop, this));
+    TickThread = new BKThread(std::bind(&BKScheduledAsyncTaskManager::TickerRun, this), std::bind(&BKScheduledAsyncTaskManager::TickerStop, this), FBKThreadOptions(FString(L"BKScheduler")));
     return 0;
-}
\ No newline at end of file
+}
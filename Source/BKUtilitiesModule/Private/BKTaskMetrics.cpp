@@ -0,0 +1,177 @@
+// Copyright Burak Kara, All rights reserved.
+
+#include "BKTaskMetrics.h"
+#include "BKAsyncTaskManager.h"
+#include "BKScheduledTaskManager.h"
+#include "BKUtilities.h"
+#include "BKFastMutex.h"
+#include <chrono>
+
+struct FBKTaskMetricsRecorder
+{
+    BKLatencyHistogram QueueWait[ASYNC_TASK_PRIORITY_COUNT];
+    BKLatencyHistogram Execution[ASYNC_TASK_PRIORITY_COUNT];
+};
+
+//Recorders of live threads; a thread's counts move to the retired totals when it exits.
+static BKFastMutex Recorders_Mutex;
+static TArray<FBKTaskMetricsRecorder*> Recorders;
+static FBKHistogramSnapshot RetiredQueueWait[ASYNC_TASK_PRIORITY_COUNT];
+static FBKHistogramSnapshot RetiredExecution[ASYNC_TASK_PRIORITY_COUNT];
+
+static std::atomic<uint64> IntervalStartNs(static_cast<uint64>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()));
+
+struct FBKTaskMetricsRecorderHolder
+{
+    FBKTaskMetricsRecorder* Recorder = nullptr;
+
+    FBKTaskMetricsRecorder* Get()
+    {
+        if (!Recorder)
+        {
+            Recorder = new FBKTaskMetricsRecorder;
+            BKFastScopeGuard Guard(&Recorders_Mutex);
+            Recorders.Add(Recorder);
+        }
+        return Recorder;
+    }
+    ~FBKTaskMetricsRecorderHolder()
+    {
+        if (!Recorder) return;
+
+        BKFastScopeGuard Guard(&Recorders_Mutex);
+        for (int32 Lane = 0; Lane < ASYNC_TASK_PRIORITY_COUNT; Lane++)
+        {
+            RetiredQueueWait[Lane].Add(Recorder->QueueWait[Lane]);
+            RetiredExecution[Lane].Add(Recorder->Execution[Lane]);
+        }
+        Recorders.Remove(Recorder);
+        delete (Recorder);
+        Recorder = nullptr;
+    }
+};
+static thread_local FBKTaskMetricsRecorderHolder LocalRecorder;
+
+uint32 BKTaskMetrics::DumpTaskHandle = 0;
+
+void BKTaskMetrics::RecordQueueWait(EBKTaskPriority Priority, uint64 WaitUs)
+{
+    LocalRecorder.Get()->QueueWait[static_cast<int32>(Priority)].Record(WaitUs);
+}
+void BKTaskMetrics::RecordExecution(EBKTaskPriority Priority, uint64 DurationUs)
+{
+    LocalRecorder.Get()->Execution[static_cast<int32>(Priority)].Record(DurationUs);
+}
+
+void BKTaskMetrics::GetSnapshot(FBKTaskMetricsSnapshot& OutSnapshot)
+{
+    for (int32 Lane = 0; Lane < ASYNC_TASK_PRIORITY_COUNT; Lane++)
+    {
+        OutSnapshot.QueueWait[Lane] = FBKHistogramSnapshot();
+        OutSnapshot.Execution[Lane] = FBKHistogramSnapshot();
+    }
+    {
+        BKFastScopeGuard Guard(&Recorders_Mutex);
+        for (int32 Lane = 0; Lane < ASYNC_TASK_PRIORITY_COUNT; Lane++)
+        {
+            OutSnapshot.QueueWait[Lane].Add(RetiredQueueWait[Lane]);
+            OutSnapshot.Execution[Lane].Add(RetiredExecution[Lane]);
+        }
+        for (int32 i = 0; i < Recorders.Num(); i++)
+        {
+            for (int32 Lane = 0; Lane < ASYNC_TASK_PRIORITY_COUNT; Lane++)
+            {
+                OutSnapshot.QueueWait[Lane].Add(Recorders[i]->QueueWait[Lane]);
+                OutSnapshot.Execution[Lane].Add(Recorders[i]->Execution[Lane]);
+            }
+        }
+    }
+
+    for (int32 Lane = 0; Lane < ASYNC_TASK_PRIORITY_COUNT; Lane++)
+    {
+        OutSnapshot.QueuedTasks[Lane] = BKAsyncTaskManager::GetLaneStats(static_cast<EBKTaskPriority>(Lane)).QueuedTasks;
+    }
+    BKAsyncTaskManager::GetWorkerUtilization(OutSnapshot.Workers);
+
+    uint64 NowNs = static_cast<uint64>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    OutSnapshot.IntervalMs = static_cast<double>(NowNs - IntervalStartNs.load(std::memory_order_relaxed)) / 1000000.0;
+}
+void BKTaskMetrics::Reset()
+{
+    {
+        BKFastScopeGuard Guard(&Recorders_Mutex);
+        for (int32 Lane = 0; Lane < ASYNC_TASK_PRIORITY_COUNT; Lane++)
+        {
+            RetiredQueueWait[Lane] = FBKHistogramSnapshot();
+            RetiredExecution[Lane] = FBKHistogramSnapshot();
+        }
+        for (int32 i = 0; i < Recorders.Num(); i++)
+        {
+            for (int32 Lane = 0; Lane < ASYNC_TASK_PRIORITY_COUNT; Lane++)
+            {
+                Recorders[i]->QueueWait[Lane].Reset();
+                Recorders[i]->Execution[Lane].Reset();
+            }
+        }
+    }
+    BKAsyncTaskManager::ResetLaneStats();
+    BKAsyncTaskManager::ResetWorkerUtilization();
+
+    IntervalStartNs.store(static_cast<uint64>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()), std::memory_order_relaxed);
+}
+
+FString BKTaskMetrics::ToString(const FBKTaskMetricsSnapshot& Snapshot)
+{
+    static const wchar_t* LaneNames[ASYNC_TASK_PRIORITY_COUNT] = {L"LatencyCritical", L"Normal", L"Background"};
+
+    FString Result = FString(L"Async task metrics over ") + FString::FromInt(static_cast<int32>(Snapshot.IntervalMs)) + FString(L" ms");
+    for (int32 Lane = 0; Lane < ASYNC_TASK_PRIORITY_COUNT; Lane++)
+    {
+        const FBKHistogramSnapshot& Wait = Snapshot.QueueWait[Lane];
+        const FBKHistogramSnapshot& Execution = Snapshot.Execution[Lane];
+
+        Result += FString(L"\n  ") + FString(LaneNames[Lane]) +
+                FString(L": queued ") + FString::FromInt(Snapshot.QueuedTasks[Lane]) +
+                FString(L", ") + FString::FromInt(static_cast<int32>(Snapshot.GetThroughput(static_cast<EBKTaskPriority>(Lane)) + 0.5)) + FString(L" tasks/s") +
+                FString(L", wait us p50/p99/max ") + FString::FromInt(static_cast<int32>(Wait.GetPercentileUs(50))) +
+                FString(L"/") + FString::FromInt(static_cast<int32>(Wait.GetPercentileUs(99))) +
+                FString(L"/") + FString::FromInt(static_cast<int32>(Wait.MaxValue)) +
+                FString(L", run us p50/p99/max ") + FString::FromInt(static_cast<int32>(Execution.GetPercentileUs(50))) +
+                FString(L"/") + FString::FromInt(static_cast<int32>(Execution.GetPercentileUs(99))) +
+                FString(L"/") + FString::FromInt(static_cast<int32>(Execution.MaxValue));
+    }
+    Result += FString(L"\n  Workers busy: ");
+    for (int32 i = 0; i < Snapshot.Workers.Num(); i++)
+    {
+        if (i > 0) Result += FString(L", ");
+        Result += FString::FromInt(static_cast<int32>(Snapshot.Workers[i].BusyRatio * 100.0 + 0.5)) + FString(L"%");
+    }
+    return Result;
+}
+
+void BKTaskMetrics::StartPeriodicDump(uint32 IntervalMs, bool bResetAfterDump)
+{
+    StopPeriodicDump();
+    if (IntervalMs == 0) return;
+
+    static TArray<BKAsyncTaskParameter*> NoParameter;
+    DumpTaskHandle = BKScheduledAsyncTaskManager::NewScheduledAsyncTask([bResetAfterDump](const TArray<BKAsyncTaskParameter*>&)
+    {
+        //Large; kept off the worker's stack.
+        static FBKTaskMetricsSnapshot Snapshot;
+        static BKFastMutex Snapshot_Mutex;
+
+        BKFastScopeGuard Guard(&Snapshot_Mutex);
+        GetSnapshot(Snapshot);
+        BKUtilities::Print(EBKLogType::Log, ToString(Snapshot));
+        if (bResetAfterDump) Reset();
+    }, NoParameter, IntervalMs, true, false, EBKTaskPriority::Background);
+}
+void BKTaskMetrics::StopPeriodicDump()
+{
+    if (DumpTaskHandle != 0)
+    {
+        BKScheduledAsyncTaskManager::CancelScheduledAsyncTask(DumpTaskHandle);
+        DumpTaskHandle = 0;
+    }
+}
@@ -0,0 +1,192 @@
+// Copyright Burak Kara, All rights reserved.
+
+#ifndef Pragma_Once_BKTimerWheel
+#define Pragma_Once_BKTimerWheel
+
+#include "BKEngine.h"
+#include "BKArray.h"
+#include "BKTaskDefines.h"
+
+#define TIMER_WHEEL_ROOT_BITS 8
+#define TIMER_WHEEL_LEVEL_BITS 6
+#define TIMER_WHEEL_ROOT_SIZE (1 << TIMER_WHEEL_ROOT_BITS)
+#define TIMER_WHEEL_LEVEL_SIZE (1 << TIMER_WHEEL_LEVEL_BITS)
+#define TIMER_WHEEL_UPPER_LEVELS 3
+
+//Delays beyond this (about 18.6 hours at 1ms ticks) are parked in the last level and re-placed when they come around.
+#define TIMER_WHEEL_MAX_DELTA ((uint64)1 << (TIMER_WHEEL_ROOT_BITS + TIMER_WHEEL_UPPER_LEVELS * TIMER_WHEEL_LEVEL_BITS))
+
+struct FBKTimerNode
+{
+    FBKAwaitingTask* Task = nullptr;
+
+    uint64 ExpireTick = 0;
+    uint32 Handle = 0;
+
+    //Set while the callback is dispatched; cancelling then only flags the node and the completion frees it.
+    bool bRunning = false;
+    bool bCancelled = false;
+
+    void* Owner = nullptr;
+
+    FBKTimerNode* Prev = nullptr;
+    FBKTimerNode* Next = nullptr;
+    FBKTimerNode** ListHead = nullptr;
+};
+
+// Hashed hierarchical timing wheel (Varghese & Lauck) with 1 tick resolution.
+// Schedule and Unschedule are O(1); Advance costs one slot visit per elapsed tick plus a cascade every 256 ticks.
+// Not thread-safe; the owner serializes access.
+class BKTimerWheel
+{
+
+private:
+    FBKTimerNode* RootSlots[TIMER_WHEEL_ROOT_SIZE]{};
+    FBKTimerNode* LevelSlots[TIMER_WHEEL_UPPER_LEVELS][TIMER_WHEEL_LEVEL_SIZE]{};
+
+    uint64 CurrentTick = 0;
+    int32 ScheduledCount = 0;
+
+    static void Link(FBKTimerNode** Head, FBKTimerNode* Node)
+    {
+        Node->ListHead = Head;
+        Node->Prev = nullptr;
+        Node->Next = *Head;
+        if (*Head)
+        {
+            (*Head)->Prev = Node;
+        }
+        *Head = Node;
+    }
+
+    void Place(FBKTimerNode* Node)
+    {
+        uint64 Expire = Node->ExpireTick > CurrentTick ? Node->ExpireTick : CurrentTick;
+        uint64 Delta = Expire - CurrentTick;
+
+        if (Delta < TIMER_WHEEL_ROOT_SIZE)
+        {
+            Link(&RootSlots[Expire & (TIMER_WHEEL_ROOT_SIZE - 1)], Node);
+            return;
+        }
+        if (Delta >= TIMER_WHEEL_MAX_DELTA)
+        {
+            Expire = CurrentTick + TIMER_WHEEL_MAX_DELTA - 1;
+        }
+        for (int32 Level = 0; Level < TIMER_WHEEL_UPPER_LEVELS; Level++)
+        {
+            int32 Shift = TIMER_WHEEL_ROOT_BITS + (Level + 1) * TIMER_WHEEL_LEVEL_BITS;
+            if (Level == TIMER_WHEEL_UPPER_LEVELS - 1 || Delta < ((uint64)1 << Shift))
+            {
+                int32 Index = static_cast<int32>((Expire >> (Shift - TIMER_WHEEL_LEVEL_BITS)) & (TIMER_WHEEL_LEVEL_SIZE - 1));
+                Link(&LevelSlots[Level][Index], Node);
+                return;
+            }
+        }
+    }
+
+    //Moves every node of the current slot of the given upper level down. Returns the slot index.
+    int32 Cascade(int32 Level)
+    {
+        int32 Shift = TIMER_WHEEL_ROOT_BITS + Level * TIMER_WHEEL_LEVEL_BITS;
+        auto Index = static_cast<int32>((CurrentTick >> Shift) & (TIMER_WHEEL_LEVEL_SIZE - 1));
+
+        FBKTimerNode* Node = LevelSlots[Level][Index];
+        LevelSlots[Level][Index] = nullptr;
+        while (Node)
+        {
+            FBKTimerNode* Next = Node->Next;
+            Place(Node);
+            Node = Next;
+        }
+        return Index;
+    }
+
+public:
+    explicit BKTimerWheel(uint64 StartTick = 0) : CurrentTick(StartTick)
+    {
+    }
+
+    void Schedule(FBKTimerNode* Node)
+    {
+        if (!Node || Node->ListHead) return;
+        Place(Node);
+        ScheduledCount++;
+    }
+
+    void Unschedule(FBKTimerNode* Node)
+    {
+        if (!Node || !Node->ListHead) return;
+
+        if (Node->Prev)
+        {
+            Node->Prev->Next = Node->Next;
+        }
+        else
+        {
+            *Node->ListHead = Node->Next;
+        }
+        if (Node->Next)
+        {
+            Node->Next->Prev = Node->Prev;
+        }
+        Node->Prev = nullptr;
+        Node->Next = nullptr;
+        Node->ListHead = nullptr;
+        ScheduledCount--;
+    }
+
+    //Processes every tick up to and including NowTick; expired nodes are unlinked and appended to OutExpired.
+    void Advance(uint64 NowTick, TArray<FBKTimerNode*>& OutExpired)
+    {
+        while (CurrentTick <= NowTick)
+        {
+            if (ScheduledCount == 0)
+            {
+                CurrentTick = NowTick + 1;
+                return;
+            }
+
+            auto Index = static_cast<int32>(CurrentTick & (TIMER_WHEEL_ROOT_SIZE - 1));
+            if (Index == 0)
+            {
+                for (int32 Level = 0; Level < TIMER_WHEEL_UPPER_LEVELS; Level++)
+                {
+                    if (Cascade(Level) != 0) break;
+                }
+            }
+
+            FBKTimerNode* Node = RootSlots[Index];
+            RootSlots[Index] = nullptr;
+            while (Node)
+            {
+                FBKTimerNode* Next = Node->Next;
+                Node->Prev = nullptr;
+                Node->Next = nullptr;
+                Node->ListHead = nullptr;
+                if (Node->ExpireTick > CurrentTick)
+                {
+                    Place(Node);
+                }
+                else
+                {
+                    ScheduledCount--;
+                    OutExpired.Add(Node);
+                }
+                Node = Next;
+            }
+            CurrentTick++;
+        }
+    }
+
+    uint64 GetCurrentTick() const
+    {
+        return CurrentTick;
+    }
+    int32 Num() const
+    {
+        return ScheduledCount;
+    }
+};
+
+#endif //Pragma_Once_BKTimerWheel
@@ -76,6 +76,10 @@ double BKUtilities::GetTimeStampInMSDetailed()
     double NS = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
     return NS / 1000000.0f;
 }
+uint64 BKUtilities::GetMonotonicTimeStampInMS()
+{
+    return static_cast<uint64>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
 
 FString BKUtilities::WGetSafeErrorMessage()
 {
@@ -4,8 +4,56 @@
 #define Pragma_Once_BKAsyncTaskManager
 
 #include "BKEngine.h"
-#include "BKSafeQueue.h"
+#include "BKMPMCQueue.h"
+#include "BKWorkStealingDeque.h"
 #include "BKTaskDefines.h"
+#include "BKParker.h"
+#include "BKTaskMetrics.h"
+
+#define ASYNC_TASK_MANAGER_MAX_WORKERS 1024
+#define ASYNC_TASK_MANAGER_QUEUE_CAPACITY 16384
+#define ASYNC_TASK_POOL_LOCAL_CACHE_SIZE 64
+#define ASYNC_TASK_POOL_CAPACITY 4096
+#define ASYNC_TASK_LANE_SCHEDULE_MAX 64
+#define ASYNC_TASK_BATCH_CAPACITY 64
+//Blocked producers recheck the queue depth at least this often, in case a wake-up was missed.
+#define ASYNC_TASK_BLOCKED_PRODUCER_RECHECK_MS 10
+
+class BKAsyncTaskBatch;
+
+// How workers pick between priority lanes.
+struct FBKTaskLaneOptions
+{
+    //Strict: a lane only runs when every higher lane is empty. Otherwise every lane is served in proportion to its
+    //weight while it has work, so a flood in one lane delays but never starves the others.
+    bool bStrictPriority = false;
+    uint32 LaneWeights[ASYNC_TASK_PRIORITY_COUNT] = {8, 4, 1};
+
+    //Workers that only run their lane, taken from the front of the worker list. At least one worker stays shared.
+    int32 ReservedWorkers[ASYNC_TASK_PRIORITY_COUNT] = {0, 0, 0};
+
+    //Queued tasks a lane accepts before the submission's EBKOverloadPolicy applies; 0 is unbounded.
+    //The Normal lane also counts the tasks in the workers' deques.
+    int32 MaxQueuedTasks[ASYNC_TASK_PRIORITY_COUNT] = {0, 0, 0};
+
+    //HighWatermarkCallback runs on the submitting thread when a lane's queue reaches HighWatermark, and again only
+    //after the lane has drained below half of it. 0 disables it. Keep the callback short.
+    int32 HighWatermark[ASYNC_TASK_PRIORITY_COUNT] = {0, 0, 0};
+    std::function<void(EBKTaskPriority Priority, int32 QueuedTasks)> HighWatermarkCallback;
+};
+
+// Snapshot for monitoring. Wait times cover tasks that had to queue; tasks handed straight to an idle worker did not wait.
+struct FBKTaskLaneStats
+{
+    int32 QueuedTasks = 0;
+    uint64 DequeuedTasks = 0;
+    double TotalWaitMs = 0;
+    double MaxWaitMs = 0;
+    uint64 DroppedTasks = 0;
+    uint64 RejectedTasks = 0;
+    //Submissions that had to wait for room under EBKOverloadPolicy::Block.
+    uint64 BlockedSubmissions = 0;
+};
 
 struct FBKAsyncWorker
 {
@@ -14,38 +62,106 @@ private:
     void ProcessData();
     void ProcessData_CriticalPart();
 
+    //Published by SetData with release; the worker reads CurrentData after seeing DataReady.
     FBKAwaitingTask* CurrentData = nullptr;
-    bool DataReady = false;
+    std::atomic<bool> DataReady;
+
+    BKParker Parker;
+    void WaitForData(const FBKIdleStrategy& IdleStrategy);
+
+    BKThread* WorkerThread = nullptr;
+
+    //Slot in the manager's worker array; also selects the worker's deque in work-stealing mode.
+    int32 WorkerIndex = 0;
+
+    //Work-stealing mode: set while the worker is listed in FreeWorkers, so it is never listed twice.
+    std::atomic<bool> bListedAsSleeping;
+
+    //Lane this worker is reserved for, or INDEX_NONE when it serves every lane.
+    int32 ReservedLane = INDEX_NONE;
 
-    BKConditionVariable Condition;
-    BKMutex Mutex;
+    //Utilization since UtilizationStartNs; written by the worker, reset by BKTaskMetrics::Reset.
+    std::atomic<uint64> BusyNanoseconds;
+    std::atomic<uint64> ExecutedTasks;
+    std::atomic<uint64> UtilizationStartNs;
 
-    BKThread* WorkerThread;
+    void WorkersDen_WorkStealing();
+    bool SleepUntilWoken();
+
+    friend class BKAsyncTaskManager;
 
 public:
-    FBKAsyncWorker();
+    explicit FBKAsyncWorker(int32 _WorkerIndex = 0);
 
     void StartWorker();
     void EndWorker();
 
     void SetData(FBKAwaitingTask* Task, bool bSendSignal);
+    void WakeUp();
     void WorkersDen();
     uint32 WorkersStopCallback();
+
+    static void ExecuteTask(FBKAwaitingTask* Task);
 };
 
 class BKAsyncTaskManager
 {
 
 public:
-    static void StartSystem(int32 WorkerThreadNo);
+    //In work-stealing mode every worker owns a deque; tasks created on a worker stay on it and idle workers steal.
+    //Workers are placed according to Layout.WorkerAffinityMask. IdleStrategy decides how long idle workers spin before they sleep.
+    //LaneOptions sets how priority lanes share the workers.
+    static void StartSystem(int32 WorkerThreadNo, bool bWorkStealing = false, const FBKCoreLayout& Layout = FBKCoreLayout(), const FBKIdleStrategy& IdleStrategy = FBKIdleStrategy(),
+            const FBKTaskLaneOptions& LaneOptions = FBKTaskLaneOptions());
     static void EndSystem();
 
     static bool IsSystemStarted();
+    static bool IsWorkStealingEnabled();
+    //0 while the system is stopped.
+    static int32 GetWorkerCount();
 
     static void PushFreeWorker(FBKAsyncWorker* Worker);
-    static FBKAwaitingTask* TryToGetAwaitingTask();
+    //ReservedLane restricts the search to one lane; INDEX_NONE picks by the lane policy.
+    static FBKAwaitingTask* TryToGetAwaitingTask(int32 ReservedLane = INDEX_NONE);
+
+    //Returns false if the task was not queued: the system is stopped or Overload refused it. TaskParameters are then left to the caller.
+    static bool NewAsyncTask(BKFutureAsyncTask& NewTask, TArray<BKAsyncTaskParameter*>& TaskParameters, bool bDoNotDeallocateParameters = false,
+            EBKTaskPriority Priority = EBKTaskPriority::Normal, EBKOverloadPolicy Overload = EBKOverloadPolicy::Block);
+
+    //Allocation-free submission for void() callables that fit in BK_INLINE_TASK_SIZE bytes; task nodes are pooled.
+    //Returns false if the callable was not queued; it is then never called.
+    template <typename F>
+    static bool NewAsyncTask(F&& Callable, EBKTaskPriority Priority = EBKTaskPriority::Normal, EBKOverloadPolicy Overload = EBKOverloadPolicy::Block)
+    {
+        if (!bSystemStarted || !ManagerInstance) return false;
+        if (!ManagerInstance->AdmitTasks_Internal(Priority, 1, Overload)) return false;
+
+        FBKAwaitingTask* AsTask = AllocateTask();
+        AsTask->InlineFunction.Bind(std::forward<F>(Callable));
+        AsTask->Priority = Priority;
+        ManagerInstance->SubmitTask(AsTask);
+        return true;
+    }
+
+    //Submits every task collected in Batch with one queue operation and wakes at most one worker per task. Batch is empty afterwards.
+    //Queue limits are not applied here; a producer that batches admits each item with AdmitTasks before building it.
+    static void NewAsyncTasks(BKAsyncTaskBatch& Batch);
 
-    static void NewAsyncTask(BKFutureAsyncTask& NewTask, TArray<BKAsyncTaskParameter*>& TaskParameters, bool bDoNotDeallocateParameters = false);
+    //Applies the lane limit to Count tasks the caller is about to submit, before it allocates anything for them.
+    //Blocks, or counts the drop or rejection, exactly as a submission with Overload would. Returns false if they must not be submitted.
+    static bool AdmitTasks(EBKTaskPriority Priority, int32 Count, EBKOverloadPolicy Overload);
+    //True while the lane is at its queue limit.
+    static bool IsOverloaded(EBKTaskPriority Priority);
+
+    static FBKTaskLaneStats GetLaneStats(EBKTaskPriority Priority);
+    static void ResetLaneStats();
+
+    static void GetWorkerUtilization(TArray<FBKWorkerUtilization>& OutWorkers);
+    static void ResetWorkerUtilization();
+
+    //Task nodes come from a per-thread cache backed by a global lock-free pool.
+    static FBKAwaitingTask* AllocateTask();
+    static void ReleaseTask(FBKAwaitingTask* Task);
 
 private:
     static bool bSystemStarted;
@@ -60,19 +176,122 @@ private:
         return *this;
     }
 
-    friend class FBKAsyncWorker;
+    friend struct FBKAsyncWorker;
     static uint32 AsyncWorkerStopped(FBKAsyncWorker* StoppedWorker);
 
-    void StartSystem_Internal(int32 WorkerThreadNo);
+    void StartSystem_Internal(int32 WorkerThreadNo, bool bWorkStealing, const FBKCoreLayout& Layout, const FBKIdleStrategy& _IdleStrategy, const FBKTaskLaneOptions& _LaneOptions);
     void EndSystem_Internal();
 
     void StartWorkers(int32 WorkerThreadNo);
 
+    void SubmitTask(FBKAwaitingTask* AsTask);
+
+    //Set when any lane has a queue limit or a watermark; admission is free otherwise.
+    bool bHasQueueLimits = false;
+    bool AdmitTasks_Internal(EBKTaskPriority Priority, int32 Count, EBKOverloadPolicy Overload);
+    void WaitForQueueSpace(int32 Lane);
+    int32 GetQueuedTaskCount(int32 Lane) const;
+    void SubmitTasks(FBKAwaitingTask** Tasks, int32 Count, EBKTaskPriority Priority);
+
+    //Hands queued tasks to free workers; closes the window where a task is queued while the last busy worker goes idle.
+    void DispatchAwaitingTasks();
+    void DispatchAwaitingTasks(int32 WorkerClass);
+
+    FBKTaskLaneOptions LaneOptions;
+    //Weighted mode: lanes interleaved in proportion to their weights; each thread walks it with its own ticket.
+    uint8 LaneSchedule[ASYNC_TASK_LANE_SCHEDULE_MAX]{};
+    int32 LaneScheduleLength = 0;
+    void BuildLaneSchedule();
+    int32 GetReservedLane(int32 WorkerIndex) const;
+    int32 PickPreferredLane() const;
+
+    bool PopAwaitingTask(int32 ReservedLane, FBKAwaitingTask*& OutTask);
+    bool HasAwaitingTasks(int32 ReservedLane) const;
+    void QueueTask(FBKAwaitingTask* Task);
+
+    struct FBKLaneCounters
+    {
+        std::atomic<uint64> DequeuedTasks{0};
+        std::atomic<uint64> TotalWaitUs{0};
+        std::atomic<uint64> MaxWaitUs{0};
+        std::atomic<uint64> DroppedTasks{0};
+        std::atomic<uint64> RejectedTasks{0};
+        std::atomic<uint64> BlockedSubmissions{0};
+
+        //Futex word of blocked producers; bumped on dequeue while BlockedProducers is non-zero.
+        std::atomic<uint32> SpaceEpoch{0};
+        std::atomic<int32> BlockedProducers{0};
+        std::atomic<bool> bAboveHighWatermark{false};
+    };
+    FBKLaneCounters LaneCounters[ASYNC_TASK_PRIORITY_COUNT];
+    static void ReportQueueDelay(FBKAwaitingTask* Task);
+
     FBKAsyncWorker** AsyncWorkers = nullptr;
     int32 WorkerThreadCount = 0;
 
-    BKSafeQueue<FBKAsyncWorker*> FreeWorkers;
-    BKSafeQueue<FBKAwaitingTask*> AwaitingTasks;
+    bool bWorkStealingMode = false;
+
+    FBKCoreLayout CoreLayout;
+    FBKIdleStrategy IdleStrategy;
+
+    //Owned by the manager rather than the workers, so a restarted worker does not invalidate a deque being stolen from.
+    BKWorkStealingDeque<FBKAwaitingTask*>** WorkerDeques = nullptr;
+
+    void EnqueueTask_WorkStealing(FBKAwaitingTask* Task);
+    FBKAwaitingTask* FindTask_WorkStealing(FBKAsyncWorker* Worker, uint32& StealSeed);
+    bool HasPendingTasks_WorkStealing(int32 ReservedLane);
+    //Wakes a sleeping worker that can run tasks of Lane: one reserved for it, else a shared one. Returns false if none sleeps.
+    bool WakeSleepingWorker(int32 Lane);
+
+    //Index ASYNC_TASK_PRIORITY_COUNT of FreeWorkers holds the shared workers, the others the workers reserved for that lane.
+    //Each worker is in its queue at most once, so none can be full. In work-stealing mode they hold the sleeping workers.
+    BKMPMCQueue<FBKAsyncWorker*, ASYNC_TASK_MANAGER_MAX_WORKERS> FreeWorkers[ASYNC_TASK_PRIORITY_COUNT + 1];
+    BKMPMCSpillQueue<FBKAwaitingTask*, ASYNC_TASK_MANAGER_QUEUE_CAPACITY> AwaitingTasks[ASYNC_TASK_PRIORITY_COUNT];
+};
+
+// Collects tasks of one priority on the calling thread, for a producer that sees work arrive in bursts.
+// Adding to a full batch submits it first. Tasks still in the batch are submitted when it is destroyed.
+class BKAsyncTaskBatch
+{
+
+private:
+    FBKAwaitingTask* Tasks[ASYNC_TASK_BATCH_CAPACITY];
+    int32 TaskNum = 0;
+    EBKTaskPriority Priority;
+
+    BKAsyncTaskBatch(const BKAsyncTaskBatch&);
+    BKAsyncTaskBatch& operator=(const BKAsyncTaskBatch&);
+
+    friend class BKAsyncTaskManager;
+
+public:
+    explicit BKAsyncTaskBatch(EBKTaskPriority _Priority = EBKTaskPriority::Normal) : Priority(_Priority)
+    {
+    }
+    ~BKAsyncTaskBatch()
+    {
+        if (TaskNum > 0) BKAsyncTaskManager::NewAsyncTasks(*this);
+    }
+
+    template <typename F>
+    void Add(F&& Callable)
+    {
+        if (TaskNum == ASYNC_TASK_BATCH_CAPACITY) BKAsyncTaskManager::NewAsyncTasks(*this);
+
+        FBKAwaitingTask* AsTask = BKAsyncTaskManager::AllocateTask();
+        AsTask->InlineFunction.Bind(std::forward<F>(Callable));
+        AsTask->Priority = Priority;
+        Tasks[TaskNum++] = AsTask;
+    }
+
+    int32 Num() const
+    {
+        return TaskNum;
+    }
+    bool IsEmpty() const
+    {
+        return TaskNum == 0;
+    }
 };
 
 #endif //Pragma_Once_BKAsyncTaskManager
\ No newline at end of file
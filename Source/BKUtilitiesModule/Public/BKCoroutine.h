@@ -0,0 +1,506 @@
+// Copyright Burak Kara, All rights reserved.
+
+#ifndef Pragma_Once_BKCoroutine
+#define Pragma_Once_BKCoroutine
+
+#include "BKEngine.h"
+
+// Only available in builds configured with -DBK_ENABLE_COROUTINES=ON (C++20).
+#if BK_WITH_COROUTINES
+
+#include "BKAsyncTaskManager.h"
+#include "BKScheduledTaskManager.h"
+#include "BKFuture.h"
+#include "BKFastMutex.h"
+#include "BKRWLock.h"
+#include "BKAtomic.h"
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+
+#define BK_COROUTINE_FRAME_GRANULARITY 64
+#define BK_COROUTINE_FRAME_POOL_MAX 2048
+#define BK_COROUTINE_FRAME_CACHE_COUNT 64
+
+// Coroutine frames are recycled through per-thread free lists, one per BK_COROUTINE_FRAME_GRANULARITY size class.
+// Frames bigger than BK_COROUTINE_FRAME_POOL_MAX come from the heap.
+class BKCoroutineFrameAllocator
+{
+
+public:
+    static void* Allocate(size_t Size);
+    static void Deallocate(void* Frame, size_t Size);
+};
+
+struct FBKCoroutinePromiseBase
+{
+    //Resumed when the coroutine finishes.
+    std::coroutine_handle<> Continuation;
+    std::exception_ptr Exception;
+
+    static void* operator new(size_t Size)
+    {
+        return BKCoroutineFrameAllocator::Allocate(Size);
+    }
+    static void operator delete(void* Frame, size_t Size)
+    {
+        BKCoroutineFrameAllocator::Deallocate(Frame, Size);
+    }
+
+    struct FFinalAwaiter
+    {
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+        template <typename TPromise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<TPromise> Handle) noexcept
+        {
+            std::coroutine_handle<> Next = Handle.promise().Continuation;
+            return Next ? Next : std::noop_coroutine();
+        }
+        void await_resume() const noexcept
+        {
+        }
+    };
+
+    //Tasks are lazy: nothing runs until they are awaited or spawned.
+    std::suspend_always initial_suspend() const noexcept
+    {
+        return {};
+    }
+    FFinalAwaiter final_suspend() const noexcept
+    {
+        return {};
+    }
+    void unhandled_exception()
+    {
+        Exception = std::current_exception();
+    }
+};
+
+template <typename T>
+class BKTask;
+
+template <typename T>
+struct FBKTaskPromise : public FBKCoroutinePromiseBase
+{
+    std::optional<T> Value;
+
+    BKTask<T> get_return_object();
+
+    template <typename U>
+    void return_value(U&& Result)
+    {
+        Value.emplace(std::forward<U>(Result));
+    }
+
+    T TakeResult()
+    {
+        if (Exception) std::rethrow_exception(Exception);
+        return std::move(*Value);
+    }
+};
+template <>
+struct FBKTaskPromise<void> : public FBKCoroutinePromiseBase
+{
+    BKTask<void> get_return_object();
+
+    void return_void() const
+    {
+    }
+
+    void TakeResult()
+    {
+        if (Exception) std::rethrow_exception(Exception);
+    }
+};
+
+// Lazily started coroutine returning T. co_await it from another coroutine, or hand it to BKSpawn.
+// The awaiting coroutine is resumed on whichever thread finishes the task, without a trip through the task queue.
+template <typename T = void>
+class [[nodiscard]] BKTask
+{
+
+public:
+    typedef FBKTaskPromise<T> promise_type;
+
+private:
+    std::coroutine_handle<promise_type> Handle;
+
+    BKTask(const BKTask&);
+    BKTask& operator=(const BKTask&);
+
+public:
+    explicit BKTask(std::coroutine_handle<promise_type> _Handle) : Handle(_Handle)
+    {
+    }
+    BKTask(BKTask&& Other) noexcept : Handle(Other.Handle)
+    {
+        Other.Handle = nullptr;
+    }
+    BKTask& operator=(BKTask&& Other) noexcept
+    {
+        if (this != &Other)
+        {
+            if (Handle) Handle.destroy();
+            Handle = Other.Handle;
+            Other.Handle = nullptr;
+        }
+        return *this;
+    }
+    ~BKTask()
+    {
+        if (Handle) Handle.destroy();
+    }
+
+    bool IsValid() const
+    {
+        return static_cast<bool>(Handle);
+    }
+    bool IsDone() const
+    {
+        return Handle && Handle.done();
+    }
+
+    struct FAwaiter
+    {
+        std::coroutine_handle<promise_type> Handle;
+
+        bool await_ready() const noexcept
+        {
+            return Handle.done();
+        }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> Awaiting) noexcept
+        {
+            Handle.promise().Continuation = Awaiting;
+            return Handle;
+        }
+        T await_resume()
+        {
+            return Handle.promise().TakeResult();
+        }
+    };
+
+    FAwaiter operator co_await() &&
+    {
+        return FAwaiter{Handle};
+    }
+};
+
+template <typename T>
+BKTask<T> FBKTaskPromise<T>::get_return_object()
+{
+    return BKTask<T>(std::coroutine_handle<FBKTaskPromise<T>>::from_promise(*this));
+}
+inline BKTask<void> FBKTaskPromise<void>::get_return_object()
+{
+    return BKTask<void>(std::coroutine_handle<FBKTaskPromise<void>>::from_promise(*this));
+}
+
+// Eagerly started coroutine that frees its own frame; used to run a BKTask nobody awaits.
+struct FBKDetachedCoroutine
+{
+    struct promise_type
+    {
+        static void* operator new(size_t Size)
+        {
+            return BKCoroutineFrameAllocator::Allocate(Size);
+        }
+        static void operator delete(void* Frame, size_t Size)
+        {
+            BKCoroutineFrameAllocator::Deallocate(Frame, Size);
+        }
+
+        FBKDetachedCoroutine get_return_object() const noexcept
+        {
+            return {};
+        }
+        std::suspend_never initial_suspend() const noexcept
+        {
+            return {};
+        }
+        std::suspend_never final_suspend() const noexcept
+        {
+            return {};
+        }
+        void return_void() const noexcept
+        {
+        }
+        void unhandled_exception() const noexcept
+        {
+            std::terminate();
+        }
+    };
+};
+
+// Resumes its coroutine exactly once: when called, or when the task carrying it is destroyed without running
+// (EndSystem drops queued tasks and pending timers), so a suspended coroutine is never leaked.
+struct FBKResumeTask
+{
+    std::coroutine_handle<> Handle;
+
+    explicit FBKResumeTask(std::coroutine_handle<> _Handle) : Handle(_Handle)
+    {
+    }
+    FBKResumeTask(FBKResumeTask&& Other) noexcept : Handle(Other.Handle)
+    {
+        Other.Handle = nullptr;
+    }
+    ~FBKResumeTask()
+    {
+        if (Handle) Release().resume();
+    }
+
+    //For a refused submission: the caller resumes the coroutine itself.
+    std::coroutine_handle<> Release()
+    {
+        std::coroutine_handle<> Result = Handle;
+        Handle = nullptr;
+        return Result;
+    }
+    void operator()()
+    {
+        if (Handle) Release().resume();
+    }
+
+private:
+    FBKResumeTask(const FBKResumeTask&);
+    FBKResumeTask& operator=(const FBKResumeTask&);
+};
+// Shares one FBKResumeTask between the copies of a std::function based task.
+struct FBKSharedResumeTask : public BKIntrusiveRefCounted
+{
+    FBKResumeTask Resume;
+
+    explicit FBKSharedResumeTask(std::coroutine_handle<> _Handle) : Resume(_Handle)
+    {
+    }
+};
+
+// co_await BKSwitchToWorker() continues the coroutine on a BKAsyncTaskManager worker. Without workers, or when the
+// lane is full, it continues inline instead of waiting for room.
+struct FBKWorkerAwaiter
+{
+    bool await_ready() const noexcept
+    {
+        return !BKAsyncTaskManager::IsSystemStarted();
+    }
+    bool await_suspend(std::coroutine_handle<> Handle) const
+    {
+        FBKResumeTask Resume(Handle);
+        if (BKAsyncTaskManager::NewAsyncTask(std::move(Resume), EBKTaskPriority::Normal, EBKOverloadPolicy::Reject)) return true;
+
+        Resume.Release();
+        return false;
+    }
+    void await_resume() const noexcept
+    {
+    }
+};
+inline FBKWorkerAwaiter BKSwitchToWorker()
+{
+    return FBKWorkerAwaiter();
+}
+
+// co_await BKSleepFor(Ms) suspends without holding a thread; the coroutine is resumed by a BKScheduledAsyncTaskManager timer.
+// If the timer is refused it continues inline; if the scheduler stops first it is resumed early by EndSystem.
+struct FBKSleepAwaiter
+{
+    uint32 DurationMs = 0;
+
+    bool await_ready() const noexcept
+    {
+        return DurationMs == 0 || !BKScheduledAsyncTaskManager::IsSystemStarted();
+    }
+    bool await_suspend(std::coroutine_handle<> Handle) const
+    {
+        //Kept alive here too, so that a refused timer does not resume the coroutine before this returns.
+        BKIntrusivePtr<FBKSharedResumeTask> Resume(new FBKSharedResumeTask(Handle));
+        TArray<BKAsyncTaskParameter*> NoParameters;
+        if (BKScheduledAsyncTaskManager::NewScheduledAsyncTask([Resume](const TArray<BKAsyncTaskParameter*>&) { Resume->Resume(); }, NoParameters, DurationMs, false) != 0) return true;
+
+        Resume->Resume.Release();
+        return false;
+    }
+    void await_resume() const noexcept
+    {
+    }
+};
+inline FBKSleepAwaiter BKSleepFor(uint32 DurationMs)
+{
+    return FBKSleepAwaiter{DurationMs};
+}
+
+// co_await on a BKFuture yields the same future, now ready; check IsFailed()/Get() on it without blocking.
+template <typename T>
+struct FBKFutureAwaiter
+{
+    BKIntrusivePtr<FBKFutureState<T>> State;
+
+    bool await_ready() const noexcept
+    {
+        return !State.IsValid() || State->IsReady();
+    }
+    void await_suspend(std::coroutine_handle<> Handle)
+    {
+        //May resume the coroutine right here if the value raced in; nothing touches the awaiter afterwards.
+        FBKFutureState<T>* Source = State.Get();
+        Source->SetContinuation([Handle]() { Handle.resume(); });
+    }
+    BKFuture<T> await_resume()
+    {
+        return BKFuture<T>(State);
+    }
+
+    static FBKFutureAwaiter FromFuture(BKFuture<T>&& Future)
+    {
+        return FBKFutureAwaiter{std::move(Future.State)};
+    }
+};
+template <typename T>
+FBKFutureAwaiter<T> operator co_await(BKFuture<T>&& Future)
+{
+    return FBKFutureAwaiter<T>::FromFuture(std::move(Future));
+}
+
+enum class EBKSocketEvent : uint8
+{
+    Readable,
+    Writable
+};
+
+// One pending readiness wait; lives in the awaiting coroutine's frame and is only touched by the reactor until resumed.
+struct FBKSocketWaiter
+{
+    std::coroutine_handle<> Handle;
+    int64 SocketHandle = -1;
+    EBKSocketEvent Event = EBKSocketEvent::Readable;
+    //Monotonic ms, 0 for no deadline.
+    uint64 DeadlineMs = 0;
+    bool bReady = false;
+};
+
+// Single poll() thread that resumes coroutines waiting for socket readiness, so in-flight I/O does not pin workers.
+// Resumed coroutines continue on BKAsyncTaskManager workers when they are running and the lane has room, otherwise
+// on the reactor thread. Not available on Windows.
+class BKSocketReactor
+{
+
+public:
+    static bool StartSystem();
+    static void EndSystem();
+
+    static bool IsSystemStarted();
+
+    //Returns false if the reactor is not running; the caller must not suspend then.
+    static bool Register(FBKSocketWaiter* Waiter);
+
+private:
+    static BKAtomic<bool> bSystemStarted;
+    static BKSocketReactor* ReactorInstance;
+    //Read-locked by Register while it uses ReactorInstance; EndSystem write-locks it to detach the instance.
+    static BKRWLock Instance_Lock;
+
+    BKThread* ReactorThread = nullptr;
+
+    BKFastMutex Pending_Mutex;
+    TArray<FBKSocketWaiter*> PendingWaiters;
+
+    //Owned by the reactor thread.
+    TArray<FBKSocketWaiter*> Waiters;
+
+    //Self-pipe that interrupts poll() when a waiter is registered or the reactor stops.
+    int32 WakeReadHandle = -1;
+    int32 WakeWriteHandle = -1;
+
+    void ReactorRun();
+    uint32 ReactorStop();
+    void Wake();
+    static void Complete(FBKSocketWaiter* Waiter, bool bReady);
+
+    BKSocketReactor() = default;
+    ~BKSocketReactor() = default;
+    BKSocketReactor(const BKSocketReactor& Other);
+    BKSocketReactor& operator=(const BKSocketReactor& Other)
+    {
+        return *this;
+    }
+
+    bool StartSystem_Internal();
+    void EndSystem_Internal();
+};
+
+// co_await BKAwaitSocket(...) returns true once the socket is ready, false when TimeoutMs (when > 0) passed first or the reactor stopped.
+// Without a running reactor it returns true immediately, so callers must keep such sockets blocking.
+struct FBKSocketAwaiter
+{
+    FBKSocketWaiter Waiter;
+
+    bool await_ready() noexcept
+    {
+        if (BKSocketReactor::IsSystemStarted()) return false;
+        Waiter.bReady = true;
+        return true;
+    }
+    bool await_suspend(std::coroutine_handle<> Handle)
+    {
+        Waiter.Handle = Handle;
+        if (BKSocketReactor::Register(&Waiter)) return true;
+        Waiter.bReady = true;
+        return false;
+    }
+    bool await_resume() const noexcept
+    {
+        return Waiter.bReady;
+    }
+};
+inline FBKSocketAwaiter BKAwaitSocket(int64 SocketHandle, EBKSocketEvent Event, uint32 TimeoutMs = 0)
+{
+    FBKSocketAwaiter Awaiter;
+    Awaiter.Waiter.SocketHandle = SocketHandle;
+    Awaiter.Waiter.Event = Event;
+    Awaiter.Waiter.DeadlineMs = TimeoutMs > 0 ? BKUtilities::GetMonotonicTimeStampInMS() + TimeoutMs : 0;
+    return Awaiter;
+}
+
+template <typename T>
+FBKDetachedCoroutine BKSpawn_Internal(BKTask<T> Task, BKPromise<typename TBKFutureResult<T>::ValueType> Promise)
+{
+    co_await BKSwitchToWorker();
+    try
+    {
+        if constexpr (std::is_void<T>::value)
+        {
+            co_await std::move(Task);
+            Promise.SetValue(FBKVoid());
+        }
+        else
+        {
+            Promise.SetValue(co_await std::move(Task));
+        }
+    }
+    catch (const std::exception& Exception)
+    {
+        Promise.SetFailed(FString(Exception.what()));
+    }
+    catch (...)
+    {
+        Promise.SetFailed(FString(L"Coroutine has thrown an unknown exception."));
+    }
+}
+
+// Starts Task on a worker. The returned future completes with its result; ignore it for fire-and-forget coroutines.
+template <typename T>
+BKFuture<typename TBKFutureResult<T>::ValueType> BKSpawn(BKTask<T>&& Task)
+{
+    BKPromise<typename TBKFutureResult<T>::ValueType> Promise;
+    auto Result = Promise.GetFuture();
+    BKSpawn_Internal<T>(std::move(Task), std::move(Promise));
+    return Result;
+}
+
+#endif //BK_WITH_COROUTINES
+
+#endif //Pragma_Once_BKCoroutine
@@ -0,0 +1,697 @@
+// Copyright Burak Kara, All rights reserved.
+
+#ifndef Pragma_Once_BKFuture
+#define Pragma_Once_BKFuture
+
+#include "BKEngine.h"
+#include "BKAsyncTaskManager.h"
+#include "BKSharedPtr.h"
+#include "BKFastMutex.h"
+#include "BKFutex.h"
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template <typename T>
+class BKFuture;
+template <typename T>
+class BKPromise;
+template <typename T>
+struct FBKWhenAnyResult;
+template <typename T>
+struct FBKFutureAwaiter;
+template <typename T>
+BKFuture<TArray<T>> BKWhenAll(TArray<BKFuture<T>>&& Futures);
+template <typename T>
+BKFuture<FBKWhenAnyResult<T>> BKWhenAny(TArray<BKFuture<T>>&& Futures);
+
+// Value of futures whose work produces nothing. Continuations of such futures may also take no argument.
+struct FBKVoid
+{
+};
+
+// State shared by a promise and its future. Holds the value or the failure reason and at most one continuation.
+template <typename T>
+class FBKFutureState : public BKIntrusiveRefCounted
+{
+
+private:
+    static const uint32 Status_Pending = 0;
+    static const uint32 Status_Value = 1;
+    static const uint32 Status_Failed = 2;
+
+    //Also the futex word blocking waiters sleep on.
+    std::atomic<uint32> Status;
+    std::atomic<int32> BlockedWaiters;
+
+    //Orders completion against attaching the continuation.
+    BKFastMutex Mutex;
+    FBKInlineTask Continuation;
+
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type ValueStorage;
+    FString Error;
+
+    FBKFutureState(const FBKFutureState&);
+    FBKFutureState& operator=(const FBKFutureState&);
+
+    void OnCompleted()
+    {
+        if (BlockedWaiters.load() > 0)
+        {
+            BKFutex::WakeAll(&Status);
+        }
+        //No continuation can be attached after completion, so this is read without the lock.
+        if (Continuation.IsBound())
+        {
+            Continuation();
+            Continuation.Reset();
+        }
+    }
+
+public:
+    FBKFutureState() : Status(Status_Pending), BlockedWaiters(0)
+    {
+    }
+    ~FBKFutureState()
+    {
+        if (Status.load(std::memory_order_relaxed) == Status_Value)
+        {
+            GetValue().~T();
+        }
+    }
+
+    bool IsReady() const
+    {
+        return Status.load(std::memory_order_acquire) != Status_Pending;
+    }
+    bool IsFailed() const
+    {
+        return Status.load(std::memory_order_acquire) == Status_Failed;
+    }
+
+    //Only valid once IsReady() returned true.
+    T& GetValue()
+    {
+        return *reinterpret_cast<T*>(&ValueStorage);
+    }
+    const FString& GetError() const
+    {
+        return Error;
+    }
+
+    //Returns false if the state was already completed.
+    template <typename... Args>
+    bool SetValue(Args&&... Arguments)
+    {
+        {
+            BKFastScopeGuard Guard(&Mutex);
+            if (Status.load(std::memory_order_relaxed) != Status_Pending) return false;
+            new (&ValueStorage) T(std::forward<Args>(Arguments)...);
+            Status.store(Status_Value);
+        }
+        OnCompleted();
+        return true;
+    }
+    bool SetFailed(const FString& Reason)
+    {
+        {
+            BKFastScopeGuard Guard(&Mutex);
+            if (Status.load(std::memory_order_relaxed) != Status_Pending) return false;
+            Error = Reason;
+            Status.store(Status_Failed);
+        }
+        OnCompleted();
+        return true;
+    }
+
+    //Runs Callable on the calling thread if the state is already complete, otherwise on the thread that completes it.
+    template <typename F>
+    void SetContinuation(F&& Callable)
+    {
+        {
+            BKFastScopeGuard Guard(&Mutex);
+            if (Status.load(std::memory_order_relaxed) == Status_Pending)
+            {
+                Continuation.Bind(std::forward<F>(Callable));
+                return;
+            }
+        }
+        Callable();
+    }
+
+    //Returns true when the state is complete, false if TimeoutMs (when >= 0) elapsed first.
+    bool Wait(int32 TimeoutMs)
+    {
+        if (IsReady()) return true;
+        if (TimeoutMs == 0) return false;
+
+        typedef std::chrono::steady_clock FClock;
+        FClock::time_point Start = FClock::now();
+
+        BlockedWaiters.fetch_add(1);
+        while (Status.load() == Status_Pending)
+        {
+            int32 RemainingMs = -1;
+            if (TimeoutMs > 0)
+            {
+                auto ElapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(FClock::now() - Start).count();
+                if (ElapsedMs >= TimeoutMs) break;
+                RemainingMs = static_cast<int32>(TimeoutMs - ElapsedMs);
+            }
+            BKFutex::Wait(&Status, Status_Pending, RemainingMs);
+        }
+        BlockedWaiters.fetch_sub(1);
+        return IsReady();
+    }
+};
+
+template <typename T>
+class BKPromise
+{
+
+private:
+    BKIntrusivePtr<FBKFutureState<T>> State;
+    bool bFutureRetrieved = false;
+
+    BKPromise(const BKPromise&);
+    BKPromise& operator=(const BKPromise&);
+
+    void Abandon()
+    {
+        if (State.IsValid() && !State->IsReady())
+        {
+            State->SetFailed(FString(L"Promise was destroyed before it was fulfilled."));
+        }
+    }
+
+public:
+    BKPromise() : State(new FBKFutureState<T>())
+    {
+    }
+    BKPromise(BKPromise&& Other) noexcept : State(std::move(Other.State)), bFutureRetrieved(Other.bFutureRetrieved)
+    {
+    }
+    BKPromise& operator=(BKPromise&& Other) noexcept
+    {
+        if (this != &Other)
+        {
+            Abandon();
+            State = std::move(Other.State);
+            bFutureRetrieved = Other.bFutureRetrieved;
+        }
+        return *this;
+    }
+    //An unfulfilled promise fails its future instead of leaving it pending forever.
+    ~BKPromise()
+    {
+        Abandon();
+    }
+
+    //Only one future can be taken from a promise.
+    BKFuture<T> GetFuture()
+    {
+        if (!State.IsValid() || bFutureRetrieved)
+        {
+            BKUtilities::Print(EBKLogType::Warning, FString(L"Future of this promise was already retrieved."));
+            return BKFuture<T>();
+        }
+        bFutureRetrieved = true;
+        return BKFuture<T>(State);
+    }
+
+    //Continuations waiting on the future run on this thread before SetValue returns. Returns false if already fulfilled.
+    template <typename... Args>
+    bool SetValue(Args&&... Arguments)
+    {
+        return State.IsValid() && State->SetValue(std::forward<Args>(Arguments)...);
+    }
+    bool SetFailed(const FString& Reason)
+    {
+        return State.IsValid() && State->SetFailed(Reason);
+    }
+
+    bool IsFulfilled() const
+    {
+        return State.IsValid() && State->IsReady();
+    }
+};
+
+// Calls a continuation with the value, or without arguments when it does not accept one.
+template <typename F, typename T, typename = void>
+struct TBKContinuationInvoker
+{
+    typedef decltype(std::declval<F&>()()) ResultType;
+
+    static ResultType Invoke(F& Function, T&&)
+    {
+        return Function();
+    }
+};
+template <typename F, typename T>
+struct TBKContinuationInvoker<F, T, decltype(void(std::declval<F&>()(std::declval<T&&>())))>
+{
+    typedef decltype(std::declval<F&>()(std::declval<T&&>())) ResultType;
+
+    static ResultType Invoke(F& Function, T&& Value)
+    {
+        return Function(std::move(Value));
+    }
+};
+
+// Maps what a callable returns to the value of the future it produces: void becomes FBKVoid, BKFuture<U> is flattened to U.
+template <typename R>
+struct TBKFutureResult
+{
+    typedef R ValueType;
+
+    template <typename G>
+    static void Fulfil(BKPromise<ValueType>& Promise, G&& Call)
+    {
+        Promise.SetValue(Call());
+    }
+};
+template <>
+struct TBKFutureResult<void>
+{
+    typedef FBKVoid ValueType;
+
+    template <typename G>
+    static void Fulfil(BKPromise<ValueType>& Promise, G&& Call)
+    {
+        Call();
+        Promise.SetValue(FBKVoid());
+    }
+};
+template <typename U>
+struct TBKFutureResult<BKFuture<U>>
+{
+    typedef U ValueType;
+
+    template <typename G>
+    static void Fulfil(BKPromise<ValueType>& Promise, G&& Call)
+    {
+        BKFuture<U> Inner = Call();
+        Inner.ForwardTo(std::move(Promise));
+    }
+};
+
+// Continuation attached by BKFuture::Then/ThenAsync.
+template <typename T, typename F>
+struct TBKThenTask
+{
+    typedef TBKContinuationInvoker<F, T> FInvoker;
+    typedef TBKFutureResult<typename std::decay<typename FInvoker::ResultType>::type> FResult;
+
+    BKIntrusivePtr<FBKFutureState<T>> Source;
+    F Function;
+    BKPromise<typename FResult::ValueType> Next;
+
+    TBKThenTask(const BKIntrusivePtr<FBKFutureState<T>>& _Source, F&& _Function) : Source(_Source), Function(std::move(_Function))
+    {
+    }
+
+    void operator()()
+    {
+        if (Source->IsFailed())
+        {
+            Next.SetFailed(Source->GetError());
+            return;
+        }
+        FBKFutureState<T>* State = Source.Get();
+        F& Callable = Function;
+        FResult::Fulfil(Next, [State, &Callable]() { return FInvoker::Invoke(Callable, std::move(State->GetValue())); });
+    }
+};
+
+// Moves ThenAsync continuations onto the async task manager once their input is ready.
+template <typename TTask>
+struct TBKDispatchTask
+{
+    TTask Task;
+
+    explicit TBKDispatchTask(TTask&& _Task) : Task(std::move(_Task))
+    {
+    }
+
+    void operator()()
+    {
+        //Never waits for room in the lane: this runs on whichever thread completed the input, often a worker.
+        //A refused continuation runs inline, as with Then.
+        if (BKAsyncTaskManager::NewAsyncTask(std::move(Task), EBKTaskPriority::Normal, EBKOverloadPolicy::Reject)) return;
+        Task();
+    }
+};
+
+// Single-consumer result of an asynchronous operation. Then/ThenAsync consume the future; it is invalid afterwards.
+// A failure skips the continuations and travels down the chain until Recover or the final consumer sees it.
+template <typename T>
+class BKFuture
+{
+
+private:
+    BKIntrusivePtr<FBKFutureState<T>> State;
+
+    friend class BKPromise<T>;
+    template <typename U>
+    friend struct TBKFutureResult;
+    template <typename U>
+    friend struct FBKFutureAwaiter;
+
+    explicit BKFuture(const BKIntrusivePtr<FBKFutureState<T>>& _State) : State(_State)
+    {
+    }
+
+    BKFuture(const BKFuture&);
+    BKFuture& operator=(const BKFuture&);
+
+    struct FForwardTask
+    {
+        BKIntrusivePtr<FBKFutureState<T>> Source;
+        BKPromise<T> Target;
+
+        void operator()()
+        {
+            if (Source->IsFailed()) Target.SetFailed(Source->GetError());
+            else Target.SetValue(std::move(Source->GetValue()));
+        }
+    };
+
+    template <typename F>
+    struct FRecoverTask
+    {
+        BKIntrusivePtr<FBKFutureState<T>> Source;
+        F Function;
+        BKPromise<T> Next;
+
+        void operator()()
+        {
+            if (Source->IsFailed()) Next.SetValue(Function(Source->GetError()));
+            else Next.SetValue(std::move(Source->GetValue()));
+        }
+    };
+
+    void ForwardTo(BKPromise<T>&& Target)
+    {
+        if (!State.IsValid())
+        {
+            Target.SetFailed(FString(L"Continuation returned an invalid future."));
+            return;
+        }
+        BKIntrusivePtr<FBKFutureState<T>> Source = std::move(State);
+        Source->SetContinuation(FForwardTask{Source, std::move(Target)});
+    }
+
+public:
+    typedef T ValueType;
+
+    BKFuture() = default;
+    BKFuture(BKFuture&& Other) noexcept : State(std::move(Other.State))
+    {
+    }
+    BKFuture& operator=(BKFuture&& Other) noexcept
+    {
+        if (this != &Other) State = std::move(Other.State);
+        return *this;
+    }
+
+    bool IsValid() const
+    {
+        return State.IsValid();
+    }
+    bool IsReady() const
+    {
+        return State.IsValid() && State->IsReady();
+    }
+    bool IsFailed() const
+    {
+        return State.IsValid() && State->IsFailed();
+    }
+    FString GetError() const
+    {
+        return IsFailed() ? State->GetError() : FString(L"");
+    }
+
+    //Blocks the calling thread. Waiting on a worker for work queued behind it can deadlock; prefer Then there.
+    bool Wait(int32 TimeoutMs = -1) const
+    {
+        return State.IsValid() && State->Wait(TimeoutMs);
+    }
+
+    //Waits, then moves the value into OutValue. Returns false on timeout or failure; GetError() tells which failure.
+    bool Get(T& OutValue, int32 TimeoutMs = -1)
+    {
+        if (!Wait(TimeoutMs) || State->IsFailed()) return false;
+        OutValue = std::move(State->GetValue());
+        return true;
+    }
+
+    //Runs Function(Value) - or Function() - inline: right away if the value is ready, otherwise on the thread that sets it.
+    //Keep inline continuations short; use ThenAsync for heavy work.
+    template <typename F>
+    BKFuture<typename TBKThenTask<T, typename std::decay<F>::type>::FResult::ValueType> Then(F&& Function)
+    {
+        typedef TBKThenTask<T, typename std::decay<F>::type> FTask;
+
+        FTask Task(State, typename std::decay<F>::type(std::forward<F>(Function)));
+        auto Result = Task.Next.GetFuture();
+        if (!State.IsValid())
+        {
+            Task.Next.SetFailed(FString(L"Then was called on an invalid future."));
+            return Result;
+        }
+        BKIntrusivePtr<FBKFutureState<T>> Source = std::move(State);
+        Source->SetContinuation(std::move(Task));
+        return Result;
+    }
+
+    //Same as Then, but the continuation is queued on the async task manager once the value is ready.
+    //If the lane is full or the manager is not running it runs inline instead.
+    template <typename F>
+    BKFuture<typename TBKThenTask<T, typename std::decay<F>::type>::FResult::ValueType> ThenAsync(F&& Function)
+    {
+        typedef TBKThenTask<T, typename std::decay<F>::type> FTask;
+
+        FTask Task(State, typename std::decay<F>::type(std::forward<F>(Function)));
+        auto Result = Task.Next.GetFuture();
+        if (!State.IsValid())
+        {
+            Task.Next.SetFailed(FString(L"ThenAsync was called on an invalid future."));
+            return Result;
+        }
+        BKIntrusivePtr<FBKFutureState<T>> Source = std::move(State);
+        Source->SetContinuation(TBKDispatchTask<FTask>(std::move(Task)));
+        return Result;
+    }
+
+    //Turns a failure back into a value: Function(const FString& Error) must return T. Values pass through unchanged.
+    template <typename F>
+    BKFuture<T> Recover(F&& Function)
+    {
+        BKPromise<T> Next;
+        BKFuture<T> Result = Next.GetFuture();
+        if (!State.IsValid())
+        {
+            Next.SetValue(Function(FString(L"Recover was called on an invalid future.")));
+            return Result;
+        }
+        BKIntrusivePtr<FBKFutureState<T>> Source = std::move(State);
+        Source->SetContinuation(FRecoverTask<typename std::decay<F>::type>{Source, std::forward<F>(Function), std::move(Next)});
+        return Result;
+    }
+
+    template <typename U>
+    friend BKFuture<TArray<U>> BKWhenAll(TArray<BKFuture<U>>&& Futures);
+    template <typename U>
+    friend BKFuture<FBKWhenAnyResult<U>> BKWhenAny(TArray<BKFuture<U>>&& Futures);
+};
+
+template <typename T>
+BKFuture<typename std::decay<T>::type> BKMakeReadyFuture(T&& Value)
+{
+    BKPromise<typename std::decay<T>::type> Promise;
+    Promise.SetValue(std::forward<T>(Value));
+    return Promise.GetFuture();
+}
+
+template <typename T>
+BKFuture<T> BKMakeFailedFuture(const FString& Reason)
+{
+    BKPromise<T> Promise;
+    Promise.SetFailed(Reason);
+    return Promise.GetFuture();
+}
+
+// Runs Callable() on the async task manager; what it returns (void, a value or another future) completes the result.
+// Does not wait for room in the lane: if the task is refused the result fails right away and Callable is not called.
+template <typename F>
+BKFuture<typename TBKFutureResult<typename std::decay<decltype(std::declval<typename std::decay<F>::type&>()())>::type>::ValueType> BKAsync(F&& Callable)
+{
+    typedef typename std::decay<F>::type FType;
+    typedef TBKFutureResult<typename std::decay<decltype(std::declval<FType&>()())>::type> FResult;
+
+    struct FAsyncTask
+    {
+        FType Function;
+        BKPromise<typename FResult::ValueType> Promise;
+
+        void operator()()
+        {
+            FResult::Fulfil(Promise, Function);
+        }
+    };
+
+    FAsyncTask Task{FType(std::forward<F>(Callable)), BKPromise<typename FResult::ValueType>()};
+    auto Result = Task.Promise.GetFuture();
+    if (!BKAsyncTaskManager::NewAsyncTask(std::move(Task), EBKTaskPriority::Normal, EBKOverloadPolicy::Reject))
+    {
+        Task.Promise.SetFailed(FString(L"Async task manager refused the task."));
+    }
+    return Result;
+}
+
+template <typename T>
+struct FBKWhenAllContext : public BKIntrusiveRefCounted
+{
+    TArray<BKIntrusivePtr<FBKFutureState<T>>> Sources;
+    std::atomic<int32> Remaining;
+    std::atomic<bool> bDone;
+    BKPromise<TArray<T>> Promise;
+
+    explicit FBKWhenAllContext(int32 Count) : Remaining(Count), bDone(false)
+    {
+    }
+};
+
+template <typename T>
+struct TBKWhenAllTask
+{
+    BKIntrusivePtr<FBKWhenAllContext<T>> Context;
+    int32 Index;
+
+    void operator()()
+    {
+        FBKFutureState<T>* Source = Context->Sources[Index].Get();
+        if (Source->IsFailed())
+        {
+            if (!Context->bDone.exchange(true)) Context->Promise.SetFailed(Source->GetError());
+            return;
+        }
+        if (Context->Remaining.fetch_sub(1, std::memory_order_acq_rel) == 1 && !Context->bDone.exchange(true))
+        {
+            TArray<T> Values;
+            Values.Reserve(Context->Sources.Num());
+            for (int32 i = 0; i < Context->Sources.Num(); i++)
+            {
+                Values.Add(std::move(Context->Sources[i]->GetValue()));
+            }
+            Context->Promise.SetValue(std::move(Values));
+        }
+    }
+};
+
+// Completes with every value in input order once all futures succeed, or with the first failure.
+template <typename T>
+BKFuture<TArray<T>> BKWhenAll(TArray<BKFuture<T>>&& Futures)
+{
+    BKIntrusivePtr<FBKWhenAllContext<T>> Context(new FBKWhenAllContext<T>(Futures.Num()));
+    auto Result = Context->Promise.GetFuture();
+    if (Futures.Num() == 0)
+    {
+        Context->Promise.SetValue(TArray<T>());
+        return Result;
+    }
+
+    Context->Sources.Reserve(Futures.Num());
+    for (int32 i = 0; i < Futures.Num(); i++)
+    {
+        if (!Futures[i].IsValid())
+        {
+            Context->Promise.SetFailed(FString(L"BKWhenAll was given an invalid future."));
+            return Result;
+        }
+        Context->Sources.Add(std::move(Futures[i].State));
+    }
+    //Sources is complete before the first continuation can read it.
+    for (int32 i = 0; i < Context->Sources.Num(); i++)
+    {
+        Context->Sources[i]->SetContinuation(TBKWhenAllTask<T>{Context, i});
+    }
+    Futures.Empty();
+    return Result;
+}
+
+template <typename T>
+struct FBKWhenAnyResult
+{
+    //Position of the first future that succeeded.
+    int32 Index;
+    T Value;
+
+    FBKWhenAnyResult(int32 _Index, T&& _Value) : Index(_Index), Value(std::move(_Value))
+    {
+    }
+};
+
+template <typename T>
+struct FBKWhenAnyContext : public BKIntrusiveRefCounted
+{
+    std::atomic<int32> Remaining;
+    std::atomic<bool> bDone;
+    BKPromise<FBKWhenAnyResult<T>> Promise;
+
+    explicit FBKWhenAnyContext(int32 Count) : Remaining(Count), bDone(false)
+    {
+    }
+};
+
+template <typename T>
+struct TBKWhenAnyTask
+{
+    BKIntrusivePtr<FBKWhenAnyContext<T>> Context;
+    BKIntrusivePtr<FBKFutureState<T>> Source;
+    int32 Index;
+
+    void operator()()
+    {
+        if (!Source->IsFailed())
+        {
+            if (!Context->bDone.exchange(true)) Context->Promise.SetValue(FBKWhenAnyResult<T>(Index, std::move(Source->GetValue())));
+        }
+        else if (Context->Remaining.fetch_sub(1, std::memory_order_acq_rel) == 1 && !Context->bDone.exchange(true))
+        {
+            Context->Promise.SetFailed(Source->GetError());
+        }
+    }
+};
+
+// Completes with the first value to arrive and its index. Fails only when every future failed, with the last reason.
+template <typename T>
+BKFuture<FBKWhenAnyResult<T>> BKWhenAny(TArray<BKFuture<T>>&& Futures)
+{
+    BKIntrusivePtr<FBKWhenAnyContext<T>> Context(new FBKWhenAnyContext<T>(Futures.Num()));
+    auto Result = Context->Promise.GetFuture();
+    if (Futures.Num() == 0)
+    {
+        Context->Promise.SetFailed(FString(L"BKWhenAny was given no futures."));
+        return Result;
+    }
+    for (int32 i = 0; i < Futures.Num(); i++)
+    {
+        if (!Futures[i].IsValid())
+        {
+            Context->Promise.SetFailed(FString(L"BKWhenAny was given an invalid future."));
+            return Result;
+        }
+    }
+    for (int32 i = 0; i < Futures.Num(); i++)
+    {
+        BKIntrusivePtr<FBKFutureState<T>> Source = std::move(Futures[i].State);
+        Source->SetContinuation(TBKWhenAnyTask<T>{Context, Source, i});
+    }
+    Futures.Empty();
+    return Result;
+}
+
+#endif //Pragma_Once_BKFuture
@@ -0,0 +1,187 @@
+// Copyright Burak Kara, All rights reserved.
+
+#ifndef Pragma_Once_BKParallel
+#define Pragma_Once_BKParallel
+
+#include "BKEngine.h"
+#include "BKAsyncTaskManager.h"
+#include "BKSharedPtr.h"
+#include "BKFutex.h"
+#include <atomic>
+#include <type_traits>
+
+//With an automatic grain size, each participant gets about this many chunks, so uneven chunks still balance out.
+#define BK_PARALLEL_CHUNKS_PER_WORKER 4
+
+// Shared by the calling thread and its helper tasks. Reference counted, because a helper may only start after the
+// loop has returned; it then finds no chunk left and just drops its reference.
+struct FBKParallelForState : public BKIntrusiveRefCounted
+{
+    typedef void (*FBKRangeInvoker)(const void* Body, int32 Begin, int32 End);
+
+    std::atomic<int32> NextChunk;
+    //Futex word; the thread finishing the last chunk wakes the caller.
+    std::atomic<uint32> RemainingChunks;
+
+    int32 Num;
+    int32 GrainSize;
+    int32 ChunkCount;
+
+    //Only called for a claimed chunk; the caller waits for every chunk, so Body outlives all calls.
+    const void* Body;
+    FBKRangeInvoker Invoker;
+
+    FBKParallelForState(int32 _Num, int32 _GrainSize, int32 _ChunkCount, const void* _Body, FBKRangeInvoker _Invoker)
+            : NextChunk(0), RemainingChunks(static_cast<uint32>(_ChunkCount)), Num(_Num), GrainSize(_GrainSize), ChunkCount(_ChunkCount), Body(_Body), Invoker(_Invoker)
+    {
+    }
+
+    void RunChunks()
+    {
+        while (true)
+        {
+            int32 Chunk = NextChunk.fetch_add(1, std::memory_order_relaxed);
+            if (Chunk >= ChunkCount) return;
+
+            int32 Begin = Chunk * GrainSize;
+            int32 End = Num - Begin > GrainSize ? Begin + GrainSize : Num;
+            Invoker(Body, Begin, End);
+
+            if (RemainingChunks.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                BKFutex::WakeAll(&RemainingChunks);
+            }
+        }
+    }
+    void WaitForChunks()
+    {
+        uint32 Remaining;
+        while ((Remaining = RemainingChunks.load(std::memory_order_acquire)) != 0)
+        {
+            BKFutex::Wait(&RemainingChunks, Remaining);
+        }
+    }
+};
+
+template <typename F>
+struct TBKRangeInvoker
+{
+    static void Invoke(const void* Body, int32 Begin, int32 End)
+    {
+        (*static_cast<const F*>(Body))(Begin, End);
+    }
+};
+
+inline int32 BKGetParallelGrainSize(int32 Num, int32 GrainSize)
+{
+    if (GrainSize > 0) return GrainSize;
+
+    int32 Participants = BKAsyncTaskManager::GetWorkerCount() + 1;
+    int32 Chunks = Participants * BK_PARALLEL_CHUNKS_PER_WORKER;
+    return Num > Chunks ? (Num + Chunks - 1) / Chunks : 1;
+}
+
+//Calls Body(Begin, End) for consecutive ranges of at most GrainSize indices covering [0, Num), on the async workers
+//and on the calling thread, and returns when every range is done. GrainSize <= 0 picks one from the worker count.
+//Ranges that fit in a single grain, or run while the task manager is stopped, run inline without allocating.
+template <typename F>
+void BKParallelForRange(int32 Num, int32 GrainSize, const F& Body, EBKTaskPriority Priority = EBKTaskPriority::Normal)
+{
+    if (Num <= 0) return;
+
+    GrainSize = BKGetParallelGrainSize(Num, GrainSize);
+    const int32 ChunkCount = (Num + GrainSize - 1) / GrainSize;
+    const int32 WorkerCount = BKAsyncTaskManager::GetWorkerCount();
+    if (ChunkCount <= 1 || WorkerCount == 0)
+    {
+        Body(0, Num);
+        return;
+    }
+
+    BKIntrusivePtr<FBKParallelForState> State(new FBKParallelForState(Num, GrainSize, ChunkCount, &Body, &TBKRangeInvoker<F>::Invoke));
+
+    const int32 HelperCount = ChunkCount - 1 < WorkerCount ? ChunkCount - 1 : WorkerCount;
+    {
+        BKAsyncTaskBatch Helpers(Priority);
+        for (int32 i = 0; i < HelperCount; i++)
+        {
+            Helpers.Add([State]()
+            {
+                State->RunChunks();
+            });
+        }
+    }
+
+    State->RunChunks();
+    State->WaitForChunks();
+}
+
+//Calls Body(Index) for every index in [0, Num).
+template <typename F>
+void BKParallelFor(int32 Num, int32 GrainSize, const F& Body, EBKTaskPriority Priority = EBKTaskPriority::Normal)
+{
+    BKParallelForRange(Num, GrainSize, [&Body](int32 Begin, int32 End)
+    {
+        for (int32 i = Begin; i < End; i++)
+        {
+            Body(i);
+        }
+    }, Priority);
+}
+
+//Calls Body(Element) for every element. The array must not be resized meanwhile; for a BKHashMap, iterate a
+//snapshot taken with GenerateKeyArray or GenerateValueArray.
+template <typename T, typename F>
+void BKParallelFor(TArray<T>& Array, int32 GrainSize, const F& Body, EBKTaskPriority Priority = EBKTaskPriority::Normal)
+{
+    BKParallelForRange(Array.Num(), GrainSize, [&Array, &Body](int32 Begin, int32 End)
+    {
+        for (int32 i = Begin; i < End; i++)
+        {
+            Body(Array[i]);
+        }
+    }, Priority);
+}
+
+//Folds Map(Index) over [0, Num) with Combine, starting every range from Identity. Range results are combined in index
+//order, so Combine only has to be associative.
+template <typename T, typename MapF, typename CombineF>
+T BKParallelReduce(int32 Num, int32 GrainSize, const T& Identity, const MapF& Map, const CombineF& Combine, EBKTaskPriority Priority = EBKTaskPriority::Normal)
+{
+    static_assert(!std::is_same<T, bool>::value, "BKParallelReduce: TArray<bool> cannot be written from several threads.");
+
+    if (Num <= 0) return Identity;
+
+    GrainSize = BKGetParallelGrainSize(Num, GrainSize);
+    const int32 ChunkCount = (Num + GrainSize - 1) / GrainSize;
+    if (ChunkCount <= 1 || BKAsyncTaskManager::GetWorkerCount() == 0)
+    {
+        T Result = Identity;
+        for (int32 i = 0; i < Num; i++)
+        {
+            Result = Combine(Result, Map(i));
+        }
+        return Result;
+    }
+
+    TArray<T> Partials;
+    Partials.SetNum(ChunkCount);
+    BKParallelForRange(Num, GrainSize, [&](int32 Begin, int32 End)
+    {
+        T Partial = Identity;
+        for (int32 i = Begin; i < End; i++)
+        {
+            Partial = Combine(Partial, Map(i));
+        }
+        Partials[Begin / GrainSize] = Partial;
+    }, Priority);
+
+    T Result = Identity;
+    for (int32 i = 0; i < ChunkCount; i++)
+    {
+        Result = Combine(Result, Partials[i]);
+    }
+    return Result;
+}
+
+#endif //Pragma_Once_BKParallel
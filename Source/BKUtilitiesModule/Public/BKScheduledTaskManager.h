@@ -5,7 +5,21 @@
 
 #include "BKEngine.h"
 #include "BKTaskDefines.h"
-#include "BKSafeQueue.h"
+
+#define TIMER_HANDLE_SLOT_BITS 20
+//Returned by NewScheduledAsyncTask when WaitFor is 0 and the task went straight to BKAsyncTaskManager. Timer handles
+//never have a zero generation, so this is never a valid handle.
+#define SCHEDULED_TASK_DISPATCHED 1
+
+class BKTimerWheel;
+struct FBKTimerNode;
+
+struct FBKTimerSlot
+{
+    FBKTimerNode* Node = nullptr;
+    uint32 Generation = 1;
+    int32 NextFreeSlot = INDEX_NONE;
+};
 
 class BKScheduledAsyncTaskManager
 {
@@ -16,7 +30,10 @@ public:
 
     static bool IsSystemStarted();
 
-    static uint32 NewScheduledAsyncTask(BKFutureAsyncTask NewTask, TArray<BKAsyncTaskParameter*>& TaskParameters, uint32 WaitFor, bool bLoop, bool bDoNotDeallocateParameters = false);
+    //Returns a handle for CancelScheduledAsyncTask, SCHEDULED_TASK_DISPATCHED when WaitFor is 0 and the task was queued
+    //right away, or 0 if it was refused; TaskParameters are then deallocated unless bDoNotDeallocateParameters is set.
+    //Expired tasks run on BKAsyncTaskManager workers in the Priority lane when it is started; loop tasks are re-armed after their callback returns.
+    static uint32 NewScheduledAsyncTask(BKFutureAsyncTask NewTask, TArray<BKAsyncTaskParameter*>& TaskParameters, uint32 WaitFor, bool bLoop, bool bDoNotDeallocateParameters = false, EBKTaskPriority Priority = EBKTaskPriority::Normal);
     static void CancelScheduledAsyncTask(uint32 TaskUniqueIx);
 
 private:
@@ -24,14 +41,35 @@ private:
 
     void TickerRun();
     uint32 TickerStop();
-    BKMutex Ticker_Mutex;
+
+    //Static so that callbacks still running on workers can finish safely after EndSystem.
+    static BKMutex Ticker_Mutex;
 
     BKThread* TickThread = nullptr;
 
     uint32 SleepMsBetweenCheck = 50;
 
-    BKSafeQueue<FBKAwaitingTask*> AwaitingScheduledTasks;
-    TArray<uint32> CancelledScheduledTasks;
+    BKTimerWheel* TimerWheel = nullptr;
+    uint64 StartTimestampMs = 0;
+    uint64 GetCurrentTick() const;
+
+    //Handle = generation << TIMER_HANDLE_SLOT_BITS | slot index; a stale handle never matches a reused slot.
+    TArray<FBKTimerSlot> TimerSlots;
+    int32 FirstFreeTimerSlot = INDEX_NONE;
+
+    FBKTimerNode* AllocateTimer(FBKAwaitingTask* Task);
+    FBKTimerNode* FindTimer(uint32 Handle);
+    //Frees the slot only; the caller deallocates the node after releasing Ticker_Mutex.
+    void ReleaseTimer(FBKTimerNode* Node);
+
+    static void DispatchTimer(FBKTimerNode* Node);
+    static void RunTimer(FBKTimerNode* Node);
+    //For an expired timer that could not be run: schedules it again for the next tick.
+    static void RearmTimer(FBKTimerNode* Node);
+    //Never called under Ticker_Mutex: destroying a task that did not run may resume a coroutine (see BKSleepFor).
+    static void DeallocateTimer(FBKTimerNode* Node);
+    static void DeallocateParameters(TArray<BKAsyncTaskParameter*>& Parameters);
+    friend struct FBKTimerDispatch;
 
     static BKScheduledAsyncTaskManager* ManagerInstance;
 
@@ -43,9 +81,6 @@ private:
         return *this;
     }
 
-    uint32 CurrentTaskIx = 1;
-    BKMutex CurrentTaskIx_Mutex;
-
     void StartSystem_Internal(uint32 SleepDurationMs);
     void EndSystem_Internal();
 };
@@ -7,6 +7,33 @@
 #include "BKThread.h"
 #include "BKConditionVariable.h"
 #include <utility>
+#include <new>
+#include <cstddef>
+#include <type_traits>
+
+#define BK_INLINE_TASK_SIZE 64
+#define ASYNC_TASK_PRIORITY_COUNT 3
+
+// Lanes of BKAsyncTaskManager, highest priority first.
+enum class EBKTaskPriority : uint8
+{
+    //Work whose delay is visible to peers: UDP receive and ACK handling, retransmission sweeps.
+    LatencyCritical = 0,
+    Normal = 1,
+    //Housekeeping that can wait: heartbeats, deferred deletes.
+    Background = 2
+};
+
+// What a submission does when its lane already holds FBKTaskLaneOptions::MaxQueuedTasks.
+enum class EBKOverloadPolicy : uint8
+{
+    //Waits until the lane drains below the limit. Async workers are admitted instead, since they would wait on their own pool.
+    Block = 0,
+    //The task is discarded; for work that is worthless when late, like unreliable datagrams.
+    DropNewest = 1,
+    //The task is refused so the caller can report it, e.g. with a 503.
+    Reject = 2
+};
 
 class BKAsyncTaskParameter
 {
@@ -16,7 +43,88 @@ public:
     virtual ~BKAsyncTaskParameter() = default;
 };
 
-typedef std::function<void(TArray<BKAsyncTaskParameter*>)> BKFutureAsyncTask;
+typedef std::function<void(const TArray<BKAsyncTaskParameter*>&)> BKFutureAsyncTask;
+
+// Type-erased void() callable. Callables up to BK_INLINE_TASK_SIZE bytes are stored in place; bigger ones go to the heap.
+class FBKInlineTask
+{
+
+private:
+    typedef void (*FInvoker)(void*);
+    typedef void (*FDestroyer)(void*);
+
+    typename std::aligned_storage<BK_INLINE_TASK_SIZE, alignof(std::max_align_t)>::type Storage;
+
+    void* Target = nullptr;
+    FInvoker Invoker = nullptr;
+    FDestroyer Destroyer = nullptr;
+
+    template <typename FType>
+    static void Invoke(void* Callable)
+    {
+        (*static_cast<FType*>(Callable))();
+    }
+    template <typename FType>
+    static void DestroyInline(void* Callable)
+    {
+        static_cast<FType*>(Callable)->~FType();
+    }
+    template <typename FType>
+    static void DestroyHeap(void* Callable)
+    {
+        delete (static_cast<FType*>(Callable));
+    }
+
+    FBKInlineTask(const FBKInlineTask&);
+    FBKInlineTask& operator=(const FBKInlineTask&);
+
+public:
+    FBKInlineTask() = default;
+    ~FBKInlineTask()
+    {
+        Reset();
+    }
+
+    template <typename F>
+    void Bind(F&& Callable)
+    {
+        typedef typename std::decay<F>::type FType;
+
+        Reset();
+        if (sizeof(FType) <= BK_INLINE_TASK_SIZE && alignof(FType) <= alignof(std::max_align_t))
+        {
+            Target = new (&Storage) FType(std::forward<F>(Callable));
+            Destroyer = &DestroyInline<FType>;
+        }
+        else
+        {
+            Target = new FType(std::forward<F>(Callable));
+            Destroyer = &DestroyHeap<FType>;
+        }
+        Invoker = &Invoke<FType>;
+    }
+
+    void Reset()
+    {
+        if (Invoker)
+        {
+            Destroyer(Target);
+            Target = nullptr;
+            Invoker = nullptr;
+            Destroyer = nullptr;
+        }
+    }
+
+    bool IsBound() const
+    {
+        return Invoker != nullptr;
+    }
+
+    void operator()()
+    {
+        Invoker(Target);
+    }
+};
 
 struct FBKAwaitingTask
 {
@@ -27,6 +135,8 @@ public:
     bool bLoop = false;
     bool bDoNotDeallocateParameters = false;
 
+    EBKTaskPriority Priority = EBKTaskPriority::Normal;
+
     bool bQueued = false;
     double QueuedTimestamp = 0;
 
@@ -35,6 +145,28 @@ public:
     BKFutureAsyncTask FunctionPtr;
     TArray<BKAsyncTaskParameter*> Parameters;
 
+    //Used instead of FunctionPtr/Parameters when the task was created from a plain callable.
+    FBKInlineTask InlineFunction;
+
+    //For pooled tasks
+    FBKAwaitingTask() = default;
+
+    //Drops the callables but keeps the Parameters capacity for the next use.
+    void ResetForReuse()
+    {
+        PassedTimeMs = 0;
+        WaitTimeMs = 0;
+        bLoop = false;
+        bDoNotDeallocateParameters = false;
+        Priority = EBKTaskPriority::Normal;
+        bQueued = false;
+        QueuedTimestamp = 0;
+        TaskUniqueIx = 0;
+        FunctionPtr = nullptr;
+        Parameters.Reset();
+        InlineFunction.Reset();
+    }
+
     //For normal tasks
     FBKAwaitingTask(BKFutureAsyncTask& Function, TArray<BKAsyncTaskParameter*>& Array, bool _bDoNotDeallocateParameters = false)
     {
@@ -44,8 +176,9 @@ public:
     }
 
     //For scheduled tasks
-    FBKAwaitingTask(uint32 TaskIx, BKFutureAsyncTask& Function, TArray<BKAsyncTaskParameter*>& Array, uint32 _WaitTimeMs, bool _bLoop, bool _bDoNotDeallocateParameters = false)
+    FBKAwaitingTask(uint32 TaskIx, BKFutureAsyncTask& Function, TArray<BKAsyncTaskParameter*>& Array, uint32 _WaitTimeMs, bool _bLoop, bool _bDoNotDeallocateParameters = false, EBKTaskPriority _Priority = EBKTaskPriority::Normal)
     {
+        Priority = _Priority;
         TaskUniqueIx = TaskIx;
         FunctionPtr = Function;
         Parameters = Array;
@@ -0,0 +1,208 @@
+// Copyright Burak Kara, All rights reserved.
+
+#ifndef Pragma_Once_BKTaskMetrics
+#define Pragma_Once_BKTaskMetrics
+
+#include "BKEngine.h"
+#include "BKTaskDefines.h"
+#include <atomic>
+
+#define BK_HISTOGRAM_SUB_BUCKET_BITS 4
+#define BK_HISTOGRAM_SUB_BUCKET_COUNT (1 << BK_HISTOGRAM_SUB_BUCKET_BITS)
+//Values are clamped to 2^36 microseconds (about 19 hours).
+#define BK_HISTOGRAM_MAX_MAGNITUDE 36
+#define BK_HISTOGRAM_BUCKET_COUNT ((BK_HISTOGRAM_MAX_MAGNITUDE - BK_HISTOGRAM_SUB_BUCKET_BITS + 2) * BK_HISTOGRAM_SUB_BUCKET_COUNT)
+
+// Log-linear histogram of microsecond values, HDR style: every power of two is split into 16 linear buckets, so a
+// reported percentile is within 1/16 of the recorded value. Recording is lock-free and meant for a single writer
+// thread; readers take a consistent-enough copy with FBKHistogramSnapshot::Add.
+class BKLatencyHistogram
+{
+
+private:
+    std::atomic<uint64> Buckets[BK_HISTOGRAM_BUCKET_COUNT];
+    std::atomic<uint64> TotalCount;
+    std::atomic<uint64> TotalSum;
+    std::atomic<uint64> MaxValue;
+
+    BKLatencyHistogram(const BKLatencyHistogram&);
+    BKLatencyHistogram& operator=(const BKLatencyHistogram&);
+
+    friend struct FBKHistogramSnapshot;
+
+    //Single writer: a plain load and store avoids the locked instruction of fetch_add.
+    static void Bump(std::atomic<uint64>& Counter, uint64 Amount)
+    {
+        Counter.store(Counter.load(std::memory_order_relaxed) + Amount, std::memory_order_relaxed);
+    }
+
+public:
+    BKLatencyHistogram()
+    {
+        Reset();
+    }
+
+    static int32 GetBucketIndex(uint64 Value)
+    {
+        if (Value < BK_HISTOGRAM_SUB_BUCKET_COUNT) return static_cast<int32>(Value);
+
+        int32 Magnitude = 63;
+        while (!(Value >> Magnitude)) Magnitude--;
+        if (Magnitude > BK_HISTOGRAM_MAX_MAGNITUDE) return BK_HISTOGRAM_BUCKET_COUNT - 1;
+
+        const int32 Shift = Magnitude - BK_HISTOGRAM_SUB_BUCKET_BITS;
+        return (Shift + 1) * BK_HISTOGRAM_SUB_BUCKET_COUNT + static_cast<int32>((Value >> Shift) & (BK_HISTOGRAM_SUB_BUCKET_COUNT - 1));
+    }
+    static uint64 GetBucketLowerBound(int32 Index)
+    {
+        const int32 Group = Index / BK_HISTOGRAM_SUB_BUCKET_COUNT;
+        const uint64 SubBucket = static_cast<uint64>(Index % BK_HISTOGRAM_SUB_BUCKET_COUNT);
+        if (Group == 0) return SubBucket;
+        return (BK_HISTOGRAM_SUB_BUCKET_COUNT + SubBucket) << (Group - 1);
+    }
+
+    void Record(uint64 ValueUs)
+    {
+        Bump(Buckets[GetBucketIndex(ValueUs)], 1);
+        Bump(TotalCount, 1);
+        Bump(TotalSum, ValueUs);
+        if (ValueUs > MaxValue.load(std::memory_order_relaxed))
+        {
+            MaxValue.store(ValueUs, std::memory_order_relaxed);
+        }
+    }
+
+    //A value recorded concurrently may survive the reset.
+    void Reset()
+    {
+        for (std::atomic<uint64>& Bucket : Buckets)
+        {
+            Bucket.store(0, std::memory_order_relaxed);
+        }
+        TotalCount.store(0, std::memory_order_relaxed);
+        TotalSum.store(0, std::memory_order_relaxed);
+        MaxValue.store(0, std::memory_order_relaxed);
+    }
+};
+
+struct FBKHistogramSnapshot
+{
+    uint64 Buckets[BK_HISTOGRAM_BUCKET_COUNT];
+    uint64 TotalCount = 0;
+    uint64 TotalSum = 0;
+    uint64 MaxValue = 0;
+
+    FBKHistogramSnapshot()
+    {
+        for (uint64& Bucket : Buckets) Bucket = 0;
+    }
+
+    void Add(const BKLatencyHistogram& Histogram)
+    {
+        for (int32 i = 0; i < BK_HISTOGRAM_BUCKET_COUNT; i++)
+        {
+            Buckets[i] += Histogram.Buckets[i].load(std::memory_order_relaxed);
+        }
+        TotalCount += Histogram.TotalCount.load(std::memory_order_relaxed);
+        TotalSum += Histogram.TotalSum.load(std::memory_order_relaxed);
+        uint64 OtherMax = Histogram.MaxValue.load(std::memory_order_relaxed);
+        if (OtherMax > MaxValue) MaxValue = OtherMax;
+    }
+    void Add(const FBKHistogramSnapshot& Other)
+    {
+        for (int32 i = 0; i < BK_HISTOGRAM_BUCKET_COUNT; i++)
+        {
+            Buckets[i] += Other.Buckets[i];
+        }
+        TotalCount += Other.TotalCount;
+        TotalSum += Other.TotalSum;
+        if (Other.MaxValue > MaxValue) MaxValue = Other.MaxValue;
+    }
+
+    double GetMeanUs() const
+    {
+        return TotalCount > 0 ? static_cast<double>(TotalSum) / static_cast<double>(TotalCount) : 0;
+    }
+    //Percentile in [0, 100]. Returns the lower bound of the bucket holding it, capped at the recorded maximum.
+    uint64 GetPercentileUs(double Percentile) const
+    {
+        if (TotalCount == 0) return 0;
+
+        uint64 Rank = static_cast<uint64>(Percentile / 100.0 * static_cast<double>(TotalCount) + 0.5);
+        if (Rank < 1) Rank = 1;
+        if (Rank > TotalCount) Rank = TotalCount;
+
+        uint64 Seen = 0;
+        for (int32 i = 0; i < BK_HISTOGRAM_BUCKET_COUNT; i++)
+        {
+            Seen += Buckets[i];
+            if (Seen >= Rank)
+            {
+                uint64 Value = BKLatencyHistogram::GetBucketLowerBound(i);
+                return Value < MaxValue ? Value : MaxValue;
+            }
+        }
+        return MaxValue;
+    }
+};
+
+struct FBKWorkerUtilization
+{
+    int32 WorkerIndex = 0;
+    //INDEX_NONE for shared workers.
+    int32 ReservedLane = INDEX_NONE;
+    uint64 ExecutedTasks = 0;
+    //Time spent running tasks over the time since the last reset (or the worker's start).
+    double BusyRatio = 0;
+};
+
+struct FBKTaskMetricsSnapshot
+{
+    //Time covered by the counters, since the last BKTaskMetrics::Reset.
+    double IntervalMs = 0;
+
+    //Per EBKTaskPriority. Queue wait only covers tasks that had to queue.
+    FBKHistogramSnapshot QueueWait[ASYNC_TASK_PRIORITY_COUNT];
+    FBKHistogramSnapshot Execution[ASYNC_TASK_PRIORITY_COUNT];
+    int32 QueuedTasks[ASYNC_TASK_PRIORITY_COUNT] = {0, 0, 0};
+
+    TArray<FBKWorkerUtilization> Workers;
+
+    //Executed tasks per second over IntervalMs.
+    double GetThroughput(EBKTaskPriority Priority) const
+    {
+        return IntervalMs > 0 ? static_cast<double>(Execution[static_cast<int32>(Priority)].TotalCount) * 1000.0 / IntervalMs : 0;
+    }
+    double GetAverageBusyRatio() const
+    {
+        if (Workers.Num() == 0) return 0;
+        double Sum = 0;
+        for (int32 i = 0; i < Workers.Num(); i++) Sum += Workers[i].BusyRatio;
+        return Sum / Workers.Num();
+    }
+};
+
+// Queue wait and execution histograms of BKAsyncTaskManager, recorded per thread and merged on read.
+class BKTaskMetrics
+{
+
+public:
+    static void RecordQueueWait(EBKTaskPriority Priority, uint64 WaitUs);
+    static void RecordExecution(EBKTaskPriority Priority, uint64 DurationUs);
+
+    //A snapshot is about 26 KB; keep one around rather than putting it on a small stack.
+    static void GetSnapshot(FBKTaskMetricsSnapshot& OutSnapshot);
+    //Clears the histograms, the lane statistics and the worker utilization, and starts a new interval.
+    static void Reset();
+
+    static FString ToString(const FBKTaskMetricsSnapshot& Snapshot);
+
+    //Prints ToString every IntervalMs from a background-lane scheduled task; optionally resets after every dump.
+    static void StartPeriodicDump(uint32 IntervalMs, bool bResetAfterDump = true);
+    static void StopPeriodicDump();
+
+private:
+    static uint32 DumpTaskHandle;
+};
+
+#endif //Pragma_Once_BKTaskMetrics
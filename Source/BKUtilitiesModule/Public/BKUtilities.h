@@ -161,6 +161,9 @@ public:
     static uint32 GetSafeTimeStampInMS();
     static double GetTimeStampInMSDetailed();
 
+    //Never goes backwards; only meaningful for measuring intervals.
+    static uint64 GetMonotonicTimeStampInMS();
+
     static FString WGetSafeErrorMessage();
     static FString WGenerateMD5HashFromString(const FString& RawData);
     static FString WGenerateMD5Hash(const TArray<uint8>& RawData);